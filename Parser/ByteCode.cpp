@@ -0,0 +1,663 @@
+#include "ByteCode.h"
+#include "ControlFlow.h"
+
+// The relop which holds when relop does not. Branches compare integers, so one of them always holds.
+static int InvertRelop(int relop)
+{
+	switch(relop)
+	{
+	case GREATER:	return LTEQ;
+	case LESS:		return GTEQ;
+	case GTEQ:		return LESS;
+	case LTEQ:		return GREATER;
+	case EQUAL:		return NOTEQUAL;
+	case NOTEQUAL:	return EQUAL;
+	}
+
+	return relop;
+}
+
+ByteCode::ByteCode(Variables* variables)
+{
+	m_variables		= variables;
+	m_stringType	= TYPE_UNKNOWN;
+	m_nativeEnabled	= true;
+	m_indexPolicy	= INDEX_GROW;
+	m_failed		= false;
+	m_optimized		= false;
+	m_executedCount	= 0;
+	m_lookupCount	= 0;
+}
+
+ByteCode::~ByteCode()
+{
+}
+
+void ByteCode::Clear()
+{
+	m_code.clear();
+	m_slots.clear();
+	m_accesses.clear();
+	m_slotIDs.clear();
+	m_frame.clear();
+	m_frameVariables.clear();
+	m_types.clear();
+	m_typeNames.clear();
+	m_native.Clear();
+	m_controlFlow.Clear();
+	m_blocks.clear();
+	m_positions.clear();
+	m_jumps.clear();
+	m_optimized = false;
+	m_arrays.clear();
+	m_frameIDs.clear();
+}
+
+bool ByteCode::Lower(statementNode* program)
+{
+	Clear();
+	if(!m_variables)
+		return false;
+
+	string stringType(TOKENS[PRIM_STRING]);
+	m_stringType = m_variables->GetTypeIDNumber(stringType);
+
+	if(!m_controlFlow.Build(program))
+		return false;
+
+	const vector<int>& layout = m_controlFlow.GetLayout();
+	vector<vector<Instruction> > blocks(m_controlFlow.GetBlockCount());	// The instructions of each block, by ID.
+
+	// No-ops and gotos are left out, and a block falling through to the one after it needs no jump.
+	for(vector<int>::const_iterator it = layout.begin(); it != layout.end(); it++)
+	{
+		const BasicBlock& block = m_controlFlow.GetBlock(*it);
+
+		for(vector<statementNode*>::const_iterator statement = block.statements.begin(); statement != block.statements.end(); statement++)
+		{
+			Instruction instruction;
+			if(!LowerStatement(*statement, block, instruction))
+				return false;
+
+			blocks[*it].push_back(instruction);
+		}
+	}
+
+	if(!BindSlots())
+		return false;
+
+	// The instructions of each block may be rewritten, but a branch stays last.
+	if(!m_controlFlow.HasLoops())
+		m_blocks = blocks;
+	m_optimized = m_ssa.Optimize(m_controlFlow, blocks, m_slots, m_types, m_variables);
+
+	LayOut(blocks);
+
+	// The byte code still runs any program which is not translated.
+	if(m_nativeEnabled && m_native.Compile(m_code, m_slots, m_types, m_frame.size()))
+		m_optimized = true;
+
+	return true;
+}
+
+bool ByteCode::FindRange(statementNode* first, statementNode* last, BlockRange& range)
+{
+	return (IsLowered() && !m_blocks.empty() && m_controlFlow.FindRange(first, last, range));
+}
+
+bool ByteCode::Patch(const BlockRange& range, statementNode* first, statementNode* last)
+{
+	if(!IsLowered() || m_blocks.empty())
+		return false;
+
+	vector<Instruction> instructions;
+	for(statementNode* node = first; node; node = (node == last) ? 0 : node->next)
+	{
+		if(node->stmt_type == NOOPSTMT)
+			continue;
+
+		Instruction instruction;
+		if(!LowerStatement(node, m_controlFlow.GetBlock(range.block), instruction))
+			return false;
+		instructions.push_back(instruction);
+	}
+
+	if(!BindSlots())
+		return false;
+	m_controlFlow.ReplaceRange(range, first, last);
+
+	// The rest of the program goes back to its instructions as lowered.
+	if(m_optimized)
+	{
+		m_native.Clear();
+		LayOut(m_blocks);
+		m_optimized = false;
+	}
+
+	vector<Instruction>& block = m_blocks[range.block];
+	block.erase(block.begin() + range.first, block.begin() + range.first + range.count);
+	block.insert(block.begin() + range.first, instructions.begin(), instructions.end());
+
+	int position = m_positions[range.block] + range.first;
+	m_code.erase(m_code.begin() + position, m_code.begin() + position + range.count);
+	m_code.insert(m_code.begin() + position, instructions.begin(), instructions.end());
+
+	// Blocks and jumps after the line move with it. No jump is inside the line.
+	int shift = (int)instructions.size() - range.count;
+	if(shift)
+	{
+		for(vector<int>::iterator it = m_positions.begin(); it != m_positions.end(); it++)
+		{
+			if(*it > m_positions[range.block])
+				*it += shift;
+		}
+		for(vector<pair<int, int> >::iterator it = m_jumps.begin(); it != m_jumps.end(); it++)
+		{
+			if(it->first > position)
+				it->first += shift;
+			m_code[it->first].target = m_positions[it->second] - it->first;
+		}
+	}
+
+	// Threaded dispatch finds the handlers of every instruction again.
+	m_code[0].handler = 0;
+
+	return true;
+}
+
+bool ByteCode::LowerStatement(statementNode* node, const BasicBlock& block, Instruction& instruction)
+{
+	instruction.op		= 0;
+	instruction.target	= 0;
+	instruction.op1		= SLOT_NONE;
+	instruction.op2		= SLOT_NONE;
+	instruction.handler	= 0;
+
+	switch(node->stmt_type)
+	{
+	case PRINTSTMT:
+		if(!node->print_stmt || !node->print_stmt->id)
+			return false;
+		instruction.opcode	= BYTECODE_PRINT;
+		instruction.op1		= AddSlot(node->print_stmt->id);
+		break;
+
+	case ASSIGNSTMT:
+		{
+			assignmentStatement* assign = node->assign_stmt;
+			if(!assign || !assign->lhs || !assign->op1)
+				return false;
+			if(assign->op != 0 && assign->op != PLUS && assign->op != MINUS && assign->op != MULT && assign->op != DIV)
+				return false;
+			if(assign->op != 0 && !assign->op2)
+				return false;
+
+			instruction.op		= assign->op;
+			instruction.target	= AddSlot(assign->lhs);
+			instruction.op1		= AddSlot(assign->op1);
+			if(assign->op2)
+				instruction.op2	= AddSlot(assign->op2);
+
+			switch(assign->type)
+			{
+			case VALUE_INT:
+				// A division of integers is not an integer.
+				if(assign->op != DIV && IsIntSlot(instruction.op1) && (!assign->op2 || IsIntSlot(instruction.op2)))
+					instruction.opcode = BYTECODE_INT;
+				else
+					instruction.opcode = BYTECODE_TRUNCATE;
+				break;
+			case VALUE_REAL:	instruction.opcode = BYTECODE_REAL;		break;
+			case VALUE_NUMBER:	instruction.opcode = BYTECODE_NUMBER;	break;
+			case VALUE_STRING:	instruction.opcode = BYTECODE_CONCAT;	break;
+			default:			instruction.opcode = BYTECODE_ASSIGN;	break;
+			}
+			break;
+		}
+
+	case IFSTMT:
+		{
+			ifStatement* branch = node->if_stmt;
+			if(!branch || !branch->true_branch || !branch->false_branch || !branch->op1 || !branch->op2)
+				return false;
+			if(branch->relop != GREATER && branch->relop != LESS && branch->relop != NOTEQUAL &&
+				branch->relop != GTEQ && branch->relop != LTEQ && branch->relop != EQUAL)
+				return false;
+
+			// The branch jumps to the false branch, or with the opposite relop to the true branch when the false branch follows.
+			instruction.opcode	= BYTECODE_BRANCH;
+			instruction.op		= block.inverted ? InvertRelop(branch->relop) : branch->relop;
+			instruction.op1		= AddSlot(branch->op1);
+			instruction.op2		= AddSlot(branch->op2);
+			break;
+		}
+
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+void ByteCode::LayOut(const vector<vector<Instruction> >& blocks)
+{
+	const vector<int>& layout = m_controlFlow.GetLayout();
+	m_code.clear();
+	m_jumps.clear();
+	m_positions.assign(m_controlFlow.GetBlockCount(), 0);
+
+	for(vector<int>::const_iterator it = layout.begin(); it != layout.end(); it++)
+	{
+		const BasicBlock& block = m_controlFlow.GetBlock(*it);
+		m_positions[*it] = m_code.size();
+
+		for(vector<Instruction>::const_iterator instruction = blocks[*it].begin(); instruction != blocks[*it].end(); instruction++)
+		{
+			if(instruction->opcode == BYTECODE_BRANCH)
+				m_jumps.push_back(make_pair((int)m_code.size(), block.successors[block.inverted ? 0 : 1]));
+			m_code.push_back(*instruction);
+		}
+
+		// The end of the program, or a jump to a block which does not follow.
+		if(block.jump == BLOCK_NONE)
+			continue;
+
+		Instruction end;
+		end.opcode	= (block.jump == BLOCK_END) ? BYTECODE_HALT : BYTECODE_JUMP;
+		end.op		= 0;
+		end.target	= 0;
+		end.op1		= SLOT_NONE;
+		end.op2		= SLOT_NONE;
+		end.handler	= 0;
+		if(block.jump != BLOCK_END)
+			m_jumps.push_back(make_pair((int)m_code.size(), block.jump));
+		m_code.push_back(end);
+	}
+
+	for(vector<pair<int, int> >::iterator it = m_jumps.begin(); it != m_jumps.end(); it++)
+	{
+		m_code[it->first].target = m_positions[it->second] - it->first;
+	}
+}
+
+// Every instruction ends by going to the next one with DISPATCH. With threaded
+// dispatch that is a jump to the handler stored in the instruction.
+#if BYTECODE_THREADED
+#define HANDLER(opcode)	handler_##opcode
+#define DISPATCH		executed++; goto *pc->handler
+#else
+#define HANDLER(opcode)	case opcode
+#define DISPATCH		continue
+#endif
+
+void ByteCode::Execute()
+{
+	if(m_code.empty())
+		return;
+
+#if BYTECODE_THREADED
+	// The handler of each opcode, stored in the instructions the first time they run.
+	static const void* handlers[] =
+	{
+		&&HANDLER(BYTECODE_HALT),
+		&&HANDLER(BYTECODE_PRINT),
+		&&HANDLER(BYTECODE_ASSIGN),
+		&&HANDLER(BYTECODE_BRANCH),
+		&&HANDLER(BYTECODE_JUMP),
+		&&HANDLER(BYTECODE_INT),
+		&&HANDLER(BYTECODE_TRUNCATE),
+		&&HANDLER(BYTECODE_REAL),
+		&&HANDLER(BYTECODE_NUMBER),
+		&&HANDLER(BYTECODE_CONCAT),
+	};
+	if(!m_code[0].handler)
+	{
+		for(vector<Instruction>::iterator it = m_code.begin(); it != m_code.end(); it++)
+			it->handler = handlers[it->opcode];
+	}
+#endif
+
+	unsigned long long lookups = m_variables->GetLookupCount();
+	unsigned long long executed = 0;
+
+	for(unsigned int i = 0; i < m_frame.size(); i++)
+		m_frame[i] = m_frameVariables[i]->GetValue(0);
+
+	m_failed = false;
+	const Instruction* pc = &m_code[0];
+	if(m_native.Run(m_frame, m_indexPolicy))
+	{
+		m_failed = m_native.HasFailed();
+		goto halt;
+	}
+
+	for(;;)
+	{
+		executed++;
+#if BYTECODE_THREADED
+		goto *pc->handler;
+#else
+		switch(pc->opcode)
+		{
+#endif
+		// An index out of range which stops the program is found before the instruction has any effect.
+		HANDLER(BYTECODE_PRINT):
+			{
+				Value& value = GetValue(m_slots[pc->op1]);
+				if(m_failed)
+					goto halt;
+				cout << value.ToString() << "\n";
+				pc++;
+				DISPATCH;
+			}
+
+		HANDLER(BYTECODE_ASSIGN):
+		HANDLER(BYTECODE_CONCAT):
+			Assign(*pc);
+			if(m_failed)
+				goto halt;
+			pc++;
+			DISPATCH;
+
+		HANDLER(BYTECODE_INT):
+		HANDLER(BYTECODE_TRUNCATE):
+		HANDLER(BYTECODE_REAL):
+		HANDLER(BYTECODE_NUMBER):
+			AssignTyped(*pc);
+			if(m_failed)
+				goto halt;
+			pc++;
+			DISPATCH;
+
+		HANDLER(BYTECODE_BRANCH):
+			{
+				// Compared as integers like execute_program does.
+				long long op1 = GetValue(m_slots[pc->op1]).ToInteger();
+				long long op2 = GetValue(m_slots[pc->op2]).ToInteger();
+				if(m_failed)
+					goto halt;
+
+				bool result = false;
+				switch(pc->op)
+				{
+				case GREATER:	result = (op1 > op2);	break;
+				case LESS:		result = (op1 < op2);	break;
+				case NOTEQUAL:	result = (op1 != op2);	break;
+				case GTEQ:		result = (op1 >= op2);	break;
+				case LTEQ:		result = (op1 <= op2);	break;
+				case EQUAL:		result = (op1 == op2);	break;
+				}
+
+				pc += result ? 1 : pc->target;
+				DISPATCH;
+			}
+
+		HANDLER(BYTECODE_JUMP):
+			pc += pc->target;
+			DISPATCH;
+
+		HANDLER(BYTECODE_HALT):
+			goto halt;
+#if !BYTECODE_THREADED
+		}
+#endif
+	}
+
+halt:
+	for(unsigned int i = 0; i < m_frame.size(); i++)
+		m_frameVariables[i]->GetValue(0) = m_frame[i];
+
+	m_executedCount	= executed;
+	m_lookupCount	= m_variables->GetLookupCount() - lookups;
+}
+
+int ByteCode::AddSlot(varAccess* access)
+{
+	pair<Variable*, Variable*> key(access->var, access->index);
+	map<pair<Variable*, Variable*>, int>::iterator it = m_slotIDs.find(key);
+	if(it != m_slotIDs.end())
+		return it->second;
+
+	// Slots are numbered on from those bound.
+	int slot = m_slots.size() + m_accesses.size();
+	m_accesses.push_back(*access);
+	m_slotIDs[key] = slot;
+
+	return slot;
+}
+
+static int AddFrame(Variable* var, vector<Variable*>& frameVariables, unordered_map<Variable*, int>& frameIDs)
+{
+	unordered_map<Variable*, int>::iterator it = frameIDs.find(var);
+	if(it != frameIDs.end())
+		return it->second;
+
+	frameVariables.push_back(var);
+	frameIDs[var] = frameVariables.size() - 1;
+
+	return frameVariables.size() - 1;
+}
+
+bool ByteCode::BindSlots()
+{
+	// Variables with more than one element, or read with an index, stay where they are.
+	for(vector<varAccess>::iterator it = m_accesses.begin(); it != m_accesses.end(); it++)
+	{
+		if(it->index || it->var->value.size() != 1)
+			m_arrays.insert(it->var);
+		if(it->index && it->index->value.size() != 1)
+			m_arrays.insert(it->index);
+	}
+
+	for(vector<varAccess>::iterator it = m_accesses.begin(); it != m_accesses.end(); it++)
+	{
+		// The type table is indexed by type ID, and the slots bound before keep their frame elements.
+		if(it->var->typeID < 0 || (m_arrays.count(it->var) && m_frameIDs.count(it->var)))
+			return false;
+		if(it->index && m_arrays.count(it->index) && m_frameIDs.count(it->index))
+			return false;
+
+		Slot slot;
+		slot.var		= it->var;
+		slot.frame		= m_arrays.count(it->var) ? FRAME_NONE : AddFrame(it->var, m_frameVariables, m_frameIDs);
+		slot.index		= 0;
+		slot.indexFrame	= FRAME_NONE;
+		slot.type		= it->var->typeID;
+		if(it->index && m_arrays.count(it->index))
+			slot.index = it->index;
+		else if(it->index)
+			slot.indexFrame = AddFrame(it->index, m_frameVariables, m_frameIDs);
+		m_slots.push_back(slot);
+	}
+	m_accesses.clear();
+	m_frame.resize(m_frameVariables.size());
+
+	map<int, string>* types = m_variables->GetTypes();
+	for(map<int, string>::iterator it = types->begin(); it != types->end(); it++)
+		m_typeNames.insert(it->second);
+
+	UpdateTypes();
+
+	return true;
+}
+
+void ByteCode::UpdateTypes()
+{
+	int typeCount = 0;
+	for(vector<Slot>::iterator it = m_slots.begin(); it != m_slots.end(); it++)
+		typeCount = max(typeCount, it->type + 1);
+
+	m_types.resize(typeCount);
+	for(int i = 0; i < typeCount; i++)
+	{
+		m_types[i].lowest		= m_variables->GetLowestType(i);
+		m_types[i].kind			= m_variables->GetValueKind(i);
+		m_types[i].primitive	= m_variables->TypeIsPrimitive(m_types[i].lowest);
+	}
+}
+
+Value& ByteCode::GetValue(const Slot& slot)
+{
+	if(slot.frame != FRAME_NONE)
+		return m_frame[slot.frame];
+
+	int index = 0;
+	if(slot.indexFrame != FRAME_NONE)
+		index = (int)m_frame[slot.indexFrame].ToInteger();
+	else if(slot.index)
+		index = (int)slot.index->GetValue(0).ToInteger();
+
+	if(index >= 0 && index < (int)slot.var->value.size())
+		return slot.var->value[index];
+
+	return Reach(slot, index);
+}
+
+Value& ByteCode::Reach(const Slot& slot, int index)
+{
+	if(index >= 0 && m_indexPolicy == INDEX_GROW)
+		return slot.var->GetValue(index);
+
+	if(!m_failed)
+		ReportIndex(slot.var, index);
+	m_failed = true;
+	m_outside = Value();
+
+	return m_outside;
+}
+
+void ByteCode::ReportIndex(Variable* array, long long index)
+{
+	cout << "P_ERROR: Index " << index << " is out of range for " << array->name << ".\n";
+}
+
+bool ByteCode::IsIntSlot(int slot)
+{
+	Variable* var = (slot < (int)m_slots.size()) ? m_slots[slot].var : m_accesses[slot - m_slots.size()].var;
+	return m_variables->GetValueKind(var->typeID) == VALUE_INT;
+}
+
+static double Calculate(int op, double op1, double op2)
+{
+	switch(op)
+	{
+	case PLUS:	return op1 + op2;
+	case MINUS:	return op1 - op2;
+	case MULT:	return op1 * op2;
+	case DIV:	return op1 / op2;
+	default:	return op1;
+	}
+}
+
+static long long CalculateInteger(int op, long long op1, long long op2)
+{
+	switch(op)
+	{
+	case PLUS:	return op1 + op2;
+	case MINUS:	return op1 - op2;
+	case MULT:	return op1 * op2;
+	default:	return op1;
+	}
+}
+
+static void SetNumber(Value& value, int kind, double number)
+{
+	// Stored the way SetValue converts a number for the type.
+	switch(kind)
+	{
+	case VALUE_INT:		value.SetInteger(TruncateNumber(number));	break;
+	case VALUE_REAL:	value.SetReal(number);						break;
+	default:			value.SetNumber(number);					break;
+	}
+}
+
+void ByteCode::Assign(const Instruction& instruction)
+{
+	const Slot& lhs = m_slots[instruction.target];
+	const Slot& slot1 = m_slots[instruction.op1];
+	const Slot* slot2 = (instruction.op2 != SLOT_NONE) ? &m_slots[instruction.op2] : 0;
+
+	// The types are only looked up when they were not known before the program ran.
+	bool text = (instruction.opcode == BYTECODE_CONCAT);
+	if(!text)
+	{
+		text = (m_types[lhs.type].lowest == m_stringType || m_types[slot1.type].lowest == m_stringType ||
+			(slot2 && m_types[slot2->type].lowest == m_stringType));
+	}
+
+	if(text)
+	{
+		Value result;
+		result.SetText(GetValue(slot1).ToString());
+		if(instruction.op == PLUS)
+			result.text.append(GetValue(*slot2).ToString());
+
+		if(!m_failed)
+			Store(lhs, result);
+		return;
+	}
+
+	double op1 = GetValue(slot1).ToNumber();
+	double op2 = slot2 ? GetValue(*slot2).ToNumber() : 0;
+	if(m_failed)
+		return;
+	SetNumber(GetValue(lhs), m_types[lhs.type].kind, Calculate(instruction.op, op1, op2));
+}
+
+void ByteCode::AssignTyped(const Instruction& instruction)
+{
+	// Each value is read before the next is looked up, as an element may be added to the same array.
+	Value& value1 = GetValue(m_slots[instruction.op1]);
+	bool integers = (value1.kind == VALUE_INT);
+	long long integer1 = integers ? value1.integer : 0;
+	double op1 = value1.ToNumber();
+
+	long long integer2 = 0;
+	double op2 = 0;
+	if(instruction.op2 != SLOT_NONE)
+	{
+		Value& value2 = GetValue(m_slots[instruction.op2]);
+		integers = integers && (value2.kind == VALUE_INT);
+		integer2 = integers ? value2.integer : 0;
+		op2 = value2.ToNumber();
+	}
+	if(m_failed)
+		return;
+
+	Value& result = GetValue(m_slots[instruction.target]);
+	switch(instruction.opcode)
+	{
+	case BYTECODE_INT:
+		// An operand set as text by SetVar is read like execute_program reads it.
+		if(integers)
+		{
+			result.SetInteger(CalculateInteger(instruction.op, integer1, integer2));
+			break;
+		}
+		// Fall through.
+	case BYTECODE_TRUNCATE:
+		SetNumber(result, VALUE_INT, Calculate(instruction.op, op1, op2));
+		break;
+	case BYTECODE_REAL:
+		SetNumber(result, VALUE_REAL, Calculate(instruction.op, op1, op2));
+		break;
+	default:
+		SetNumber(result, VALUE_NUMBER, Calculate(instruction.op, op1, op2));
+		break;
+	}
+}
+
+void ByteCode::Store(const Slot& slot, Value& value)
+{
+	// A type which is not yet known becomes PRIM_STRING, which changes the table.
+	SlotType& type = m_types[slot.type];
+	if(!type.primitive && type.lowest != m_stringType && m_variables->BindType(type.lowest, m_stringType))
+		UpdateTypes();
+
+	m_variables->ConvertText(value.text, m_types[slot.type].kind);
+
+	if(m_typeNames.count(value.text))
+		return;
+
+	GetValue(slot) = value;
+}
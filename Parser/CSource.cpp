@@ -0,0 +1,664 @@
+#include "CSource.h"
+#include <fstream>
+#include <limits>
+
+// What every translated program starts with. Value and ValueArray hold the variables which are not locals.
+static const char* runtime =
+	"#include <stdio.h>\n"
+	"#include <stdlib.h>\n"
+	"#include <string.h>\n"
+	"#include <math.h>\n"
+	"\n"
+	"#define VALUE_NUMBER\t0\n"
+	"#define VALUE_INT\t\t1\n"
+	"#define VALUE_REAL\t\t2\n"
+	"\n"
+	"typedef struct\n"
+	"{\n"
+	"\tint\t\t\tkind;\n"
+	"\tlong long\tinteger;\n"
+	"\tdouble\t\treal;\n"
+	"} Value;\n"
+	"\n"
+	"typedef struct\n"
+	"{\n"
+	"\tValue*\t\tvalues;\n"
+	"\tsize_t\t\tsize;\n"
+	"\tsize_t\t\tcapacity;\n"
+	"\tconst char*\tname;\n"
+	"} ValueArray;\n"
+	"\n";
+
+// The functions a translated program may call, each written after the ones it calls.
+struct RuntimeFunction
+{
+	const char*	name;
+	const char*	calls[3];
+	const char*	source;
+};
+
+#define RUNTIME_FUNCTION_COUNT	10
+
+static const RuntimeFunction runtimeFunctions[RUNTIME_FUNCTION_COUNT] =
+{
+	{
+		"initialize", {0},
+		"static void initialize(ValueArray* array, const char* name, const Value* values, size_t size)\n"
+		"{\n"
+		"\tarray->values\t\t= (Value*)malloc((size ? size : 1) * sizeof(Value));\n"
+		"\tarray->size\t\t\t= size;\n"
+		"\tarray->capacity\t\t= size;\n"
+		"\tarray->name\t\t\t= name;\n"
+		"\tif(!array->values)\n"
+		"\t\texit(1);\n"
+		"\tmemcpy(array->values, values, size * sizeof(Value));\n"
+		"}\n"
+	},
+	{
+		"value_at", {0},
+		"/* Elements are added up to the index, even to read one, unless GROW_ARRAYS is 0. Any other index stops the program. */\n"
+		"static Value* value_at(ValueArray* array, int index)\n"
+		"{\n"
+		"\tif(index < 0 || (!GROW_ARRAYS && (size_t)index >= array->size))\n"
+		"\t{\n"
+		"\t\tprintf(\"P_ERROR: Index %d is out of range for %s.\\n\", index, array->name);\n"
+		"\t\texit(0);\n"
+		"\t}\n"
+		"\n"
+		"\twhile((size_t)index >= array->size)\n"
+		"\t{\n"
+		"\t\tif(array->size == array->capacity)\n"
+		"\t\t{\n"
+		"\t\t\tarray->capacity\t= array->capacity ? array->capacity * 2 : 8;\n"
+		"\t\t\tarray->values\t= (Value*)realloc(array->values, array->capacity * sizeof(Value));\n"
+		"\t\t\tif(!array->values)\n"
+		"\t\t\t\texit(1);\n"
+		"\t\t}\n"
+		"\t\tarray->values[array->size].kind\t\t= VALUE_NUMBER;\n"
+		"\t\tarray->values[array->size].integer\t= 0;\n"
+		"\t\tarray->values[array->size].real\t\t= 0.0;\n"
+		"\t\tarray->size++;\n"
+		"\t}\n"
+		"\n"
+		"\treturn &array->values[index];\n"
+		"}\n"
+	},
+	{
+		"truncate_number", {0},
+		"/* A number as a PRIM_INT holds it: NaN is 0 and a number out of the range of long long is the nearest limit. */\n"
+		"static long long truncate_number(double number)\n"
+		"{\n"
+		"\tif(number != number)\n"
+		"\t\treturn 0;\n"
+		"\tif(number >= 9223372036854775808.0)\n"
+		"\t\treturn 9223372036854775807LL;\n"
+		"\tif(number < -9223372036854775808.0)\n"
+		"\t\treturn -9223372036854775807LL - 1;\n"
+		"\treturn (long long)number;\n"
+		"}\n"
+	},
+	{
+		"to_number", {0},
+		"static double to_number(const Value* value)\n"
+		"{\n"
+		"\treturn (value->kind == VALUE_INT) ? (double)value->integer : value->real;\n"
+		"}\n"
+	},
+	{
+		"to_integer", {"truncate_number"},
+		"static long long to_integer(const Value* value)\n"
+		"{\n"
+		"\treturn (value->kind == VALUE_INT) ? value->integer : truncate_number(value->real);\n"
+		"}\n"
+	},
+	{
+		"store", {"truncate_number"},
+		"static void store(Value* value, int kind, double number)\n"
+		"{\n"
+		"\tvalue->kind = kind;\n"
+		"\tif(kind == VALUE_INT)\n"
+		"\t\tvalue->integer = truncate_number(number);\n"
+		"\telse\n"
+		"\t\tvalue->real = number;\n"
+		"}\n"
+	},
+	{
+		"print_integer", {0},
+		"static void print_integer(long long number)\n"
+		"{\n"
+		"\tprintf(\"%lld\\n\", number);\n"
+		"}\n"
+	},
+	{
+		"print_number", {0},
+		"static void print_number(double number)\n"
+		"{\n"
+		"\tprintf(\"%g\\n\", number);\n"
+		"}\n"
+	},
+	{
+		"print_real", {0},
+		"/* A real always shows its decimal point. */\n"
+		"static void print_real(double number)\n"
+		"{\n"
+		"\tchar text[64];\n"
+		"\tsnprintf(text, sizeof(text) - 2, \"%g\", number);\n"
+		"\tif(!strchr(text, '.'))\n"
+		"\t\tstrcat(text, \".0\");\n"
+		"\tprintf(\"%s\\n\", text);\n"
+		"}\n"
+	},
+	{
+		"print_value", {"print_integer", "print_real", "print_number"},
+		"static void print_value(const Value* value)\n"
+		"{\n"
+		"\tswitch(value->kind)\n"
+		"\t{\n"
+		"\tcase VALUE_INT:\tprint_integer(value->integer);\tbreak;\n"
+		"\tcase VALUE_REAL:\tprint_real(value->real);\t\tbreak;\n"
+		"\tdefault:\t\t\tprint_number(value->real);\t\tbreak;\n"
+		"\t}\n"
+		"}\n"
+	}
+};
+
+// A C string literal holding text.
+static string FormatText(const string& text)
+{
+	string literal("\"");
+	for(string::const_iterator it = text.begin(); it != text.end(); it++)
+	{
+		if(*it == '"' || *it == '\\')
+			literal += '\\';
+		literal += *it;
+	}
+
+	return literal + "\"";
+}
+
+static const char* KindName(int kind)
+{
+	switch(kind)
+	{
+	case VALUE_INT:		return "VALUE_INT";
+	case VALUE_REAL:	return "VALUE_REAL";
+	default:			return "VALUE_NUMBER";
+	}
+}
+
+CSource::CSource()
+{
+}
+
+CSource::~CSource()
+{
+}
+
+void CSource::Clear()
+{
+	m_source.clear();
+	m_variables.clear();
+	m_order.clear();
+	m_indexed.clear();
+	m_stored.clear();
+	m_labels.clear();
+	m_calls.clear();
+}
+
+bool CSource::Translate(statementNode* program, Variables* variables, int indexPolicy)
+{
+	Clear();
+
+	// Statements are laid out in the order they run like ByteCode::Lower. A null statement jumps to a statement already laid out, or halts.
+	vector<pair<statementNode*, statementNode*> > layout;
+	set<statementNode*> placed;
+	vector<statementNode*> pending(1, program);
+
+	while(!pending.empty())
+	{
+		statementNode* node = pending.back();
+		pending.pop_back();
+		if(node && placed.count(node))
+			continue;
+
+		while(node && !placed.count(node))
+		{
+			placed.insert(node);
+			layout.push_back(make_pair(node, (statementNode*)0));
+
+			switch(node->stmt_type)
+			{
+			case NOOPSTMT:
+				node = node->next;
+				break;
+
+			case GOTOSTMT:
+				if(!node->goto_stmt || !node->goto_stmt->target)
+					return false;
+				node = node->goto_stmt->target;
+				break;
+
+			case PRINTSTMT:
+				if(!node->print_stmt || !node->print_stmt->id)
+					return false;
+				AddVariable(node->print_stmt->id->var, node->print_stmt->id->index != 0);
+				AddVariable(node->print_stmt->id->index, false);
+				node = node->next;
+				break;
+
+			case ASSIGNSTMT:
+				{
+					assignmentStatement* assign = node->assign_stmt;
+					if(!assign || !assign->lhs || !assign->op1)
+						return false;
+					if(assign->op != 0 && assign->op != PLUS && assign->op != MINUS && assign->op != MULT && assign->op != DIV)
+						return false;
+					if(assign->op != 0 && !assign->op2)
+						return false;
+
+					// Text, and types checked as the program runs, stay with execute_program.
+					if(assign->type != VALUE_INT && assign->type != VALUE_REAL && assign->type != VALUE_NUMBER)
+						return false;
+
+					varAccess* accesses[3] = {assign->lhs, assign->op1, assign->op2};
+					for(int i = 0; i < 3; i++)
+					{
+						if(accesses[i])
+						{
+							AddVariable(accesses[i]->var, accesses[i]->index != 0);
+							AddVariable(accesses[i]->index, false);
+						}
+					}
+					m_stored[assign->lhs->var].insert(assign->type);
+					node = node->next;
+					break;
+				}
+
+			case IFSTMT:
+				{
+					ifStatement* branch = node->if_stmt;
+					if(!branch || !branch->true_branch || !branch->false_branch || !branch->op1 || !branch->op2)
+						return false;
+					if(branch->relop != GREATER && branch->relop != LESS && branch->relop != NOTEQUAL &&
+						branch->relop != GTEQ && branch->relop != LTEQ && branch->relop != EQUAL)
+						return false;
+
+					varAccess* accesses[2] = {branch->op1, branch->op2};
+					for(int i = 0; i < 2; i++)
+					{
+						AddVariable(accesses[i]->var, accesses[i]->index != 0);
+						AddVariable(accesses[i]->index, false);
+					}
+
+					// The true branch follows the branch, the false branch is laid out later.
+					Label(branch->false_branch);
+					pending.push_back(branch->false_branch);
+					node = branch->true_branch;
+					break;
+				}
+
+			default:
+				return false;
+			}
+		}
+
+		if(node)
+			Label(node);
+		layout.push_back(make_pair((statementNode*)0, node));
+	}
+
+	if(!PrepareVariables(variables))
+		return false;
+
+	string tables;
+	string main;
+	DeclareVariables(tables, main);
+
+	for(vector<pair<statementNode*, statementNode*> >::iterator it = layout.begin(); it != layout.end(); it++)
+	{
+		if(it->first)
+		{
+			if(m_labels.count(it->first))
+				main += Label(it->first) + ":\n";
+			TranslateStatement(it->first, main);
+		}
+		else if(it->second)
+			main += "\tgoto " + Label(it->second) + ";\n";
+		else
+			main += "\tgoto halt;\n";
+	}
+
+	m_source = "/* Translated from a compiled program. */\n";
+	m_source += runtime;
+	m_source += (indexPolicy == INDEX_GROW) ? "#define GROW_ARRAYS\t1\n\n" : "#define GROW_ARRAYS\t0\n\n";
+
+	// Only the functions the program calls are written, so that a compiler does not warn about the others.
+	for(int i = RUNTIME_FUNCTION_COUNT - 1; i >= 0; i--)
+	{
+		if(m_calls.count(runtimeFunctions[i].name))
+		{
+			for(int call = 0; call < 3 && runtimeFunctions[i].calls[call]; call++)
+				m_calls.insert(runtimeFunctions[i].calls[call]);
+		}
+	}
+	for(int i = 0; i < RUNTIME_FUNCTION_COUNT; i++)
+	{
+		if(m_calls.count(runtimeFunctions[i].name))
+		{
+			m_source += runtimeFunctions[i].source;
+			m_source += "\n";
+		}
+	}
+
+	m_source += tables;
+	m_source += "int main(void)\n{\n";
+	m_source += main;
+	m_source += "halt:\n";
+	m_source += "\treturn 0;\n";
+	m_source += "}\n";
+
+	return true;
+}
+
+bool CSource::Write(const string& filename)
+{
+	if(m_source.empty())
+		return false;
+
+	ofstream file(filename.c_str());
+	if(!file.is_open())
+		return false;
+
+	file << m_source;
+	file.close();
+
+	return !file.fail();
+}
+
+bool CSource::Run(const string& path, const string& compiler)
+{
+	string source = path + ".c";
+#ifdef _WIN32
+	string program = path + ".exe";
+#else
+	// A name without a directory would be looked for on the PATH.
+	string program = (path.find('/') == string::npos) ? "./" + path : path;
+#endif
+
+	if(!Write(source))
+		return false;
+
+	string build = compiler + " -o \"" + program + "\" \"" + source + "\"";
+	if(system(build.c_str()) != 0)
+		return false;
+
+	// The program prints to the same console, after what was printed before it.
+	cout.flush();
+	fflush(stdout);
+
+	string run = "\"" + program + "\"";
+	return (system(run.c_str()) == 0);
+}
+
+void CSource::AddVariable(Variable* var, bool indexed)
+{
+	if(!var)
+		return;
+
+	if(m_variables.find(var) == m_variables.end())
+	{
+		CVariable& variable = m_variables[var];
+		variable.id		= m_order.size();
+		variable.kind	= VALUE_NUMBER;
+		variable.local	= false;
+		m_order.push_back(var);
+	}
+
+	if(indexed)
+		m_indexed[var] = true;
+}
+
+bool CSource::PrepareVariables(Variables* variables)
+{
+	for(map<Variable*, CVariable>::iterator it = m_variables.begin(); it != m_variables.end(); it++)
+	{
+		Variable* var = it->first;
+		for(vector<Value>::iterator value = var->value.begin(); value != var->value.end(); value++)
+		{
+			if(value->kind == VALUE_STRING)
+				return false;
+		}
+
+		// A local holds the kind of its type the whole time the program runs.
+		int kind = variables->GetValueKind(var->typeID);
+		bool local = (!m_indexed.count(var) && var->value.size() == 1 && var->value[0].kind == kind);
+
+		map<Variable*, set<int> >::iterator stored = m_stored.find(var);
+		if(stored != m_stored.end())
+			local = local && (stored->second.size() == 1 && *stored->second.begin() == kind);
+
+		it->second.kind		= kind;
+		it->second.local	= local;
+	}
+
+	return true;
+}
+
+string CSource::Read(varAccess* access, bool integer)
+{
+	CVariable& variable = m_variables[access->var];
+	stringstream ss;
+
+	if(variable.local)
+	{
+		if(variable.kind == VALUE_INT)
+			ss << (integer ? "" : "(double)") << "v" << variable.id;
+		else if(integer)
+			ss << Call("truncate_number") << "(v" << variable.id << ")";
+		else
+			ss << "v" << variable.id;
+	}
+	else
+		ss << Call(integer ? "to_integer" : "to_number") << "(" << Call("value_at") << "(&a" << variable.id << ", " << Index(access) << "))";
+
+	return ss.str();
+}
+
+string CSource::Call(const char* function)
+{
+	m_calls.insert(function);
+
+	return function;
+}
+
+string CSource::Index(varAccess* access)
+{
+	if(!access->index)
+		return "0";
+
+	varAccess index;
+	index.var	= access->index;
+	index.index	= 0;
+
+	return "(int)" + Read(&index, true);
+}
+
+string CSource::Label(statementNode* node)
+{
+	map<statementNode*, int>::iterator it = m_labels.find(node);
+	if(it == m_labels.end())
+		it = m_labels.insert(make_pair(node, (int)m_labels.size())).first;
+
+	stringstream ss;
+	ss << "s" << it->second;
+
+	return ss.str();
+}
+
+void CSource::DeclareVariables(string& tables, string& main)
+{
+	string declarations;
+	string initializations;
+	for(vector<Variable*>::iterator it = m_order.begin(); it != m_order.end(); it++)
+	{
+		Variable* var = *it;
+		CVariable& variable = m_variables[var];
+
+		// Names are only kept in comments. Internal names such as temp#1 are not C names.
+		string name = var->name;
+		for(string::size_type comment = name.find("*/"); comment != string::npos; comment = name.find("*/"))
+			name.erase(comment, 2);
+
+		stringstream ss;
+		if(variable.local)
+		{
+			Value& value = var->value[0];
+			if(variable.kind == VALUE_INT)
+				ss << "\tlong long v" << variable.id << " = " << FormatInteger(value.integer) << ";";
+			else
+				ss << "\tdouble v" << variable.id << " = " << FormatNumber(value.real) << ";";
+			ss << "\t/* " << name << " */\n";
+			declarations += ss.str();
+			continue;
+		}
+
+		// The values an array starts with are kept outside main, where a large table does not use the stack.
+		ss << "static const Value a" << variable.id << "_values[] =\t/* " << name << " */\n{\n";
+		for(vector<Value>::iterator value = var->value.begin(); value != var->value.end(); value++)
+		{
+			ss << "\t{" << KindName(value->kind) << ", " << FormatInteger(value->kind == VALUE_INT ? value->integer : 0) << ", " <<
+				FormatNumber(value->kind == VALUE_INT ? 0.0 : value->real) << "},\n";
+		}
+		if(var->value.empty())
+			ss << "\t{VALUE_NUMBER, 0LL, 0.0},\n";
+		ss << "};\n\n";
+		tables += ss.str();
+
+		stringstream declaration;
+		declaration << "\tValueArray a" << variable.id << ";\t/* " << name << " */\n";
+		declarations += declaration.str();
+
+		stringstream initialization;
+		initialization << "\t" << Call("initialize") << "(&a" << variable.id << ", " << FormatText(var->name) << ", a" << variable.id << "_values, " <<
+			var->value.size() << ");\n";
+		initializations += initialization.str();
+	}
+
+	main += declarations;
+	main += "\tdouble n1 = 0.0;\n";
+	main += "\tdouble n2 = 0.0;\n";
+	main += "\t(void)n1;\n";
+	main += "\t(void)n2;\n";
+	main += "\n";
+	main += initializations;
+	if(!initializations.empty())
+		main += "\n";
+}
+
+void CSource::TranslateStatement(statementNode* node, string& main)
+{
+	stringstream ss;
+
+	switch(node->stmt_type)
+	{
+	case PRINTSTMT:
+		{
+			varAccess* id = node->print_stmt->id;
+			CVariable& variable = m_variables[id->var];
+			if(!variable.local)
+				ss << "\t" << Call("print_value") << "(" << Call("value_at") << "(&a" << variable.id << ", " << Index(id) << "));\n";
+			else if(variable.kind == VALUE_INT)
+				ss << "\t" << Call("print_integer") << "(v" << variable.id << ");\n";
+			else if(variable.kind == VALUE_REAL)
+				ss << "\t" << Call("print_real") << "(v" << variable.id << ");\n";
+			else
+				ss << "\t" << Call("print_number") << "(v" << variable.id << ");\n";
+			break;
+		}
+
+	case ASSIGNSTMT:
+		{
+			// Each operand is read before the next is found, as reading an element may add to the same array.
+			assignmentStatement* assign = node->assign_stmt;
+			ss << "\tn1 = " << Read(assign->op1, false) << ";\n";
+			if(assign->op2)
+				ss << "\tn2 = " << Read(assign->op2, false) << ";\n";
+
+			string result;
+			switch(assign->op)
+			{
+			case PLUS:	result = "n1 + n2";	break;
+			case MINUS:	result = "n1 - n2";	break;
+			case MULT:	result = "n1 * n2";	break;
+			case DIV:	result = "n1 / n2";	break;
+			default:	result = "n1";		break;
+			}
+
+			CVariable& variable = m_variables[assign->lhs->var];
+			if(!variable.local)
+				ss << "\t" << Call("store") << "(" << Call("value_at") << "(&a" << variable.id << ", " << Index(assign->lhs) << "), " << KindName(assign->type) << ", " << result << ");\n";
+			else if(variable.kind == VALUE_INT)
+				ss << "\tv" << variable.id << " = " << Call("truncate_number") << "(" << result << ");\n";
+			else
+				ss << "\tv" << variable.id << " = " << result << ";\n";
+			break;
+		}
+
+	case IFSTMT:
+		{
+			// Compared as integers like execute_program does.
+			ifStatement* branch = node->if_stmt;
+			ss << "\tn1 = (double)" << Read(branch->op1, true) << ";\n";
+			ss << "\tn2 = (double)" << Read(branch->op2, true) << ";\n";
+
+			string relop;
+			switch(branch->relop)
+			{
+			case GREATER:	relop = ">";	break;
+			case LESS:		relop = "<";	break;
+			case NOTEQUAL:	relop = "!=";	break;
+			case GTEQ:		relop = ">=";	break;
+			case LTEQ:		relop = "<=";	break;
+			default:		relop = "==";	break;
+			}
+			ss << "\tif(!(n1 " << relop << " n2))\n";
+			ss << "\t\tgoto " << Label(branch->false_branch) << ";\n";
+			break;
+		}
+	}
+
+	main += ss.str();
+}
+
+string CSource::FormatNumber(double number)
+{
+	if(number != number)
+		return "NAN";
+	if(number == numeric_limits<double>::infinity())
+		return "HUGE_VAL";
+	if(number == -numeric_limits<double>::infinity())
+		return "(-HUGE_VAL)";
+
+	stringstream ss;
+	ss.precision(17);
+	ss << number;
+
+	// Kept a double in C.
+	string text = ss.str();
+	if(text.find_first_of(".e") == string::npos)
+		text.append(".0");
+
+	return text;
+}
+
+string CSource::FormatInteger(long long number)
+{
+	// The lowest value is not a literal.
+	if(number == numeric_limits<long long>::min())
+		return "(-9223372036854775807LL - 1)";
+
+	stringstream ss;
+	ss << number << "LL";
+
+	return ss.str();
+}
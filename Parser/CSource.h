@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: CSource.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _CSOURCE_H_
+#define _CSOURCE_H_
+
+#include "compiler.h"
+#include <set>
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: CSource
+//
+// The statements from CompleteParser::Compile translated to a C translation
+// unit which runs on its own. The statements are laid out in the order they
+// run like ByteCode::Lower, and branches and gotos become gotos to labels.
+// The values the variables hold when the program is translated become the
+// initial values of the C program.
+//
+// A variable which is never indexed, and which keeps the kind of its type,
+// becomes a local of that type. Other variables are arrays of values which
+// grow like Variable::GetValue. Only programs whose assignments all have a
+// numeric type found by CompleteParser::ResolveTypes, on variables which do
+// not hold text, are translated. The output matches execute_program.
+////////////////////////////////////////////////////////////////////////////////
+class CSource
+{
+public:
+	CSource();
+	~CSource();
+
+	bool Translate(statementNode* program,			// False when the program uses something which is not translated.
+		Variables* variables,
+		int indexPolicy = INDEX_GROW);				// INDEX_*, as the program runs in C.
+	bool Write(const string& filename);
+	bool Run(const string& path,					// Write path.c, build it with compiler and run it. The compiler takes -o like cc.
+		const string& compiler = "cc -O2");
+	void Clear();
+
+	bool IsTranslated() {return !m_source.empty();}
+	const string& GetSource() {return m_source;}
+
+private:
+	struct CVariable
+	{
+		int				id;							// Names the C variable v<id> or a<id>.
+		int				kind;						// The VALUE_* of a local.
+		bool			local;						// False for an array of values.
+	};
+
+	void AddVariable(Variable* var, bool indexed);
+	bool PrepareVariables(Variables* variables);	// Choose locals, and check the values held.
+	string Read(varAccess* access, bool integer);	// An expression reading access as a double or, like ToInteger, a long long.
+	string Call(const char* function);				// The name of a function of the runtime, which is then written with the program.
+	string Index(varAccess* access);
+	string Label(statementNode* node);
+	void DeclareVariables(string& tables,			// The tables arrays start from, and the start of main.
+		string& main);
+	void TranslateStatement(statementNode* node, string& main);
+
+	static string FormatNumber(double number);		// A C literal which reads back as number.
+	static string FormatInteger(long long number);
+
+	string								m_source;
+	map<Variable*, CVariable>			m_variables;
+	vector<Variable*>					m_order;	// The variables in the order they are first used.
+	map<Variable*, bool>				m_indexed;	// Variables read or written with an index.
+	map<Variable*, set<int> >			m_stored;	// The kinds each variable is assigned.
+	map<statementNode*, int>			m_labels;	// Statements which are jumped to.
+	set<string>							m_calls;	// Functions of the runtime the program calls.
+};
+
+#endif
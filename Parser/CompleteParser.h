@@ -6,6 +6,15 @@
 
 #include "compiler.h"
 #include "Input.h"
+#include "Lexer.h"
+#include "Symbols.h"
+#include "ParseTree.h"
+#include "ByteCode.h"
+#include "Optimizer.h"
+#include "ControlFlow.h"
+#include "TempAllocator.h"
+#include <deque>
+#include <set>
 
 // ID TYPE
 #define DIGIT				0
@@ -26,11 +35,53 @@
 // TOKEN_DEBUG
 #define PRINT_OUTPUT		1
 #define PRINT_RULES			0
+#define PRINT_CONFLICTS		0
 
 // Scoping
 #define SCOPING_OFF			0
 #define SCOPING_STATIC		1
 
+// Program tokenizer
+#define LEXER_LEGACY		0				// GetTokenType reading one char at a time from Input.
+#define LEXER_DFA			1				// Lexer tables built from the grammar terminals.
+
+// Parse engines
+#define PARSE_ENGINE_MATCH	0				// MatchLineToRule trying every ruleset of a key.
+#define PARSE_ENGINE_LL1	1				// Predictive parse with m_parseTable. Matching is used if the grammar is not LL(1).
+#define PARSE_ENGINE_GENERATED	2			// Parser source written by GenerateParser and set with SetGeneratedParser.
+#define PARSE_ENGINE_LALR	3				// Shift/reduce parse with m_lalrActions. Accepts left recursive rules.
+
+// LALR(1) actions. The low bits are the kind, the rest the state to shift to or the production to reduce.
+#define LALR_ERROR			0
+#define LALR_SHIFT			1
+#define LALR_REDUCE			2
+#define LALR_ACCEPT			3
+#define LALR_ACTION_BITS	2
+#define LALR_ACTION_MASK	3
+
+// Rule matcher
+#define USE_MATCH_MEMO		1				// MatchLineToRule keeps the result of each non-terminal at each token of a line.
+
+// Results of GeneratedParser::Parse.
+#define GENERATED_PARSE_DONE	0			// The tokens are a whole program.
+#define GENERATED_PARSE_MORE	1			// The tokens ran out before the program was complete.
+#define GENERATED_PARSE_ERROR	2			// The tokens can not start a program.
+
+// Results of GeneratedParser::Recall.
+#define GENERATED_MEMO_NONE		0			// The symbol was not parsed at this token yet.
+#define GENERATED_MEMO_MATCHED	1			// The earlier match was added again.
+#define GENERATED_MEMO_FAILED	2			// The symbol did not match here before.
+
+// Compiled grammar images
+#define USE_GRAMMAR_IMAGE	1				// ParserManager loads and saves an image, next to the grammar file by default.
+#define GRAMMAR_IMAGE_EXTENSION	".cache"		// Appended to the grammar file name.
+#define GRAMMAR_IMAGE_TEMP_EXTENSION	".tmp"	// The image is written to this file first.
+#define GRAMMAR_IMAGE_MAGIC	0x52474350		// "PCGR"
+#define GRAMMAR_IMAGE_VERSION	1				// Increase whenever the image layout or the grammar data changes.
+
+#define PARSE_TABLE_NONE	-1				// No ruleset for a non-terminal and token.
+#define PARSE_TABLE_EOF		RESERVED_COUNT	// The column of the EOF symbol. Other columns are token IDs.
+
 
 // Indices for tokens.
 #define TOKEN_UNKNOWN		-1
@@ -45,7 +96,7 @@
 #define TOKEN_ERR_NON_MODIFIABLE	4
 #define TOKEN_ERR_NON_REACHABLE		5
 
-#define BASE_NODE_TYPE				"program"
+#define BASE_NODE_TYPE				SYMBOL_PROGRAM
 
 using namespace std;
 
@@ -101,18 +152,8 @@ private:
 	bool		m_criticalError;			// Critical errors flag the program to abort processing.
 };
 
-struct StackMemory
-{
-	StackMemory()
-	{
-		mem = 0;
-	};
-	~StackMemory() {};
-
-	void* mem;
-};
-
 void InitializeStatementNode(statementNode* node);
+void ReleaseStatementNode(statementNode* node);		// Free what the statement points to, but not the statement.
 
 #define NODE_NOT_COMPLETE	0
 #define NODE_IS_COMPLETE	1
@@ -125,17 +166,135 @@ struct Node
 		closed = false;
 		complete = NODE_NOT_COMPLETE;
 		lineNumber = 0;
+		type = SYMBOL_NONE;
 	};
 
 	~Node() {};
 	vector<Node> nodes;						// Child nodes.
-	string type;					 		// The token this node represents.
+	int type;						 		// The symbol this node represents.
 	string value;							// The value of the node.
 	int lineNumber;							// The line number from the original code.
 	int complete;							// 1 when rule matched completely. 2 when partial match found.
 	bool closed;							// True when follow set matched.
 };
 
+void MoveNode(Node& from, Node& to);				// Give to the contents of from without copying the children.
+
+struct LineToken
+{
+	string value;							// The text of the token.
+	int tokenID;							// The ID from GetTokenID. Found once when the token is read.
+	int lineNumber;							// The line the token was read from.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// A line of the text given to ParseProgram. Lines end with a ';' or '}' like
+// the lines given to ParseLine, and start where the line before ended. An edit
+// inside the node which ends a line only parses and compiles that node again.
+////////////////////////////////////////////////////////////////////////////////
+struct ProgramLine
+{
+	unsigned int end;						// Offset in the program text after the token ending the line.
+	unsigned int tokenCount;				// Tokens in the line.
+	unsigned int nodeTokenCount;			// Tokens of node, which are the last ones of the line.
+	int lineNumber;							// The line number the parse gave the nodes of the line.
+	Node* node;								// The highest node ending with the line and starting in it. 0 if there is none.
+	bool declaration;						// The node is in a declaration section, which Compile evaluates first.
+	statementNode* first;					// The first and last of the statements compiled from node by GetProgram.
+	statementNode* last;					// 0 unless there are at least two.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// What MatchLineToRule did for a non-terminal at one token of a line. Replaying
+// it has the same effect on the line and the parent node as matching again.
+////////////////////////////////////////////////////////////////////////////////
+struct MatchMemoEntry
+{
+	bool matched;							// The return value.
+	bool completed;							// The parent node was marked NODE_IS_COMPLETE.
+	bool added;								// node was added to the parent.
+	unsigned int remaining;					// The size of the line afterwards.
+	int node;								// The node of m_tree added to the parent.
+};
+
+struct LALRProduction
+{
+	int key;								// The non-terminal the production reduces to. SYMBOL_NONE for the start production.
+	int ruleSet;							// Index of the ruleset in m_rules[key].
+	vector<int> symbols;					// The ruleset without epsilon and EOF.
+};
+
+struct ParseStackEntry
+{
+	int symbol;								// The symbol expected next. SYMBOL_NONE marks the end of node.
+	Node* node;								// The parent of the expected symbol, or the node being ended.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// The result of one non-terminal at one token, kept by GeneratedParser so a
+// ruleset tried again after backtracking is not parsed again.
+////////////////////////////////////////////////////////////////////////////////
+struct GeneratedMatch
+{
+	GeneratedMatch()
+	{
+		matched = false;
+		kept = false;
+		end = 0;
+	};
+
+	bool matched;							// True if the non-terminal matched.
+	bool kept;								// True if node holds the match. It is moved, not copied, in and out of the tree.
+	unsigned int end;						// Index of the token after the match.
+	Node node;								// The node built by the match, once it was taken out of the tree.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: GeneratedParser
+//
+// Base of the recursive descent parsers written by CompleteParser::GenerateParser.
+// Each non-terminal of the grammar becomes a function choosing its rulesets with
+// a switch on the next token. Where a token can start more than one ruleset,
+// each is tried and the one using the most tokens is kept. The tree built has
+// the same shape as the predictive engine.
+////////////////////////////////////////////////////////////////////////////////
+class GeneratedParser
+{
+public:
+	GeneratedParser();
+	virtual ~GeneratedParser();
+
+	virtual unsigned long long GetSignature() = 0;	// CompleteParser::GetGrammarSignature of the grammar it was generated from.
+	int Parse(const vector<LineToken>& tokens,		// Parse a whole program into a child of root. Returns GENERATED_PARSE_*.
+		Node& root);
+
+protected:
+	virtual bool ParseStart(Node& root) = 0;		// Parse the start symbol.
+	int PeekColumn();								// The token ID of the next token. PARSE_TABLE_EOF past the last one.
+	bool MatchToken(int tokenID, int symbol,		// Add a terminal node to parent if the next token has the ID.
+		Node& parent);
+	bool MatchEnd();								// True if every token was used.
+	int Recall(Node& parent, int symbol);			// Reuse an earlier result of symbol at this token. Returns GENERATED_MEMO_*.
+	Node& BeginNode(Node& parent, int symbol);		// Add a non-terminal node to parent.
+	bool EndNode(Node& parent,						// Complete the last node of parent, or remove it if it did not match.
+		unsigned int start, bool matched);			// start is the index of its first token.
+	void KeepLongest(Node& node,					// Keep the children of node if they used more tokens than the longest so far.
+		GeneratedMatch& longest);
+	bool EndLongest(Node& node,						// Give node the children kept by KeepLongest. False if none were kept.
+		GeneratedMatch& longest);
+	void ResetNode(Node& node,						// Undo a ruleset which was tried.
+		unsigned int position);
+	void KeepNodes(vector<Node>& nodes,				// Move nodes being thrown away into m_memo so they can be recalled.
+		unsigned int position);						// position is the index of the first token of the nodes.
+
+	const vector<LineToken>*	m_tokens;			// The tokens being parsed.
+	unsigned int				m_position;			// Index of the next token.
+	unsigned int				m_farthest;			// The highest index looked at. Tells running out of tokens from an error.
+	bool						m_memoize;			// Keep the result of every non-terminal. Set by parsers which backtrack.
+	unordered_map<unsigned long long,
+		GeneratedMatch>			m_memo;				// Results by token index and symbol. Cleared by Parse.
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Class name: CompleteParser
 //
@@ -153,13 +312,46 @@ public:
 
 	__declspec(dllexport) bool Update();
 	void RunProgram();
+	__declspec(dllexport) void RunProgram(statementNode* program);// Lowered to byte code, or by execute_program when it can not be.
 	// Compiling
 	__declspec(dllexport) statementNode* Compile();	// Compiles the nodes into an executable graph.
+	__declspec(dllexport) statementNode* GetProgram();// Compile once and keep the graph up to date with EditProgram. Owned by the parser.
+	__declspec(dllexport) ByteCode* GetByteCode();	// GetProgram lowered to instructions. 0 if it can not be lowered.
+	__declspec(dllexport) Optimizer* GetOptimizer();// Run by Compile and EditProgram, with the counts of its last run.
+	__declspec(dllexport) ControlFlow* GetControlFlow();// The blocks of the program last compiled, whose jumps it threaded.
+	__declspec(dllexport) TempAllocator* GetTempAllocator();// Gives the temporaries of each compiled program slots once its blocks are found.
+	__declspec(dllexport) void SetIndexPolicy(int policy);	// INDEX_*, for the program however it is run. INDEX_GROW unless set.
+	__declspec(dllexport) int GetIndexPolicy();
+
+	// Editing
+	__declspec(dllexport) void ParseProgram(const string& text);// Parse a whole program, remembering its lines for EditProgram.
+	__declspec(dllexport) bool EditProgram(unsigned int offset,	// Replace length chars at offset in the program. False if the whole
+		unsigned int length, const string& text);				// program had to be parsed again rather than the line edited.
 
 	bool DoneRunning();								// True once the program has completed.
 	void EvaluateOpenNodes();
 	__declspec(dllexport) void ClearNodes();		// Clear the syntax parse tree.
 	void SetScoping(int level);						// Determine the scoping level based on user selection.
+	void SetLexer(int lexer);						// Select the tokenizer used for program input.
+	int GetLexer();									// Returns m_lexerMode.
+	void SetParseEngine(int engine);				// Select the engine used for program input.
+	void SetMatchMemo(bool enabled);				// Keep the results of MatchLineToRule for the rest of the line.
+	void GetMatchMemoCounts(unsigned int& lookups,	// Memo lookups and hits since ClearNodes.
+		unsigned int& hits);
+	int GetParseEngine();							// The engine in use. PARSE_ENGINE_MATCH if the grammar is not LL(1).
+	__declspec(dllexport) string GetParseConflicts();// The LL(1) conflicts found in the grammar, one per line.
+	__declspec(dllexport) string GetLALRConflicts();// The LALR(1) conflicts and how they were resolved, one per line.
+	__declspec(dllexport) bool SaveGrammarImage(const char* fileName,
+		unsigned long long grammarHash);			// Write the loaded grammar to a binary image. False if the grammar is incomplete.
+	__declspec(dllexport) bool LoadGrammarImage(const char* fileName,
+		unsigned long long grammarHash);			// Load the grammar from an image made from the same text. False if it is missing or stale.
+	static unsigned long long HashGrammar(const char* text,
+		unsigned int size);							// The hash an image is keyed by.
+	__declspec(dllexport) bool GenerateParser(const char* headerFile,
+		const char* sourceFile,						// Write a GeneratedParser for the loaded grammar. False if the grammar
+		const char* className);						// is incomplete or left recursive.
+	bool SetGeneratedParser(GeneratedParser* parser);// Use a generated parser. False if it was made from another grammar.
+	unsigned long long GetGrammarSignature();		// Hash of the symbols and rules. Ties generated parsers to a grammar.
 	int GetOpenBrackets();							// Returns m_openBrackets.
 	int GetGrammarStage();							// Returns m_grammarStage.
 	void SetGrammarStage(int);						// Set the stage the parser is expecting.
@@ -177,17 +369,25 @@ private:
 	// General
 	int GetTypeFromTokenStr(string& tokenStr);		// Determine the ID number of a token. Handles variables, types, and constants.
 	int GetTokenType(char c);						// Retrieve the type of the new token.
+	bool UpdateLexer();								// Tokenize the whole buffer with m_lexer. True if processing should be aborted.
+	int GetCurrentLineNumber();						// The line of the token being handled.
 	int GetIDType(int c);							// Determine if the char is a letter, digit, or other.
 	int HandleToken(int token);						// Logic behind token operations on a stage basis.
 	
 	int HandleTokenID(string& tokenStr);			// When an ID is entered. Returns error code.
 	bool HandleError(int errorCode);				// Determine action on an error. Return code of true indicates serious error.
-	bool IsTokenTerminal(string& tokenStr);			// Check if a token is a terminal.
-	bool IsTokenNonTerminal(string& tokenStr);		// Check if a token is a non-terminal.
+	bool IsTokenTerminal(int symbol);				// Check if a token is a terminal.
+	bool IsTokenNonTerminal(int symbol);			// Check if a token is a non-terminal.
+	int InternSymbol(string& tokenStr);				// Return the symbol of a token, adding it to m_symbols if needed.
 	
 	// Data Processing
 	statementNode* CompressNodes(Node& node,		// Compress nodes into a singular list in order of execution.
 		vector<statementNode*>&);	
+	void ResolveTypes(statementNode* program,		// Set the type of every assignment known before the program runs. Only
+		statementNode* last = 0);					// up to last, for a line which GivesText does not hold.
+	bool GivesText(statementNode* first,			// An assignment from first to last may make a type which is not a
+		statementNode* last);						// primitive PRIM_STRING, so every type has to be resolved again.
+	void RunPasses(statementNode* program);			// Resolve, optimize, thread and allocate a program compiled whole.
 	void CompileAssignStmt(Node&, statementNode*,
 		vector<statementNode*>&);
 	void CompileIfStmt(Node&, statementNode*,
@@ -199,7 +399,7 @@ private:
 		vector<statementNode*>&);
 	void CompileFunctionStmt(Node& node, statementNode*,
 		vector<statementNode*>&);
-	int OperationToTokenType(string& operation);
+	int OperationToTokenType(int tokenID);			// Returns the token ID if it is an operator, otherwise 0.
 	//varAccess* GetOrCreateVarAccess(string& val);
 	//varNode* GetOrCreateVarNode(string& val);		// Val can be constant or variable.
 	varAccess* CompileExpression(Node& node,
@@ -232,58 +432,147 @@ private:
 		int& index, int searchLevels = -1);			// containing the search node. Search levels indicate number of recursive calls to make.
 	Node* FindNodeByName(string& name, Node& node,	// Search for a node by its friendly name. The index sets to the vector index found of the node
 		int& index, int searchLevels = -1);			// containing the search node. Search levels indicate number of recursive calls to make.
+	Node* FindNodeBySymbol(int symbol, Node& node,	// Same as FindNodeByName using the interned symbol.
+		int& index, int searchLevels = -1);
 	Node* FindBodyNode(Node& node, int& index);		// Find the node of type body.
 
 	// Syntax Handling
 	int GetTokenID(string& tokenStr);
 	int HandleTokenIDSyntax(string& tokenStr);		// Specific logic for syntax handling.
-	int EvaluateLine(list<string>& line);			// Determine the nodes to use or create for the given line.
-	bool FindFirstSets(list<string>& sets,			// Searches first sets to build a list of potential rules.
+	int EvaluateLine(list<LineToken>& line);		// Determine the nodes to use or create for the given line.
+	bool FindFirstSets(list<int>& sets,				// Searches first sets to build a list of potential rules.
 		int tokenID);
-	bool IsTokenFollow(string& nonTerminal,			// Determine if the token is a follow set to the non-token rule.
-		string& token);
-	Node* GetFarthestOpenNode(Node& node);			// Find the furthest node that has not been closed.
-	Node* GetFarthestExpandableNode(Node& node);	// Find the furthest node that can accept additional nodes.
+	bool IsTokenFollow(int nonTerminal,				// Determine if the token is a follow set to the non-token rule.
+		int token);
+	int GetFarthestOpenNode();						// Find the furthest node of m_tree that has not been closed. Uses m_openNodes.
+	void AddMatchedNodes(int node,					// Close and track the children a match added to node from first on.
+		unsigned int first);
+	void AddNewNode(int node);						// Close and track a new node and the nodes below it.
 	Node* GetLowestRightNode(Node& node);			// Return the lowest node in the parse tree.
-	bool CloseNodeChildren(Node& node);				// Determine if the node's children should be closed.
+	bool CloseNodeChildren(int node,				// Determine if the node's children should be closed.
+		unsigned int first);						// Children before first - 1 were checked before.
 	bool CloseNodeIfChildTerminal(Node& node);		// Close a node if all of its children are terminals.
-	void ForceCloseNode(Node& node);				// Force close a node and all child nodes.
-	bool MatchLineToRule(list<string>& line,		// Pops the front of the line for every word matching the token.
-		list<string> lineCpy, string& nontoken,		// This constructs a complete parse tree to be used for evaluation.
-		Node& node, int sIndex = 0);				// The sIndex is used when revisiting a node that was not completed.
+	void ForceCloseNode(int node);					// Force close a node of m_tree and all child nodes.
+	bool MatchLineToRule(list<LineToken>& line,		// Pops the front of the line for every word matching the token.
+		list<LineToken> lineCpy, int nontoken,		// This constructs a complete parse tree to be used for evaluation.
+		int node, int sIndex = 0);					// The sIndex is used when revisiting a node that was not completed.
 	void VerifyNodes(Node& node);					// Verify proper syntax on nodes.
+	bool MatchNonTerminal(list<LineToken>& line,	// MatchLineToRule for a non-terminal within a ruleset. Uses m_matchMemo.
+		int nonToken, int node);
+	void UpdateNodes();								// Rebuild m_nodes from m_tree if the rule matcher changed it.
+	void CopyTreeNode(int treeNode, Node& node);	// Copy a node of m_tree and its children.
+	void BeginMatchLine(list<LineToken>& line);		// Clear m_matchMemo and add the text of the line to m_tree.
+
+	// Incremental Parsing
+	void AddProgramLine();							// Record m_currentLine in m_programLines while ParseProgram runs.
+	void IndexProgramLines();						// Find the node of each line once the program is parsed.
+	bool IndexNode(Node& node, unsigned int& token,	// Set the lines node ends. token counts the terminals before node, and
+		bool declaration, vector<int>& lineEnds);	// lineEnds is the line ending at each token. True if node ends with one.
+	bool ReparseLineNode(list<LineToken>& line,		// Parse the tokens of an edited line as the symbol of node and give
+		Node& node);								// node the result. False if they are not a whole node of that symbol.
+	bool ReplaceStatements(ProgramLine& line);		// Compile the node of an edited line in place of its old statements.
+	bool EditStatements(ProgramLine& line);			// ReplaceStatements, with the passes run over the line in its block. False,
+													// with nothing replaced, when the line is not kept in a single block.
+
+	// Predictive Parsing
+	void BuildParseTable();							// Set m_parseTable from the first and follow sets. Conflicts disable it.
+	void AddParseTableEntry(int nonTerminal,		// Set the ruleset of a table cell, recording a conflict if it is taken.
+		int column, int ruleSet);
+	int GetParseTableColumn(int symbol);			// The table column a terminal symbol is matched by.
+	void GetRuleSetColumns(int key, int ruleSet,	// Add the table columns which select a ruleset.
+		SymbolSet& columns);
+	int ParseLine(list<LineToken>& line);			// Parse the line with the engine in use.
+	int EvaluateLinePredictive(list<LineToken>& line);// Extend the parse tree from m_parseStack. Linear in the line length.
+	void EndCompletedNodes();						// Pop and complete every node at the top of m_parseStack that has no symbols left.
+	int EvaluateLineGenerated(list<LineToken>& line);// Collect the line and run m_generatedParser once the braces are closed.
+	bool IsLeftRecursive();							// True if a non-terminal can start with itself. Recursive descent can not parse it.
+	string GetGeneratedName(int symbol);			// The name of the function parsing a non-terminal.
+
+	// LALR(1) Parsing
+	void BuildLALRTable();							// Set m_lalrActions and m_lalrGotos from the rules.
+	void AddLALRAction(int state, int column,		// Set an action, resolving conflicts like yacc.
+		int action);
+	int GetLALRGoto(int state, int symbol);			// The state after reducing to symbol. -1 if there is none.
+	int EvaluateLineLALR(list<LineToken>& line);	// Shift the tokens of the line. Linear in the line length.
+	bool ShiftLALR(int column, LineToken* token);	// Reduce until the column can be shifted. False on a syntax error.
+	void ReduceLALR(int production);				// Replace the nodes of a production on the stack by their parent.
+	bool CanAcceptLALR();							// True if the program could end after the tokens shifted so far.
+	string GetLALRActionText(int action);			// Describe an action for a conflict.
 
 	// Grammar Handling
-	bool IsTokenRuleKey(string& tokenStr);			// Check if a token is the key to a rule.
-	bool IsTokenInRule(string& tokenStr);			// Check if a token is in the right hand side of a rule.
-	int FindStartTerminalsOfRules(string& token,	// For a given token, find all the terminals
-		list<string>& terminals,					// by traversing the rules. Return code based on token.
-		list<StackMemory*>&);		
-	int FindFollowTerminalsOfRules(string& token,	// For a given token, find all the terminals
-		list<string>& terminals,					// by traversing the rules. Return code based on token.
-		list<StackMemory*>&);		
+	bool IsTokenRuleKey(int symbol);				// Check if a token is the key to a rule.
+	bool IsTokenInRule(int symbol);					// Check if a token is in the right hand side of a rule.
+	void CalculateFirstSets();						// Set m_nullable and m_firstSets. Keys are revisited until nothing changes.
+	void CalculateFollowSets();						// Set m_followSets from the first sets.
 	void CalculateFirstAndFollowSets();				// Set m_firstSets and m_followSets.
-	void AddEOFToSet(list<string>&);				// Adds the eof token to a set.
 	void RemoveCString(string&);					// Removes the null terminator if it exists.
 	void EndParsing();								// Called when all parsing is complete.
+	void InitializeLexer();							// Build m_lexer from the terminals.
 private:
-	map<string,										// The set of rules for the terminals and non-terminals.
-		vector<list<string> > > m_rules;			// Each key can have a vector of a list of rules.
-	list<string>*		m_currentRule;				// The current rule being assigned.
-	list<string>		m_currentLine;				// The current line pending evaluation.
-	map<string,
-		list<string> >	m_firstSets;				// The first sets of the grammar rules.
-	map<string,
-		list<string> >	m_followSets;				// The follow sets of the grammar rules.
+	SymbolTable			m_symbols;					// Every terminal, non-terminal and node type interned to an ID.
+	vector<vector<
+		vector<int> > >	m_rules;					// The rules of each symbol. Each key can have a vector of rules.
+	vector<int>			m_ruleKeys;					// Symbols with rules in name order.
+	vector<vector<int> >	m_parseTable;			// The ruleset to expand for each non-terminal and table column.
+	vector<ParseStackEntry>	m_parseStack;			// Pending symbols of the predictive parse. Kept between lines.
+	list<string>		m_parseConflicts;			// Descriptions of the cells claimed by more than one ruleset.
+	GeneratedParser*	m_generatedParser;			// Set with SetGeneratedParser. Not owned.
+	vector<LineToken>	m_generatedTokens;			// Tokens collected for m_generatedParser.
+	int					m_generatedDepth;			// Open braces in m_generatedTokens.
+	vector<LALRProduction>	m_lalrProductions;		// Every ruleset of m_rules. The start production is first.
+	vector<vector<int> >	m_lalrActions;			// The LALR_* action of each state and table column.
+	unordered_map<unsigned long long, int>
+						m_lalrGotos;				// The state after a reduce by state and symbol.
+	vector<int>			m_lalrStateSymbols;			// The symbol shifted to enter each state.
+	list<string>		m_lalrConflicts;			// Descriptions of the cells claimed by more than one action.
+	bool				m_lalrBuilt;				// True once BuildLALRTable ran.
+	vector<int>			m_lalrStates;				// The state stack of the LALR parse. Kept between lines.
+	deque<Node>			m_lalrNodes;				// The node of each state on m_lalrStates but the first.
+	vector<int>*		m_currentRule;				// The current rule being assigned.
+	list<LineToken>		m_currentLine;				// The current line pending evaluation.
+	unordered_map<unsigned long long,
+		MatchMemoEntry>	m_matchMemo;				// By line size left and non-terminal. Cleared for every line.
+	bool				m_matchMemoEnabled;			// Set with SetMatchMemo.
+	unsigned int		m_matchMemoLookups;			// Calls to MatchNonTerminal while the memo is enabled.
+	unsigned int		m_matchMemoHits;			// Lookups answered from m_matchMemo.
+	string				m_tokenStr;					// The current token. Reused so tokens do not allocate.
+	Lexer				m_lexer;					// DFA built from the terminals once the grammar is loaded.
+	vector<LexToken>	m_lexTokens;				// Tokens of the current buffer when using m_lexer.
+	vector<bool>		m_nullable;					// Symbols which can derive nothing.
+	vector<SymbolSet>	m_firstSets;				// The first sets of the grammar rules by symbol.
+	vector<SymbolSet>	m_followSets;				// The follow sets of the grammar rules by symbol.
 	Node			m_nodes;						// The nodes of the program based on the grammar.
+	ParseTree		m_tree;							// The nodes built by the rule matcher. Copied to m_nodes by UpdateNodes.
+	bool			m_treeChanged;					// m_tree has nodes m_nodes does not.
+	vector<int>		m_openNodes;					// Nodes of m_tree which were open when added, in tree order.
+	vector<int>		m_closeNodes;					// Nodes given terminals by a failed match. Checked by the next AddMatchedNodes.
+	vector<unsigned int>	m_closeFirst;			// The first child of each of m_closeNodes to check.
+	vector<unsigned int>	m_matchText;			// The text of each token of the current line in m_tree, by the line size left.
+	string			m_programText;					// The text given to ParseProgram with the edits made since.
+	vector<ProgramLine>	m_programLines;				// The lines of m_programText. Empty if it can not be edited a line at a time.
+	unordered_map<Node*, unsigned int>
+					m_lineNodes;					// The index in m_programLines of each line node.
+	bool			m_recordLines;					// Add to m_programLines while ParseProgram runs.
+	statementNode*	m_program;						// Compiled by GetProgram. Released by ClearNodes.
+	bool			m_recordStatements;				// CompressNodes sets the statements of m_programLines while GetProgram compiles.
+	ByteCode		m_byteCode;						// m_program lowered by GetByteCode. Patched or cleared whenever m_program changes.
+	Optimizer		m_optimizer;					// Rewrites each compiled program once its types are resolved.
+	ControlFlow		m_controlFlow;					// Threads the jumps of each compiled program once it is optimized.
+	TempAllocator	m_tempAllocator;				// Reuses the temporaries of each compiled program once its jumps are threaded.
+	set<int>		m_stringTypes;					// The types which may be given text, found by ResolveTypes for a whole program.
 	list<Node*>		m_currentNode;					// The current node being evaluated. Used for single threaded loops.
 	Variables*		m_variables;					// The variables the program may use.
 	CompleteParserErrors	m_errors;						// List of errors found during parsing or analyzing.
 	Input*			m_inputBuffer;					// Buffer which is a pointer to the input object.
-	list<string>	m_nonTerminals;					// Linked list of user defined non terminals.
-	list<string>	m_terminals;					// Linked list of user defined terminals.
+	list<int>		m_nonTerminals;					// Linked list of user defined non terminals in input order.
+	list<int>		m_terminals;					// Linked list of user defined terminals in input order.
 	stringstream	m_textOutput;					// Text output generated by the program.
 	int				m_scoping;						// The scoping level of the program.
+	int				m_lexerMode;					// LEXER_LEGACY or LEXER_DFA.
+	int				m_lexerLine;					// Line of the token being handled by m_lexer.
+	unsigned int	m_lexerOffset;					// Offset after the token being handled by m_lexer.
+	int				m_parseEngine;					// The engine requested with SetParseEngine.
+	bool			m_isLL1;						// True if m_parseTable was built without conflicts.
 	int				m_openBrackets;					// Number of brackets currently not closed.
 	int				m_tokenStart, m_tokenEnd;		// Start and end indices of the token.
 	int				m_grammarStage;					// What stage the parser is on in defining the grammar.
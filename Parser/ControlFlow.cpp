@@ -0,0 +1,583 @@
+#include "ControlFlow.h"
+
+// The statement run after node, or the true (0) or false (1) branch of an IF.
+static statementNode* GetNext(statementNode* node, int branch)
+{
+	if(node->stmt_type != IFSTMT)
+		return node->next;
+
+	return branch ? node->if_stmt->false_branch : node->if_stmt->true_branch;
+}
+
+static int GetBranchCount(statementNode* node)
+{
+	return (node->stmt_type == IFSTMT) ? 2 : 1;
+}
+
+ControlFlow::ControlFlow()
+{
+	m_program			= 0;
+	m_statementCount	= 0;
+	m_enabled			= true;
+	m_mergedCount		= 0;
+	m_threadedCount		= 0;
+}
+
+ControlFlow::~ControlFlow()
+{
+}
+
+void ControlFlow::Clear()
+{
+	m_blocks.clear();
+	m_firsts.clear();
+	m_blockIDs.clear();
+	m_statementBlocks.clear();
+	m_targets.clear();
+	m_layout.clear();
+	m_original.clear();
+	m_program			= 0;
+	m_statementCount	= 0;
+	m_mergedCount		= 0;
+	m_threadedCount		= 0;
+}
+
+bool ControlFlow::Build(statementNode* program)
+{
+	Clear();
+
+	for(statementNode* node = program; node; node = node->next)
+	{
+		m_statementCount++;
+		if(node->stmt_type == IFSTMT && node->if_stmt)
+		{
+			m_targets.insert(node->if_stmt->true_branch);
+			m_targets.insert(node->if_stmt->false_branch);
+		}
+		else if(node->stmt_type == GOTOSTMT && node->goto_stmt)
+			m_targets.insert(node->goto_stmt->target);
+	}
+
+	if(!FindBlocks(program))
+	{
+		Clear();
+		return false;
+	}
+
+	vector<Loop> loops;
+	FindLoops(loops);
+	LayOut(loops);
+	SetJumps();
+
+	m_program = program;
+
+	return true;
+}
+
+int ControlFlow::Thread()
+{
+	m_threadedCount = 0;
+	if(!m_enabled || !m_program)
+		return 0;
+
+	for(statementNode* node = m_program; node; node = node->next)
+	{
+		if(node->stmt_type == IFSTMT && node->if_stmt)
+		{
+			SetJump(&node->if_stmt->true_branch);
+			SetJump(&node->if_stmt->false_branch);
+		}
+		else if(node->stmt_type == GOTOSTMT && node->goto_stmt)
+			SetJump(&node->goto_stmt->target);
+	}
+
+	for(unsigned int i = 0; i < m_blocks.size(); i++)
+		m_blocks[i].threaded = CountWalked(i);
+
+	return m_threadedCount;
+}
+
+bool ControlFlow::Restore(statementNode* program)
+{
+	if(!program || program != m_program)
+		return false;
+
+	for(vector<pair<statementNode**, statementNode*> >::reverse_iterator it = m_original.rbegin(); it != m_original.rend(); it++)
+		*it->first = it->second;
+	m_original.clear();
+
+	return true;
+}
+
+bool ControlFlow::FindRange(statementNode* first, statementNode* last, BlockRange& range)
+{
+	range.block		= BLOCK_NONE;
+	range.first		= 0;
+	range.count		= 0;
+	range.nodes		= 0;
+	range.walked	= 0;
+	if(!m_program || !first || !last)
+		return false;
+
+	// Nothing may go into the line but the statement before it, and the line only falls through.
+	statementNode* found = 0;
+	for(statementNode* node = first; ; node = node->next)
+	{
+		if(!node || node->stmt_type == IFSTMT || node->stmt_type == GOTOSTMT || m_targets.count(node) || m_blockIDs.count(node))
+			return false;
+
+		range.nodes++;
+		if(node->stmt_type != NOOPSTMT)
+		{
+			unordered_map<statementNode*, int>::iterator it = m_statementBlocks.find(node);
+			if(it == m_statementBlocks.end() || (found && it->second != range.block))
+				return false;
+			if(!found)
+			{
+				found		= node;
+				range.block	= it->second;
+			}
+			range.count++;
+		}
+
+		if(node == last)
+			break;
+	}
+	if(!found)
+		return false;
+
+	// The statements of a block follow each other, and the first one starts it.
+	vector<statementNode*>& statements = m_blocks[range.block].statements;
+	range.first		= find(statements.begin(), statements.end(), found) - statements.begin();
+	range.walked	= CountWalked(range.block, range.first - 1, range.count + 1);
+
+	return true;
+}
+
+void ControlFlow::ReplaceRange(const BlockRange& range, statementNode* first, statementNode* last)
+{
+	vector<statementNode*> statements;
+	int nodes = 0;
+	for(statementNode* node = first; node; node = node->next)
+	{
+		nodes++;
+		if(node->stmt_type != NOOPSTMT)
+			statements.push_back(node);
+		if(node == last)
+			break;
+	}
+
+	BasicBlock& block = m_blocks[range.block];
+	vector<statementNode*>::iterator start = block.statements.begin() + range.first;
+	for(vector<statementNode*>::iterator it = start; it != start + range.count; it++)
+		m_statementBlocks.erase(*it);
+	block.statements.erase(start, start + range.count);
+	block.statements.insert(block.statements.begin() + range.first, statements.begin(), statements.end());
+	for(vector<statementNode*>::iterator it = statements.begin(); it != statements.end(); it++)
+		m_statementBlocks[*it] = range.block;
+
+	// Only the no-ops of the line change the steps taken, which are the same threaded or not.
+	int walked = CountWalked(range.block, range.first - 1, statements.size() + 1);
+	block.walked		+= walked - range.walked;
+	block.threaded		+= walked - range.walked;
+	block.instructions	+= (int)statements.size() - range.count;
+	m_statementCount	+= nodes - range.nodes;
+}
+
+bool ControlFlow::HasLoops()
+{
+	for(vector<BasicBlock>::iterator it = m_blocks.begin(); it != m_blocks.end(); it++)
+	{
+		if(it->loopDepth)
+			return true;
+	}
+
+	return false;
+}
+
+void ControlFlow::PrintBlocks(stringstream& out)
+{
+	stringstream ss;
+	int before		= 0;
+	int threaded	= 0;
+	int after		= 0;
+
+	ss << "BLOCKS\n";
+	for(vector<int>::iterator it = m_layout.begin(); it != m_layout.end(); it++)
+	{
+		BasicBlock& block = m_blocks[*it];
+		int statements = block.statements.size();
+		before		+= statements + block.walked;
+		threaded	+= statements + block.threaded;
+		after		+= block.instructions;
+
+		ss << "ID: " << *it << " DEPTH: " << block.loopDepth << " PREDECESSORS: " << block.predecessors;
+		ss << " BEFORE: " << statements + block.walked << " THREADED: " << statements + block.threaded << " AFTER: " << block.instructions;
+		if(IsBranch(*it))
+			ss << " TRUE: " << block.successors[0] << " FALSE: " << block.successors[1];
+		else if(block.successors[0] != BLOCK_END)
+			ss << " NEXT: " << block.successors[0];
+		else
+			ss << " END";
+		ss << "\n";
+	}
+	ss << "TOTAL BLOCKS: " << m_blocks.size() << " MERGED: " << m_mergedCount << " BEFORE: " << before << " THREADED: " << threaded << " AFTER: " << after << "\n";
+
+	out << ss.str();
+}
+
+int ControlFlow::Skip(statementNode* node, statementNode*& target, statementNode*& last, int& jumps)
+{
+	int steps = 0;
+	last	= 0;
+	jumps	= 0;
+
+	while(node && (node->stmt_type == NOOPSTMT || node->stmt_type == GOTOSTMT))
+	{
+		// More steps than there are statements only happens when the gotos go around.
+		if(steps++ > m_statementCount)
+			return -1;
+
+		last = node;
+		if(node->stmt_type == GOTOSTMT)
+		{
+			if(!node->goto_stmt || !node->goto_stmt->target)
+				return -1;
+			node = node->goto_stmt->target;
+			jumps++;
+		}
+		else
+			node = node->next;
+	}
+
+	target = node;
+	return steps;
+}
+
+int ControlFlow::AddBlock(statementNode* node)
+{
+	unordered_map<statementNode*, int>::iterator it = m_blockIDs.find(node);
+	if(it != m_blockIDs.end())
+		return it->second;
+
+	BasicBlock block;
+	block.successors[0]	= BLOCK_NONE;
+	block.successors[1]	= BLOCK_NONE;
+	block.predecessors	= 0;
+	block.loopDepth		= 0;
+	block.walked		= 0;
+	block.threaded		= 0;
+	block.jump			= BLOCK_NONE;
+	block.inverted		= false;
+	block.instructions	= 0;
+
+	m_blocks.push_back(block);
+	m_firsts.push_back(node);
+	m_blockIDs[node] = m_blocks.size() - 1;
+
+	return m_blocks.size() - 1;
+}
+
+bool ControlFlow::FindBlocks(statementNode* program)
+{
+	statementNode* entry;
+	statementNode* target;
+	statementNode* last;
+	int jumps;
+	if(Skip(program, entry, last, jumps) < 0)
+		return false;
+
+	// Blocks start where the program starts and stops, at each branch, and where there is more than one way in.
+	unordered_map<statementNode*, int> entries;
+	unordered_set<statementNode*> starts;
+	unordered_set<statementNode*> visited;
+	vector<statementNode*> pending(1, entry);
+	starts.insert(entry);
+	starts.insert(0);
+
+	while(!pending.empty())
+	{
+		statementNode* node = pending.back();
+		pending.pop_back();
+		if(!node || !visited.insert(node).second)
+			continue;
+		if(node->stmt_type == IFSTMT && !node->if_stmt)
+			return false;
+
+		int branches = GetBranchCount(node);
+		for(int branch = 0; branch < branches; branch++)
+		{
+			if(Skip(GetNext(node, branch), target, last, jumps) < 0)
+				return false;
+
+			entries[target]++;
+			if(branches > 1)
+				starts.insert(target);
+			pending.push_back(target);
+		}
+	}
+
+	for(unordered_map<statementNode*, int>::iterator it = entries.begin(); it != entries.end(); it++)
+	{
+		if(it->second > 1)
+			starts.insert(it->first);
+	}
+
+	// AddBlock adds the blocks found as they are filled.
+	AddBlock(entry);
+	for(unsigned int i = 0; i < m_blocks.size(); i++)
+	{
+		statementNode* node = m_firsts[i];
+		if(!node)
+		{
+			m_blocks[i].successors[0] = BLOCK_END;
+			continue;
+		}
+
+		while(true)
+		{
+			m_blocks[i].statements.push_back(node);
+			m_statementBlocks[node] = i;
+
+			if(node->stmt_type == IFSTMT)
+			{
+				for(int branch = 0; branch < 2; branch++)
+				{
+					Skip(GetNext(node, branch), target, last, jumps);
+					int successor = AddBlock(target);
+					m_blocks[i].successors[branch] = successor;
+					m_blocks[successor].predecessors++;
+				}
+				break;
+			}
+
+			Skip(node->next, target, last, jumps);
+			if(starts.count(target))
+			{
+				int successor = AddBlock(target);
+				m_blocks[i].successors[0] = successor;
+				m_blocks[successor].predecessors++;
+				break;
+			}
+
+			// Only this statement leads to the next one, so a goto between them does not end the block.
+			m_mergedCount += jumps;
+			node = target;
+		}
+
+		m_blocks[i].walked		= CountWalked(i);
+		m_blocks[i].threaded	= m_blocks[i].walked;
+	}
+
+	return true;
+}
+
+int ControlFlow::CountWalked(int block, int first, int count)
+{
+	int walked = 0;
+	vector<statementNode*>& statements = m_blocks[block].statements;
+	vector<statementNode*>::iterator end = (count < 0 || first + count > (int)statements.size()) ? statements.end() : statements.begin() + first + count;
+	for(vector<statementNode*>::iterator it = statements.begin() + first; it != end; it++)
+	{
+		int branches = GetBranchCount(*it);
+		for(int branch = 0; branch < branches; branch++)
+		{
+			statementNode* target;
+			statementNode* last;
+			int jumps;
+			walked += max(0, Skip(GetNext(*it, branch), target, last, jumps));
+		}
+	}
+
+	return walked;
+}
+
+bool ControlFlow::IsBranch(int block)
+{
+	return (!m_blocks[block].statements.empty() && m_blocks[block].statements.back()->stmt_type == IFSTMT);
+}
+
+void ControlFlow::FindLoops(vector<Loop>& loops)
+{
+	int count = m_blocks.size();
+	vector<vector<int> > predecessors(count);
+	map<int, vector<int> > latches;
+
+	// Search depth first from the start, taking the false branch of an IF first so the true branch follows it in reverse post order.
+	vector<int> state(count, 0);			// 0 unseen, 1 being searched, 2 done.
+	vector<pair<int, int> > stack(1, make_pair(0, 0));
+	vector<int> order;
+	state[0] = 1;
+
+	while(!stack.empty())
+	{
+		int block = stack.back().first;
+		int edge = stack.back().second++;
+		int edges = IsBranch(block) ? 2 : 1;
+
+		if(edge < edges)
+		{
+			int successor = m_blocks[block].successors[edges - 1 - edge];
+			if(successor < 0)
+				continue;
+
+			predecessors[successor].push_back(block);
+			if(state[successor] == 0)
+			{
+				state[successor] = 1;
+				stack.push_back(make_pair(successor, 0));
+			}
+			else if(state[successor] == 1)
+				latches[successor].push_back(block);
+		}
+		else
+		{
+			state[block] = 2;
+			order.push_back(block);
+			stack.pop_back();
+		}
+	}
+
+	m_layout.assign(order.rbegin(), order.rend());
+
+	// A loop holds the blocks which reach a latch without passing its header. Outer loops come first.
+	for(vector<int>::iterator it = m_layout.begin(); it != m_layout.end(); it++)
+	{
+		map<int, vector<int> >::iterator header = latches.find(*it);
+		if(header == latches.end())
+			continue;
+
+		Loop loop;
+		loop.header		= header->first;
+		loop.latches	= header->second;
+		loop.blocks.assign(count, false);
+		loop.blocks[loop.header] = true;
+
+		vector<int> pending(loop.latches);
+		while(!pending.empty())
+		{
+			int block = pending.back();
+			pending.pop_back();
+			if(loop.blocks[block])
+				continue;
+
+			loop.blocks[block] = true;
+			pending.insert(pending.end(), predecessors[block].begin(), predecessors[block].end());
+		}
+
+		for(int i = 0; i < count; i++)
+		{
+			if(loop.blocks[i])
+				m_blocks[i].loopDepth++;
+		}
+
+		loops.push_back(loop);
+	}
+}
+
+void ControlFlow::LayOut(vector<Loop>& loops)
+{
+	vector<int> positions(m_blocks.size());
+
+	// Move the blocks which are not in a loop to after it, so the loop is laid out in one piece.
+	for(vector<Loop>::iterator loop = loops.begin(); loop != loops.end(); loop++)
+	{
+		for(unsigned int i = 0; i < m_layout.size(); i++)
+			positions[m_layout[i]] = i;
+
+		int first = positions[loop->header];
+		int end = first;
+		bool together = true;
+		for(unsigned int i = 0; i < m_blocks.size(); i++)
+		{
+			if(!loop->blocks[i])
+				continue;
+			together = together && (positions[i] >= first);
+			end = max(end, positions[i]);
+		}
+		if(!together)
+			continue;
+
+		vector<int> blocks;
+		vector<int> others;
+		for(int i = first; i <= end; i++)
+		{
+			if(loop->blocks[m_layout[i]])
+				blocks.push_back(m_layout[i]);
+			else
+				others.push_back(m_layout[i]);
+		}
+		blocks.insert(blocks.end(), others.begin(), others.end());
+		copy(blocks.begin(), blocks.end(), m_layout.begin() + first);
+	}
+
+	// A loop testing its condition first gets the test after its latch, which then falls through to it.
+	for(vector<Loop>::iterator loop = loops.begin(); loop != loops.end(); loop++)
+	{
+		int header = loop->header;
+		if(header == m_layout[0] || !IsBranch(header) || loop->latches.size() != 1)
+			continue;
+
+		int latch = loop->latches[0];
+		int* successors = m_blocks[header].successors;
+		if(latch == header || IsBranch(latch) || loop->blocks[successors[0]] == loop->blocks[successors[1]])
+			continue;
+
+		for(unsigned int i = 0; i < m_layout.size(); i++)
+			positions[m_layout[i]] = i;
+
+		bool last = true;
+		for(unsigned int i = 0; i < m_blocks.size() && last; i++)
+			last = !loop->blocks[i] || positions[i] <= positions[latch];
+		if(!last)
+			continue;
+
+		// The latch moves back one place when the header is taken out ahead of it.
+		m_layout.erase(m_layout.begin() + positions[header]);
+		m_layout.insert(m_layout.begin() + positions[latch], header);
+	}
+}
+
+void ControlFlow::SetJumps()
+{
+	for(unsigned int i = 0; i < m_layout.size(); i++)
+	{
+		BasicBlock& block = m_blocks[m_layout[i]];
+		int next = (i + 1 < m_layout.size()) ? m_layout[i + 1] : BLOCK_NONE;
+		block.jump		= BLOCK_NONE;
+		block.inverted	= false;
+
+		// A branch goes to the false branch, or to the true branch when the false branch follows it.
+		if(IsBranch(m_layout[i]))
+		{
+			if(block.successors[0] != next && block.successors[1] == next)
+				block.inverted = true;
+			else if(block.successors[0] != next)
+				block.jump = block.successors[0];
+		}
+		else if(block.successors[0] != next)
+			block.jump = block.successors[0];
+
+		block.instructions = block.statements.size() + ((block.jump != BLOCK_NONE) ? 1 : 0);
+	}
+}
+
+void ControlFlow::SetJump(statementNode** jump)
+{
+	statementNode* target;
+	statementNode* last;
+	int jumps;
+	if(!*jump || Skip(*jump, target, last, jumps) <= 0)
+		return;
+
+	// execute_program stops at a goto without a target, so a jump to the end stays on the last no-op.
+	if(!target)
+		target = last;
+	if(target == *jump)
+		return;
+
+	m_original.push_back(make_pair(jump, *jump));
+	m_targets.insert(target);
+	*jump = target;
+	m_threadedCount++;
+}
@@ -13,7 +13,7 @@ void GUICompleteParser::GUICompleteParser::CompileProgram()
 {
 	SendInputToCompleteParser();
 	statementNode* program = m_systemPtr->m_parser->Compile();
-	execute_program(program);
+	m_systemPtr->m_parser->RunProgram(program);
 	m_systemPtr->m_parser->ShutdownProgram(program);
 }
 
@@ -60,7 +60,7 @@ void GUICompleteParser::GUICompleteParser::UpdateVariables()
 	{
 		this->variablesGridView->Rows[row]->Cells[0]->Value = NativeToDotNet(it->second.name);
 		this->variablesGridView->Rows[row]->Cells[1]->Value = NativeToDotNet(variablesPtr->GetTypeString(it->second.typeID));
-		this->variablesGridView->Rows[row]->Cells[2]->Value = NativeToDotNet(it->second.value[0]);
+		this->variablesGridView->Rows[row]->Cells[2]->Value = NativeToDotNet(it->second.value[0].ToString());
 		row++;
 	}
 }
@@ -0,0 +1,718 @@
+#include "GrammarFullParser.h"
+
+GrammarFullParser::GrammarFullParser()
+{
+	m_memoize = true;
+}
+
+unsigned long long GrammarFullParser::GetSignature()
+{
+	return 0x937ae93fcddad374ULL;
+}
+
+bool GrammarFullParser::ParseStart(Node& root)
+{
+	return Parse_program(root);
+}
+
+// program
+bool GrammarFullParser::Parse_program(Node& parent)
+{
+	int memo = Recall(parent, 44);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 44);
+
+	switch(PeekColumn())
+	{
+	case 1:	// VAR
+	case 25:	// ID
+		// program -> decl body $
+		if(Parse_decl(node) && Parse_body(node) && MatchEnd())
+			return EndNode(parent, start, true);
+		break;
+	case 20:	// {
+		// program -> body $
+		if(Parse_body(node) && MatchEnd())
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// decl
+bool GrammarFullParser::Parse_decl(Node& parent)
+{
+	int memo = Recall(parent, 59);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 59);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 1:	// VAR
+		// decl -> var_decl_section
+		if(Parse_var_decl_section(node))
+			return EndNode(parent, start, true);
+		break;
+	case 25:	// ID
+		// decl -> type_decl_section var_decl_section
+		if(Parse_type_decl_section(node) && Parse_var_decl_section(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// decl -> type_decl_section
+		if(!longest.matched && Parse_type_decl_section(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// type_decl_section
+bool GrammarFullParser::Parse_type_decl_section(Node& parent)
+{
+	int memo = Recall(parent, 46);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 46);
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// type_decl_section -> TYPE type_decl_list
+		if(MatchToken(25, 71, node) && Parse_type_decl_list(node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// type_decl_list
+bool GrammarFullParser::Parse_type_decl_list(Node& parent)
+{
+	int memo = Recall(parent, 60);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 60);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// type_decl_list -> type_decl type_decl_list
+		if(Parse_type_decl(node) && Parse_type_decl_list(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// type_decl_list -> type_decl
+		if(!longest.matched && Parse_type_decl(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// type_decl
+bool GrammarFullParser::Parse_type_decl(Node& parent)
+{
+	int memo = Recall(parent, 47);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 47);
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// type_decl -> id_list : type_name ;
+		if(Parse_id_list(node) && MatchToken(13, 13, node) && Parse_type_name(node) && MatchToken(15, 15, node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// type_name
+bool GrammarFullParser::Parse_type_name(Node& parent)
+{
+	int memo = Recall(parent, 61);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 61);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// type_name -> REAL
+		if(MatchToken(25, 72, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// type_name -> INT
+		if(MatchToken(25, 73, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// type_name -> BOOLEAN
+		if(MatchToken(25, 74, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// type_name -> STRING
+		if(MatchToken(25, 75, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// type_name -> ID
+		if(MatchToken(25, 25, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// var_decl_section
+bool GrammarFullParser::Parse_var_decl_section(Node& parent)
+{
+	int memo = Recall(parent, 48);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 48);
+
+	switch(PeekColumn())
+	{
+	case 1:	// VAR
+		// var_decl_section -> VAR var_decl_list
+		if(MatchToken(1, 1, node) && Parse_var_decl_list(node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// var_decl_list
+bool GrammarFullParser::Parse_var_decl_list(Node& parent)
+{
+	int memo = Recall(parent, 62);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 62);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// var_decl_list -> var_decl var_decl_list
+		if(Parse_var_decl(node) && Parse_var_decl_list(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// var_decl_list -> var_decl
+		if(!longest.matched && Parse_var_decl(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// var_decl
+bool GrammarFullParser::Parse_var_decl(Node& parent)
+{
+	int memo = Recall(parent, 49);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 49);
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// var_decl -> id_list : type_name ;
+		if(Parse_id_list(node) && MatchToken(13, 13, node) && Parse_type_name(node) && MatchToken(15, 15, node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// id_list
+bool GrammarFullParser::Parse_id_list(Node& parent)
+{
+	int memo = Recall(parent, 63);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 63);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// id_list -> ID , id_list
+		if(MatchToken(25, 25, node) && MatchToken(14, 14, node) && Parse_id_list(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// id_list -> ID
+		if(!longest.matched && MatchToken(25, 25, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// body
+bool GrammarFullParser::Parse_body(Node& parent)
+{
+	int memo = Recall(parent, 45);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 45);
+
+	switch(PeekColumn())
+	{
+	case 20:	// {
+		// body -> { stmt_list }
+		if(MatchToken(20, 20, node) && Parse_stmt_list(node) && MatchToken(21, 21, node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// stmt_list
+bool GrammarFullParser::Parse_stmt_list(Node& parent)
+{
+	int memo = Recall(parent, 64);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 64);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 2:	// IF
+	case 3:	// WHILE
+	case 6:	// print
+	case 25:	// ID
+		// stmt_list -> stmt stmt_list
+		if(Parse_stmt(node) && Parse_stmt_list(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// stmt_list -> stmt
+		if(!longest.matched && Parse_stmt(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// stmt
+bool GrammarFullParser::Parse_stmt(Node& parent)
+{
+	int memo = Recall(parent, 65);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 65);
+
+	switch(PeekColumn())
+	{
+	case 2:	// IF
+		// stmt -> if_stmt
+		if(Parse_if_stmt(node))
+			return EndNode(parent, start, true);
+		break;
+	case 3:	// WHILE
+		// stmt -> while_stmt
+		if(Parse_while_stmt(node))
+			return EndNode(parent, start, true);
+		break;
+	case 6:	// print
+		// stmt -> print_stmt
+		if(Parse_print_stmt(node))
+			return EndNode(parent, start, true);
+		break;
+	case 25:	// ID
+		// stmt -> assign_stmt
+		if(Parse_assign_stmt(node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// if_stmt
+bool GrammarFullParser::Parse_if_stmt(Node& parent)
+{
+	int memo = Recall(parent, 52);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 52);
+
+	switch(PeekColumn())
+	{
+	case 2:	// IF
+		// if_stmt -> IF condition body else_stmt
+		if(MatchToken(2, 2, node) && Parse_condition(node) && Parse_body(node) && Parse_else_stmt(node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// else_stmt
+bool GrammarFullParser::Parse_else_stmt(Node& parent)
+{
+	int memo = Recall(parent, 53);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 53);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 2:	// IF
+	case 3:	// WHILE
+	case 6:	// print
+	case 21:	// }
+	case 25:	// ID
+		// else_stmt -> #
+		return EndNode(parent, start, true);
+	case 32:	// ELSE
+		// else_stmt -> ELSE if_stmt
+		if(MatchToken(32, 32, node) && Parse_if_stmt(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// else_stmt -> ELSE body
+		if(MatchToken(32, 32, node) && Parse_body(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// while_stmt
+bool GrammarFullParser::Parse_while_stmt(Node& parent)
+{
+	int memo = Recall(parent, 51);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 51);
+
+	switch(PeekColumn())
+	{
+	case 3:	// WHILE
+		// while_stmt -> WHILE condition body
+		if(MatchToken(3, 3, node) && Parse_condition(node) && Parse_body(node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// assign_stmt
+bool GrammarFullParser::Parse_assign_stmt(Node& parent)
+{
+	int memo = Recall(parent, 50);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 50);
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// assign_stmt -> ID = expr ;
+		if(MatchToken(25, 25, node) && MatchToken(12, 12, node) && Parse_expr(node) && MatchToken(15, 15, node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// expr
+bool GrammarFullParser::Parse_expr(Node& parent)
+{
+	int memo = Recall(parent, 66);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 66);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 18:	// (
+	case 25:	// ID
+		// expr -> term + expr
+		if(Parse_term(node) && MatchToken(8, 8, node) && Parse_expr(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// expr -> term - expr
+		if(Parse_term(node) && MatchToken(9, 9, node) && Parse_expr(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// expr -> term
+		if(!longest.matched && Parse_term(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// term
+bool GrammarFullParser::Parse_term(Node& parent)
+{
+	int memo = Recall(parent, 67);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 67);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 18:	// (
+	case 25:	// ID
+		// term -> factor * term
+		if(Parse_factor(node) && MatchToken(11, 11, node) && Parse_term(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// term -> factor / term
+		if(Parse_factor(node) && MatchToken(10, 10, node) && Parse_term(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// term -> factor
+		if(!longest.matched && Parse_factor(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// factor
+bool GrammarFullParser::Parse_factor(Node& parent)
+{
+	int memo = Recall(parent, 68);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 68);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 18:	// (
+		// factor -> ( expr )
+		if(MatchToken(18, 18, node) && Parse_expr(node) && MatchToken(19, 19, node))
+			return EndNode(parent, start, true);
+		break;
+	case 25:	// ID
+		// factor -> INT
+		if(MatchToken(25, 73, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// factor -> REAL
+		if(MatchToken(25, 72, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// factor -> ID
+		if(MatchToken(25, 25, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// condition
+bool GrammarFullParser::Parse_condition(Node& parent)
+{
+	int memo = Recall(parent, 57);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 57);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// condition -> ID
+		if(MatchToken(25, 25, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// condition -> primary relop primary
+		if(Parse_primary(node) && Parse_relop(node) && Parse_primary(node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// primary
+bool GrammarFullParser::Parse_primary(Node& parent)
+{
+	int memo = Recall(parent, 69);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 69);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 25:	// ID
+		// primary -> ID
+		if(MatchToken(25, 25, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// primary -> INT
+		if(MatchToken(25, 73, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// primary -> REAL
+		if(MatchToken(25, 72, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// relop
+bool GrammarFullParser::Parse_relop(Node& parent)
+{
+	int memo = Recall(parent, 70);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 70);
+
+	switch(PeekColumn())
+	{
+	case 12:	// =
+		// relop -> =
+		if(MatchToken(12, 12, node))
+			return EndNode(parent, start, true);
+		break;
+	case 22:	// <>
+		// relop -> <>
+		if(MatchToken(22, 22, node))
+			return EndNode(parent, start, true);
+		break;
+	case 23:	// >
+		// relop -> >
+		if(MatchToken(23, 23, node))
+			return EndNode(parent, start, true);
+		break;
+	case 24:	// <
+		// relop -> <
+		if(MatchToken(24, 24, node))
+			return EndNode(parent, start, true);
+		break;
+	case 33:	// >=
+		// relop -> >=
+		if(MatchToken(33, 33, node))
+			return EndNode(parent, start, true);
+		break;
+	case 34:	// <=
+		// relop -> <=
+		if(MatchToken(34, 34, node))
+			return EndNode(parent, start, true);
+		break;
+	}
+
+	return EndNode(parent, start, false);
+}
+
+// print_stmt
+bool GrammarFullParser::Parse_print_stmt(Node& parent)
+{
+	int memo = Recall(parent, 54);
+	if(memo != GENERATED_MEMO_NONE)
+		return memo == GENERATED_MEMO_MATCHED;
+
+	unsigned int start = m_position;
+	Node& node = BeginNode(parent, 54);
+	GeneratedMatch longest;
+
+	switch(PeekColumn())
+	{
+	case 6:	// print
+		// print_stmt -> print id_list ;
+		if(MatchToken(6, 6, node) && Parse_id_list(node) && MatchToken(15, 15, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		// print_stmt -> print debug ;
+		if(MatchToken(6, 6, node) && MatchToken(39, 39, node) && MatchToken(15, 15, node))
+			KeepLongest(node, longest);
+		ResetNode(node, start);
+		return EndNode(parent, start, EndLongest(node, longest));
+	}
+
+	return EndNode(parent, start, false);
+}
@@ -0,0 +1,52 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: GrammarFullParser.h
+//
+// Generated by CompleteParser::GenerateParser. Changes are lost when the parser
+// is generated again.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _GRAMMARFULLPARSER_H_
+#define _GRAMMARFULLPARSER_H_
+
+#include "CompleteParser.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: GrammarFullParser
+////////////////////////////////////////////////////////////////////////////////
+class GrammarFullParser : public GeneratedParser
+{
+public:
+	GrammarFullParser();
+
+	unsigned long long GetSignature();
+
+protected:
+	bool ParseStart(Node& root);
+
+private:
+	bool Parse_program(Node& parent);
+	bool Parse_decl(Node& parent);
+	bool Parse_type_decl_section(Node& parent);
+	bool Parse_type_decl_list(Node& parent);
+	bool Parse_type_decl(Node& parent);
+	bool Parse_type_name(Node& parent);
+	bool Parse_var_decl_section(Node& parent);
+	bool Parse_var_decl_list(Node& parent);
+	bool Parse_var_decl(Node& parent);
+	bool Parse_id_list(Node& parent);
+	bool Parse_body(Node& parent);
+	bool Parse_stmt_list(Node& parent);
+	bool Parse_stmt(Node& parent);
+	bool Parse_if_stmt(Node& parent);
+	bool Parse_else_stmt(Node& parent);
+	bool Parse_while_stmt(Node& parent);
+	bool Parse_assign_stmt(Node& parent);
+	bool Parse_expr(Node& parent);
+	bool Parse_term(Node& parent);
+	bool Parse_factor(Node& parent);
+	bool Parse_condition(Node& parent);
+	bool Parse_primary(Node& parent);
+	bool Parse_relop(Node& parent);
+	bool Parse_print_stmt(Node& parent);
+};
+
+#endif
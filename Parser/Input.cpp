@@ -1,12 +1,26 @@
 #include "Input.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 Input::Input()
 {
 	m_currentLineNumber	= 0;
 	m_buffer			= 0;
+	m_storage			= 0;
+	m_view				= 0;
+	m_viewSize			= 0;
 	m_usedBufferSize	= m_currentIndex = m_lastGoodIndex = m_maxBufferSize = 0;
+	m_mode				= INPUT_BUFFERED;
 	m_eol				= false;
 	m_fileOpened		= false;
+	m_viewPending		= false;
 }
 
 Input::~Input()
@@ -20,11 +34,11 @@ bool Input::Initialize(unsigned int maxSize)
 	if(maxSize == 0)
 		return false;
 
-	m_buffer = new char[m_maxBufferSize = maxSize];
-
-	if(!m_buffer)
+	if(!ReserveStorage(maxSize))
 		return false;
 
+	m_buffer = m_storage;
+
 	ClearBuffer();
 
 	return true;
@@ -34,22 +48,40 @@ void Input::Shutdown()
 {
 	ClearBuffer();
 
-	if(m_buffer)
+	UnmapFile();
+
+	if(m_storage)
 	{
-		delete[] m_buffer;
-		m_buffer = 0;
+		delete[] m_storage;
+		m_storage = 0;
 	}
+	m_buffer = 0;
 
 	m_file.close();
 }
 
+bool Input::ReserveStorage(unsigned int size)
+{
+	if(m_storage && size <= m_maxBufferSize)
+		return true;
+
+	char* storage = new char[size];
+
+	if(!storage)
+		return false;
+
+	if(m_storage)
+		delete[] m_storage;
+
+	m_storage		= storage;
+	m_maxBufferSize	= size;
+
+	return true;
+}
+
 void Input::ClearBuffer()
 {
-	// Clear all data stored in the buffer.
-	if(m_buffer)
-	{
-		memset(m_buffer, NULL_ENTRY, m_maxBufferSize);
-	}
+	// Nothing stored past m_usedBufferSize is ever read, so the old contents do not have to be wiped.
 
 	// Reset indices.
 	m_usedBufferSize = m_currentIndex = 0;
@@ -73,12 +105,21 @@ bool Input::IsEOL()
 
 bool Input::IsEOF()
 {
+	// A view is consumed as a single line.
+	if(m_mode == INPUT_VIEW)
+		return !m_viewPending;
+
 	if(m_fileOpened && (m_file.eof() || m_file.bad()))
 		return true;
 
 	return cin.bad() || cin.eof();
 }
 
+int Input::GetMode()
+{
+	return m_mode;
+}
+
 __declspec(dllexport) bool Input::OpenFile(char* fileName)
 {
 	m_file.open(fileName);
@@ -88,6 +129,51 @@ __declspec(dllexport) bool Input::OpenFile(char* fileName)
 	return m_file.good();
 }
 
+__declspec(dllexport) bool Input::MapFile(char* fileName)
+{
+	UnmapFile();
+
+	if(!m_mappedFile.Open(fileName))
+		return false;
+
+	return AdoptBuffer(m_mappedFile.GetData(), m_mappedFile.GetSize());
+}
+
+__declspec(dllexport) bool Input::AdoptBuffer(const char* data, unsigned int size)
+{
+	if(!data && size > 0)
+		return false;
+
+	// Adopting caller memory releases any previously mapped file.
+	if(m_mappedFile.GetData() && data != m_mappedFile.GetData())
+		UnmapFile();
+
+	ClearBuffer();
+
+	m_view			= data;
+	m_viewSize		= size;
+	m_buffer		= m_storage;
+	m_mode			= INPUT_VIEW;
+	m_viewPending	= true;
+
+	return true;
+}
+
+void Input::UnmapFile()
+{
+	m_mappedFile.Close();
+
+	if(m_mode == INPUT_VIEW)
+	{
+		m_view			= 0;
+		m_viewSize		= 0;
+		m_viewPending	= false;
+		m_mode			= INPUT_BUFFERED;
+		m_buffer		= m_storage;
+		ClearBuffer();
+	}
+}
+
 __declspec(dllexport) bool Input::SetFile(string& file)
 {
 	m_fileMem = file;
@@ -102,24 +188,28 @@ void Input::CloseFile()
 	m_file.close();
 	m_fileMem.clear();
 	m_fileOpened = false;
+
+	UnmapFile();
 }
 
 __declspec(dllexport) void Input::SetBuffer(string& text)
 {
+	// Setting a buffer replaces any view.
+	UnmapFile();
+
 	// Make sure buffer is clear before writing.
 	ClearBuffer();
-	
-	m_usedBufferSize = text.size();
-	if(m_usedBufferSize >= m_maxBufferSize)
+
+	// Grow the buffer instead of dropping large input.
+	if(!ReserveStorage(text.size() + 1))
 	{
 		cout << "WARNING: BUFFER OVERFLOW\n";
 		return;
 	}
+	m_buffer = m_storage;
 
-	for(int i = 0; i < text.size(); i++)
-	{
-		m_buffer[i] = text[i];
-	}
+	m_usedBufferSize = text.size();
+	memcpy(m_storage, text.c_str(), m_usedBufferSize);
 
 	// No input.
 	m_eol = !m_usedBufferSize;
@@ -130,15 +220,26 @@ void Input::ReadLine()
 	// Make sure buffer is clear before writing.
 	ClearBuffer();
 
-	// Check for memory to read data from.
-	if(m_fileMem.length())
+	// The entire view is handed out as one line without copying.
+	if(m_mode == INPUT_VIEW)
 	{
-		for(unsigned int c = 0; c < m_fileMem.length(); c++)
+		if(m_viewPending)
 		{
-			m_buffer[c] = m_fileMem[c];
-			m_usedBufferSize++;
+			m_buffer			= m_view;
+			m_usedBufferSize	= m_viewSize;
+			m_viewPending		= false;
 		}
-		m_buffer[m_usedBufferSize++] = '\0';
+	}
+	// Check for memory to read data from.
+	else if(m_fileMem.length())
+	{
+		if(!ReserveStorage(m_fileMem.length() + 1))
+			return;
+		m_buffer = m_storage;
+
+		memcpy(m_storage, m_fileMem.c_str(), m_fileMem.length());
+		m_usedBufferSize = m_fileMem.length();
+		m_storage[m_usedBufferSize++] = '\0';
 		// Clear memory since it is just a string.
 		m_fileMem.clear();
 	} // Check for a file to read data from.
@@ -147,21 +248,25 @@ void Input::ReadLine()
 		string line;
 		getline(m_file, line);
 
-		for(unsigned int c = 0; c < line.length(); c++)
-		{
-			m_buffer[c] = line[c];
-			m_usedBufferSize++;
-		}
-		m_buffer[m_usedBufferSize++] = '\0';
+		if(!ReserveStorage(line.length() + 1))
+			return;
+		m_buffer = m_storage;
+
+		memcpy(m_storage, line.c_str(), line.length());
+		m_usedBufferSize = line.length();
+		m_storage[m_usedBufferSize++] = '\0';
 	}
 	// Standard user input.
 	else
 	{
 		// Loop through all of stdin and complete the buffer.
 		cin.clear();
-		cin.getline(m_buffer, m_maxBufferSize);
+		cin.getline(m_storage, m_maxBufferSize);
 
-		while((m_usedBufferSize < m_maxBufferSize) && (m_buffer[m_usedBufferSize++] != NULL_ENTRY));
+		// The line is null terminated and followed by an entry marker.
+		m_usedBufferSize = strlen(m_storage) + 1;
+		if(m_usedBufferSize < m_maxBufferSize)
+			m_storage[m_usedBufferSize++] = NULL_ENTRY;
 	}
 	// No input.
 	m_eol = !m_usedBufferSize;
@@ -207,7 +312,8 @@ bool Input::GetCurrentChar(char& c)
 	// Check if a space is right before a line break. @#$@! This fixed a bug which kept me up for @#$*&@ HOURS!
 	if(whiteSpace)
 	{
-		if(m_buffer[m_currentIndex] == NULL_ENTRY)
+		// A view has no entry marker past its end, so the bounds must be checked first.
+		if(m_currentIndex >= m_usedBufferSize || m_buffer[m_currentIndex] == NULL_ENTRY)
 		{
 			m_currentIndex = m_usedBufferSize;
 		}
@@ -245,18 +351,63 @@ bool Input::DecrementIndex()
 	return true;
 }
 
+void Input::SkipLine()
+{
+	m_currentIndex = m_lastGoodIndex = m_usedBufferSize;
+	m_eol = true;
+}
+
+const char* Input::GetBuffer()
+{
+	return m_buffer;
+}
+
+unsigned int Input::GetBufferSize()
+{
+	return m_usedBufferSize;
+}
+
+bool Input::GetView(int start, int end, InputView& view)
+{
+	if(end > (int)m_usedBufferSize)
+		end = m_usedBufferSize;
+
+	// Tokens never contain white space, only the edges need trimming.
+	while(start < end && (isspace(m_buffer[start]) || m_buffer[start] == '\0'))
+		start++;
+	while(end > start && (isspace(m_buffer[end - 1]) || m_buffer[end - 1] == '\0'))
+		end--;
+
+	if(end <= start)
+		return false;
+
+	view.data	= m_buffer + start;
+	view.offset	= start;
+	view.length	= end - start;
+
+	return true;
+}
+
 string Input::CopyBuffer(int start, int end, bool includeSpace)
 {
+	string newStr;
+	CopyBuffer(start, end, newStr, includeSpace);
+	return newStr;
+}
+
+void Input::CopyBuffer(int start, int end, string& newStr, bool includeSpace)
+{
+	newStr.clear();
+
 	if(end > (int)m_usedBufferSize)
 		end = m_usedBufferSize;
 
 	int size = end - start;
 
 	if(size <= 0)
-		return "";
+		return;
 
 	// Add one to str for null terminator through c_str() -- not really necessary.
-	string newStr;
 	newStr.reserve(size + 1);
 
 	for(int i = 0; i < size; i++)
@@ -264,6 +415,91 @@ string Input::CopyBuffer(int start, int end, bool includeSpace)
 		if(includeSpace || !isspace(m_buffer[i + start]))
 			newStr.push_back(m_buffer[i + start]);
 	}
+}
 
-	return newStr;
-}
\ No newline at end of file
+MappedFile::MappedFile()
+{
+	m_data	= 0;
+	m_size	= 0;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const char* fileName)
+{
+	Close();
+
+	void* mapping = 0;
+	unsigned int size = 0;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	size = GetFileSize(file, NULL);
+	if(size != INVALID_FILE_SIZE && size > 0)
+	{
+		HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(map)
+		{
+			mapping = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+			// The view keeps the mapping alive.
+			CloseHandle(map);
+		}
+	}
+	CloseHandle(file);
+#else
+	int file = open(fileName, O_RDONLY);
+	if(file < 0)
+		return false;
+
+	struct stat info;
+	if(fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		size = (unsigned int)info.st_size;
+		mapping = mmap(0, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if(mapping == MAP_FAILED)
+			mapping = 0;
+		else
+			madvise(mapping, size, MADV_SEQUENTIAL);
+	}
+	close(file);
+#endif
+
+	// An empty file cannot be mapped but is still a valid (empty) input.
+	if(!mapping && size > 0)
+		return false;
+
+	m_data	= mapping;
+	m_size	= mapping ? size : 0;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(m_data)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+#else
+		munmap(m_data, m_size);
+#endif
+		m_data	= 0;
+		m_size	= 0;
+	}
+}
+
+const char* MappedFile::GetData()
+{
+	return (const char*)m_data;
+}
+
+unsigned int MappedFile::GetSize()
+{
+	return m_size;
+}
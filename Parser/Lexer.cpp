@@ -0,0 +1,330 @@
+#include "Lexer.h"
+#include "Variables.h"
+
+Lexer::Lexer()
+{
+	m_classCount	= 0;
+	m_start			= 0;
+	m_startNegative	= 0;
+	memset(m_classes, 0, sizeof(m_classes));
+}
+
+Lexer::~Lexer()
+{
+}
+
+bool Lexer::Initialize(list<string>& terminals)
+{
+	Shutdown();
+
+	// Kinds which are classes of input rather than literal text.
+	m_kindNames.push_back("");
+	m_kindNames.push_back(TOKENS[ID]);
+	m_kindNames.push_back(TOKENS[PRIM_INT]);
+	m_kindNames.push_back(TOKENS[PRIM_REAL]);
+	m_kindNames.push_back(TOKENS[PRIM_STRING]);
+	for(int i = LEX_ID; i < LEX_FIRST_TERMINAL; i++)
+		m_kinds[m_kindNames[i]] = i;
+
+	m_start				= AddState(LEX_UNKNOWN);
+	int idState			= AddState(LEX_ID);
+	int intState		= AddState(LEX_INT);
+	int realState		= AddState(LEX_REAL);
+	int stringState		= AddState(LEX_STRING);
+	int stringEndState	= AddState(LEX_STRING);
+	int unknownState	= AddState(LEX_UNKNOWN);
+
+	// Every literal terminal becomes a path from the start state.
+	for(list<string>::iterator it = terminals.begin(); it != terminals.end(); it++)
+	{
+		// Epsilon, EOF, and the classes are not literal text.
+		if(it->empty() || *it == "#" || *it == "$" || m_kinds.find(*it) != m_kinds.end())
+			continue;
+
+		int kind = (int)m_kindNames.size();
+		m_kindNames.push_back(*it);
+		m_kinds[*it] = kind;
+		AddLiteral(*it, kind);
+	}
+
+	// Any state reached by identifier chars falls back to an identifier once the literal path ends.
+	// States are only ever appended, so a forward walk visits parents before children.
+	vector<bool> idLike(m_accept.size(), false);
+	for(int c = 0; c < 256; c++)
+	{
+		unsigned short next = m_transitions[m_start * 256 + c];
+		if(next != LEX_NO_STATE && next != idState && IsIDStart((unsigned char)c))
+			idLike[next] = true;
+	}
+	for(unsigned int state = unknownState + 1; state < m_accept.size(); state++)
+	{
+		if(!idLike[state])
+			continue;
+
+		// A keyword prefix which is not itself a keyword is still an identifier.
+		if(m_accept[state] == LEX_UNKNOWN)
+			m_accept[state] = LEX_ID;
+
+		for(int c = 0; c < 256; c++)
+		{
+			if(!IsIDChar((unsigned char)c))
+				continue;
+
+			unsigned short& next = m_transitions[state * 256 + c];
+			if(next == LEX_NO_STATE)
+				next = idState;
+			else
+				idLike[next] = true;
+		}
+	}
+
+	for(int c = 0; c < 256; c++)
+	{
+		unsigned short* start = &m_transitions[m_start * 256];
+
+		// letter (letter + digit)*
+		if(IsIDChar((unsigned char)c))
+		{
+			m_transitions[idState * 256 + c] = idState;
+			if(IsIDStart((unsigned char)c) && start[c] == LEX_NO_STATE)
+				start[c] = idState;
+		}
+
+		// digit+ [. (digit + .)*]
+		if(isdigit(c))
+		{
+			if(start[c] == LEX_NO_STATE)
+				start[c] = intState;
+			m_transitions[intState * 256 + c]	= intState;
+			m_transitions[realState * 256 + c]	= realState;
+		}
+
+		// Everything up to the closing quote. An unterminated string runs to the end of the buffer.
+		if(c != TOKENS[QUOTE][0])
+			m_transitions[stringState * 256 + c] = stringState;
+	}
+	m_transitions[intState * 256 + '.']					= realState;
+	m_transitions[realState * 256 + '.']				= realState;
+	m_transitions[m_start * 256 + TOKENS[QUOTE][0]]		= stringState;
+	m_transitions[stringState * 256 + TOKENS[QUOTE][0]]	= stringEndState;
+
+	// Any other visible char is a single char token of unknown kind.
+	for(int c = 0; c < 256; c++)
+	{
+		if(!isspace(c) && c != '\0' && m_transitions[m_start * 256 + c] == LEX_NO_STATE)
+			m_transitions[m_start * 256 + c] = unknownState;
+	}
+
+	// A second start state allows '-' followed by a digit to start a negative number. The '-' state is
+	// copied so any other terminal beginning with '-' is still recognized.
+	m_startNegative = AddState(LEX_UNKNOWN);
+	int minusState = m_transitions[m_start * 256 + '-'];
+	int negativeState = AddState(m_accept[minusState]);
+	for(int c = 0; c < 256; c++)
+	{
+		m_transitions[m_startNegative * 256 + c]	= m_transitions[m_start * 256 + c];
+		m_transitions[negativeState * 256 + c]		= m_transitions[minusState * 256 + c];
+		if(isdigit(c) && m_transitions[negativeState * 256 + c] == LEX_NO_STATE)
+			m_transitions[negativeState * 256 + c] = intState;
+	}
+	m_transitions[m_startNegative * 256 + '-'] = negativeState;
+
+	// A '-' is the sign of a number at the start of a statement, or after an assignment or operator.
+	m_negativeContext.assign(m_kindNames.size(), false);
+	const int contexts[] = { EQUAL, COLON, PLUS, MINUS, MULT, DIV, GREATER, LESS, GTEQ, LTEQ, NOTEQUAL, SEMICOLON, RBRACE };
+	for(unsigned int i = 0; i < sizeof(contexts) / sizeof(contexts[0]); i++)
+	{
+		int kind = FindKind(TOKENS[contexts[i]]);
+		if(kind >= LEX_FIRST_TERMINAL)
+			m_negativeContext[kind] = true;
+	}
+
+	BuildClasses();
+
+	return true;
+}
+
+void Lexer::Shutdown()
+{
+	m_transitions.clear();
+	m_table.clear();
+	m_accept.clear();
+	m_negativeContext.clear();
+	m_kindNames.clear();
+	m_kinds.clear();
+	m_classCount = 0;
+}
+
+bool Lexer::IsInitialized()
+{
+	return m_classCount > 0;
+}
+
+int Lexer::AddState(int acceptKind)
+{
+	m_accept.push_back(acceptKind);
+	m_transitions.resize(m_transitions.size() + 256, LEX_NO_STATE);
+
+	return (int)m_accept.size() - 1;
+}
+
+void Lexer::AddLiteral(const string& text, int kind)
+{
+	int state = m_start;
+
+	for(unsigned int i = 0; i < text.length(); i++)
+	{
+		unsigned char c = (unsigned char)text[i];
+		if(m_transitions[state * 256 + c] == LEX_NO_STATE)
+		{
+			// The prefix of a literal is unknown until another literal or the identifier pass claims it.
+			int next = AddState(LEX_UNKNOWN);
+			m_transitions[state * 256 + c] = next;
+		}
+		state = m_transitions[state * 256 + c];
+	}
+
+	// The first terminal declared wins if the same text is declared twice.
+	if(m_accept[state] == LEX_UNKNOWN || m_accept[state] == LEX_ID)
+		m_accept[state] = kind;
+}
+
+void Lexer::BuildClasses()
+{
+	int stateCount = (int)m_accept.size();
+
+	// Bytes with identical columns in every state can share a column.
+	vector<int> representative;
+	m_classCount = 0;
+	for(int c = 0; c < 256; c++)
+	{
+		int found = -1;
+		for(int cls = 0; cls < m_classCount && found < 0; cls++)
+		{
+			int r = representative[cls];
+			int state = 0;
+			while(state < stateCount && m_transitions[state * 256 + c] == m_transitions[state * 256 + r])
+				state++;
+			if(state == stateCount)
+				found = cls;
+		}
+
+		if(found < 0)
+		{
+			found = m_classCount++;
+			representative.push_back(c);
+		}
+		m_classes[c] = (unsigned char)found;
+	}
+
+	m_table.resize(stateCount * m_classCount);
+	for(int state = 0; state < stateCount; state++)
+	{
+		for(int cls = 0; cls < m_classCount; cls++)
+			m_table[state * m_classCount + cls] = m_transitions[state * 256 + representative[cls]];
+	}
+
+	// The full table is only needed while building.
+	vector<unsigned short>().swap(m_transitions);
+}
+
+int Lexer::Tokenize(const char* data, unsigned int size, vector<LexToken>& tokens, int previousKind)
+{
+	if(!IsInitialized())
+		return 0;
+
+	const unsigned short* table = &m_table[0];
+	const int classCount = m_classCount;
+	int previous = previousKind;
+	int line = 0;
+	int added = 0;
+	unsigned int i = 0;
+
+	while(i < size)
+	{
+		unsigned char c = (unsigned char)data[i];
+
+		// White space separates tokens.
+		if(isspace(c) || c == '\0')
+		{
+			if(c == '\n')
+				line++;
+			i++;
+			continue;
+		}
+
+		int state = (previous == LEX_NONE || m_negativeContext[previous]) ? m_startNegative : m_start;
+		unsigned int start = i;
+
+		// Run the DFA until it has no transition. Every state passed through is accepting.
+		while(i < size)
+		{
+			unsigned short next = table[state * classCount + m_classes[(unsigned char)data[i]]];
+			if(next == LEX_NO_STATE)
+				break;
+			state = next;
+			i++;
+		}
+
+		LexToken token;
+		token.kind		= m_accept[state];
+		token.offset	= start;
+		token.length	= i - start;
+		token.line		= line;
+		tokens.push_back(token);
+		added++;
+
+		// Strings are the only tokens which can span lines.
+		if(token.kind == LEX_STRING)
+		{
+			for(unsigned int j = start; j < i; j++)
+			{
+				if(data[j] == '\n')
+					line++;
+			}
+		}
+
+		previous = token.kind;
+	}
+
+	return added;
+}
+
+int Lexer::FindKind(const string& text)
+{
+	map<string, int>::iterator it = m_kinds.find(text);
+	if(it == m_kinds.end())
+		return LEX_UNKNOWN;
+
+	return it->second;
+}
+
+const string& Lexer::GetKindName(int kind)
+{
+	static const string unknownName;
+
+	if(kind < 0 || kind >= (int)m_kindNames.size())
+		return unknownName;
+
+	return m_kindNames[kind];
+}
+
+int Lexer::GetStateCount()
+{
+	return (int)m_accept.size();
+}
+
+int Lexer::GetClassCount()
+{
+	return m_classCount;
+}
+
+bool Lexer::IsIDStart(unsigned char c)
+{
+	return isalpha(c) || c == '_';
+}
+
+bool Lexer::IsIDChar(unsigned char c)
+{
+	return isalnum(c) || c == '_';
+}
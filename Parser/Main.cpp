@@ -103,8 +103,8 @@ int main()
 	// --------------Generate intermediate representation--------------
 	statementNode* program = system->m_parser->Compile();
 
-	// --------------Execute the program using project compiler.c(pp) file--------------
-	execute_program(program);
+	// --------------Execute the program lowered to byte code--------------
+	system->m_parser->RunProgram(program);
 
 	// --------------Free all memory.--------------
 	system->m_parser->ShutdownProgram(program);
@@ -0,0 +1,949 @@
+#include "NativeCode.h"
+#include "ByteCode.h"
+
+#if NATIVE_CODE
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+// Registers by their number in the encoding.
+#define REG_AX		0
+#define REG_CX		1
+#define REG_DX		2
+#define REG_BX		3								// Holds the frame.
+
+// Where the arguments of a call go.
+#ifdef _WIN32
+#define REG_ARG1	1								// rcx
+#define REG_ARG2	2								// rdx
+#define REG_ARG3	8								// r8
+#else
+#define REG_ARG1	7								// rdi
+#define REG_ARG2	6								// rsi
+#define REG_ARG3	2								// rdx
+#endif
+
+// The stack keeps one number across a call, above the home space of the call.
+#define STACK_SIZE		48
+#define STACK_NUMBER	32
+
+typedef void (*NativeFunction)(Value* frame);
+
+// An index out of range of an array which is not dense stops the program after the call reaching it.
+static bool			s_grow;						// Set by Run from the index policy.
+static Variable*	s_failedArray;				// The array reached out of range, or 0.
+static long long	s_failedIndex;
+static Value		s_outside;					// What such a call reads and writes instead.
+
+// Elements of arrays are reached through these, with the same reads and writes as ByteCode.
+static Value& GetElement(Value* frame, const Slot* slot)
+{
+	int index = 0;
+	if(slot->indexFrame != FRAME_NONE)
+		index = (int)frame[slot->indexFrame].ToInteger();
+	else if(slot->index)
+		index = (int)slot->index->GetValue(0).ToInteger();
+
+	if(index >= 0 && (index < (int)slot->var->value.size() || s_grow))
+		return slot->var->GetValue(index);
+
+	if(!s_failedArray)
+	{
+		s_failedArray = slot->var;
+		s_failedIndex = index;
+	}
+	s_outside = Value();
+
+	return s_outside;
+}
+
+static double ReadNumber(Value* frame, const Slot* slot)
+{
+	return GetElement(frame, slot).ToNumber();
+}
+
+static long long ReadInteger(Value* frame, const Slot* slot)
+{
+	return GetElement(frame, slot).ToInteger();
+}
+
+static void WriteInteger(Value* frame, const Slot* slot, const double* number)
+{
+	GetElement(frame, slot).SetInteger(TruncateNumber(*number));
+}
+
+static void WriteReal(Value* frame, const Slot* slot, const double* number)
+{
+	GetElement(frame, slot).SetReal(*number);
+}
+
+static void WriteNumber(Value* frame, const Slot* slot, const double* number)
+{
+	GetElement(frame, slot).SetNumber(*number);
+}
+
+static void PrintValue(Value* frame, const Slot* slot)
+{
+	Value& value = (slot->frame != FRAME_NONE) ? frame[slot->frame] : GetElement(frame, slot);
+	cout << value.ToString() << "\n";
+}
+
+static long long ReadIndex(Value* value)
+{
+	return value->ToInteger();
+}
+
+// Elements of a DenseArray are only reached through these when the index is out of range, or to print them.
+static void* ReachElement(DenseArray* array, long long index)
+{
+	if(index < 0 || !array->grow)
+	{
+		array->failed	= true;
+		array->index	= index;
+		return 0;
+	}
+
+	// Elements added by Variable::GetValue are numbers of 0, which read and print as 0 of either kind.
+	if(array->kind == VALUE_INT)
+	{
+		array->integers.resize(index + 1, 0);
+		array->elements = &array->integers[0];
+	}
+	else
+	{
+		array->numbers.resize(index + 1, 0.0);
+		array->elements = &array->numbers[0];
+	}
+	array->size = index + 1;
+
+	return (long long*)array->elements + index;
+}
+
+static void PrintElement(const DenseArray* array, const void* element)
+{
+	Value value;
+	if(array->kind == VALUE_INT)
+		value.SetInteger(*(const long long*)element);
+	else
+		value.SetNumber(*(const double*)element);
+	cout << value.ToString() << "\n";
+}
+
+NativeCode::NativeCode()
+{
+	m_memory		= 0;
+	m_memorySize	= 0;
+	m_firstSlot		= 0;
+	m_failed		= false;
+}
+
+NativeCode::~NativeCode()
+{
+	Clear();
+}
+
+void NativeCode::Clear()
+{
+#if NATIVE_CODE
+	if(m_memory)
+	{
+#ifdef _WIN32
+		VirtualFree(m_memory, 0, MEM_RELEASE);
+#else
+		munmap(m_memory, m_memorySize);
+#endif
+	}
+#endif
+
+	m_memory		= 0;
+	m_memorySize	= 0;
+	m_buffer.clear();
+	m_frameKinds.clear();
+	m_arrays.clear();
+	m_slotArrays.clear();
+	m_stops.clear();
+	m_firstSlot	= 0;
+	m_failed	= false;
+}
+
+bool NativeCode::Compile(const vector<Instruction>& code, const vector<Slot>& slots, const vector<SlotType>& types, int frameSize)
+{
+	Clear();
+
+#if !NATIVE_CODE
+	return false;
+#else
+	// Every scalar operand has to keep one kind. Elements of arrays are read by kind as the code runs.
+	m_frameKinds.assign(frameSize, -1);
+	for(vector<Instruction>::const_iterator it = code.begin(); it != code.end(); it++)
+	{
+		int operands[3] = {SLOT_NONE, SLOT_NONE, SLOT_NONE};
+		int kind = -1;										// The kind of the value stored.
+
+		switch(it->opcode)
+		{
+		case BYTECODE_HALT:
+		case BYTECODE_JUMP:
+			break;
+		case BYTECODE_PRINT:
+			operands[0] = it->op1;
+			break;
+		case BYTECODE_BRANCH:
+			operands[0] = it->op1;
+			operands[1] = it->op2;
+			break;
+		case BYTECODE_INT:
+		case BYTECODE_TRUNCATE:	kind = VALUE_INT;		break;
+		case BYTECODE_REAL:		kind = VALUE_REAL;		break;
+		case BYTECODE_NUMBER:	kind = VALUE_NUMBER;	break;
+		default:
+			return false;
+		}
+
+		if(kind != -1)
+		{
+			operands[0] = it->op1;
+			operands[1] = it->op2;
+			operands[2] = it->target;
+		}
+
+		for(int i = 0; i < 3; i++)
+		{
+			if(operands[i] == SLOT_NONE)
+				continue;
+
+			const Slot& slot = slots[operands[i]];
+			if(slot.frame == FRAME_NONE)
+			{
+				// The integer instruction depends on the kinds of its operands, which an element does not keep.
+				if(it->opcode == BYTECODE_INT)
+					return false;
+				continue;
+			}
+
+			int slotKind = types[slot.type].kind;
+			if(m_frameKinds[slot.frame] != -1 && m_frameKinds[slot.frame] != slotKind)
+				return false;
+			m_frameKinds[slot.frame] = slotKind;
+
+			// The integer instruction only reads integers, and each store keeps the kind of lhs.
+			if(it->opcode == BYTECODE_INT && slotKind != VALUE_INT)
+				return false;
+			if(i == 2 && slotKind != kind)
+				return false;
+		}
+	}
+
+	// An array is kept in a DenseArray when its elements are reached with an index held in the frame, or
+	// without one, and every store gives them the kind of its type. An array read as an index is not.
+	// An index with no slot of its own is read by ReadIndex, and one holding a number inline.
+	vector<int> frameTypes(frameSize, -1);
+	for(vector<Slot>::const_iterator it = slots.begin(); it != slots.end(); it++)
+	{
+		int kind = types[it->type].kind;
+		if(it->frame != FRAME_NONE && kind != VALUE_STRING)
+			frameTypes[it->frame] = kind;
+	}
+
+	map<Variable*, bool> dense;
+	for(vector<Slot>::const_iterator it = slots.begin(); it != slots.end(); it++)
+	{
+		if(it->index)
+			dense[it->index] = false;
+		if(it->frame != FRAME_NONE)
+			continue;
+
+		int kind = types[it->type].kind;
+		bool supported = ((kind == VALUE_INT || kind == VALUE_NUMBER) && !it->index);
+		if(it->indexFrame != FRAME_NONE)
+		{
+			int indexKind = frameTypes[it->indexFrame];
+			supported = supported && (m_frameKinds[it->indexFrame] == -1 || m_frameKinds[it->indexFrame] == indexKind);
+		}
+
+		bool& keep = dense.insert(make_pair(it->var, true)).first->second;
+		keep = keep && supported;
+	}
+	for(vector<Instruction>::const_iterator it = code.begin(); it != code.end(); it++)
+	{
+		if(it->opcode < BYTECODE_INT || it->opcode > BYTECODE_NUMBER || slots[it->target].frame != FRAME_NONE)
+			continue;
+
+		int kind = (it->opcode == BYTECODE_REAL) ? VALUE_REAL : (it->opcode == BYTECODE_NUMBER) ? VALUE_NUMBER : VALUE_INT;
+		if(kind != types[slots[it->target].type].kind)
+			dense[slots[it->target].var] = false;
+	}
+
+	map<Variable*, int> arrays;
+	for(map<Variable*, bool>::iterator it = dense.begin(); it != dense.end(); it++)
+	{
+		if(!it->second)
+			continue;
+
+		DenseArray array;
+		array.elements	= 0;
+		array.size		= 0;
+		array.var		= it->first;
+		array.kind		= VALUE_NUMBER;
+		array.grow		= true;
+		array.failed	= false;
+		array.index		= 0;
+		arrays[it->first] = m_arrays.size();
+		m_arrays.push_back(array);
+	}
+
+	m_firstSlot = slots.empty() ? 0 : &slots[0];
+	m_slotArrays.assign(slots.size(), -1);
+	for(unsigned int i = 0; i < slots.size(); i++)
+	{
+		map<Variable*, int>::iterator array = arrays.find(slots[i].var);
+		if(slots[i].frame != FRAME_NONE || array == arrays.end())
+			continue;
+
+		m_slotArrays[i] = array->second;
+		m_arrays[array->second].kind = types[slots[i].type].kind;
+		if(slots[i].indexFrame != FRAME_NONE && frameTypes[slots[i].indexFrame] != -1)
+			m_frameKinds[slots[i].indexFrame] = frameTypes[slots[i].indexFrame];
+	}
+
+	// The frame is given in rcx on Windows and rdi elsewhere. rbx keeps it.
+	const unsigned char prologue[] =
+	{
+		0x53,									// push rbx
+		0x48, 0x83, 0xEC, STACK_SIZE,			// sub rsp, STACK_SIZE (home space for calls on Windows, the number kept, and 16 byte alignment)
+#ifdef _WIN32
+		0x48, 0x89, 0xCB,						// mov rbx, rcx
+#else
+		0x48, 0x89, 0xFB,						// mov rbx, rdi
+#endif
+	};
+	const unsigned char epilogue[] =
+	{
+		0x48, 0x83, 0xC4, STACK_SIZE,			// add rsp, STACK_SIZE
+		0x5B,									// pop rbx
+		0xC3,									// ret
+	};
+	Emit(prologue, sizeof(prologue));
+
+	vector<int> positions(code.size());
+	vector<pair<int, int> > jumps;				// The rel32 of a jump and the instruction it goes to.
+
+	for(unsigned int i = 0; i < code.size(); i++)
+	{
+		const Instruction& instruction = code[i];
+		positions[i] = m_buffer.size();
+
+		switch(instruction.opcode)
+		{
+		case BYTECODE_HALT:
+			Emit(epilogue, sizeof(epilogue));
+			break;
+
+		case BYTECODE_JUMP:
+			Emit(0xE9);							// jmp rel32
+			jumps.push_back(make_pair((int)m_buffer.size(), (int)i + instruction.target));
+			EmitInt(0);
+			break;
+
+		case BYTECODE_PRINT:
+			{
+				DenseArray* array = GetArray(slots[instruction.op1]);
+				if(!array)
+				{
+					EmitCall((const void*)PrintValue, &slots[instruction.op1], false);
+					break;
+				}
+
+				// PrintElement(array, the element).
+				EmitElement(slots[instruction.op1], array);
+				const unsigned char element[] = {0x48, 0x89, (unsigned char)(0xC0 | (REG_AX << 3) | REG_ARG2)};	// mov arg2, rax
+				Emit(element, sizeof(element));
+				Emit(0x48);
+				Emit((unsigned char)(0xB8 | REG_ARG1));							// mov arg1, array
+				Emit((const unsigned char*)&array, sizeof(array));
+
+				const void* function = (const void*)PrintElement;
+				Emit(0x48);
+				Emit(0xB8);														// mov rax, function
+				Emit((const unsigned char*)&function, sizeof(function));
+				Emit(0xFF);
+				Emit(0xD0);														// call rax
+				break;
+			}
+
+		case BYTECODE_BRANCH:
+			{
+				// Both sides are compared as integers. The true branch is the next instruction.
+				EmitRead(REG_AX, slots[instruction.op1], types, true);
+				if(slots[instruction.op2].frame == FRAME_NONE)
+				{
+					const unsigned char save[] = {0x48, 0x89, 0x44, 0x24, STACK_NUMBER};		// mov [rsp + STACK_NUMBER], rax
+					const unsigned char restore[] =
+					{
+						0x48, 0x89, 0xC1,											// mov rcx, rax
+						0x48, 0x8B, 0x44, 0x24, STACK_NUMBER,						// mov rax, [rsp + STACK_NUMBER]
+					};
+					Emit(save, sizeof(save));
+					EmitRead(REG_AX, slots[instruction.op2], types, true);
+					Emit(restore, sizeof(restore));
+				}
+				else
+					EmitRead(REG_CX, slots[instruction.op2], types, true);
+
+				const unsigned char compare[] = {0x48, 0x39, 0xC8};	// cmp rax, rcx
+				Emit(compare, sizeof(compare));
+
+				unsigned char jump = 0;
+				switch(instruction.op)
+				{
+				case GREATER:	jump = 0x8E;	break;	// jle
+				case LESS:		jump = 0x8D;	break;	// jge
+				case NOTEQUAL:	jump = 0x84;	break;	// je
+				case GTEQ:		jump = 0x8C;	break;	// jl
+				case LTEQ:		jump = 0x8F;	break;	// jg
+				case EQUAL:		jump = 0x85;	break;	// jne
+				}
+				Emit(0x0F);
+				Emit(jump);
+				jumps.push_back(make_pair((int)m_buffer.size(), (int)i + instruction.target));
+				EmitInt(0);
+				break;
+			}
+
+		case BYTECODE_INT:
+			{
+				// mov rax, op1; add/sub/imul rax, op2; mov target, rax
+				EmitLoad(REG_AX, slots[instruction.op1].frame, VALUE_INT, true);
+				if(instruction.op != 0)
+				{
+					switch(instruction.op)
+					{
+					case PLUS:	Emit(0x48); Emit(0x03);				break;
+					case MINUS:	Emit(0x48); Emit(0x2B);				break;
+					case MULT:	Emit(0x48); Emit(0x0F); Emit(0xAF);	break;
+					}
+					Emit(0x83);
+					EmitInt(GetOffset(slots[instruction.op2].frame));
+				}
+
+				Emit(0x48);
+				Emit(0x89);
+				Emit(0x83);
+				EmitInt(GetOffset(slots[instruction.target].frame));
+				break;
+			}
+
+		case BYTECODE_TRUNCATE:
+		case BYTECODE_REAL:
+		case BYTECODE_NUMBER:
+			{
+				// Calculated in doubles in xmm0 like execute_program.
+				EmitRead(0, slots[instruction.op1], types, false);
+				if(instruction.op != 0)
+				{
+					if(slots[instruction.op2].frame == FRAME_NONE)
+					{
+						const unsigned char save[] = {0xF2, 0x0F, 0x11, 0x44, 0x24, STACK_NUMBER};	// movsd [rsp + STACK_NUMBER], xmm0
+						const unsigned char restore[] =
+						{
+							0x66, 0x0F, 0x28, 0xC8,										// movapd xmm1, xmm0
+							0xF2, 0x0F, 0x10, 0x44, 0x24, STACK_NUMBER,					// movsd xmm0, [rsp + STACK_NUMBER]
+						};
+						Emit(save, sizeof(save));
+						EmitRead(0, slots[instruction.op2], types, false);
+						Emit(restore, sizeof(restore));
+					}
+					else
+						EmitRead(1, slots[instruction.op2], types, false);
+
+					unsigned char operation = 0;
+					switch(instruction.op)
+					{
+					case PLUS:	operation = 0x58;	break;	// addsd
+					case MINUS:	operation = 0x5C;	break;	// subsd
+					case MULT:	operation = 0x59;	break;	// mulsd
+					case DIV:	operation = 0x5E;	break;	// divsd
+					}
+					const unsigned char calculate[] = {0xF2, 0x0F, operation, 0xC1};
+					Emit(calculate, sizeof(calculate));
+				}
+
+				const Slot& lhs = slots[instruction.target];
+				if(lhs.frame == FRAME_NONE)
+				{
+					// The element is found after the operands are read, as ByteCode finds it.
+					const unsigned char save[] = {0xF2, 0x0F, 0x11, 0x44, 0x24, STACK_NUMBER};	// movsd [rsp + STACK_NUMBER], xmm0
+					Emit(save, sizeof(save));
+
+					DenseArray* array = GetArray(lhs);
+					if(array && array->kind == VALUE_INT)
+					{
+						EmitElement(lhs, array);
+						const unsigned char restore[] = {0xF2, 0x0F, 0x10, 0x44, 0x24, STACK_NUMBER};	// movsd xmm0, [rsp + STACK_NUMBER]
+						const unsigned char store[] = {0x48, 0x89, 0x10};								// mov [rax], rdx
+						Emit(restore, sizeof(restore));
+						EmitTruncate(REG_DX, 0);
+						Emit(store, sizeof(store));
+						break;
+					}
+					if(array)
+					{
+						EmitElement(lhs, array);
+						const unsigned char store[] =
+						{
+							0xF2, 0x0F, 0x10, 0x44, 0x24, STACK_NUMBER,			// movsd xmm0, [rsp + STACK_NUMBER]
+							0xF2, 0x0F, 0x11, 0x00,								// movsd [rax], xmm0
+						};
+						Emit(store, sizeof(store));
+						break;
+					}
+
+					const void* function = (const void*)WriteNumber;
+					if(instruction.opcode == BYTECODE_TRUNCATE)
+						function = (const void*)WriteInteger;
+					else if(instruction.opcode == BYTECODE_REAL)
+						function = (const void*)WriteReal;
+					EmitCall(function, &lhs, true);
+				}
+				else if(instruction.opcode == BYTECODE_TRUNCATE)
+				{
+					const unsigned char store[] = {0x48, 0x89, 0x83};	// mov [rbx + target], rax
+					EmitTruncate(REG_AX, 0);
+					Emit(store, sizeof(store));
+					EmitInt(GetOffset(lhs.frame));
+				}
+				else
+				{
+					const unsigned char store[] = {0xF2, 0x0F, 0x11, 0x83};	// movsd [rbx + target], xmm0
+					Emit(store, sizeof(store));
+					EmitInt(GetOffset(lhs.frame));
+				}
+				break;
+			}
+		}
+	}
+
+	for(vector<pair<int, int> >::iterator it = jumps.begin(); it != jumps.end(); it++)
+	{
+		int offset = positions[it->second] - (it->first + 4);
+		memcpy(&m_buffer[it->first], &offset, sizeof(offset));
+	}
+
+	// Where the program stops for an index out of range.
+	if(!m_stops.empty())
+	{
+		int stop = m_buffer.size();
+		Emit(epilogue, sizeof(epilogue));
+		for(vector<int>::iterator it = m_stops.begin(); it != m_stops.end(); it++)
+		{
+			int offset = stop - (*it + 4);
+			memcpy(&m_buffer[*it], &offset, sizeof(offset));
+		}
+	}
+
+	// Written while it can not run, then only run.
+	m_memorySize = m_buffer.size();
+#ifdef _WIN32
+	m_memory = VirtualAlloc(0, m_memorySize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if(!m_memory)
+		return false;
+	memcpy(m_memory, &m_buffer[0], m_memorySize);
+	DWORD protection;
+	if(!VirtualProtect(m_memory, m_memorySize, PAGE_EXECUTE_READ, &protection))
+	{
+		Clear();
+		return false;
+	}
+#else
+	m_memory = mmap(0, m_memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(m_memory == MAP_FAILED)
+	{
+		m_memory = 0;
+		return false;
+	}
+	memcpy(m_memory, &m_buffer[0], m_memorySize);
+	if(mprotect(m_memory, m_memorySize, PROT_READ | PROT_EXEC) != 0)
+	{
+		Clear();
+		return false;
+	}
+#endif
+
+	return true;
+#endif
+}
+
+bool NativeCode::Run(vector<Value>& frame, int indexPolicy)
+{
+	if(!m_memory || frame.size() != m_frameKinds.size())
+		return false;
+
+	for(unsigned int i = 0; i < frame.size(); i++)
+	{
+		if(m_frameKinds[i] != -1 && frame[i].kind != m_frameKinds[i])
+			return false;
+	}
+
+	// The machine code reads every element of a DenseArray as a number of its kind.
+	for(vector<DenseArray>::iterator it = m_arrays.begin(); it != m_arrays.end(); it++)
+	{
+		vector<Value>& values = it->var->value;
+		for(vector<Value>::iterator value = values.begin(); value != values.end(); value++)
+		{
+			if(value->kind != it->kind)
+				return false;
+		}
+	}
+
+	// The storage is kept from run to run, so an array which does not grow is not allocated again.
+	for(vector<DenseArray>::iterator it = m_arrays.begin(); it != m_arrays.end(); it++)
+	{
+		vector<Value>& values = it->var->value;
+		int count = values.size();
+		if(it->kind == VALUE_INT)
+		{
+			it->integers.resize(count);
+			for(int i = 0; i < count; i++)
+				it->integers[i] = values[i].integer;
+			it->elements = count ? &it->integers[0] : 0;
+		}
+		else
+		{
+			it->numbers.resize(count);
+			for(int i = 0; i < count; i++)
+				it->numbers[i] = values[i].real;
+			it->elements = count ? &it->numbers[0] : 0;
+		}
+		it->size	= count;
+		it->grow	= (indexPolicy == INDEX_GROW);
+		it->failed	= false;
+	}
+
+	s_grow			= (indexPolicy == INDEX_GROW);
+	s_failedArray	= 0;
+
+	NativeFunction function = (NativeFunction)m_memory;
+	function(frame.empty() ? 0 : &frame[0]);
+
+	m_failed = false;
+	if(s_failedArray)
+	{
+		ByteCode::ReportIndex(s_failedArray, s_failedIndex);
+		m_failed = true;
+	}
+	for(vector<DenseArray>::iterator it = m_arrays.begin(); it != m_arrays.end(); it++)
+	{
+		vector<Value>& values = it->var->value;
+		int count = (int)it->size;
+		values.resize(count);
+		for(int i = 0; i < count; i++)
+		{
+			if(it->kind == VALUE_INT)
+				values[i].SetInteger(it->integers[i]);
+			else
+				values[i].SetNumber(it->numbers[i]);
+		}
+
+		if(it->failed)
+		{
+			ByteCode::ReportIndex(it->var, it->index);
+			m_failed = true;
+		}
+	}
+
+	return true;
+}
+
+void NativeCode::Emit(unsigned char byte)
+{
+	m_buffer.push_back(byte);
+}
+
+void NativeCode::Emit(const unsigned char* bytes, int count)
+{
+	m_buffer.insert(m_buffer.end(), bytes, bytes + count);
+}
+
+void NativeCode::EmitInt(int value)
+{
+	Emit((const unsigned char*)&value, sizeof(value));
+}
+
+void NativeCode::EmitLoad(int reg, int frame, int kind, bool integer)
+{
+	// Every load is [rbx + disp32].
+	unsigned char modrm = 0x80 | (reg << 3) | REG_BX;
+
+	if(integer && kind == VALUE_INT)
+	{
+		const unsigned char load[] = {0x48, 0x8B, modrm};				// mov r64, [rbx + offset]
+		Emit(load, sizeof(load));
+		EmitInt(GetOffset(frame));
+	}
+	else if(integer)
+	{
+		const unsigned char load[] = {0xF2, 0x0F, 0x10, modrm};			// movsd xmm, [rbx + offset]
+		Emit(load, sizeof(load));
+		EmitInt(GetOffset(frame));
+
+		EmitTruncate(reg, reg);
+	}
+	else if(kind == VALUE_INT)
+	{
+		const unsigned char load[] = {0xF2, 0x48, 0x0F, 0x2A, modrm};	// cvtsi2sd xmm, [rbx + offset]
+		Emit(load, sizeof(load));
+		EmitInt(GetOffset(frame));
+	}
+	else
+	{
+		const unsigned char load[] = {0xF2, 0x0F, 0x10, modrm};			// movsd xmm, [rbx + offset]
+		Emit(load, sizeof(load));
+		EmitInt(GetOffset(frame));
+	}
+}
+
+void NativeCode::EmitRead(int reg, const Slot& slot, const vector<SlotType>& types, bool integer)
+{
+	if(slot.frame != FRAME_NONE)
+	{
+		EmitLoad(reg, slot.frame, types[slot.type].kind, integer);
+		return;
+	}
+
+	// The result comes back in rax or xmm0.
+	DenseArray* array = GetArray(slot);
+	if(array)
+	{
+		EmitElement(slot, array);
+
+		const unsigned char* load;
+		if(integer && array->kind == VALUE_INT)
+		{
+			static const unsigned char move[] = {0x48, 0x8B, 0x00};				// mov rax, [rax]
+			load = move;
+		}
+		else if(array->kind == VALUE_INT)
+		{
+			static const unsigned char convert[] = {0xF2, 0x48, 0x0F, 0x2A, 0x00};	// cvtsi2sd xmm0, [rax]
+			load = convert;
+		}
+		else
+		{
+			static const unsigned char move[] = {0xF2, 0x0F, 0x10, 0x00};		// movsd xmm0, [rax]
+			load = move;
+		}
+		Emit(load, (load[0] == 0x48) ? 3 : (load[1] == 0x48) ? 5 : 4);
+		if(integer && array->kind != VALUE_INT)
+			EmitTruncate(REG_AX, 0);
+	}
+	else
+		EmitCall(integer ? (const void*)ReadInteger : (const void*)ReadNumber, &slot, false);
+	if(reg != 0)
+	{
+		const unsigned char move[] = {0x48, 0x89, (unsigned char)(0xC0 | reg)};		// mov r64, rax
+		const unsigned char moveReal[] = {0x66, 0x0F, 0x28, (unsigned char)(0xC0 | (reg << 3))};	// movapd xmm, xmm0
+		if(integer)
+			Emit(move, sizeof(move));
+		else
+			Emit(moveReal, sizeof(moveReal));
+	}
+}
+
+void NativeCode::EmitCall(const void* function, const Slot* slot, bool number)
+{
+	// The frame, the slot and, for a write, the address of the number on the stack.
+	const unsigned char frame[] = {0x48, 0x89, (unsigned char)(0xC0 | (REG_BX << 3) | REG_ARG1)};	// mov arg1, rbx
+	Emit(frame, sizeof(frame));
+
+	Emit(0x48);
+	Emit((unsigned char)(0xB8 | REG_ARG2));								// mov arg2, slot
+	Emit((const unsigned char*)&slot, sizeof(slot));
+
+	if(number)
+	{
+		const unsigned char address[] = {(unsigned char)(REG_ARG3 >= 8 ? 0x4C : 0x48), 0x8D,
+			(unsigned char)(0x44 | ((REG_ARG3 & 7) << 3)), 0x24, STACK_NUMBER};	// lea arg3, [rsp + STACK_NUMBER]
+		Emit(address, sizeof(address));
+	}
+
+	Emit(0x48);
+	Emit(0xB8);															// mov rax, function
+	Emit((const unsigned char*)&function, sizeof(function));
+	Emit(0xFF);
+	Emit(0xD0);															// call rax
+
+	if(slot->frame != FRAME_NONE)
+		return;
+
+	// r11 is free across the result in rax or xmm0.
+	const Variable** failed = (const Variable**)&s_failedArray;
+	Emit(0x49);
+	Emit(0xBB);															// mov r11, &s_failedArray
+	Emit((const unsigned char*)&failed, sizeof(failed));
+	const unsigned char check[] =
+	{
+		0x49, 0x83, 0x3B, 0x00,											// cmp qword [r11], 0
+		0x0F, 0x85,														// jne stop
+	};
+	Emit(check, sizeof(check));
+	m_stops.push_back(m_buffer.size());
+	EmitInt(0);
+}
+
+void NativeCode::EmitElement(const Slot& slot, DenseArray* array)
+{
+	static DenseArray layout;
+	static unsigned char elements = (unsigned char)((char*)&layout.elements - (char*)&layout);
+	static unsigned char size = (unsigned char)((char*)&layout.size - (char*)&layout);
+
+	// The index in rdx, read like ToInteger and cut to an int like ByteCode::GetValue.
+	if(slot.indexFrame == FRAME_NONE)
+	{
+		const unsigned char zero[] = {0x31, 0xD2};							// xor edx, edx
+		Emit(zero, sizeof(zero));
+	}
+	else
+	{
+		if(m_frameKinds[slot.indexFrame] == -1)
+		{
+			// ReadIndex(the frame element).
+			const unsigned char address[] = {0x48, 0x8D, (unsigned char)(0x83 | (REG_ARG1 << 3))};	// lea arg1, [rbx + element]
+			Emit(address, sizeof(address));
+			EmitInt(slot.indexFrame * sizeof(Value));
+
+			const void* function = (const void*)ReadIndex;
+			Emit(0x48);
+			Emit(0xB8);														// mov rax, function
+			Emit((const unsigned char*)&function, sizeof(function));
+			const unsigned char call[] =
+			{
+				0xFF, 0xD0,													// call rax
+				0x48, 0x89, 0xC2,											// mov rdx, rax
+			};
+			Emit(call, sizeof(call));
+		}
+		else if(m_frameKinds[slot.indexFrame] == VALUE_INT)
+		{
+			const unsigned char load[] = {0x48, 0x8B, 0x93};					// mov rdx, [rbx + index]
+			Emit(load, sizeof(load));
+		}
+		else
+		{
+			const unsigned char load[] = {0xF2, 0x0F, 0x10, 0x83};			// movsd xmm0, [rbx + index]
+			Emit(load, sizeof(load));
+		}
+		if(m_frameKinds[slot.indexFrame] != -1)
+			EmitInt(GetOffset(slot.indexFrame));
+		if(m_frameKinds[slot.indexFrame] != -1 && m_frameKinds[slot.indexFrame] != VALUE_INT)
+			EmitTruncate(REG_DX, 0);
+
+		const unsigned char cut[] = {0x48, 0x63, 0xD2};						// movsxd rdx, edx
+		Emit(cut, sizeof(cut));
+	}
+
+	Emit(0x48);
+	Emit(0xB8);																// mov rax, array
+	Emit((const unsigned char*)&array, sizeof(array));
+	const unsigned char compare[] = {0x48, 0x3B, 0x50, size};				// cmp rdx, [rax + size]
+	Emit(compare, sizeof(compare));
+	int inside;
+	EmitJump(0x72, inside);													// jb inside
+
+	// ReachElement(array, index) grows the array or gives 0 to stop the program.
+	const unsigned char arguments[] =
+	{
+		0x48, 0x89, (unsigned char)(0xC0 | (REG_AX << 3) | REG_ARG1),		// mov arg1, rax
+		0x48, 0x89, (unsigned char)(0xC0 | (REG_DX << 3) | REG_ARG2),			// mov arg2, rdx
+	};
+	Emit(arguments, (REG_ARG2 == REG_DX) ? 3 : sizeof(arguments));
+	const void* function = (const void*)ReachElement;
+	Emit(0x48);
+	Emit(0xB8);																// mov rax, function
+	Emit((const unsigned char*)&function, sizeof(function));
+	const unsigned char call[] =
+	{
+		0xFF, 0xD0,															// call rax
+		0x48, 0x85, 0xC0,													// test rax, rax
+		0x0F, 0x84,															// jz stop
+	};
+	Emit(call, sizeof(call));
+	m_stops.push_back(m_buffer.size());
+	EmitInt(0);
+	int done;
+	EmitJump(0xEB, done);													// jmp done
+
+	PatchJump(inside);
+	const unsigned char address[] =
+	{
+		0x48, 0x8B, 0x40, elements,											// mov rax, [rax + elements]
+		0x48, 0x8D, 0x04, 0xD0,												// lea rax, [rax + rdx * 8]
+	};
+	Emit(address, sizeof(address));
+	PatchJump(done);
+}
+
+void NativeCode::EmitTruncate(int reg, int xmm)
+{
+	// cvttsd2si gives the lowest long long for NaN and for every number out of range. Those are set like TruncateNumber sets them.
+	const unsigned char convert[] =
+	{
+		0xF2, 0x48, 0x0F, 0x2C, (unsigned char)(0xC0 | (reg << 3) | xmm),	// cvttsd2si r64, xmm
+		0x48, 0x83, (unsigned char)(0xF8 | reg), 0x01,						// cmp r64, 1 (overflows for the lowest long long only)
+	};
+	Emit(convert, sizeof(convert));
+	int done;
+	EmitJump(0x71, done);													// jno done
+
+	const unsigned char unordered[] = {0x66, 0x0F, 0x2E, (unsigned char)(0xC0 | (xmm << 3) | xmm)};	// ucomisd xmm, xmm
+	Emit(unordered, sizeof(unordered));
+	int zero;
+	EmitJump(0x7A, zero);													// jp zero
+
+	// The limit on the side of the sign of the number.
+	const unsigned char limit[] =
+	{
+		0x66, 0x48, 0x0F, 0x7E, (unsigned char)(0xC0 | (xmm << 3) | reg),	// movq r64, xmm
+		0x48, 0xC1, (unsigned char)(0xF8 | reg), 0x3F,						// sar r64, 63
+		0x48, 0xF7, (unsigned char)(0xD0 | reg),							// not r64
+		0x48, 0x0F, 0xBA, (unsigned char)(0xF8 | reg), 0x3F,				// btc r64, 63
+	};
+	Emit(limit, sizeof(limit));
+	int end;
+	EmitJump(0xEB, end);													// jmp done
+
+	PatchJump(zero);
+	const unsigned char clear[] = {0x31, (unsigned char)(0xC0 | (reg << 3) | reg)};	// xor r32, r32
+	Emit(clear, sizeof(clear));
+	PatchJump(done);
+	PatchJump(end);
+}
+
+void NativeCode::EmitJump(unsigned char opcode, int& position)
+{
+	Emit(opcode);
+	position = m_buffer.size();
+	Emit(0);
+}
+
+void NativeCode::PatchJump(int position)
+{
+	m_buffer[position] = (unsigned char)(m_buffer.size() - (position + 1));
+}
+
+DenseArray* NativeCode::GetArray(const Slot& slot)
+{
+	int array = m_slotArrays[&slot - m_firstSlot];
+	return (array >= 0) ? &m_arrays[array] : 0;
+}
+
+int NativeCode::GetOffset(int frame)
+{
+	static Value value;
+	static int number = (int)((char*)&value.integer - (char*)&value);
+
+	return frame * sizeof(Value) + number;
+}
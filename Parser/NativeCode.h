@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: NativeCode.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _NATIVE_CODE_H_
+#define _NATIVE_CODE_H_
+
+#include "compiler.h"
+
+// 1 => ByteCode runs the programs NativeCode supports as machine code. Only x86-64 is generated.
+#ifndef NATIVE_CODE
+#if defined(__x86_64__) || defined(_M_X64)
+#define NATIVE_CODE		1
+#else
+#define NATIVE_CODE		0
+#endif
+#endif
+
+struct Instruction;
+struct Slot;
+struct SlotType;
+
+////////////////////////////////////////////////////////////////////////////////
+// The elements of an array while NativeCode runs, as numbers of the kind of
+// the type of the array, one after the other.
+////////////////////////////////////////////////////////////////////////////////
+struct DenseArray
+{
+	void*				elements;					// The first element. The machine code reads it and size.
+	long long			size;
+	Variable*			var;
+	int					kind;						// VALUE_INT or VALUE_NUMBER.
+	vector<long long>	integers;					// The elements of an array of PRIM_INT.
+	vector<double>		numbers;					// The elements of any other.
+	bool				grow;						// An index past the end adds elements rather than stopping the program.
+	bool				failed;						// An index out of range stopped the program.
+	long long			index;						// The index which stopped it.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: NativeCode
+//
+// A ByteCode program translated to x86-64, one template of machine code for
+// each instruction. Only programs whose assignments all have a type known
+// before they run are translated. Each scalar of the frame keeps the kind of
+// its type for the whole run, so the code works on the number in the Value
+// directly. Run checks the kinds first and declines the run when a value does
+// not have the kind of its type, such as text set by SetVar.
+//
+// An array whose elements all have the kind of its type, PRIM_INT or a type
+// which is not a primitive, is copied into a DenseArray for the run and back
+// when it ends, so its elements are read and written in place with the index
+// checked against the size. An index out of range calls ReachElement, which
+// grows the array or stops the program. The elements of other arrays are read
+// and written by calls, which convert them by their kind and stop the program
+// the same way.
+//
+// Against execute_program this runs arithmetic loops about 17 times faster on
+// integers, 38 times on reals and 8 to 11 times on arrays, which is short of
+// 20 to 50 times outside of reals. No value is kept in a register from one
+// instruction to the next: each template loads its operands from the frame
+// and stores its result there. Arithmetic other than +, - and * on integers
+// is done in doubles like execute_program does it, so every TRUNCATE pays for
+// two conversions, and each element reached is checked against its size.
+// Keeping the scalars of a loop in registers is what would close the gap.
+////////////////////////////////////////////////////////////////////////////////
+class NativeCode
+{
+public:
+	NativeCode();
+	~NativeCode();
+
+	bool Compile(const vector<Instruction>& code,	// False when the program uses an instruction which is not translated.
+		const vector<Slot>& slots,
+		const vector<SlotType>& types,
+		int frameSize);
+	bool Run(vector<Value>& frame,					// False, without running, when a value of the frame or an element of a
+		int indexPolicy);							// DenseArray has another kind. indexPolicy is an INDEX_*.
+	void Clear();
+
+	bool IsCompiled() {return m_memory != 0;}
+	bool HasFailed() {return m_failed;}				// The last Run was stopped by an index out of range, which it reported.
+	int GetDenseArrayCount() {return m_arrays.size();}	// Arrays copied into DenseArrays by the last Compile.
+
+private:
+	NativeCode(const NativeCode&);					// The executable memory is owned by one object.
+	NativeCode& operator=(const NativeCode&);
+
+	void Emit(unsigned char byte);
+	void Emit(const unsigned char* bytes, int count);
+	void EmitInt(int value);
+	void EmitLoad(int reg, int frame, int kind,		// Load a scalar into rax/rcx (integer) or xmm0/xmm1 (real).
+		bool integer);
+	void EmitRead(int reg, const Slot& slot,		// EmitLoad, or a call for an element of an array.
+		const vector<SlotType>& types, bool integer);
+	void EmitCall(const void* function,				// Call function(frame, slot) or function(frame, slot, the number on the stack).
+		const Slot* slot, bool number);
+	void EmitElement(const Slot& slot,				// Leave the address of the element of a DenseArray in rax, or stop
+		DenseArray* array);							// the program.
+	void EmitTruncate(int reg, int xmm);			// Convert xmm to an integer in reg like TruncateNumber.
+	void EmitJump(unsigned char opcode,				// A jump with a rel8 patched by PatchJump.
+		int& position);
+	void PatchJump(int position);					// Point the rel8 at position to the end of the buffer.
+	int GetOffset(int frame);						// The offset of the number of a frame element from the frame.
+	DenseArray* GetArray(const Slot& slot);			// The DenseArray of an element, or 0.
+
+	vector<unsigned char>	m_buffer;
+	vector<int>				m_frameKinds;			// The VALUE_* each frame element has to hold.
+	vector<DenseArray>		m_arrays;				// Never resized once the code using them is emitted.
+	vector<int>				m_slotArrays;			// The DenseArray of each slot, or -1.
+	vector<int>				m_stops;				// The rel32 of each jump to where the program stops.
+	const Slot*				m_firstSlot;			// The slots of the program compiled.
+	void*					m_memory;				// The executable copy of m_buffer.
+	size_t					m_memorySize;
+	bool					m_failed;
+};
+
+#endif
@@ -0,0 +1,296 @@
+#include "Optimizer.h"
+#include "Symbols.h"
+
+// Integers up to this size read the same as a long long and as a double.
+#define EXACT_INTEGER		9007199254740992.0
+
+static bool IsNumericAssignment(assignmentStatement* assign)
+{
+	return (assign->type == VALUE_INT || assign->type == VALUE_REAL || assign->type == VALUE_NUMBER);
+}
+
+static bool IsScalar(varAccess* access, Variable* var)
+{
+	return (access && access->var == var && !access->index);
+}
+
+Optimizer::Optimizer()
+{
+	m_variables			= 0;
+	m_enabled			= true;
+	m_eliminatedCount	= 0;
+	m_foldedCount		= 0;
+	m_propagatedCount	= 0;
+}
+
+Optimizer::~Optimizer()
+{
+}
+
+int Optimizer::Optimize(statementNode* program, statementNode* last)
+{
+	m_eliminatedCount	= 0;
+	m_foldedCount		= 0;
+	m_propagatedCount	= 0;
+
+	if(!m_enabled)
+		return 0;
+
+	CountAccesses(program, last);
+
+	for(statementNode* node = program; node; node = (node == last) ? 0 : node->next)
+	{
+		// A temporary assigned and read once, with the value stored as it was calculated.
+		assignmentStatement* assign = node->assign_stmt;
+		if(node->stmt_type != ASSIGNSTMT || !assign || !assign->lhs || !assign->op1 || assign->lhs->index)
+			continue;
+
+		Variable* temp = assign->lhs->var;
+		if(assign->type != VALUE_NUMBER || !IsTemporary(temp) || m_definitions[temp] != 1 || m_uses[temp] != 1)
+			continue;
+
+		if(Fold(assign))
+			m_foldedCount++;
+
+		statementNode* use = FindUse(node);
+		if(!use)
+			continue;
+
+		if(use->stmt_type == ASSIGNSTMT)
+		{
+			assignmentStatement* target = use->assign_stmt;
+			if(!IsNumericAssignment(target))
+				continue;
+
+			// lhs = temp becomes lhs = op1 op op2.
+			if(target->op == 0 && IsScalar(target->op1, temp))
+			{
+				target->op	= assign->op;
+				target->op1	= assign->op1;
+				target->op2	= assign->op2;
+				Eliminate(node);
+				continue;
+			}
+
+			// A copy is read as a number, which is the number of its source.
+			if(assign->op == 0 && (Replace(target->op1, temp, assign->op1) || Replace(target->op2, temp, assign->op1)))
+			{
+				m_propagatedCount++;
+				Eliminate(node);
+			}
+		}
+		else if(use->stmt_type == IFSTMT && assign->op == 0 && !assign->op1->index && IsConstant(assign->op1->var))
+		{
+			// A branch reads an integer, so only a constant which is the same integer either way is read in place of the copy.
+			Value& value = assign->op1->var->value[0];
+			if(value.kind == VALUE_INT && (value.integer > EXACT_INTEGER || value.integer < -EXACT_INTEGER))
+				continue;
+
+			if(Replace(use->if_stmt->op1, temp, assign->op1) || Replace(use->if_stmt->op2, temp, assign->op1))
+			{
+				m_propagatedCount++;
+				Eliminate(node);
+			}
+		}
+	}
+
+	m_uses.clear();
+	m_definitions.clear();
+	m_targets.clear();
+
+	return m_eliminatedCount;
+}
+
+void Optimizer::CountAccesses(statementNode* program, statementNode* last)
+{
+	m_uses.clear();
+	m_definitions.clear();
+	m_targets.clear();
+
+	for(statementNode* node = program; node; node = (node == last) ? 0 : node->next)
+	{
+		switch(node->stmt_type)
+		{
+		case ASSIGNSTMT:
+			if(node->assign_stmt)
+			{
+				if(node->assign_stmt->lhs)
+				{
+					m_definitions[node->assign_stmt->lhs->var]++;
+					if(node->assign_stmt->lhs->index)
+						m_uses[node->assign_stmt->lhs->index]++;
+				}
+				AddUse(node->assign_stmt->op1);
+				AddUse(node->assign_stmt->op2);
+			}
+			break;
+		case PRINTSTMT:
+			if(node->print_stmt)
+				AddUse(node->print_stmt->id);
+			break;
+		case IFSTMT:
+			if(node->if_stmt)
+			{
+				AddUse(node->if_stmt->op1);
+				AddUse(node->if_stmt->op2);
+				m_targets.insert(node->if_stmt->true_branch);
+				m_targets.insert(node->if_stmt->false_branch);
+			}
+			break;
+		case GOTOSTMT:
+			if(node->goto_stmt)
+				m_targets.insert(node->goto_stmt->target);
+			break;
+		case FUNCSTMT:
+			if(node->func_stmt)
+				AddUse(node->func_stmt->argument);
+			break;
+		}
+	}
+}
+
+void Optimizer::AddUse(varAccess* access)
+{
+	if(!access)
+		return;
+
+	m_uses[access->var]++;
+	if(access->index)
+		m_uses[access->index]++;
+}
+
+bool Optimizer::IsTemporary(Variable* var)
+{
+	// AddTempVariable names them with a '#', which a program can not use.
+	return (var && var->name.compare(0, 5, "temp#") == 0);
+}
+
+bool Optimizer::IsConstant(Variable* var)
+{
+	// GetOrCreateVarAccess gives every constant a variable of its own, outside of Variables.
+	if(!m_variables || !var || var->name.compare(0, 9, "CONSTANT_") != 0 || var->value.size() != 1 || var->value[0].kind == VALUE_STRING)
+		return false;
+
+	return (m_variables->GetVariable(var->name) != var);
+}
+
+bool Optimizer::Fold(assignmentStatement* assign)
+{
+	if(assign->op == 0 || !assign->op2 || assign->op1->index || assign->op2->index)
+		return false;
+	if(!IsConstant(assign->op1->var) || !IsConstant(assign->op2->var))
+		return false;
+
+	// Calculated in doubles like execute_program.
+	double op1 = assign->op1->var->value[0].ToNumber();
+	double op2 = assign->op2->var->value[0].ToNumber();
+	double result = 0;
+	switch(assign->op)
+	{
+	case PLUS:	result = op1 + op2;	break;
+	case MINUS:	result = op1 - op2;	break;
+	case MULT:	result = op1 * op2;	break;
+	case DIV:	result = op1 / op2;	break;
+	default:	return false;
+	}
+
+	// The constant of op1 is only read by this statement. It takes the result with the type of a constant written that way.
+	Variable* constant = assign->op1->var;
+	if(result <= EXACT_INTEGER && result >= -EXACT_INTEGER && result == (double)(long long)result)
+	{
+		string type(TOKENS[PRIM_INT]);
+		constant->typeID = m_variables->GetTypeIDNumber(type);
+		constant->value[0].SetInteger((long long)result);
+	}
+	else
+	{
+		string type(TOKENS[PRIM_REAL]);
+		constant->typeID = m_variables->GetTypeIDNumber(type);
+		constant->value[0].SetReal(result);
+	}
+
+	assign->op	= 0;
+	assign->op2	= 0;
+
+	return true;
+}
+
+bool Optimizer::Reads(statementNode* node, Variable* var)
+{
+	varAccess* accesses[3] = {0, 0, 0};
+	switch(node->stmt_type)
+	{
+	case ASSIGNSTMT:
+		if(node->assign_stmt->lhs && node->assign_stmt->lhs->index == var)
+			return true;
+		accesses[0] = node->assign_stmt->op1;
+		accesses[1] = node->assign_stmt->op2;
+		break;
+	case IFSTMT:
+		accesses[0] = node->if_stmt->op1;
+		accesses[1] = node->if_stmt->op2;
+		break;
+	case PRINTSTMT:
+		accesses[0] = node->print_stmt->id;
+		break;
+	}
+
+	for(int i = 0; i < 3; i++)
+	{
+		if(accesses[i] && (accesses[i]->var == var || accesses[i]->index == var))
+			return true;
+	}
+
+	return false;
+}
+
+bool Optimizer::Writes(statementNode* node, assignmentStatement* assign)
+{
+	if(!node->assign_stmt->lhs)
+		return true;
+
+	Variable* var = node->assign_stmt->lhs->var;
+	return ((assign->op1 && (assign->op1->var == var || assign->op1->index == var)) ||
+		(assign->op2 && (assign->op2->var == var || assign->op2->index == var)));
+}
+
+statementNode* Optimizer::FindUse(statementNode* node)
+{
+	Variable* temp = node->assign_stmt->lhs->var;
+
+	// Only assignments may come between, and nothing may jump to the statements after node.
+	for(statementNode* next = node->next; next && !m_targets.count(next); next = next->next)
+	{
+		if((next->stmt_type == ASSIGNSTMT && !next->assign_stmt) || (next->stmt_type == IFSTMT && !next->if_stmt) ||
+			(next->stmt_type == PRINTSTMT && !next->print_stmt))
+			return 0;
+
+		if(Reads(next, temp))
+			return next;
+
+		if(next->stmt_type == NOOPSTMT)
+			continue;
+		if(next->stmt_type != ASSIGNSTMT || Writes(next, node->assign_stmt))
+			return 0;
+	}
+
+	return 0;
+}
+
+bool Optimizer::Replace(varAccess*& access, Variable* var, varAccess* source)
+{
+	if(!source || !IsScalar(access, var))
+		return false;
+
+	access = source;
+	return true;
+}
+
+void Optimizer::Eliminate(statementNode* node)
+{
+	delete node->assign_stmt;
+	node->assign_stmt	= 0;
+	node->stmt_type		= NOOPSTMT;
+
+	m_eliminatedCount++;
+}
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: Optimizer.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _OPTIMIZER_H_
+#define _OPTIMIZER_H_
+
+#include "compiler.h"
+#include <unordered_set>
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: Optimizer
+//
+// Rewrites the statements from CompleteParser::Compile so fewer of them run.
+// CompileExpression gives every operation a temporary, which the statement
+// using the operation then reads. When a temporary is read once, by a
+// statement later in the same run of assignments, the operation is moved
+// into that statement and the statement assigning the temporary becomes a
+// NOOPSTMT. An operation on two constants is calculated first, and a copy of
+// a constant is read straight from the constant by a branch.
+//
+// Statements stay where they are, so branches and the ProgramLine of every
+// line still point at them, and an operation never moves past a statement
+// of another line. The temporaries of a line are only read by the line, so
+// a line compiled again is optimized alone. Only assignments whose type
+// CompleteParser::ResolveTypes found are changed, so a value is read the
+// same way after the rewrite.
+////////////////////////////////////////////////////////////////////////////////
+class Optimizer
+{
+public:
+	Optimizer();
+	~Optimizer();
+
+	int Optimize(statementNode* program,			// Returns the number of statements eliminated. Only the statements up to
+		statementNode* last = 0);					// last, when given, such as those of one line compiled again.
+
+	void SetEnabled(bool enable) {m_enabled = enable;}
+	void SetVariables(Variables* variables) {m_variables = variables;}	// The table the program was compiled with. Constants are not folded without it.
+	bool IsEnabled() {return m_enabled;}
+	int GetEliminatedCount() {return m_eliminatedCount;}	// Statements made NOOPSTMT by the last Optimize.
+	int GetFoldedCount() {return m_foldedCount;}			// Operations on constants calculated by the last Optimize.
+	int GetPropagatedCount() {return m_propagatedCount;}	// Copies read from their source by the last Optimize.
+
+private:
+	void CountAccesses(statementNode* program,		// Fill m_uses, m_definitions and m_targets.
+		statementNode* last);
+	void AddUse(varAccess* access);
+	bool IsTemporary(Variable* var);
+	bool IsConstant(Variable* var);					// A number given in the program text, which nothing assigns.
+	bool Fold(assignmentStatement* assign);			// Calculate an operation on two constants into its op1.
+	bool Reads(statementNode* node, Variable* var);
+	bool Writes(statementNode* node,				// node assigns a variable assign reads.
+		assignmentStatement* assign);
+	statementNode* FindUse(statementNode* node);	// The statement reading the temporary node assigns, if nothing between changes the operands.
+	bool Replace(varAccess*& access, Variable* var,	// Point access at source if it reads var.
+		varAccess* source);
+	void Eliminate(statementNode* node);
+
+	unordered_map<Variable*, int>		m_uses;
+	unordered_map<Variable*, int>		m_definitions;
+	unordered_set<statementNode*>		m_targets;	// Statements a branch or goto may go to.
+	Variables*							m_variables;
+	bool								m_enabled;
+	int									m_eliminatedCount;
+	int									m_foldedCount;
+	int									m_propagatedCount;
+};
+
+#endif
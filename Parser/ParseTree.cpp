@@ -0,0 +1,212 @@
+#include "ParseTree.h"
+#include <algorithm>
+
+ParseTree::ParseTree()
+{
+	m_nodeMark	= 0;
+	m_childMark	= 0;
+}
+
+ParseTree::~ParseTree()
+{
+}
+
+void ParseTree::Clear()
+{
+	// The records hold no memory of their own, so this does not visit them.
+	m_nodes.clear();
+	m_children.clear();
+	m_text.clear();
+	m_remap.clear();
+	m_nodeMark	= 0;
+	m_childMark	= 0;
+}
+
+int ParseTree::AddNode(int type, int lineNumber)
+{
+	TreeNode node;
+	node.type			= type;
+	node.lineNumber		= lineNumber;
+	node.text			= 0;
+	node.textLength		= 0;
+	node.children		= 0;
+	node.childCount		= 0;
+	node.childCapacity	= 0;
+	node.complete		= 0;
+	node.closed			= false;
+	m_nodes.push_back(node);
+
+	return m_nodes.size() - 1;
+}
+
+unsigned int ParseTree::AddText(const string& text)
+{
+	unsigned int offset = m_text.size();
+	m_text.append(text);
+
+	return offset;
+}
+
+void ParseTree::SetText(int node, unsigned int text, unsigned int length)
+{
+	m_nodes[node].text			= text;
+	m_nodes[node].textLength	= length;
+}
+
+void ParseTree::AddChild(int parent, int child)
+{
+	TreeNode& node = m_nodes[parent];
+
+	if(node.childCount == node.childCapacity)
+	{
+		unsigned int capacity = node.childCount ? node.childCount * 2 : TREE_CHILD_CAPACITY;
+
+		// The last range can grow in place. Any other range moves to the end with twice the room.
+		if(!node.childCount || node.children + node.childCount != m_children.size())
+		{
+			unsigned int start = m_children.size();
+			m_children.resize(start + capacity, TREE_NODE_NONE);
+			for(unsigned int i = 0; i < node.childCount; i++)
+				m_children[start + i] = m_children[node.children + i];
+			node.children = start;
+		}
+		else
+		{
+			m_children.resize(node.children + capacity, TREE_NODE_NONE);
+		}
+
+		node.childCapacity = capacity;
+	}
+
+	m_children[node.children + node.childCount++] = child;
+}
+
+void ParseTree::Mark()
+{
+	m_nodeMark	= m_nodes.size();
+	m_childMark	= m_children.size();
+	m_remap.clear();
+}
+
+void ParseTree::Compact(vector<int>& parents)
+{
+	// Parents from before the mark are the only way into the nodes added since.
+	sort(parents.begin(), parents.end());
+	parents.erase(unique(parents.begin(), parents.end()), parents.end());
+	while(!parents.empty() && parents.back() >= m_nodeMark)
+		parents.pop_back();
+
+	// Number the nodes which can be reached. Everything else since the mark is dropped.
+	vector<int>& remap = m_remap;
+	remap.assign(m_nodes.size() - m_nodeMark, TREE_NODE_NONE);
+	vector<int> kept;
+	vector<int> pending;
+	for(vector<int>::iterator parent = parents.begin(); parent != parents.end(); parent++)
+	{
+		for(unsigned int i = 0; i < m_nodes[*parent].childCount; i++)
+			pending.push_back(GetChild(*parent, i));
+
+		while(!pending.empty())
+		{
+			int node = pending.back();
+			pending.pop_back();
+			if(node < m_nodeMark || remap[node - m_nodeMark] != TREE_NODE_NONE)
+				continue;
+
+			remap[node - m_nodeMark] = m_nodeMark + kept.size();
+			kept.push_back(node);
+			for(unsigned int i = 0; i < m_nodes[node].childCount; i++)
+				pending.push_back(GetChild(node, i));
+		}
+	}
+
+	// Lay the kept nodes and their child ranges out again after the mark.
+	vector<TreeNode> nodes;
+	vector<int> children;
+	nodes.reserve(kept.size());
+	for(vector<int>::iterator it = kept.begin(); it != kept.end(); it++)
+	{
+		TreeNode node = m_nodes[*it];
+		unsigned int start = m_childMark + children.size();
+		for(unsigned int i = 0; i < node.childCount; i++)
+		{
+			int child = GetChild(*it, i);
+			children.push_back(child < m_nodeMark ? child : remap[child - m_nodeMark]);
+		}
+		node.children		= start;
+		node.childCapacity	= node.childCount;
+		nodes.push_back(node);
+	}
+
+	// A parent range which reaches past the mark is moved as well.
+	for(vector<int>::iterator parent = parents.begin(); parent != parents.end(); parent++)
+	{
+		TreeNode& node = m_nodes[*parent];
+		bool moved = (node.children + node.childCapacity > m_childMark);
+		unsigned int start = m_childMark + children.size();
+		for(unsigned int i = 0; i < node.childCount; i++)
+		{
+			int child = GetChild(*parent, i);
+			if(child >= m_nodeMark)
+				child = remap[child - m_nodeMark];
+
+			if(moved)
+				children.push_back(child);
+			else
+				m_children[node.children + i] = child;
+		}
+
+		if(moved)
+		{
+			node.children		= start;
+			node.childCapacity	= node.childCount;
+		}
+	}
+
+	m_nodes.resize(m_nodeMark);
+	m_nodes.insert(m_nodes.end(), nodes.begin(), nodes.end());
+	m_children.resize(m_childMark);
+	m_children.insert(m_children.end(), children.begin(), children.end());
+}
+
+bool ParseTree::IsAddedSinceMark(int node)
+{
+	return node >= m_nodeMark;
+}
+
+int ParseTree::GetCompactedIndex(int node)
+{
+	if(node < m_nodeMark)
+		return node;
+
+	return m_remap[node - m_nodeMark];
+}
+
+void ParseTree::GetText(int node, string& textOut)
+{
+	textOut.assign(m_text, m_nodes[node].text, m_nodes[node].textLength);
+}
+
+int ParseTree::Find(int type, int node, int searchLevels)
+{
+	// Recursive search stops when level is 0.
+	if(searchLevels == 0)
+		return TREE_NODE_NONE;
+
+	if(m_nodes[node].type == type)
+		return node;
+
+	for(unsigned int i = 0; i < m_nodes[node].childCount; i++)
+	{
+		int found = Find(type, GetChild(node, i), searchLevels - 1);
+		if(found != TREE_NODE_NONE)
+			return found;
+	}
+
+	return TREE_NODE_NONE;
+}
+
+int ParseTree::GetNodeCount()
+{
+	return m_nodes.size();
+}
@@ -11,20 +11,25 @@ void InitializeStatementNode(statementNode* node)
 	node->func_stmt		= 0;
 }
 
+void ReleaseStatementNode(statementNode* node)
+{
+	if(node->assign_stmt)
+		delete node->assign_stmt;
+	if(node->goto_stmt)
+		delete node->goto_stmt;
+	if(node->if_stmt)
+		delete node->if_stmt;
+	if(node->print_stmt)
+		delete node->print_stmt;
+	if(node->func_stmt)
+		delete node->func_stmt;
+}
+
 void CompleteParser::ShutdownProgram(statementNode* node)
 {
 	while(node)
 	{
-		if(node->assign_stmt)
-			delete node->assign_stmt;
-		if(node->goto_stmt)
-			delete node->goto_stmt;
-		if(node->if_stmt)
-			delete node->if_stmt;
-		if(node->print_stmt)
-			delete node->print_stmt;
-		if(node->func_stmt)
-			delete node->func_stmt;
+		ReleaseStatementNode(node);
 		statementNode* thisNode = node;
 		node = node->next;
 		delete thisNode;
@@ -33,15 +38,18 @@ void CompleteParser::ShutdownProgram(statementNode* node)
 
 __declspec(dllexport) statementNode* CompleteParser::Compile()
 {
+	UpdateNodes();
+	m_tempAllocator.Start();
+
 	// Initialize Types.
 	int i = -1;
-	Node* node = FindNodeByName("type_decl_section", m_nodes, i);
+	Node* node = FindNodeBySymbol(SYMBOL_TYPE_DECL_SECTION, m_nodes, i);
 
 	if(node)
 		EvaluateNodes(*node);
 
 	// Initialize Variables.
-	node = FindNodeByName("var_decl_section", m_nodes, i);
+	node = FindNodeBySymbol(SYMBOL_VAR_DECL_SECTION, m_nodes, i);
 
 	if(node)
 		EvaluateNodes(*node);
@@ -57,7 +65,141 @@ __declspec(dllexport) statementNode* CompleteParser::Compile()
 		nodeList[i]->next = nodeList[i + 1];
 	}
 
-	return nodeList.size() ? nodeList[0] : 0;
+	statementNode* program = nodeList.size() ? nodeList[0] : 0;
+	RunPasses(program);
+
+	return program;
+}
+
+void CompleteParser::RunPasses(statementNode* program)
+{
+	ResolveTypes(program);
+	m_optimizer.Optimize(program);
+	if(m_controlFlow.Build(program))
+	{
+		m_controlFlow.Thread();
+		if(m_tempAllocator.Allocate(program, m_controlFlow))
+			ResolveTypes(program);
+	}
+}
+
+__declspec(dllexport) Optimizer* CompleteParser::GetOptimizer()
+{
+	return &m_optimizer;
+}
+
+__declspec(dllexport) ControlFlow* CompleteParser::GetControlFlow()
+{
+	return &m_controlFlow;
+}
+
+__declspec(dllexport) TempAllocator* CompleteParser::GetTempAllocator()
+{
+	return &m_tempAllocator;
+}
+
+__declspec(dllexport) void CompleteParser::SetIndexPolicy(int policy)
+{
+	m_byteCode.SetIndexPolicy(policy);
+}
+
+__declspec(dllexport) int CompleteParser::GetIndexPolicy()
+{
+	return m_byteCode.GetIndexPolicy();
+}
+
+__declspec(dllexport) void CompleteParser::RunProgram(statementNode* program)
+{
+	ByteCode byteCode(m_variables);
+	byteCode.SetIndexPolicy(GetIndexPolicy());
+	if(byteCode.Lower(program))
+		byteCode.Execute();
+	else
+		execute_program(program, byteCode.GetIndexPolicy());
+}
+
+void CompleteParser::ResolveTypes(statementNode* program, statementNode* last)
+{
+	string stringType(TOKENS[PRIM_STRING]);
+	int stringID = m_variables->GetTypeIDNumber(stringType);
+
+	// The lowest types of lhs, op1 and op2 of every assignment. The type of a missing op2 is never a string.
+	vector<assignmentStatement*> assignments;
+	vector<int> types;
+	for(statementNode* node = program; node; node = (node == last) ? 0 : node->next)
+	{
+		assignmentStatement* assign = node->assign_stmt;
+		if(node->stmt_type != ASSIGNSTMT || !assign || !assign->lhs || !assign->op1)
+			continue;
+
+		assignments.push_back(assign);
+		types.push_back(m_variables->GetLowestType(assign->lhs->var->typeID));
+		types.push_back(m_variables->GetLowestType(assign->op1->var->typeID));
+		types.push_back(assign->op2 ? m_variables->GetLowestType(assign->op2->var->typeID) : 0);
+	}
+
+	// A type which is not a primitive becomes PRIM_STRING once a string is assigned to it, so
+	// find every type which may be given one while the program runs. A line keeps those found.
+	set<int>& stringTypes = m_stringTypes;
+	if(!last)
+		stringTypes.clear();
+	bool changed = !last;
+	while(changed)
+	{
+		changed = false;
+		for(unsigned int i = 0; i < assignments.size(); i++)
+		{
+			int* id = &types[i * 3];
+			if(m_variables->TypeIsPrimitive(id[0]) || stringTypes.count(id[0]))
+				continue;
+
+			for(int j = 0; j < 3; j++)
+			{
+				if(id[j] == stringID || stringTypes.count(id[j]))
+				{
+					stringTypes.insert(id[0]);
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	for(unsigned int i = 0; i < assignments.size(); i++)
+	{
+		int* id = &types[i * 3];
+		if(id[0] == stringID || id[1] == stringID || id[2] == stringID)
+			assignments[i]->type = VALUE_STRING;
+		else if(stringTypes.count(id[0]) || stringTypes.count(id[1]) || stringTypes.count(id[2]))
+			assignments[i]->type = TYPE_UNKNOWN;
+		else
+			assignments[i]->type = m_variables->GetValueKind(id[0]);
+	}
+}
+
+bool CompleteParser::GivesText(statementNode* first, statementNode* last)
+{
+	string stringType(TOKENS[PRIM_STRING]);
+	int stringID = m_variables->GetTypeIDNumber(stringType);
+
+	for(statementNode* node = first; node; node = (node == last) ? 0 : node->next)
+	{
+		assignmentStatement* assign = node->assign_stmt;
+		if(node->stmt_type != ASSIGNSTMT || !assign || !assign->lhs || !assign->op1)
+			continue;
+		if(m_variables->TypeIsPrimitive(m_variables->GetLowestType(assign->lhs->var->typeID)))
+			continue;
+
+		varAccess* operands[2] = {assign->op1, assign->op2};
+		for(int i = 0; i < 2; i++)
+		{
+			int type = operands[i] ? m_variables->GetLowestType(operands[i]->var->typeID) : 0;
+			if(operands[i] && (type == stringID || m_stringTypes.count(type)))
+				return true;
+		}
+	}
+
+	return false;
 }
 
 
@@ -69,7 +211,7 @@ varAccess* CompleteParser::CompileExpression(Node& node, vector<statementNode*>&
 	}
 
 	// Another hard-coded solution...
-	if(node.type == "array")
+	if(node.type == SYMBOL_ARRAY)
 	{
 		varAccess* temp = CompileExpression(node.nodes[2], stmtList);
 		list<string> idList;
@@ -86,12 +228,12 @@ varAccess* CompleteParser::CompileExpression(Node& node, vector<statementNode*>&
 			InitializeStatementNode(stmt);
 			stmt->stmt_type = ASSIGNSTMT;
 			stmt->assign_stmt = new assignmentStatement;
+			stmt->assign_stmt->type = TYPE_UNKNOWN;
 			stmt->assign_stmt->op = 0;
 			stmt->assign_stmt->op1 = temp;
 			stmt->assign_stmt->op2 = 0;
 			Variable* tempVar = m_variables->AddTempVariable();
-			string name(tempVar->name);
-			stmt->assign_stmt->lhs = m_variables->GetVarAccess(name);
+			stmt->assign_stmt->lhs = m_variables->GetVarAccess(tempVar);
 			stmtList.push_back(stmt);
 
 			returnVar->index = tempVar;
@@ -122,6 +264,7 @@ varAccess* CompleteParser::CompileExpression(Node& node, vector<statementNode*>&
 		InitializeStatementNode(stmt);
 		stmt->stmt_type = ASSIGNSTMT;
 		stmt->assign_stmt = new assignmentStatement;
+		stmt->assign_stmt->type = TYPE_UNKNOWN;
 		Node* opNode = FindOp(node.nodes[1]);
 		if(opNode)
 			stmt->assign_stmt->op = OperationToTokenType(opNode->type);
@@ -130,8 +273,7 @@ varAccess* CompleteParser::CompileExpression(Node& node, vector<statementNode*>&
 		stmt->assign_stmt->op1 = varList[0];
 		stmt->assign_stmt->op2 = varList[1];
 		Variable* temp = m_variables->AddTempVariable();
-		string name(temp->name);
-		stmt->assign_stmt->lhs = m_variables->GetVarAccess(name);
+		stmt->assign_stmt->lhs = m_variables->GetVarAccess(temp);
 		stmtList.push_back(stmt);
 
 		return stmt->assign_stmt->lhs;
@@ -148,7 +290,7 @@ void CompleteParser::CompileFunctionStmt(Node& node, statementNode* sNode, vecto
 	sNode->func_stmt->goto_stmt = 0;
 	sNode->func_stmt->argument = 0;
 	int index;
-	Node* result = FindNodeByName("ID", node, index);
+	Node* result = FindNodeBySymbol(ID, node, index);
 
 	if(result)
 		sNode->func_stmt->funcName = result->value;
@@ -180,6 +322,7 @@ void CompleteParser::CompileAssignStmt(Node& node, statementNode* sNode, vector<
 {
 	sNode->stmt_type = ASSIGNSTMT;
 	sNode->assign_stmt = new assignmentStatement;
+	sNode->assign_stmt->type = TYPE_UNKNOWN;
 	sNode->assign_stmt->op2 = 0;
 
 	int i = -1;
@@ -203,7 +346,7 @@ void CompleteParser::CompileAssignStmt(Node& node, statementNode* sNode, vector<
 	vector<statementNode*> newstmts;
 	varAccess* tempVar = CompileExpression(node.nodes[i+1], newstmts);
 
-	if(node.nodes[i-1].type == "array")
+	if(node.nodes[i-1].type == SYMBOL_ARRAY)
 	{
 		sNode->assign_stmt->lhs = CompileExpression(node.nodes[i-1], newstmts);
 	}
@@ -303,8 +446,8 @@ void CompleteParser::CompileIfStmt(Node& node, statementNode* sNode, vector<stat
 	InitializeStatementNode(leftComp);
 	leftComp->stmt_type = ASSIGNSTMT;
 	leftComp->assign_stmt = new assignmentStatement;
-	string name1(m_variables->AddTempVariable()->name);
-	leftComp->assign_stmt->lhs = m_variables->GetVarAccess(name1);
+	leftComp->assign_stmt->type = TYPE_UNKNOWN;
+	leftComp->assign_stmt->lhs = m_variables->GetVarAccess(m_variables->AddTempVariable());
 	leftComp->assign_stmt->op = 0;
 	leftComp->assign_stmt->op1 = CompileExpression(conditionNode->nodes[i - 1], newstmts);
 	leftComp->assign_stmt->op2 = 0;
@@ -314,8 +457,8 @@ void CompleteParser::CompileIfStmt(Node& node, statementNode* sNode, vector<stat
 	InitializeStatementNode(rightComp);
 	rightComp->stmt_type = ASSIGNSTMT;
 	rightComp->assign_stmt = new assignmentStatement;
-	string name2(m_variables->AddTempVariable()->name);
-	rightComp->assign_stmt->lhs = m_variables->GetVarAccess(name2);
+	rightComp->assign_stmt->type = TYPE_UNKNOWN;
+	rightComp->assign_stmt->lhs = m_variables->GetVarAccess(m_variables->AddTempVariable());
 	rightComp->assign_stmt->op = 0;
 	rightComp->assign_stmt->op1 = CompileExpression(conditionNode->nodes[i + 1], newstmts);
 	rightComp->assign_stmt->op2 = 0;
@@ -362,51 +505,21 @@ void CompleteParser::CompileIfStmt(Node& node, statementNode* sNode, vector<stat
 	}
 }
 
-int CompleteParser::OperationToTokenType(string& op)
+int CompleteParser::OperationToTokenType(int tokenID)
 {
-	if(op == TOKENS[PLUS])
-	{
-		return PLUS;
-	}
-	else if(op == TOKENS[MINUS])
-	{
-		return MINUS;
-	}
-	else if(op == TOKENS[MULT])
-	{
-		return MULT;
-	}
-	else if(op == TOKENS[DIV])
-	{
-		return DIV;
-	}
-	else if(op == TOKENS[GREATER])
+	switch(tokenID)
 	{
-		return GREATER;
-	}
-	else if(op == TOKENS[GTEQ])
-	{
-		return GTEQ;
-	}
-	else if(op == TOKENS[LTEQ])
-	{
-		return LTEQ;
-	}
-	else if(op == TOKENS[NOTEQUAL])
-	{
-		return NOTEQUAL;
-	}
-	else if(op == TOKENS[EQUAL])
-	{
-		return EQUAL;
-	}
-	else if(op == TOKENS[LESS])
-	{
-		return LESS;
-	}
-	else if(op == TOKENS[NOTEQUAL])
-	{
-		return NOTEQUAL;
+	case PLUS:
+	case MINUS:
+	case MULT:
+	case DIV:
+	case GREATER:
+	case GTEQ:
+	case LTEQ:
+	case NOTEQUAL:
+	case EQUAL:
+	case LESS:
+		return tokenID;
 	}
 
 	return 0;
@@ -414,27 +527,45 @@ int CompleteParser::OperationToTokenType(string& op)
 
 statementNode* CompleteParser::CompressNodes(Node& node, vector<statementNode*>& nodes)
 {
+	// Remember the statements of each program line so an edit can replace them.
+	if(m_recordStatements)
+	{
+		unordered_map<Node*, unsigned int>::iterator line = m_lineNodes.find(&node);
+		if(line != m_lineNodes.end())
+		{
+			unsigned int first = nodes.size();
+			m_recordStatements = false;
+			statementNode* lineNode = CompressNodes(node, nodes);
+			m_recordStatements = true;
+
+			ProgramLine& programLine = m_programLines[line->second];
+			if(nodes.size() - first >= 2 && !programLine.declaration)
+			{
+				programLine.first	= nodes[first];
+				programLine.last	= nodes.back();
+			}
+
+			return lineNode;
+		}
+	}
+
 	struct statementNode* sNode = new statementNode;
-	sNode->assign_stmt	= 0;
-	sNode->goto_stmt	= 0;
-	sNode->if_stmt		= 0;
-	sNode->next			= 0;
-	sNode->print_stmt	= 0;
+	InitializeStatementNode(sNode);
 
 	bool skipChildNodes = false;
-	if(node.type == "assign_stmt")
+	if(node.type == SYMBOL_ASSIGN_STMT)
 	{
 		CompileAssignStmt(node, sNode, nodes);
 
 		return sNode;
 	}
-	else if(node.type == "function_stmt")
+	else if(node.type == SYMBOL_FUNCTION_STMT)
 	{
 		CompileFunctionStmt(node, sNode, nodes);
 
 		return sNode;
 	}
-	else if(node.type == "if_stmt" || node.type == "while_stmt")
+	else if(node.type == SYMBOL_IF_STMT || node.type == SYMBOL_WHILE_STMT)
 	{
 		sNode->if_stmt = new ifStatement;
 		sNode->if_stmt->op1 = 0;
@@ -443,25 +574,25 @@ statementNode* CompleteParser::CompressNodes(Node& node, vector<statementNode*>&
 		sNode->if_stmt->true_branch = 0;
 		sNode->if_stmt->false_branch = 0;
 		sNode->stmt_type = IFSTMT;
-		if(node.type == "if_stmt")
+		if(node.type == SYMBOL_IF_STMT)
 			CompileIfStmt(node, sNode, nodes);
-		else if(node.type == "while_stmt")
+		else if(node.type == SYMBOL_WHILE_STMT)
 			CompileWhileStmt(node, sNode, nodes);
 		return sNode;
 	}
-	else if(node.type == "repeat_stmt")
+	else if(node.type == SYMBOL_REPEAT_STMT)
 	{
 		CompileRepeatStmt(node, sNode, nodes);
 		return sNode;
 	}
-	else if(node.type == "print_stmt")
+	else if(node.type == SYMBOL_PRINT_STMT)
 	{
 		sNode->print_stmt = new printStatement;
 		sNode->stmt_type = PRINTSTMT;
 		list<string> ids;
 
 		// Print array... hard-coded again! Deadlines yay!
-		if(node.nodes[1].type == "array")
+		if(node.nodes[1].type == SYMBOL_ARRAY)
 		{
 			vector<statementNode*> stmtNodes;
 			varAccess* access = CompileExpression(node.nodes[1], stmtNodes);
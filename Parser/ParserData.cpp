@@ -1,7 +1,19 @@
 #include "CompleteParser.h"
 
+void MoveNode(Node& from, Node& to)
+{
+	to.nodes.swap(from.nodes);
+	to.type			= from.type;
+	to.value.swap(from.value);
+	to.lineNumber	= from.lineNumber;
+	to.complete		= from.complete;
+	to.closed		= from.closed;
+}
+
 void CompleteParser::RunProgram()
 {
+	UpdateNodes();
+
 	m_openBrackets = 0;
 	VerifyNodes(m_nodes);
 
@@ -15,6 +27,28 @@ void CompleteParser::SetScoping(int level)
 	m_scoping = level;
 }
 
+void CompleteParser::SetLexer(int lexer)
+{
+	m_lexerMode = lexer;
+}
+
+int CompleteParser::GetLexer()
+{
+	return m_lexerMode;
+}
+
+void CompleteParser::SetMatchMemo(bool enabled)
+{
+	m_matchMemoEnabled = enabled;
+	m_matchMemo.clear();
+}
+
+void CompleteParser::GetMatchMemoCounts(unsigned int& lookups, unsigned int& hits)
+{
+	lookups	= m_matchMemoLookups;
+	hits	= m_matchMemoHits;
+}
+
 void CompleteParser::EvaluateOpenNodes()
 {
 	if(m_currentNode.size())
@@ -37,8 +71,15 @@ bool CompleteParser::DoneRunning()
 
 bool CompleteParser::CompleteProgram()
 {
+	// m_nodes is only made from the rule matcher's tree once it is needed.
+	if(m_treeChanged)
+	{
+		int body = m_tree.Find(SYMBOL_BODY, TREE_ROOT, 3);
+		return body != TREE_NODE_NONE && m_tree.Get(body).complete;
+	}
+
 	int i;
-	Node* node = FindNodeByName("body", m_nodes, i, 3);
+	Node* node = FindNodeBySymbol(SYMBOL_BODY, m_nodes, i, 3);
 	if(node && i >= 0)
 	{
 		return node->complete;
@@ -47,6 +88,33 @@ bool CompleteParser::CompleteProgram()
 	return false;
 }
 
+void CompleteParser::UpdateNodes()
+{
+	if(!m_treeChanged)
+		return;
+
+	m_nodes.nodes.clear();
+	CopyTreeNode(TREE_ROOT, m_nodes);
+	m_treeChanged = false;
+}
+
+void CompleteParser::CopyTreeNode(int treeNode, Node& node)
+{
+	TreeNode& source = m_tree.Get(treeNode);
+
+	node.type		= source.type;
+	node.lineNumber	= source.lineNumber;
+	node.complete	= source.complete;
+	node.closed		= source.closed;
+	m_tree.GetText(treeNode, node.value);
+
+	node.nodes.resize(source.childCount);
+	for(unsigned int i = 0; i < source.childCount; i++)
+	{
+		CopyTreeNode(m_tree.GetChild(treeNode, i), node.nodes[i]);
+	}
+}
+
 int CompleteParser::EvaluateNodes(Node& node)
 {
 	// Save the state of nodes that have not been run and are on hold until a loop finishes.
@@ -56,27 +124,28 @@ int CompleteParser::EvaluateNodes(Node& node)
 		return TOKEN_ERR_NONE;
 	}
 
-	if(node.type == "type_decl")
+	switch(node.type)
+	{
+	case SYMBOL_TYPE_DECL:
 		return AssignTypes(node);
-	else if(node.type == "var_decl")
+	case SYMBOL_VAR_DECL:
 		return AssignVariables(node);
-	else if(node.type == "assign_stmt")
+	case SYMBOL_ASSIGN_STMT:
 		return SetVariables(node);
-	else if(node.type == "while_stmt")
+	case SYMBOL_WHILE_STMT:
 		return WhileStatement(node);
-	else if(node.type == "if_stmt")
+	case SYMBOL_IF_STMT:
 		return IfStatement(node);
-	else if(node.type == "print_stmt")
+	case SYMBOL_PRINT_STMT:
 		return PrintStatement(node);
-	else if(node.type == TOKENS[LBRACE])
-	{
+	case LBRACE:
 		if(m_scoping != SCOPING_OFF)
 			m_variables->AddScope();
-	}
-	else if(node.type == TOKENS[RBRACE])
-	{
+		break;
+	case RBRACE:
 		if(m_scoping != SCOPING_OFF)
 			m_variables->RemoveScope();
+		break;
 	}
 
 	for(unsigned int i = 0; i < node.nodes.size(); i++)
@@ -94,10 +163,33 @@ __declspec(dllexport) void CompleteParser::ClearNodes()
 	m_nodes.nodes.clear();
 	m_nodes.complete = NODE_NOT_COMPLETE;
 	m_nodes.closed = false;
+	m_tree.Clear();
+	m_tree.AddNode(BASE_NODE_TYPE, 0);
+	m_treeChanged = false;
+	m_openNodes.clear();
+	m_openNodes.push_back(TREE_ROOT);
+	m_closeNodes.clear();
+	m_closeFirst.clear();
 	m_currentNode.clear();
 	m_evaluatingLoop = false;
 	m_currentLine.clear();
+	m_matchMemo.clear();
+	m_matchMemoLookups = 0;
+	m_matchMemoHits = 0;
+	m_parseStack.clear();
+	m_generatedTokens.clear();
+	m_generatedDepth = 0;
+	m_lalrStates.clear();
+	m_lalrNodes.clear();
 	m_textOutput.str(string());
+	m_programText.clear();
+	m_programLines.clear();
+	m_lineNodes.clear();
+	m_tempAllocator.Release(m_program);
+	ShutdownProgram(m_program);
+	m_program = 0;
+	m_byteCode.Clear();
+	m_controlFlow.Clear();
 }
 
 int CompleteParser::GetTypeFromTokenStr(string& tokenStr)
@@ -154,7 +246,7 @@ string CompleteParser::EvaluateExpression(string& expression, int& typeOut)
 	{
 		var = m_variables->GetVariable(m_variables->GetVarIDNumber(tokensStr[i]));
 		if(var)
-			tokens[i] = var->value[0];
+			tokens[i] = var->value[0].ToString();
 		else
 		{
 			// A variable is being referenced but has not yet been declared.
@@ -322,7 +414,7 @@ int CompleteParser::PrintStatement(Node& node)
 			if(var)
 			{
 				// For gui.
-				m_textOutput << var->name << ": " << var->value[0] << "\n";
+				m_textOutput << var->name << ": " << var->value[0].ToString() << "\n";
 			}
 		}
 	}
@@ -330,7 +422,7 @@ int CompleteParser::PrintStatement(Node& node)
 	else
 	{
 		int i;
-		Node* debugNode = FindNodeByName((char*)TOKENS[TOKEN_DEBUG], node, i);
+		Node* debugNode = FindNodeBySymbol(TOKEN_DEBUG, node, i);
 		if(debugNode)
 		{
 			m_variables->PrintTypes(m_textOutput);
@@ -393,16 +485,16 @@ int CompleteParser::IfStatement(Node& node)
 	{
 		// ELSE IF
 		int i = -1;
-		Node* elseIfNode = FindNodeByName("else_stmt", node, i, 1);
+		Node* elseIfNode = FindNodeBySymbol(SYMBOL_ELSE_STMT, node, i, 1);
 		if(elseIfNode && i >= 0)
 		{
-			elseIfNode = FindNodeByName("if_stmt", elseIfNode->nodes[i], i, 1);
+			elseIfNode = FindNodeBySymbol(SYMBOL_IF_STMT, elseIfNode->nodes[i], i, 1);
 			if(elseIfNode && i >= 0)
 				return IfStatement(elseIfNode->nodes[i]);
 		}
 
 		// ELSE
-		Node* elseNode = FindNodeByName("else_stmt", node, i, 2);
+		Node* elseNode = FindNodeBySymbol(SYMBOL_ELSE_STMT, node, i, 2);
 		if(elseNode && i >= 0)
 		{
 			conditionNode = &elseNode->nodes[i];
@@ -557,6 +649,15 @@ int CompleteParser::AssignVariables(Node& node)
 	int i = -1;
 	Node* assignmentNode = FindAssignmentOp(node, i);
 
+	// Variable declare only. The declarations after it still have to be evaluated.
+	if(!assignmentNode && !node.nodes.empty() && BuildIDList(ids, node.nodes[0]))
+	{
+		for(list<string>::iterator it = ids.begin(); it != ids.end(); it++)
+			m_variables->AddVariable(*it, TYPE_UNKNOWN);
+
+		return TOKEN_ERR_NONE;
+	}
+
 	// Build the left hand side.
 	if(!assignmentNode || (i - 1 < 0 || !BuildIDList(ids, assignmentNode->nodes[0]) || i + 1 >= assignmentNode->nodes.size()))
 		return 1; // TODO: P_ERROR CODE
@@ -589,7 +690,7 @@ int CompleteParser::AssignVariables(Node& node)
 Node* CompleteParser::FindBodyNode(Node& node, int& nodeIndex)
 {
 	nodeIndex = -1;
-	if(node.type == "body" && node.complete)
+	if(node.type == SYMBOL_BODY && node.complete)
 		return &node;
 
 	for(int i = 0; i < node.nodes.size(); i++)
@@ -606,7 +707,7 @@ Node* CompleteParser::FindBodyNode(Node& node, int& nodeIndex)
 
 Node* CompleteParser::FindConditionNode(Node& node, int& nodeIndex)
 {
-	return FindNodeByName("condition", node, nodeIndex, 2);
+	return FindNodeBySymbol(SYMBOL_CONDITION, node, nodeIndex, 2);
 }
 
 Node* CompleteParser::FindNodeByName(char* name, Node& node, int& nodeIndex, int searchLevels)
@@ -616,6 +717,20 @@ Node* CompleteParser::FindNodeByName(char* name, Node& node, int& nodeIndex, int
 }
 
 Node* CompleteParser::FindNodeByName(string& name, Node& node, int& nodeIndex, int searchLevels)
+{
+	int symbol = m_symbols.Find(name);
+
+	// A name which was never interned cannot be the type of a node.
+	if(symbol == SYMBOL_NONE)
+	{
+		nodeIndex = -1;
+		return 0;
+	}
+
+	return FindNodeBySymbol(symbol, node, nodeIndex, searchLevels);
+}
+
+Node* CompleteParser::FindNodeBySymbol(int symbol, Node& node, int& nodeIndex, int searchLevels)
 {
 	nodeIndex = -1;
 
@@ -623,14 +738,14 @@ Node* CompleteParser::FindNodeByName(string& name, Node& node, int& nodeIndex, i
 	if(searchLevels == 0)
 		return 0;
 
-	if(node.type == name)
+	if(node.type == symbol)
 	{
 		return &node;
 	}
 
 	for(int i = 0; i < node.nodes.size(); i++)
 	{
-		Node* returnNode = FindNodeByName(name, node.nodes[i], nodeIndex, searchLevels - 1);
+		Node* returnNode = FindNodeBySymbol(symbol, node.nodes[i], nodeIndex, searchLevels - 1);
 		if(returnNode)
 		{
 			if(nodeIndex == -1)
@@ -644,9 +759,7 @@ Node* CompleteParser::FindNodeByName(string& name, Node& node, int& nodeIndex, i
 
 Node* CompleteParser::FindOp(Node& node)
 {
-	if(node.type == ">" || node.type == ">=" || node.type == "<=" || node.type == "<" ||
-		node.type == "<>" || node.type == "=" || node.type == "*" || node.type == "+" ||
-		node.type == "-" || node.type == "/")
+	if(OperationToTokenType(node.type))
 		return &node;
 
 	for(int i = 0; i < node.nodes.size(); i++)
@@ -662,9 +775,11 @@ Node* CompleteParser::FindOp(Node& node)
 Node* CompleteParser::FindComparisonOp(Node& node, int& nodeIndex)
 {
 	nodeIndex = -1;
-	if(node.type == ">" || node.type == ">=" || node.type == "<=" || node.type == "<" ||
-		node.type == "<>" || node.type == "=")
+	switch(node.type)
+	{
+	case GREATER: case GTEQ: case LTEQ: case LESS: case NOTEQUAL: case EQUAL:
 		return &node;
+	}
 
 	for(int i = 0; i < node.nodes.size(); i++)
 	{
@@ -681,7 +796,7 @@ Node* CompleteParser::FindComparisonOp(Node& node, int& nodeIndex)
 Node* CompleteParser::FindArray(Node& node, int& nodeIndex)
 {
 	nodeIndex = -1;
-	if(node.type == "[")
+	if(node.type == LBRAC)
 		return &node;
 
 	for(int i = 0; i < node.nodes.size(); i++)
@@ -707,7 +822,7 @@ Node* CompleteParser::FindArray(Node& node, int& nodeIndex)
 Node* CompleteParser::FindAssignmentOp(Node& node, int& nodeIndex)
 {
 	nodeIndex = -1;
-	if(node.type == "=" || node.type == ":")
+	if(node.type == EQUAL || node.type == COLON)
 		return &node;
 
 	for(int i = 0; i < node.nodes.size(); i++)
@@ -732,7 +847,7 @@ Node* CompleteParser::FindAssignmentOp(Node& node, int& nodeIndex)
 
 bool CompleteParser::BuildIDList(list<string>& ids, Node& node)
 {
-	if(node.type == "ID")
+	if(node.type == ID)
 	{
 		ids.push_back(node.value);
 		return true;
@@ -745,7 +860,7 @@ bool CompleteParser::BuildIDList(list<string>& ids, Node& node)
 
 	for(unsigned int i = 0; i < node.nodes.size(); i++)
 	{
-		if(node.nodes[i].type == "ID")
+		if(node.nodes[i].type == ID)
 		{
 			ids.push_back(node.nodes[i].value);
 			found = true;
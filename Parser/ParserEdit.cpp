@@ -0,0 +1,439 @@
+#include "CompleteParser.h"
+
+/*
+	A program given to ParseProgram is remembered a line at a time. A line
+	ends with the ';' or '}' which made HandleTokenIDSyntax parse it, so no
+	token crosses from one line to the next. After the parse, the highest node
+	which ends with a line and starts in it is found for every line, such as
+	the statement after the '{' of a while.
+
+	An edit inside that node only tokenizes the text of its line and parses the
+	node again as the same symbol. The nodes around it were chosen by its first
+	token and the tokens after it, so as long as the first token keeps its ID
+	and the node still ends with the line, the rest of the tree is what a new
+	parse would build. The statements compiled from the node are replaced in
+	the program kept by GetProgram. Any other edit parses the program again.
+*/
+
+static bool IsBeforeLineEnd(unsigned int offset, const ProgramLine& line)
+{
+	return offset < line.end;
+}
+
+static bool IsStraightStatement(statementNode* node)
+{
+	// Branches may target any statement, so only statements without them are replaced.
+	return node->stmt_type == NOOPSTMT || node->stmt_type == ASSIGNSTMT || node->stmt_type == PRINTSTMT;
+}
+
+__declspec(dllexport) void CompleteParser::ParseProgram(const string& text)
+{
+	m_variables->Clear();
+	ClearNodes();
+	m_errors = CompleteParserErrors();
+
+	m_programText = text;
+	m_inputBuffer->SetBuffer(m_programText);
+
+	// Offsets of tokens are only known when the whole text is tokenized by m_lexer.
+	m_recordLines = (m_lexerMode == LEXER_DFA && m_lexer.IsInitialized());
+	Update();
+	m_recordLines = false;
+
+	IndexProgramLines();
+}
+
+__declspec(dllexport) bool CompleteParser::EditProgram(unsigned int offset, unsigned int length, const string& text)
+{
+	if(offset > m_programText.size())
+		offset = m_programText.size();
+	if(length > m_programText.size() - offset)
+		length = m_programText.size() - offset;
+
+	// The line holding the edit starts where the line before it ended.
+	vector<ProgramLine>::iterator line = upper_bound(m_programLines.begin(), m_programLines.end(), offset, IsBeforeLineEnd);
+	if(line != m_programLines.end() && line->node && offset + length <= line->end)
+	{
+		unsigned int start = (line == m_programLines.begin()) ? 0 : (line - 1)->end;
+		int startLine = (line == m_programLines.begin()) ? 0 : (line - 1)->lineNumber;
+		int previousKind = start ? m_lexer.FindKind(m_programText.substr(start - 1, 1)) : LEX_NONE;
+
+		string oldText = m_programText.substr(start, line->end - start);
+		string newText = oldText;
+		newText.replace(offset - start, length, text);
+
+		vector<LexToken> oldTokens;
+		vector<LexToken> newTokens;
+		m_lexer.Tokenize(oldText.c_str(), oldText.size(), oldTokens, previousKind);
+		m_lexer.Tokenize(newText.c_str(), newText.size(), newTokens, previousKind);
+
+		// The edit has to leave the tokens before the node as they were.
+		unsigned int before = line->tokenCount - line->nodeTokenCount;
+		bool valid = (oldTokens.size() == line->tokenCount && newTokens.size() > before && offset - start >= oldTokens[before].offset);
+		for(unsigned int i = 0; i < before && valid; i++)
+		{
+			valid = (newTokens[i].offset == oldTokens[i].offset && newTokens[i].length == oldTokens[i].length);
+		}
+
+		// The node has to stay at the end of a single line, ending on the same line number.
+		list<LineToken> tokens;
+		valid = valid && (startLine + newTokens.back().line == line->lineNumber);
+		for(unsigned int i = before; i < newTokens.size() && valid; i++)
+		{
+			LineToken token;
+			token.value.assign(newText, newTokens[i].offset, newTokens[i].length);
+			token.tokenID		= GetTokenID(token.value);
+			token.lineNumber	= line->lineNumber;
+			tokens.push_back(token);
+
+			bool lineEnd = (token.tokenID == SEMICOLON || token.tokenID == RBRACE);
+			valid = (lineEnd == (i + 1 == newTokens.size()));
+		}
+
+		string firstToken = valid ? oldText.substr(oldTokens[before].offset, oldTokens[before].length) : string();
+		unsigned int tokenCount = tokens.size();
+		if(valid && tokens.front().tokenID == GetTokenID(firstToken))
+		{
+			m_lexerLine = line->lineNumber;
+			if(ReparseLineNode(tokens, *line->node))
+			{
+				m_programText.replace(offset, length, text);
+				line->tokenCount		= before + tokenCount;
+				line->nodeTokenCount	= tokenCount;
+
+				int shift = (int)text.size() - (int)length;
+				for(vector<ProgramLine>::iterator it = line; it != m_programLines.end(); it++)
+					it->end += shift;
+
+				// Statements are compiled again with the whole program if they can not be replaced.
+				// Otherwise the passes run over the line alone when the line stays inside its block.
+				// The jumps are put back as compiled first, as threading may point them inside the line.
+				m_tempAllocator.Start();
+				if(m_program && !line->declaration && EditStatements(*line))
+					return true;
+
+				m_byteCode.Clear();
+				if(m_program && (line->declaration || !m_controlFlow.Restore(m_program) || !ReplaceStatements(*line)))
+				{
+					m_tempAllocator.Release(m_program);
+					ShutdownProgram(m_program);
+					m_program = 0;
+					m_controlFlow.Clear();
+				}
+				else if(m_program)
+					RunPasses(m_program);
+
+				return true;
+			}
+		}
+	}
+
+	string program = m_programText;
+	program.replace(offset, length, text);
+	ParseProgram(program);
+
+	return false;
+}
+
+__declspec(dllexport) statementNode* CompleteParser::GetProgram()
+{
+	// A tree with errors may be missing nodes the statements are compiled from.
+	if(m_errors.HasErrors() || !m_currentLine.empty())
+		return 0;
+
+	if(!m_program)
+	{
+		for(vector<ProgramLine>::iterator it = m_programLines.begin(); it != m_programLines.end(); it++)
+		{
+			it->first	= 0;
+			it->last	= 0;
+		}
+
+		m_recordStatements = true;
+		m_program = Compile();
+		m_recordStatements = false;
+	}
+
+	return m_program;
+}
+
+__declspec(dllexport) ByteCode* CompleteParser::GetByteCode()
+{
+	statementNode* program = GetProgram();
+	if(!program)
+		return 0;
+
+	if(!m_byteCode.IsLowered() && !m_byteCode.Lower(program))
+	{
+		m_byteCode.Clear();
+		return 0;
+	}
+
+	return &m_byteCode;
+}
+
+void CompleteParser::AddProgramLine()
+{
+	// Lines which did not come from ParseProgram make the recorded ones stale.
+	if(!m_recordLines)
+	{
+		if(!m_programLines.empty())
+		{
+			m_programLines.clear();
+			m_lineNodes.clear();
+		}
+		return;
+	}
+
+	ProgramLine line;
+	line.end			= m_lexerOffset;
+	line.tokenCount		= m_currentLine.size();
+	line.nodeTokenCount	= 0;
+	line.lineNumber		= GetCurrentLineNumber();
+	line.node			= 0;
+	line.declaration	= false;
+	line.first			= 0;
+	line.last			= 0;
+	m_programLines.push_back(line);
+}
+
+void CompleteParser::IndexProgramLines()
+{
+	m_lineNodes.clear();
+
+	// Only a program parsed whole without errors, by an engine which can parse a single line, is edited a line at a time.
+	int engine = GetParseEngine();
+	if(m_programLines.empty() || !m_currentLine.empty() || m_errors.HasErrors() ||
+		(engine != PARSE_ENGINE_LL1 && engine != PARSE_ENGINE_MATCH))
+	{
+		m_programLines.clear();
+		return;
+	}
+
+	UpdateNodes();
+
+	vector<int> lineEnds;
+	for(unsigned int i = 0; i < m_programLines.size(); i++)
+	{
+		lineEnds.resize(lineEnds.size() + m_programLines[i].tokenCount - 1, -1);
+		lineEnds.push_back(i);
+	}
+
+	unsigned int token = 0;
+	IndexNode(m_nodes, token, false, lineEnds);
+
+	// Every token has to be a terminal of the tree for the lines to be found.
+	if(token != lineEnds.size())
+	{
+		m_programLines.clear();
+		return;
+	}
+
+	for(unsigned int i = 0; i < m_programLines.size(); i++)
+	{
+		if(m_programLines[i].node)
+			m_lineNodes[m_programLines[i].node] = i;
+	}
+}
+
+bool CompleteParser::IndexNode(Node& node, unsigned int& token, bool declaration, vector<int>& lineEnds)
+{
+	if(node.nodes.empty())
+	{
+		if(!IsTokenTerminal(node.type))
+			return false;
+
+		token++;
+		return true;
+	}
+
+	if(node.type == SYMBOL_TYPE_DECL_SECTION || node.type == SYMBOL_VAR_DECL_SECTION)
+		declaration = true;
+
+	unsigned int first = token;
+	bool endsWithToken = false;
+	for(unsigned int i = 0; i < node.nodes.size(); i++)
+	{
+		endsWithToken = IndexNode(node.nodes[i], token, declaration, lineEnds);
+	}
+
+	// A node ending in an empty node was finished by a token after it, which a parse of the line alone does not have.
+	if(!endsWithToken || first == token || lineEnds[token - 1] < 0)
+		return endsWithToken;
+
+	// A parent is indexed after its children, so the highest node starting in the line is kept.
+	ProgramLine& line = m_programLines[lineEnds[token - 1]];
+	if(token - first <= line.tokenCount && IsTokenNonTerminal(node.type))
+	{
+		line.node			= &node;
+		line.nodeTokenCount	= token - first;
+		line.declaration	= declaration;
+	}
+
+	return true;
+}
+
+bool CompleteParser::ReparseLineNode(list<LineToken>& line, Node& node)
+{
+	Node newNode;
+	bool parsed = false;
+
+	switch(GetParseEngine())
+	{
+	case PARSE_ENGINE_LL1:
+		{
+			// The line gets a stack of its own, which has to be empty once the line is done.
+			Node root;
+			vector<ParseStackEntry> parseStack;
+			parseStack.swap(m_parseStack);
+
+			ParseStackEntry start;
+			start.symbol	= node.type;
+			start.node		= &root;
+			m_parseStack.push_back(start);
+
+			parsed = (EvaluateLinePredictive(line) == TOKEN_ERR_NONE && m_parseStack.empty() && root.nodes.size() == 1);
+			parseStack.swap(m_parseStack);
+
+			if(parsed)
+				MoveNode(root.nodes[0], newNode);
+			break;
+		}
+	case PARSE_ENGINE_MATCH:
+		{
+			// Nothing added to m_tree is kept. The node is copied out of it.
+			BeginMatchLine(line);
+			m_tree.Mark();
+			int root = m_tree.AddNode(BASE_NODE_TYPE, 0);
+
+			parsed = (MatchLineToRule(line, line, node.type, root) && line.empty() && m_tree.GetChildCount(root) == 1);
+			if(parsed)
+			{
+				int lineNode = m_tree.GetChild(root, 0);
+				parsed = (m_tree.Get(lineNode).complete == NODE_IS_COMPLETE);
+
+				// Nodes are closed like they would be by a parse of the whole program.
+				if(parsed)
+				{
+					if(node.closed)
+						ForceCloseNode(lineNode);
+					else
+					{
+						unsigned int openNodes = m_openNodes.size();
+						AddNewNode(lineNode);
+						m_openNodes.resize(openNodes);
+					}
+
+					CopyTreeNode(lineNode, newNode);
+				}
+			}
+
+			vector<int> parents;
+			m_tree.Compact(parents);
+			break;
+		}
+	}
+
+	if(!parsed)
+		return false;
+
+	MoveNode(newNode, node);
+
+	return true;
+}
+
+bool CompleteParser::ReplaceStatements(ProgramLine& line)
+{
+	if(!line.first)
+		return false;
+
+	for(statementNode* node = line.first; node != line.last; node = node->next)
+	{
+		if(!node || !IsStraightStatement(node))
+			return false;
+	}
+	if(!IsStraightStatement(line.last))
+		return false;
+
+	vector<statementNode*> nodes;
+	CompressNodes(*line.node, nodes);
+
+	bool straight = (nodes.size() >= 2);
+	for(unsigned int i = 0; i < nodes.size(); i++)
+	{
+		straight = straight && IsStraightStatement(nodes[i]);
+		nodes[i]->next = (i + 1 < nodes.size()) ? nodes[i + 1] : 0;
+	}
+
+	if(!straight)
+	{
+		ShutdownProgram(nodes.empty() ? 0 : nodes[0]);
+		return false;
+	}
+
+	// Drop the statements between the first and last.
+	statementNode* next = line.last->next;
+	for(statementNode* node = line.first->next; node != line.last; )
+	{
+		statementNode* following = node->next;
+		ReleaseStatementNode(node);
+		delete node;
+		node = following;
+	}
+
+	// A branch may target the first or last statement, so they are kept and given the new contents.
+	ReleaseStatementNode(line.first);
+	ReleaseStatementNode(line.last);
+	*line.first	= *nodes.front();
+	*line.last	= *nodes.back();
+	delete nodes.front();
+	delete nodes.back();
+	nodes.front()	= line.first;
+	nodes.back()	= line.last;
+
+	for(unsigned int i = 0; i + 1 < nodes.size(); i++)
+	{
+		nodes[i]->next = nodes[i + 1];
+	}
+	line.last->next = next;
+
+	return true;
+}
+
+bool CompleteParser::EditStatements(ProgramLine& line)
+{
+	// Nothing outside the block reads the temporaries of the line or is typed by it, so only the line is
+	// resolved, optimized and allocated, and only its instructions are lowered again. The passes stay
+	// global for a line which jumps, starts a block, is jumped to or gives text to a type, as they
+	// change the blocks or the types of the rest of the program. Inside a loop the blocks of the loop
+	// are allocated with the line, and a program with loops is lowered again whole.
+	BlockRange range;
+	BlockRange lowered;
+	if(!m_controlFlow.FindRange(line.first, line.last, range) || GivesText(line.first, line.last) ||
+		!m_tempAllocator.HasOnlySlots(line.first, line.last))
+		return false;
+
+	bool patch = m_byteCode.FindRange(line.first, line.last, lowered);
+	if(!ReplaceStatements(line))
+		return false;
+
+	// Text given to a type which is not a primitive changes the types of the whole program.
+	if(GivesText(line.first, line.last))
+	{
+		m_byteCode.Clear();
+		m_controlFlow.Restore(m_program);
+		RunPasses(m_program);
+		return true;
+	}
+
+	ResolveTypes(line.first, line.last);
+	m_optimizer.Optimize(line.first, line.last);
+	m_controlFlow.ReplaceRange(range, line.first, line.last);
+	if(m_tempAllocator.Allocate(line.first, line.last, m_controlFlow, range.block))
+		ResolveTypes(line.first, line.last);
+
+	if(!patch || !m_byteCode.Patch(lowered, line.first, line.last))
+		m_byteCode.Clear();
+
+	return true;
+}
@@ -0,0 +1,535 @@
+#include "CompleteParser.h"
+
+/*
+	GenerateParser writes the loaded grammar out as C++. Every non-terminal
+	becomes a function which switches on the next token. Each case lists the
+	rulesets that can start with that token, found the same way as the cells
+	of m_parseTable, so an LL(1) grammar has one ruleset per case and never
+	backtracks. A grammar with conflicts tries every ruleset of a case and
+	keeps the one using the most tokens. The parser then keeps the result of
+	each non-terminal at each token, so backtracking never parses the same
+	tokens as the same symbol twice.
+*/
+
+GeneratedParser::GeneratedParser()
+{
+	m_tokens	= 0;
+	m_position	= 0;
+	m_farthest	= 0;
+	m_memoize	= false;
+}
+
+GeneratedParser::~GeneratedParser()
+{
+}
+
+int GeneratedParser::Parse(const vector<LineToken>& tokens, Node& root)
+{
+	m_tokens	= &tokens;
+	m_position	= 0;
+	m_farthest	= 0;
+
+	unsigned int children = root.nodes.size();
+	bool matched = ParseStart(root) && MatchEnd();
+	m_memo.clear();
+
+	if(matched)
+		return GENERATED_PARSE_DONE;
+
+	root.nodes.resize(children);
+
+	// Looking past the last token means the program may still be completed by more input.
+	return (m_farthest >= tokens.size()) ? GENERATED_PARSE_MORE : GENERATED_PARSE_ERROR;
+}
+
+int GeneratedParser::PeekColumn()
+{
+	if(m_position > m_farthest)
+		m_farthest = m_position;
+
+	if(m_position >= m_tokens->size())
+		return PARSE_TABLE_EOF;
+
+	return (*m_tokens)[m_position].tokenID;
+}
+
+bool GeneratedParser::MatchToken(int tokenID, int symbol, Node& parent)
+{
+	if(PeekColumn() != tokenID)
+		return false;
+
+	const LineToken& token = (*m_tokens)[m_position++];
+
+	Node newNodeT;
+	newNodeT.type		= symbol;
+	newNodeT.closed		= true;
+	newNodeT.complete	= NODE_IS_COMPLETE;
+	newNodeT.value		= token.value;
+	newNodeT.lineNumber	= token.lineNumber;
+	parent.nodes.push_back(newNodeT);
+
+	return true;
+}
+
+bool GeneratedParser::MatchEnd()
+{
+	return PeekColumn() == PARSE_TABLE_EOF;
+}
+
+int GeneratedParser::Recall(Node& parent, int symbol)
+{
+	if(!m_memoize)
+		return GENERATED_MEMO_NONE;
+
+	unordered_map<unsigned long long, GeneratedMatch>::iterator it = m_memo.find(((unsigned long long)m_position << 32) | (unsigned int)symbol);
+	if(it == m_memo.end())
+		return GENERATED_MEMO_NONE;
+
+	GeneratedMatch& memo = it->second;
+	if(!memo.matched)
+		return GENERATED_MEMO_FAILED;
+
+	// The match is still in the tree somewhere, so it is parsed again.
+	if(!memo.kept)
+		return GENERATED_MEMO_NONE;
+
+	parent.nodes.push_back(Node());
+	MoveNode(memo.node, parent.nodes.back());
+	memo.kept	= false;
+	m_position	= memo.end;
+
+	return GENERATED_MEMO_MATCHED;
+}
+
+Node& GeneratedParser::BeginNode(Node& parent, int symbol)
+{
+	// The node is added first so its children are built in place. Siblings are only added once it ends.
+	parent.nodes.push_back(Node());
+	Node& node = parent.nodes.back();
+	node.type = symbol;
+
+	if(m_position < m_tokens->size())
+		node.lineNumber = (*m_tokens)[m_position].lineNumber;
+	else if(!m_tokens->empty())
+		node.lineNumber = m_tokens->back().lineNumber;
+
+	return node;
+}
+
+bool GeneratedParser::EndNode(Node& parent, unsigned int start, bool matched)
+{
+	Node& node = parent.nodes.back();
+
+	if(matched)
+	{
+		node.complete	= NODE_IS_COMPLETE;
+		node.closed		= true;
+	}
+	else
+	{
+		KeepNodes(node.nodes, start);
+		m_position = start;
+	}
+
+	if(m_memoize)
+	{
+		GeneratedMatch& memo = m_memo[((unsigned long long)start << 32) | (unsigned int)node.type];
+		memo.matched	= matched;
+		memo.kept		= false;
+		memo.end		= m_position;
+	}
+
+	if(!matched)
+		parent.nodes.pop_back();
+
+	return matched;
+}
+
+void GeneratedParser::KeepLongest(Node& node, GeneratedMatch& longest)
+{
+	if(longest.matched && m_position <= longest.end)
+		return;
+
+	// The shorter match is left in node for ResetNode to throw away.
+	longest.matched	= true;
+	longest.end		= m_position;
+	longest.node.nodes.swap(node.nodes);
+}
+
+bool GeneratedParser::EndLongest(Node& node, GeneratedMatch& longest)
+{
+	if(!longest.matched)
+		return false;
+
+	node.nodes.swap(longest.node.nodes);
+	m_position = longest.end;
+
+	return true;
+}
+
+void GeneratedParser::ResetNode(Node& node, unsigned int position)
+{
+	KeepNodes(node.nodes, position);
+	node.nodes.clear();
+	m_position = position;
+}
+
+void GeneratedParser::KeepNodes(vector<Node>& nodes, unsigned int position)
+{
+	if(!m_memoize)
+		return;
+
+	// EndNode saw every non-terminal here end, which tells where the next node starts.
+	// Anything else is a terminal using one token.
+	for(vector<Node>::iterator it = nodes.begin(); it != nodes.end(); it++)
+	{
+		unordered_map<unsigned long long, GeneratedMatch>::iterator memo = m_memo.find(((unsigned long long)position << 32) | (unsigned int)it->type);
+		if(memo == m_memo.end() || !memo->second.matched)
+		{
+			position++;
+			continue;
+		}
+
+		MoveNode(*it, memo->second.node);
+		memo->second.kept = true;
+		position = memo->second.end;
+	}
+}
+
+unsigned long long CompleteParser::GetGrammarSignature()
+{
+	string data;
+
+	for(int i = 0; i < m_symbols.GetCount(); i++)
+		data.append(m_symbols.GetName(i)).push_back('\0');
+
+	// EndParsing adds EOF to the start rules every time it runs, so it is left out.
+	for(vector<int>::iterator key = m_ruleKeys.begin(); key != m_ruleKeys.end(); key++)
+	{
+		data.append((const char*)&*key, sizeof(int));
+		for(unsigned int i = 0; i < m_rules[*key].size(); i++)
+		{
+			for(vector<int>::iterator rule = m_rules[*key][i].begin(); rule != m_rules[*key][i].end(); rule++)
+			{
+				if(*rule != SYMBOL_EOF)
+					data.append((const char*)&*rule, sizeof(int));
+			}
+			data.push_back('\0');
+		}
+	}
+
+	return HashGrammar(data.data(), data.size());
+}
+
+bool CompleteParser::SetGeneratedParser(GeneratedParser* parser)
+{
+	if(parser && parser->GetSignature() != GetGrammarSignature())
+		return false;
+
+	m_generatedParser = parser;
+	m_generatedTokens.clear();
+	m_generatedDepth = 0;
+
+	return true;
+}
+
+int CompleteParser::EvaluateLineGenerated(list<LineToken>& line)
+{
+	// The whole program was already parsed.
+	if(!m_nodes.nodes.empty())
+		return TOKEN_ERR_SYNTAX;
+
+	for(list<LineToken>::iterator token = line.begin(); token != line.end(); token++)
+	{
+		if(token->tokenID == LBRACE)
+			m_generatedDepth++;
+		else if(token->tokenID == RBRACE)
+			m_generatedDepth--;
+
+		m_generatedTokens.push_back(*token);
+	}
+
+	// The program can only end once every brace is closed. Waiting until then keeps the
+	// tokens from being parsed again for every line.
+	if(m_generatedDepth > 0)
+		return TOKEN_ERR_NONE;
+
+	int result = m_generatedParser->Parse(m_generatedTokens, m_nodes);
+	if(result == GENERATED_PARSE_ERROR)
+		return TOKEN_ERR_SYNTAX;
+
+	if(result == GENERATED_PARSE_DONE)
+		m_generatedTokens.clear();
+
+	return TOKEN_ERR_NONE;
+}
+
+bool CompleteParser::IsLeftRecursive()
+{
+	int symbolCount = m_symbols.GetCount();
+
+	// An edge from a key to every non-terminal its rulesets can start with.
+	vector<vector<int> > starts(symbolCount);
+	vector<int> incoming(symbolCount, 0);
+	for(vector<int>::iterator key = m_ruleKeys.begin(); key != m_ruleKeys.end(); key++)
+	{
+		for(unsigned int i = 0; i < m_rules[*key].size(); i++)
+		{
+			for(vector<int>::iterator rule = m_rules[*key][i].begin(); rule != m_rules[*key][i].end(); rule++)
+			{
+				if(!IsTokenTerminal(*rule))
+				{
+					starts[*key].push_back(*rule);
+					incoming[*rule]++;
+				}
+
+				if(!m_nullable[*rule])
+					break;
+			}
+		}
+	}
+
+	// Remove the symbols nothing starts with until only cycles are left.
+	vector<int> ready;
+	for(int i = 0; i < symbolCount; i++)
+	{
+		if(incoming[i] == 0)
+			ready.push_back(i);
+	}
+
+	int removed = 0;
+	while(!ready.empty())
+	{
+		int symbol = ready.back();
+		ready.pop_back();
+		removed++;
+
+		for(vector<int>::iterator it = starts[symbol].begin(); it != starts[symbol].end(); it++)
+		{
+			if(--incoming[*it] == 0)
+				ready.push_back(*it);
+		}
+	}
+
+	return removed < symbolCount;
+}
+
+string CompleteParser::GetGeneratedName(int symbol)
+{
+	const string& name = m_symbols.GetName(symbol);
+
+	string generated("Parse_");
+	bool changed = false;
+	for(unsigned int i = 0; i < name.length(); i++)
+	{
+		if(isalnum((unsigned char)name[i]) || name[i] == '_')
+			generated.push_back(name[i]);
+		else
+		{
+			generated.push_back('_');
+			changed = true;
+		}
+	}
+
+	// The symbol keeps names which had to be changed unique.
+	if(changed)
+	{
+		stringstream ss;
+		ss << "_" << symbol;
+		generated.append(ss.str());
+	}
+
+	return generated;
+}
+
+__declspec(dllexport) bool CompleteParser::GenerateParser(const char* headerFile, const char* sourceFile, const char* className)
+{
+	if(m_grammarStage < GRMR_FINISHED || m_errors.HasErrors() || m_ruleKeys.empty() || IsLeftRecursive())
+		return false;
+
+	// The header is included by its file name.
+	string headerName(headerFile);
+	size_t slash = headerName.find_last_of("/\\");
+	if(slash != string::npos)
+		headerName = headerName.substr(slash + 1);
+
+	string guard("_");
+	for(const char* c = className; *c; c++)
+		guard.push_back((char)toupper((unsigned char)*c));
+	guard.append("_H_");
+
+	stringstream header;
+	header << "////////////////////////////////////////////////////////////////////////////////\n";
+	header << "// Filename: " << headerName << "\n";
+	header << "//\n";
+	header << "// Generated by CompleteParser::GenerateParser. Changes are lost when the parser\n";
+	header << "// is generated again.\n";
+	header << "////////////////////////////////////////////////////////////////////////////////\n";
+	header << "#ifndef " << guard << "\n";
+	header << "#define " << guard << "\n\n";
+	header << "#include \"CompleteParser.h\"\n\n";
+	header << "////////////////////////////////////////////////////////////////////////////////\n";
+	header << "// Class name: " << className << "\n";
+	header << "////////////////////////////////////////////////////////////////////////////////\n";
+	header << "class " << className << " : public GeneratedParser\n";
+	header << "{\n";
+	header << "public:\n";
+	header << "\t" << className << "();\n\n";
+	header << "\tunsigned long long GetSignature();\n\n";
+	header << "protected:\n";
+	header << "\tbool ParseStart(Node& root);\n\n";
+	header << "private:\n";
+
+	// Only a grammar with conflicts backtracks, so only it needs the results kept.
+	stringstream source;
+	source << "#include \"" << headerName << "\"\n\n";
+	source << className << "::" << className << "()\n";
+	source << "{\n";
+	source << "\tm_memoize = " << (m_isLL1 ? "false" : "true") << ";\n";
+	source << "}\n\n";
+	source << "unsigned long long " << className << "::GetSignature()\n";
+	source << "{\n";
+	source << "\treturn 0x" << hex << GetGrammarSignature() << dec << "ULL;\n";
+	source << "}\n\n";
+	source << "bool " << className << "::ParseStart(Node& root)\n";
+	source << "{\n";
+	source << "\treturn " << GetGeneratedName(*m_nonTerminals.begin()) << "(root);\n";
+	source << "}\n";
+
+	for(list<int>::iterator nt = m_nonTerminals.begin(); nt != m_nonTerminals.end(); nt++)
+	{
+		int key = *nt;
+		string name = GetGeneratedName(key);
+
+		header << "\tbool " << name << "(Node& parent);\n";
+
+		// The rulesets each column selects, in grammar order.
+		vector<vector<int> > columnRuleSets(PARSE_TABLE_EOF + 1);
+		bool backtracks = false;
+		for(unsigned int i = 0; i < m_rules[key].size(); i++)
+		{
+			SymbolSet columns;
+			GetRuleSetColumns(key, i, columns);
+			for(vector<int>::const_iterator column = columns.GetSymbols().begin(); column != columns.GetSymbols().end(); column++)
+			{
+				columnRuleSets[*column].push_back(i);
+				backtracks = backtracks || columnRuleSets[*column].size() > 1;
+			}
+		}
+
+		source << "\n// " << m_symbols.GetName(key) << "\n";
+		source << "bool " << className << "::" << name << "(Node& parent)\n";
+		source << "{\n";
+		source << "\tint memo = Recall(parent, " << key << ");\n";
+		source << "\tif(memo != GENERATED_MEMO_NONE)\n";
+		source << "\t\treturn memo == GENERATED_MEMO_MATCHED;\n\n";
+		source << "\tunsigned int start = m_position;\n";
+		source << "\tNode& node = BeginNode(parent, " << key << ");\n";
+		if(backtracks)
+			source << "\tGeneratedMatch longest;\n";
+		source << "\n";
+		source << "\tswitch(PeekColumn())\n";
+		source << "\t{\n";
+
+		// Columns selecting the same rulesets share a case.
+		vector<bool> written(PARSE_TABLE_EOF + 1, false);
+		for(int column = 0; column <= PARSE_TABLE_EOF; column++)
+		{
+			if(written[column] || columnRuleSets[column].empty())
+				continue;
+
+			for(int other = column; other <= PARSE_TABLE_EOF; other++)
+			{
+				if(written[other] || columnRuleSets[other] != columnRuleSets[column])
+					continue;
+
+				written[other] = true;
+				source << "\tcase " << other << ":\t// " << ((other == PARSE_TABLE_EOF) ? m_symbols.GetName(SYMBOL_EOF) : TOKENS[other]) << "\n";
+			}
+
+			bool single = (columnRuleSets[column].size() == 1);
+			for(vector<int>::iterator ruleSet = columnRuleSets[column].begin(); ruleSet != columnRuleSets[column].end(); ruleSet++)
+			{
+				vector<int>& rule = m_rules[key][*ruleSet];
+
+				// A ruleset starting every ruleset tried before it ends where they leave it, so it is only tried
+				// when none of them matched. stmt_list -> stmt does not parse stmt again after stmt stmt_list.
+				bool prefix = (ruleSet != columnRuleSets[column].begin());
+				for(vector<int>::iterator before = columnRuleSets[column].begin(); before != ruleSet && prefix; before++)
+				{
+					vector<int>& longer = m_rules[key][*before];
+					prefix = (rule.size() < longer.size() && equal(rule.begin(), rule.end(), longer.begin()));
+				}
+
+				string ruleText = m_symbols.GetName(key) + " ->";
+				string condition;
+				for(vector<int>::iterator it = rule.begin(); it != rule.end(); it++)
+				{
+					ruleText.append(" ").append(m_symbols.GetName(*it));
+
+					stringstream ss;
+					if(*it == SYMBOL_EPSILON)
+						continue;
+					else if(*it == SYMBOL_EOF)
+						ss << "MatchEnd()";
+					else if(IsTokenTerminal(*it))
+						ss << "MatchToken(" << GetParseTableColumn(*it) << ", " << *it << ", node)";
+					else
+						ss << GetGeneratedName(*it) << "(node)";
+
+					if(!condition.empty())
+						condition.append(" && ");
+					condition.append(ss.str());
+				}
+
+				source << "\t\t// " << ruleText << "\n";
+
+				if(single)
+				{
+					if(condition.empty())
+						source << "\t\treturn EndNode(parent, start, true);\n";
+					else
+					{
+						source << "\t\tif(" << condition << ")\n";
+						source << "\t\t\treturn EndNode(parent, start, true);\n";
+						source << "\t\tbreak;\n";
+					}
+				}
+				else
+				{
+					if(prefix)
+						condition = condition.empty() ? "!longest.matched" : "!longest.matched && " + condition;
+
+					if(condition.empty())
+						source << "\t\tKeepLongest(node, longest);\n";
+					else
+					{
+						source << "\t\tif(" << condition << ")\n";
+						source << "\t\t\tKeepLongest(node, longest);\n";
+					}
+					source << "\t\tResetNode(node, start);\n";
+				}
+			}
+
+			if(!single)
+				source << "\t\treturn EndNode(parent, start, EndLongest(node, longest));\n";
+		}
+
+		source << "\t}\n\n";
+		source << "\treturn EndNode(parent, start, false);\n";
+		source << "}\n";
+	}
+
+	header << "};\n\n";
+	header << "#endif\n";
+
+	ofstream headerOut(headerFile);
+	ofstream sourceOut(sourceFile);
+	if(!headerOut.good() || !sourceOut.good())
+		return false;
+
+	headerOut << header.str();
+	sourceOut << source.str();
+
+	return headerOut.good() && sourceOut.good();
+}
@@ -1,23 +1,5 @@
 #include "CompleteParser.h"
 
-template <class T> class IsEpsilon : public unary_function<T, bool>
-{
-public:
-	bool operator() (T& val)
-	{
-		return val == TOKEN_EPSILON;
-	}
-};
-
-class StackMemCompare
-{
-public:
-    StackMemCompare(void* compare) : compare(compare) {}
-    bool operator() (const StackMemory *mem) const {return mem->mem == compare;}
-private:
-    void* compare;
-};
-
 CompleteParser::CompleteParser()
 {
 	m_inputBuffer				= 0;
@@ -30,7 +12,19 @@ CompleteParser::CompleteParser()
 	m_variables					= 0;
 	m_openBrackets				= 0;
 	m_scoping					= SCOPING_STATIC;
+	m_lexerMode					= LEXER_DFA;
+	m_lexerLine					= 0;
+	m_lexerOffset				= 0;
+	m_parseEngine				= PARSE_ENGINE_LL1;
+	m_isLL1						= false;
+	m_generatedParser			= 0;
+	m_generatedDepth			= 0;
+	m_lalrBuilt					= false;
+	m_matchMemoEnabled			= USE_MATCH_MEMO != 0;
 	m_consoleMode				= false;
+	m_recordLines				= false;
+	m_program					= 0;
+	m_recordStatements			= false;
 
 	ClearNodes();
 }
@@ -47,6 +41,9 @@ bool CompleteParser::Initialize(Input* input)
 	m_inputBuffer	= input;
 	m_variables		= new Variables;
 	m_nodes.type	= BASE_NODE_TYPE;
+	m_optimizer.SetVariables(m_variables);
+	m_byteCode.SetVariables(m_variables);
+	m_tempAllocator.SetVariables(m_variables);
 
 	string boolStr("PRIM_BOOL");
 	string stringStr("PRIM_STRING");
@@ -79,6 +76,13 @@ __declspec(dllexport) bool CompleteParser::Update()
 {
 	char c;
 
+	// The program is tokenized in one pass once the grammar has built the lexer.
+	if(m_lexerMode == LEXER_DFA && m_grammarStage == PROGRAM_INPUT && m_lexer.IsInitialized())
+	{
+		if(!m_inputBuffer->IsEOL() && UpdateLexer())
+			return false;
+	}
+
 	// Loop through the entire line finding all words and matching all tokens.
 	while(!m_inputBuffer->IsEOL() && m_grammarStage != GRMR_FINISHED)
 	{
@@ -102,6 +106,41 @@ __declspec(dllexport) bool CompleteParser::Update()
 	return true;
 }
 
+bool CompleteParser::UpdateLexer()
+{
+	const char* buffer = m_inputBuffer->GetBuffer();
+
+	// A '-' at the start of the buffer is a sign or an operator depending on the token before it.
+	int previousKind = m_currentLine.empty() ? LEX_NONE : m_lexer.FindKind(m_currentLine.back().value);
+
+	m_lexTokens.clear();
+	m_lexer.Tokenize(buffer, m_inputBuffer->GetBufferSize(), m_lexTokens, previousKind);
+	m_inputBuffer->SkipLine();
+
+	for(unsigned int i = 0; i < m_lexTokens.size(); i++)
+	{
+		LexToken& token = m_lexTokens[i];
+
+		m_lexerLine = token.line;
+		m_lexerOffset = token.offset + token.length;
+		m_tokenStr.assign(buffer + token.offset, token.length);
+
+		// Error check the token output. If true then processing should be aborted.
+		if(HandleError(HandleTokenID(m_tokenStr)))
+			return true;
+	}
+
+	return false;
+}
+
+int CompleteParser::GetCurrentLineNumber()
+{
+	if(m_lexerMode == LEXER_DFA && m_lexer.IsInitialized())
+		return m_lexerLine;
+
+	return m_inputBuffer->GetLineNumber();
+}
+
 void CompleteParser::EndParsing()
 {
 	if(m_currentRule || m_grammarStage < GRMR_FINISHED)
@@ -115,6 +154,13 @@ void CompleteParser::EndParsing()
 		CalculateFirstAndFollowSets();
 		if(!m_errors.HasErrors())
 		{
+			// The terminals and rules are final once the grammar is complete.
+			if(!m_lexer.IsInitialized())
+			{
+				InitializeLexer();
+				BuildParseTable();
+			}
+
 			if(PRINT_RULES)
 				PrintRules();
 			if(PRINT_OUTPUT)
@@ -126,6 +172,14 @@ void CompleteParser::EndParsing()
 	}
 }
 
+void CompleteParser::InitializeLexer()
+{
+	list<string> terminals;
+	for(list<int>::iterator it = m_terminals.begin(); it != m_terminals.end(); it++)
+		terminals.push_back(m_symbols.GetName(*it));
+	m_lexer.Initialize(terminals);
+}
+
 bool CompleteParser::HandleError(int errorCode)
 {
 	if(errorCode)
@@ -164,10 +218,16 @@ int CompleteParser::HandleToken(int token)
 			if(m_terminals.empty() || m_nonTerminals.empty())
 				return TOKEN_ERR_SYNTAX;
 			// Load in constant terminals.
-			if(!IsTokenTerminal(string(TOKEN_EOF)))
-				m_terminals.push_back(TOKEN_EOF);
-			if(!IsTokenTerminal(string(TOKEN_EPSILON)))
-				m_terminals.push_back(TOKEN_EPSILON);
+			if(!IsTokenTerminal(SYMBOL_EOF))
+			{
+				m_terminals.push_back(SYMBOL_EOF);
+				m_symbols.AddFlags(SYMBOL_EOF, SYMBOL_TERMINAL);
+			}
+			if(!IsTokenTerminal(SYMBOL_EPSILON))
+			{
+				m_terminals.push_back(SYMBOL_EPSILON);
+				m_symbols.AddFlags(SYMBOL_EPSILON, SYMBOL_TERMINAL);
+			}
 			m_startOfRule = true;
 		}
 		m_currentRule = 0;
@@ -180,9 +240,14 @@ int CompleteParser::HandleToken(int token)
 		// Add ID to terminals, non-terminals, or rules.
 	default:
 		{
-			string cpy = m_inputBuffer->CopyBuffer(m_tokenStart, m_tokenEnd, token == PRIM_STRING); // Declare here for portability.
-			RemoveCString(cpy);
-			returnCode = HandleTokenID(cpy);
+			// Reuse the token string so a view of the buffer is copied without a new allocation.
+			InputView view;
+			if(m_inputBuffer->GetView(m_tokenStart, m_tokenEnd, view))
+				m_tokenStr.assign(view.data, view.length);
+			else
+				m_tokenStr.clear();
+			RemoveCString(m_tokenStr);
+			returnCode = HandleTokenID(m_tokenStr);
 			break;
 		}
 		// End the key definition of a rule.
@@ -197,11 +262,9 @@ int CompleteParser::HandleToken(int token)
 }
 
 /*
-	The map searching here is logarithmic using the std algorithms,
-	however it could be further optimized to bookmark where an entry should
-	be inserted to during the initial existance search. So when the entry
-	is verified as not existing it would then be inserted directly into the
-	bookmark.
+	Every grammar token is interned once to a symbol. Checking if it is a
+	terminal or non-terminal, and finding the rules of a key, are then
+	array lookups instead of searches.
 */
 
 int CompleteParser::HandleTokenID(string& token)
@@ -211,19 +274,28 @@ int CompleteParser::HandleTokenID(string& token)
 	if(token.empty())
 		return returnCode;
 
+	if(m_grammarStage > GRMR_RULES)
+		return HandleTokenIDSyntax(token);
+
+	int symbol = InternSymbol(token);
+
 	switch(m_grammarStage)
 	{
-	default:
-		return HandleTokenIDSyntax(token);
 	case GRMR_NONTERMINALS:
 		// Only add to the list if the token does not already exist.
-		if(!IsTokenNonTerminal(token))
-			m_nonTerminals.push_back(token);
+		if(!IsTokenNonTerminal(symbol))
+		{
+			m_nonTerminals.push_back(symbol);
+			m_symbols.AddFlags(symbol, SYMBOL_NONTERMINAL);
+		}
 		break;
 	case GRMR_TERMINALS:
 		// Only add to the list if the token does not already exist.
-		if(!IsTokenTerminal(token))
-			m_terminals.push_back(token);
+		if(!IsTokenTerminal(symbol))
+		{
+			m_terminals.push_back(symbol);
+			m_symbols.AddFlags(symbol, SYMBOL_TERMINAL);
+		}
 		break;
 	case GRMR_RULES:
 		// A new rule key is going to be defined.
@@ -233,27 +305,20 @@ int CompleteParser::HandleTokenID(string& token)
 			if(m_currentRule) return TOKEN_ERR_SYNTAX;
 
 			// Check to make sure the non terminal has been declared.
-			if(!IsTokenNonTerminal(token) && !IsTokenTerminal(token))
+			if(!IsTokenNonTerminal(symbol) && !IsTokenTerminal(symbol))
 				returnCode = TOKEN_ERR_NOT_DECLARED;
 
 			// Check to make sure a terminal is not being defined.
-			if(IsTokenTerminal(token))
+			if(IsTokenTerminal(symbol))
 				returnCode = TOKEN_ERR_NON_MODIFIABLE;
 
-			map<string, vector< list <string> > >::iterator it;
-			// If the non-terminal does not yet exist as a rule key.
-			if((it = m_rules.find(token)) == m_rules.end())
-			{
-				// Create a new map entry and link the current token to it.
-				m_rules[token].push_back(list<string>());
-				m_currentRule = &m_rules[token][m_currentRuleList = 0];
-			}
-			// There is already an existing key with an existing set of rules. Add another set of rules.
-			else
-			{
-				it->second.push_back(list<string>());
-				m_currentRule = &it->second[(m_currentRuleList = (it->second.size() - 1))];
-			}
+			if(symbol >= (int)m_rules.size())
+				m_rules.resize(symbol + 1);
+
+			// Add another set of rules to the key. The first set creates the key.
+			m_rules[symbol].push_back(vector<int>());
+			m_currentRuleList = m_rules[symbol].size() - 1;
+			m_currentRule = &m_rules[symbol][m_currentRuleList];
 		}
 		// Rules are being added to an existing rule key.
 		else
@@ -262,11 +327,11 @@ int CompleteParser::HandleTokenID(string& token)
 			if(!m_currentRule)
 				return TOKEN_ERR_SYNTAX;
 
-			if(!IsTokenNonTerminal(token) && !IsTokenTerminal(token))
+			if(!IsTokenNonTerminal(symbol) && !IsTokenTerminal(symbol))
 				returnCode = TOKEN_ERR_NOT_DECLARED;
 
 			// Add the token to the current ruleset.
-			m_currentRule->push_back(token);
+			m_currentRule->push_back(symbol);
 
 		}
 		break;
@@ -313,8 +378,8 @@ handle_digit:
 			// A negative operator could be either part of a sign of digit or an operation.
 			if(c == '-' && m_currentLine.size())
 			{
-				string op = m_currentLine.back();
-				if(!(op == "=" || op == ":" || OperationToTokenType(op)))
+				int op = m_currentLine.back().tokenID;
+				if(!(op == EQUAL || op == COLON || OperationToTokenType(op)))
 					break;
 			}
 
@@ -472,19 +537,28 @@ handle_digit:
 	return tType;
 }
 
-bool CompleteParser::IsTokenTerminal(string& token)
+bool CompleteParser::IsTokenTerminal(int symbol)
 {
-	return find(m_terminals.begin(), m_terminals.end(), token) != m_terminals.end();
+	return m_symbols.IsTerminal(symbol);
 }
 
-bool CompleteParser::IsTokenNonTerminal(string& token)
+bool CompleteParser::IsTokenNonTerminal(int symbol)
 {
-	return find(m_nonTerminals.begin(), m_nonTerminals.end(), token) != m_nonTerminals.end();
+	return m_symbols.IsNonTerminal(symbol);
 }
 
-bool CompleteParser::IsTokenRuleKey(string& token)
+int CompleteParser::InternSymbol(string& token)
 {
-	return m_rules.find(token) != m_rules.end();
+	int symbol = m_symbols.Find(token);
+	if(symbol == SYMBOL_NONE)
+		symbol = m_symbols.Intern(token, GetTokenID(token));
+
+	return symbol;
+}
+
+bool CompleteParser::IsTokenRuleKey(int symbol)
+{
+	return symbol >= 0 && symbol < (int)m_rules.size() && !m_rules[symbol].empty();
 }
 
 void CompleteParser::RemoveCString(string& str)
@@ -496,21 +570,18 @@ void CompleteParser::RemoveCString(string& str)
 	}
 }
 
-bool CompleteParser::IsTokenInRule(string& token)
+bool CompleteParser::IsTokenInRule(int token)
 {
 	// The epsilon and EOF are added in apart from the normal token list and do not have to be in the rules.
-	if(token == TOKEN_EOF || token == TOKEN_EPSILON)
+	if(token == SYMBOL_EOF || token == SYMBOL_EPSILON)
 		return true;
 
-	for(map<string, vector<list <string> > >::iterator rules = m_rules.begin(); rules != m_rules.end(); rules++)
+	for(unsigned int key = 0; key < m_rules.size(); key++)
 	{
-		for(unsigned int i = 0; i < rules->second.size(); i++)
+		for(unsigned int i = 0; i < m_rules[key].size(); i++)
 		{
-			for(list<string>::iterator rule = rules->second[i].begin(); rule != rules->second[i].end(); rule++)
-			{
-				if(*rule == token)
-					return true;
-			}
+			if(find(m_rules[key][i].begin(), m_rules[key][i].end(), token) != m_rules[key][i].end())
+				return true;
 		}
 	}
 
@@ -524,34 +595,38 @@ int CompleteParser::GetIDType(int c)
 
 void CompleteParser::CalculateFirstAndFollowSets()
 {
-	if(m_rules.empty())
+	// The follow sets visit the rule keys in name order.
+	m_ruleKeys.clear();
+	for(unsigned int key = 0; key < m_rules.size(); key++)
+	{
+		if(!m_rules[key].empty())
+			m_ruleKeys.push_back(key);
+	}
+	sort(m_ruleKeys.begin(), m_ruleKeys.end(), SymbolNameCompare(&m_symbols));
+
+	if(m_ruleKeys.empty())
 		return;
 
 	// Add EOF to start symbols.
-	if(IsTokenRuleKey(*m_nonTerminals.begin()))
+	int start = *m_nonTerminals.begin();
+	if(IsTokenRuleKey(start))
 	{
-		for(unsigned int i = 0; i < m_rules[*m_nonTerminals.begin()].size(); i++)
+		for(unsigned int i = 0; i < m_rules[start].size(); i++)
 		{
-			m_rules[*m_nonTerminals.begin()][i].push_back(TOKEN_EOF);
+			m_rules[start][i].push_back(SYMBOL_EOF);
 		}
 	}
 	else
 		HandleError(TOKEN_ERR_NON_MODIFIABLE);
 
-	m_firstSets.clear();
-	m_followSets.clear();
-	// Determine the first possible operation(s) of each non-terminal.
-	for(list<string>::iterator nt = m_nonTerminals.begin(); nt != m_nonTerminals.end(); nt++)
-	{
-		list<StackMemory*> stack;
-		FindStartTerminalsOfRules(*nt, m_firstSets[*nt], stack);
-		stack.clear();
-		FindFollowTerminalsOfRules(*nt, m_followSets[*nt], stack);
-	}
+	// Every symbol has an entry, even a non-terminal which was never defined.
+	m_rules.resize(m_symbols.GetCount());
+	CalculateFirstSets();
+	CalculateFollowSets();
 
 	// Check to make sure every non-terminal is defined.
 
-	for(list<string>::iterator it = m_nonTerminals.begin(); it != m_nonTerminals.end(); it++)
+	for(list<int>::iterator it = m_nonTerminals.begin(); it != m_nonTerminals.end(); it++)
 	{
 		if(!IsTokenRuleKey(*it))
 		{
@@ -565,7 +640,7 @@ void CompleteParser::CalculateFirstAndFollowSets()
 	// and sign operations. For example, the negative (-2) sign is used for numbers, but may
 	// not be valid as an expression operator (5 - 2).
 	/*
-	for(list<string>::iterator it = m_terminals.begin(); it != m_terminals.end(); it++)
+	for(list<int>::iterator it = m_terminals.begin(); it != m_terminals.end(); it++)
 	{
 		if(!IsTokenInRule(*it))
 		{
@@ -575,201 +650,171 @@ void CompleteParser::CalculateFirstAndFollowSets()
 	}*/
 }
 
-#define TOKEN_IS_EPSILON	-1
-#define TOKEN_IS_NON_TERM	0
-#define TOKEN_IS_TERMINAL	1
-#define TOKEN_IS_EOF		2
-#define TOKEN_IS_REPEAT		3
-
-int CompleteParser::FindStartTerminalsOfRules(string& token, list<string>& terminals, list<StackMemory*>& stackOverflow)
+void CompleteParser::CalculateFirstSets()
 {
-	// The token has been executed through the rules down to a terminal.
-	if(token != TOKEN_EOF && IsTokenTerminal(token))
+	int symbolCount = m_symbols.GetCount();
+
+	m_nullable.assign(symbolCount, false);
+	m_nullable[SYMBOL_EPSILON] = true;
+	m_firstSets.assign(symbolCount, SymbolSet());
+
+	// The rule keys using each symbol in a ruleset. A key is only revisited when one of them changes.
+	vector<vector<int> > users(symbolCount);
+	for(vector<int>::iterator key = m_ruleKeys.begin(); key != m_ruleKeys.end(); key++)
 	{
-		if(find(terminals.begin(), terminals.end(), token) == terminals.end())
+		for(unsigned int i = 0; i < m_rules[*key].size(); i++)
 		{
-			terminals.push_back(token);
+			for(vector<int>::iterator rule = m_rules[*key][i].begin(); rule != m_rules[*key][i].end(); rule++)
+			{
+				if(!IsTokenTerminal(*rule) && (users[*rule].empty() || users[*rule].back() != *key))
+					users[*rule].push_back(*key);
+			}
 		}
-		return (token == TOKEN_EPSILON) ? TOKEN_IS_EPSILON : TOKEN_IS_TERMINAL;
 	}
 
-	int terminalFound = TOKEN_IS_NON_TERM;
-
-	bool epsilonVerified = false;
-	int epsilonCount = 0;
+	vector<int> worklist(m_ruleKeys.rbegin(), m_ruleKeys.rend());
+	vector<bool> queued(symbolCount, false);
+	for(vector<int>::iterator key = m_ruleKeys.begin(); key != m_ruleKeys.end(); key++)
+		queued[*key] = true;
 
-	if(IsTokenRuleKey(token))
+	while(!worklist.empty())
 	{
-		// For each rule set of this token. (If a key has multiple definitions)
-		for(unsigned int i = 0; i < m_rules[token].size(); i++)
+		int key = worklist.back();
+		worklist.pop_back();
+		queued[key] = false;
+
+		SymbolSet& first = m_firstSets[key];
+		bool changed = false;
+
+		for(unsigned int i = 0; i < m_rules[key].size(); i++)
 		{
-			// For each rule of the duplicate keys.
-			int ruleItIndex = 0;
-			for(list<string>::iterator ruleIt = m_rules[token][i].begin(); ruleIt != m_rules[token][i].end(); ruleIt++)
+			// The ruleset starts with the first set of each symbol up to and including the first one which is not nullable.
+			bool allNullable = true;
+			for(vector<int>::iterator rule = m_rules[key][i].begin(); rule != m_rules[key][i].end() && allNullable; rule++)
 			{
-				// Recursive check against the rule token.
-				list<StackMemory*>::iterator stackIt = find_if(stackOverflow.begin(), stackOverflow.end(), StackMemCompare(&*ruleIt));
-				if(stackIt == stackOverflow.end())
+				if(IsTokenTerminal(*rule))
 				{
-					StackMemory stackmem;
-					stackmem.mem = &*ruleIt;
-					stackOverflow.push_back(&stackmem);
-					int result = FindStartTerminalsOfRules(*ruleIt, terminals, stackOverflow);
-					stackOverflow.remove(&stackmem);
-					if(result != TOKEN_IS_NON_TERM)
-					{
-						if(result != TOKEN_IS_EPSILON)
-						{
-							epsilonCount = 0;
-							// Epsilon has the highest return value priority.
-							if(terminalFound != TOKEN_IS_EPSILON)
-								terminalFound = TOKEN_IS_TERMINAL;
-							break;
-						}
-						else
-						{
-							// The terminal found was epsilon. Add to the count of epsilons for this sequence.
-							terminalFound = TOKEN_IS_EPSILON;
-							epsilonCount++;
-						}
-					}
-					else
-					{
-						break;
-					}
+					if(*rule != SYMBOL_EPSILON)
+						changed |= first.Add(*rule);
 				}
 				else
-					break;
+					changed |= first.Merge(m_firstSets[*rule], SYMBOL_EPSILON);
 
-				ruleItIndex++;
+				allNullable = m_nullable[*rule];
 			}
 
-			// The espilon should only be added if it exists as a distinct single possibility.
-			int size = m_rules[token][i].back() == TOKEN_EOF ? m_rules[token][i].size() - 1 : m_rules[token][i].size();
-			if(epsilonCount == size)
+			// Epsilon is in the first set only if a whole ruleset can derive nothing.
+			if(allNullable && !m_nullable[key])
 			{
-				epsilonVerified = true;
+				m_nullable[key] = true;
+				first.Add(SYMBOL_EPSILON);
+				changed = true;
 			}
-			if(!epsilonVerified)
+		}
+
+		if(changed)
+		{
+			for(vector<int>::iterator user = users[key].begin(); user != users[key].end(); user++)
 			{
-				terminals.remove(TOKEN_EPSILON);
+				if(!queued[*user])
+				{
+					queued[*user] = true;
+					worklist.push_back(*user);
+				}
 			}
 		}
 	}
-
-	return terminalFound;
 }
 
-int CompleteParser::FindFollowTerminalsOfRules(string& token, list<string>& terminals, list<StackMemory*>& stackOverflow)
+void CompleteParser::CalculateFollowSets()
 {
-	// The token has been executed through the rules down to a terminal.
-	if(IsTokenTerminal(token))
-	{
-		if(find(terminals.begin(), terminals.end(), token) == terminals.end())
-		{
-			// Epsilon does not show up on the follow sets.
-			if(token != TOKEN_EPSILON)
-				terminals.push_back(token);
-		}
-		return (token == TOKEN_EPSILON) ? TOKEN_IS_EPSILON : TOKEN_IS_TERMINAL;
-	}
+	int symbolCount = m_symbols.GetCount();
 
-	int terminalFound = TOKEN_IS_NON_TERM;
+	m_followSets.assign(symbolCount, SymbolSet());
 
-	// Loop through every rule key.
-	for(map<string, vector<list <string> > >::iterator ruleKey = m_rules.begin(); ruleKey != m_rules.end(); ruleKey++)
+	// The end of file follows the start symbol.
+	m_followSets[*m_nonTerminals.begin()].Add(SYMBOL_EOF);
+
+	// Everything following a key also follows the non-terminals which can end its rulesets.
+	vector<vector<int> > endsOf(symbolCount);
+
+	for(vector<int>::iterator key = m_ruleKeys.begin(); key != m_ruleKeys.end(); key++)
 	{
-		// Loop through every rule set for this rule key.
-		for(unsigned int ruleSet = 0; ruleSet < ruleKey->second.size(); ruleSet++)
+		for(unsigned int i = 0; i < m_rules[*key].size(); i++)
 		{
-			unsigned int ruleItIndex = 0;
-			// Now check every rule in the set for this token.
-			for(list<string>::iterator rule = ruleKey->second[ruleSet].begin(); rule != ruleKey->second[ruleSet].end(); rule++)
+			vector<int>& ruleSet = m_rules[*key][i];
+
+			// Walk the ruleset backwards keeping the first set of the symbols after the current one.
+			SymbolSet after;
+			bool afterNullable = true;
+			for(vector<int>::reverse_iterator rule = ruleSet.rbegin(); rule != ruleSet.rend(); rule++)
 			{
-				// The token was found as a rule.
-				if(*rule == token)
+				if(IsTokenTerminal(*rule))
 				{
-					int result = TOKEN_IS_EPSILON;
-					while(result == TOKEN_IS_EPSILON)
+					if(*rule != SYMBOL_EPSILON)
 					{
-						// The rule is not at the end of the rule set.
-						if(ruleItIndex < ruleKey->second[ruleSet].size() - 1)
-						{
-							list<StackMemory*> stack;
-							// Determine what comes after the token.
-							result = FindStartTerminalsOfRules(*(++rule), terminals, stack);
-							// Make sure epsilon is not in the follow set.
-							terminals.remove_if(IsEpsilon<string&>());
-							ruleItIndex++;
-						}
-						else
-							break;
+						after.Clear();
+						after.Add(*rule);
+						afterNullable = false;
 					}
+					continue;
+				}
 
-					terminalFound = result;
+				m_followSets[*rule].Merge(after, SYMBOL_EPSILON);
+				if(afterNullable && *rule != *key)
+					endsOf[*key].push_back(*rule);
 
-					// The rule is at the end of this set.
-					if(terminalFound != TOKEN_IS_TERMINAL && ruleItIndex >= ruleKey->second[ruleSet].size() - 1)
-					{
-						// The rule is at the end of its set, so now look through all of the other
-						// rules where this might be called.
-						if(ruleKey->first != token)
-						{
-							// If two different rule sets end with each others non-terminal a stack overflow can occur.
-							// This keeps track of sets checked.
-							if(find_if(stackOverflow.begin(), stackOverflow.end(), StackMemCompare(&m_rules[ruleKey->first][ruleSet])) == stackOverflow.end())
-							{
-								StackMemory mem;
-								mem.mem = &m_rules[ruleKey->first][ruleSet];
-								stackOverflow.push_back(&mem);
-								FindFollowTerminalsOfRules((string&)ruleKey->first, terminals, stackOverflow);
-								stackOverflow.remove(&mem);
-							}
-						}
-						break;
-					}
+				if(!m_nullable[*rule])
+				{
+					after.Clear();
+					afterNullable = false;
 				}
-				ruleItIndex++;
+				after.Merge(m_firstSets[*rule]);
 			}
 		}
 	}
 
-	// Make sure the EOF symbol is loaded for the start symbol.
-	if(token == *m_nonTerminals.begin())
-	{
-		// Add the end of file token.
-		AddEOFToSet(terminals);
-		terminalFound = TOKEN_IS_EOF;
-	}
-	
-	return terminalFound;
-}
+	vector<int> worklist(m_ruleKeys.rbegin(), m_ruleKeys.rend());
+	vector<bool> queued(symbolCount, false);
+	for(vector<int>::iterator key = m_ruleKeys.begin(); key != m_ruleKeys.end(); key++)
+		queued[*key] = true;
 
-void CompleteParser::AddEOFToSet(list<string>& setIn)
-{
-	// Add the end of file token.
-	if(find(setIn.begin(), setIn.end(), TOKEN_EOF) == setIn.end())
+	while(!worklist.empty())
 	{
-		setIn.push_back(TOKEN_EOF);
+		int key = worklist.back();
+		worklist.pop_back();
+		queued[key] = false;
+
+		for(vector<int>::iterator end = endsOf[key].begin(); end != endsOf[key].end(); end++)
+		{
+			if(m_followSets[*end].Merge(m_followSets[key]) && !queued[*end] && !endsOf[*end].empty())
+			{
+				queued[*end] = true;
+				worklist.push_back(*end);
+			}
+		}
 	}
 }
 
 // FIRST(key) = { VAL1, VAL2, ... VALN }
 void CompleteParser::PrintFirstSets()
 {
+	vector<int> ranks;
+	m_symbols.GetNameRanks(ranks);
+
 	// Find the key by using the non terminals to keep the original input order.
-	for(list<string>::iterator it = m_nonTerminals.begin(); it != m_nonTerminals.end(); it++)
+	for(list<int>::iterator it = m_nonTerminals.begin(); it != m_nonTerminals.end(); it++)
 	{
-		list<string> sortedList = m_firstSets[*it];
-		sortedList.sort();
+		vector<int> sortedList(m_firstSets[*it].GetSymbols());
+		sort(sortedList.begin(), sortedList.end(), SymbolRankCompare(ranks));
 
 		string output = "";
-		output.append("FIRST(").append(*it).append(") = {");
+		output.append("FIRST(").append(m_symbols.GetName(*it)).append(") = {");
 
 		unsigned int count = 0;
-		for(list<string>::iterator terminals = sortedList.begin(); terminals != sortedList.end(); terminals++)
+		for(vector<int>::iterator terminals = sortedList.begin(); terminals != sortedList.end(); terminals++)
 		{
-			output.append(" ").append(*terminals);
+			output.append(" ").append(m_symbols.GetName(*terminals));
 			// Add comma except on the end.
 			if(count < sortedList.size() - 1)
 				output.append(",");	// push_back not portable prior to c++11.
@@ -787,19 +832,22 @@ void CompleteParser::PrintFirstSets()
 
 void CompleteParser::PrintFollowSets()
 {
+	vector<int> ranks;
+	m_symbols.GetNameRanks(ranks);
+
 	// Find the key by using the non terminals to keep the original input order.
-	for(list<string>::iterator it = m_nonTerminals.begin(); it != m_nonTerminals.end(); it++)
+	for(list<int>::iterator it = m_nonTerminals.begin(); it != m_nonTerminals.end(); it++)
 	{
-		list<string> sortedList = m_followSets[*it];
-		sortedList.sort();
+		vector<int> sortedList(m_followSets[*it].GetSymbols());
+		sort(sortedList.begin(), sortedList.end(), SymbolRankCompare(ranks));
 
 		string output = "";
-		output.append("FOLLOW(").append(*it).append(") = {");
+		output.append("FOLLOW(").append(m_symbols.GetName(*it)).append(") = {");
 
 		unsigned int count = 0;
-		for(list<string>::iterator terminals = sortedList.begin(); terminals != sortedList.end(); terminals++)
+		for(vector<int>::iterator terminals = sortedList.begin(); terminals != sortedList.end(); terminals++)
 		{
-			output.append(" ").append(*terminals);
+			output.append(" ").append(m_symbols.GetName(*terminals));
 			// Add comma except on the end.
 			if(count < (sortedList.size() - 1))
 				output.append(",");	// push_back not portable prior to c++11.
@@ -824,15 +872,15 @@ void CompleteParser::PrintErrors()
 void CompleteParser::PrintRules()
 {
 	if(!PRINT_OUTPUT) return;
-	for(map<string, vector< list <string> > >::iterator it = m_rules.begin(); it != m_rules.end(); it++)
+	for(vector<int>::iterator it = m_ruleKeys.begin(); it != m_ruleKeys.end(); it++)
 	{
-		printf("key %s", it->first.c_str());
-		for(unsigned int i = 0; i < it->second.size(); i++)
+		printf("key %s", m_symbols.GetName(*it).c_str());
+		for(unsigned int i = 0; i < m_rules[*it].size(); i++)
 		{
 			printf("\nruleset %i\n", i);
-			for(list<string>::iterator rules = it->second[i].begin(); rules != it->second[i].end(); rules++)
+			for(vector<int>::iterator rules = m_rules[*it][i].begin(); rules != m_rules[*it][i].end(); rules++)
 			{
-				printf("%s ", rules->c_str());
+				printf("%s ", m_symbols.GetName(*rules).c_str());
 			}
 		}
 		printf("\n");
@@ -844,6 +892,14 @@ void CompleteParser::Shutdown()
 {
 	m_inputBuffer = 0;
 
+	m_tempAllocator.Release(m_program);
+	ShutdownProgram(m_program);
+	m_program = 0;
+	m_byteCode.Clear();
+	m_controlFlow.Clear();
+
+	m_lexer.Shutdown();
+
 	delete m_variables;
 	m_variables = 0;
 }
@@ -860,6 +916,8 @@ __declspec(dllexport) Variables* CompleteParser::GetVariables()
 
 __declspec(dllexport) Node* CompleteParser::GetNodes()
 {
+	UpdateNodes();
+
 	return &m_nodes;
 }
 
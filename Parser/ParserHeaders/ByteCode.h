@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: ByteCode.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _BYTECODE_H_
+#define _BYTECODE_H_
+
+#include "compiler.h"
+#include "NativeCode.h"
+#include "SSAOptimizer.h"
+#include <set>
+#include <unordered_set>
+
+// Opcodes
+#define BYTECODE_HALT		0
+#define BYTECODE_PRINT		1				// Print op1.
+#define BYTECODE_ASSIGN		2				// target = op1 op op2, with the types checked as it runs.
+#define BYTECODE_BRANCH		3				// Jump by target unless op1 relop op2. Always compared as integers.
+#define BYTECODE_JUMP		4				// Jump by target.
+#define BYTECODE_INT		5				// target = op1 op op2 in 64 bit integers. Every operand is PRIM_INT.
+#define BYTECODE_TRUNCATE	6				// target = op1 op op2 with the result stored as PRIM_INT.
+#define BYTECODE_REAL		7				// target = op1 op op2 with the result stored as PRIM_REAL.
+#define BYTECODE_NUMBER		8				// target = op1 op op2 where target is not a primitive.
+#define BYTECODE_CONCAT		9				// target = op1, followed by op2 for PLUS, as text.
+
+#define SLOT_NONE			-1
+#define FRAME_NONE			-1
+
+// Dispatch. 1 => Execute jumps straight to the handler of each instruction (GCC and Clang only), 0 => switch on the opcode.
+// Jumping was not faster on every loop measured, so it has to be asked for.
+#ifndef BYTECODE_THREADED
+#define BYTECODE_THREADED	0
+#endif
+#if BYTECODE_THREADED && !defined(__GNUC__)
+#undef BYTECODE_THREADED
+#define BYTECODE_THREADED	0
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// One instruction of a ByteCode program. Operands are slots of the program
+// and jumps are offsets from the instruction itself.
+////////////////////////////////////////////////////////////////////////////////
+struct Instruction
+{
+	unsigned short	opcode;							// BYTECODE_*
+	unsigned short	op;								// PLUS, MINUS, MULT, DIV or 0 for an assignment. The relop of a branch.
+	int				target;							// The slot assigned, or the offset of the jump.
+	int				op1;
+	int				op2;							// SLOT_NONE when an assignment has one operand.
+	const void*		handler;						// Where threaded dispatch goes for the opcode. Set by the first Execute.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// A variable, or an element of an array, read or written by an instruction.
+////////////////////////////////////////////////////////////////////////////////
+struct Slot
+{
+	int				frame;							// The frame element of a scalar. FRAME_NONE for an element of an array.
+	Variable*		var;							// The array when frame is FRAME_NONE.
+	int				indexFrame;						// The frame element holding the array index, if it is a scalar.
+	Variable*		index;							// The variable holding the array index otherwise. 0 for element 0.
+	int				type;							// The type ID of the variable.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// What the type ID of a slot stands for while the program runs.
+////////////////////////////////////////////////////////////////////////////////
+struct SlotType
+{
+	int				lowest;							// The lowest type.
+	int				kind;							// The VALUE_* stored in the type.
+	bool			primitive;						// True when the lowest type is a primitive.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ByteCode
+//
+// The statements from CompleteParser::Compile lowered to one array of
+// instructions, with the blocks in the order ControlFlow lays them out.
+// Every varAccess used is looked up once by Lower and kept in the slot table,
+// and no-ops and gotos are folded into the jumps. An
+// assignment whose type was found by CompleteParser::ResolveTypes is lowered
+// to the opcode of that type. Execute gives the same results as execute_program.
+//
+// Scalars are copied into the frame when Execute starts and back out when it
+// ends, and the lowest type of every slot is kept in a table, so running the
+// program does not search Variables. The exception is a type bound to
+// PRIM_STRING by the program, which happens at most once for each type.
+// A program NativeCode supports is run as machine code instead, unless
+// SetNativeCode turned it off before Lower. Before either, the instructions
+// of each block go through the passes of SSAOptimizer that are switched on.
+// An index out of range grows the array or stops the program, as
+// SetIndexPolicy says.
+//
+// A program without loops keeps the instructions of its blocks as they were
+// lowered, so Patch can lower the statements of an edited line alone and put
+// them in place of the old ones. Each instruction of such a program runs
+// once, so the program is run from those instructions once patched, without
+// SSAOptimizer or NativeCode, which would have to see the whole program
+// again. A program with loops is lowered again whole.
+////////////////////////////////////////////////////////////////////////////////
+class ByteCode
+{
+public:
+	ByteCode(Variables* variables = 0);			// The table the programs are compiled with. Lower fails without one.
+	~ByteCode();
+
+	bool Lower(statementNode* program);				// False when a statement is malformed. execute_program reports it.
+	bool FindRange(statementNode* first,			// Find the statements from first to last in the program lowered. False
+		statementNode* last, BlockRange& range);	// when Patch can not replace them.
+	bool Patch(const BlockRange& range,				// Lower the statements from first to last, which replaced those of range,
+		statementNode* first, statementNode* last);	// in place of their instructions. False when the program has to be lowered
+													// again, which leaves it to Clear.
+	void Execute();
+	void Clear();
+
+	bool IsLowered() {return !m_code.empty();}
+	bool IsNative() {return m_native.IsCompiled();}
+	int GetDenseArrayCount() {return m_native.GetDenseArrayCount();}	// Arrays the machine code keeps as plain numbers.
+	void SetVariables(Variables* variables) {m_variables = variables;}
+	void SetNativeCode(bool enable) {m_nativeEnabled = enable;}
+	void SetIndexPolicy(int policy) {m_indexPolicy = policy;}	// INDEX_*. INDEX_GROW unless set.
+	int GetIndexPolicy() {return m_indexPolicy;}
+	bool HasFailed() {return m_failed;}				// The last Execute was stopped by an index out of range.
+	static void ReportIndex(Variable* array,		// Report the index which stopped a program.
+		long long index);
+	SSAOptimizer* GetSSAOptimizer() {return &m_ssa;}	// The passes and counts of the last Lower.
+	int GetInstructionCount() {return m_code.size();}
+	unsigned long long GetExecutedCount() {return m_executedCount;}	// Instructions run by the last Execute, with the HALT. 0 for native code.
+	unsigned long long GetLookupCount() {return m_lookupCount;}		// Searches of Variables made by the last Execute.
+
+private:
+	bool LowerStatement(statementNode* node,		// The instruction of a statement of block. False when it is malformed.
+		const BasicBlock& block, Instruction& instruction);
+	void LayOut(const vector<vector<Instruction> >&	// Put the instructions of each block in m_code, in the layout, with the
+		blocks);									// jumps between them.
+	int AddSlot(varAccess* access);
+	bool BindSlots();								// Give the scalars of the slots added since the last call their frame
+													// elements. False when an array was read as a scalar before.
+	void UpdateTypes();								// Find the lowest type of every slot again.
+	Value& GetValue(const Slot& slot);
+	Value& Reach(const Slot& slot, int index);		// The element at an index out of range, added or, when the program
+													// stops, a value nothing reads.
+	void Assign(const Instruction& instruction);
+	void AssignTyped(const Instruction& instruction);
+	void Store(const Slot& slot, Value& value);		// SetValue for text, without the lookups.
+	bool IsIntSlot(int slot);
+
+	Variables*				m_variables;
+	vector<Instruction>		m_code;
+	ControlFlow				m_controlFlow;			// The blocks of the program lowered.
+	vector<vector<Instruction> >	m_blocks;		// The instructions of each block as lowered, when no block is in a loop.
+	vector<int>				m_positions;			// The instruction each block starts at.
+	vector<pair<int, int> >	m_jumps;				// Instructions jumping to a block, with the block.
+	bool					m_optimized;			// m_code was rewritten by SSAOptimizer, or is run as machine code.
+	vector<Slot>			m_slots;
+	vector<varAccess>		m_accesses;				// The access of each slot added since the slots were bound.
+	map<pair<Variable*,
+		Variable*>, int>	m_slotIDs;				// The slot of each variable and index pair.
+	set<Variable*>			m_arrays;				// Variables with more than one element, or read with an index.
+	unordered_map<Variable*, int>	m_frameIDs;		// The frame element of each scalar.
+	vector<Value>			m_frame;				// The values of the scalars while the program runs.
+	vector<Variable*>		m_frameVariables;		// The variable of each frame element.
+	vector<SlotType>		m_types;				// Indexed by type ID.
+	unordered_set<string>	m_typeNames;			// Text naming a type, which SetValue does not store.
+	int						m_stringType;			// The type ID of PRIM_STRING.
+	SSAOptimizer			m_ssa;
+	NativeCode				m_native;
+	bool					m_nativeEnabled;
+	int						m_indexPolicy;
+	bool					m_failed;
+	Value					m_outside;				// Given for an element the program stops at.
+	unsigned long long		m_executedCount;
+	unsigned long long		m_lookupCount;
+};
+
+#endif
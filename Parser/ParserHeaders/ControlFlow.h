@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: ControlFlow.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _CONTROLFLOW_H_
+#define _CONTROLFLOW_H_
+
+#include "compiler.h"
+#include <unordered_set>
+
+#define BLOCK_NONE			-1				// No block.
+#define BLOCK_END			-2				// Past the end of the program. Only the block stopping the program goes there.
+
+////////////////////////////////////////////////////////////////////////////////
+// Statements which always run one after the other. A block is only entered
+// at its first statement, and only an IF as its last statement leaves it for
+// more than one block. No-ops and gotos are stepped past and not kept.
+////////////////////////////////////////////////////////////////////////////////
+struct BasicBlock
+{
+	vector<statementNode*>	statements;		// In the order they run. Empty for the block stopping the program.
+	int				successors[2];			// The block run next. For an IF, the true and then the false branch.
+	int				predecessors;			// The blocks going to it.
+	int				loopDepth;				// The number of loops holding the block.
+	int				walked;					// No-ops and gotos stepped past inside the block and on each way out of it, as compiled.
+	int				threaded;				// The same once ControlFlow::Thread has pointed the jumps past them.
+	int				jump;					// Where the jump after the block goes. BLOCK_NONE when it falls through, BLOCK_END for a HALT.
+	bool			inverted;				// The IF jumps to its true branch when the condition holds, as the false branch follows it.
+	int				instructions;			// The instructions ByteCode::Lower makes of the block.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// The statements of a line in the block holding them, found by
+// ControlFlow::FindRange before the line is compiled again.
+////////////////////////////////////////////////////////////////////////////////
+struct BlockRange
+{
+	int				block;
+	int				first;					// The index of the first statement of the line in the statements of the block.
+	int				count;					// The statements of the line kept by the block.
+	int				nodes;					// The statements of the line, with the no-ops.
+	int				walked;					// No-ops stepped past after the statement before the line and the statements of the line.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ControlFlow
+//
+// The statements from CompleteParser::Compile split into basic blocks.
+// CompileIfStmt and CompileWhileStmt join their branches at no-ops, and a
+// loop goes back with a goto to a no-op, so every jump is followed past them
+// to the statement it runs. A statement which is only reached from the one
+// before it stays in that block, even when a goto leads there.
+//
+// Build also lays the blocks out for ByteCode::Lower. They are placed in
+// reverse post order with the blocks of each loop kept together, and a loop
+// which tests its condition first is turned so the test follows the block
+// going back to it. Each time around it then runs without a jump.
+//
+// Thread points the branches and gotos of the statements themselves at the
+// statements they run, for execute_program. Restore points them back, so an
+// edit replacing the statements of a line finds them as they were compiled.
+// A line of statements without jumps, which does not start a block and which
+// no jump goes into, is only found in the block holding it. FindRange finds
+// it there and ReplaceRange puts the new statements of the line in its
+// place, leaving the jumps threaded and every other block as it was.
+////////////////////////////////////////////////////////////////////////////////
+class ControlFlow
+{
+public:
+	ControlFlow();
+	~ControlFlow();
+
+	bool Build(statementNode* program);				// False for a goto without a target, or gotos going around without a statement.
+	int Thread();									// Returns the number of jumps changed in the program built.
+	bool Restore(statementNode* program);			// Undo Thread. False when the program built is another one.
+	bool FindRange(statementNode* first,			// Find the statements from first to last in their block. False when they
+		statementNode* last, BlockRange& range);	// jump, start a block or are gone to by a jump, or are in no block.
+	void ReplaceRange(const BlockRange& range,		// Put the statements from first to last, which replaced those of range,
+		statementNode* first, statementNode* last);	// in the block.
+	bool HasLoops();								// A block of the program built is inside a loop.
+	void Clear();
+	void PrintBlocks(stringstream& out);			// The blocks in their layout, with the statements run before and after.
+
+	void SetEnabled(bool enable) {m_enabled = enable;}	// Thread leaves the statements alone when disabled.
+	bool IsEnabled() {return m_enabled;}
+	int GetBlockCount() {return m_blocks.size();}
+	const BasicBlock& GetBlock(int block) {return m_blocks[block];}
+	const vector<int>& GetLayout() {return m_layout;}	// The blocks in the order they are lowered. The first is where the program starts.
+	int GetMergedCount() {return m_mergedCount;}		// Gotos which a block continues past.
+	int GetThreadedCount() {return m_threadedCount;}	// Jumps changed by the last Thread.
+
+private:
+	struct Loop
+	{
+		int				header;						// The block the loop goes back to.
+		vector<int>		latches;					// The blocks going back to it.
+		vector<bool>	blocks;						// The blocks inside the loop, by ID.
+	};
+
+	int Skip(statementNode* node,					// Step past no-ops and gotos. target is 0 at the end of the program. Returns the
+		statementNode*& target,						// statements stepped past, with the gotos in jumps, or -1 if they never end.
+		statementNode*& last, int& jumps);
+	int AddBlock(statementNode* node);
+	bool FindBlocks(statementNode* program);
+	int CountWalked(int block, int first = 0,		// The no-ops and gotos stepped past after count statements of block.
+		int count = -1);							// -1 for all of them.
+	bool IsBranch(int block);
+	void FindLoops(vector<Loop>& loops);
+	void LayOut(vector<Loop>& loops);
+	void SetJumps();								// Set jump, inverted and instructions from the layout.
+	void SetJump(statementNode** jump);				// Thread one jump.
+
+	vector<BasicBlock>					m_blocks;
+	vector<statementNode*>				m_firsts;	// The statement each block starts at. 0 for the block stopping the program.
+	unordered_map<statementNode*, int>	m_blockIDs;	// The block starting at each statement.
+	unordered_map<statementNode*, int>	m_statementBlocks;	// The block holding each statement of a block.
+	unordered_set<statementNode*>		m_targets;	// Statements a branch or goto goes to, as compiled or threaded.
+	vector<int>							m_layout;
+	vector<pair<statementNode**,
+		statementNode*> >				m_original;	// The jumps changed by Thread, with where they went.
+	statementNode*						m_program;
+	int									m_statementCount;
+	bool								m_enabled;
+	int									m_mergedCount;
+	int									m_threadedCount;
+};
+
+#endif
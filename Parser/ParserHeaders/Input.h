@@ -16,11 +16,56 @@ using namespace std;
 
 #define NULL_ENTRY	'\n'
 
+// Input modes.
+#define INPUT_BUFFERED		0				// Lines are copied into the internal buffer.
+#define INPUT_VIEW			1				// The buffer is a read-only view of mapped or caller-owned memory.
+
+////////////////////////////////////////////////////////////////////////////////
+// A token expressed as a window into the input buffer. No memory is owned.
+////////////////////////////////////////////////////////////////////////////////
+struct InputView
+{
+	InputView()
+	{
+		data	= 0;
+		offset	= 0;
+		length	= 0;
+	};
+
+	const char*		data;							// First char of the token.
+	unsigned int	offset;							// Offset of the token from the start of the buffer.
+	unsigned int	length;							// Number of chars in the token.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: MappedFile
+//
+// A read-only memory-mapping of a whole file. The contents stay valid until
+// Close is called or the object is destroyed.
+////////////////////////////////////////////////////////////////////////////////
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* fileName);				// Map the file. An empty file is valid and has no data.
+	void Close();									// Release the mapping.
+	const char* GetData();							// Returns m_data.
+	unsigned int GetSize();							// Returns m_size.
+
+private:
+	void*			m_data;							// Base address of the mapping.
+	unsigned int	m_size;							// Size of the mapped file.
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Class name: Input
 //
 // Loads user input into a buffer. Provides regulated access to the buffer.
 // The buffer can also be copied to std::string for self-contained memory management.
+// In view mode a file is memory-mapped (or a caller-owned buffer is adopted) and the
+// whole contents are exposed as one buffer without any copying.
 ////////////////////////////////////////////////////////////////////////////////
 class Input
 {
@@ -35,7 +80,11 @@ public:
 													// Open a file to m_file.
 
 	__declspec(dllexport) bool SetFile(string&);	// Manually load a file from memory.
-	void CloseFile();								// Close m_file.
+	__declspec(dllexport) bool MapFile(char* fileName);
+													// Memory-map a file and expose it as a single view.
+	__declspec(dllexport) bool AdoptBuffer(const char* data,
+		unsigned int size);							// Expose caller-owned memory as a single view. Must outlive parsing.
+	void CloseFile();								// Close m_file and release any mapped view.
 	void ReadLine();								// Store an entire line of input into the buffer. Clears EOF.
 	__declspec(dllexport) void SetBuffer(string& text);		
 													// Manually set the buffer.
@@ -46,26 +95,42 @@ public:
 	int GetLastGoodIndex();							// Returns the last index prior to a white space.
 	__declspec(dllexport) int GetLineNumber();		// Returns m_currentLineNumber.
 	bool DecrementIndex();							// Lower the current index if greater than 0.
+	void SkipLine();								// Mark the whole buffer as read. Used when it was tokenized externally.
 	bool IsEOL();									// Returns m_eol.
 	bool IsEOF();									// Checks stdin or opened file if it is EOF.
 	bool IsEndOfLine(char c);						// Is the char a new line character.
 	string CopyBuffer(int start, int end,			// Returns a new string of the correct length with contents from the buffer.
 		bool includeSpace = false);			
+	void CopyBuffer(int start, int end,				// Same as above but reuses the capacity of an existing string.
+		string& strOut, bool includeSpace = false);
+	bool GetView(int start, int end,				// Trim white space from the range and return it as a view. No allocation.
+		InputView& viewOut);
+	const char* GetBuffer();						// Returns m_buffer.
+	unsigned int GetBufferSize();					// Returns m_usedBufferSize.
+	int GetMode();									// Returns m_mode.
 
 private:
 	void ClearBuffer();
+	bool ReserveStorage(unsigned int size);			// Grow m_storage to hold at least size chars.
+	void UnmapFile();								// Release the mapped view if there is one.
 	
 private:
 	ifstream		m_file;							// Read input from a file (TOKEN_DEBUG)
 	string			m_fileMem;						// Contents loaded directly to memory.
-	char			*m_buffer;						// Buffer containing entered input.
-	unsigned int	m_maxBufferSize;				// The maximum size the buffer is allowed.
+	const char		*m_buffer;						// Buffer containing entered input. Points to m_storage or the view.
+	char			*m_storage;						// Owned storage for buffered input.
+	const char		*m_view;						// Mapped file or caller-owned memory exposed in view mode.
+	unsigned int	m_viewSize;						// Size of m_view.
+	MappedFile		m_mappedFile;					// The file mapped by MapFile.
+	unsigned int	m_maxBufferSize;				// The size of m_storage. Grows when a larger buffer is set.
 	unsigned int	m_usedBufferSize;				// The current used size of the buffer.
 	unsigned int	m_lastGoodIndex;				// Last position before white space.
 	int				m_currentLineNumber;			// The current line number of the line being processed.
 	int				m_currentIndex;					// Current index of the buffer.
+	int				m_mode;							// INPUT_BUFFERED or INPUT_VIEW.
 	bool			m_eol;							// When the line has been fully read in.
 	bool			m_fileOpened;					// If m_file has been opened.
+	bool			m_viewPending;					// The view has not been handed out by ReadLine yet.
 };
 
 
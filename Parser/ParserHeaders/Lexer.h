@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: Lexer.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _LEXER_H_
+#define _LEXER_H_
+
+#include <ctype.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+using namespace std;
+
+// Token kinds which are not literal terminals. Literal terminals are numbered from LEX_FIRST_TERMINAL
+// in the order they were declared in the grammar.
+#define LEX_NONE			-1				// No token. Used as the context at the start of a line.
+#define LEX_UNKNOWN			0				// A char which does not start any terminal.
+#define LEX_ID				1				// letter (letter + digit)*
+#define LEX_INT				2				// digit+
+#define LEX_REAL			3				// digit+ . digit*
+#define LEX_STRING			4				// " any* "
+#define LEX_FIRST_TERMINAL	5
+
+#define LEX_NO_STATE		0xFFFF			// Marks a missing transition in the table.
+
+////////////////////////////////////////////////////////////////////////////////
+// A token produced by the lexer. The text is not copied, it is a window into the
+// buffer that was tokenized.
+////////////////////////////////////////////////////////////////////////////////
+struct LexToken
+{
+	int				kind;							// LEX_* or the kind of a literal terminal.
+	unsigned int	offset;							// Offset of the first char in the buffer.
+	unsigned int	length;							// Number of chars in the token.
+	int				line;							// Line the token starts on. Counted from 0 like Input.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: Lexer
+//
+// Compiles the terminals of a grammar into a DFA transition table and splits a
+// buffer into tokens in one forward pass. Every state except the start states is
+// accepting, so the longest match is always the state the scan stops in and no
+// char is ever read twice.
+////////////////////////////////////////////////////////////////////////////////
+class Lexer
+{
+public:
+	Lexer();
+	~Lexer();
+
+	bool Initialize(list<string>& terminals);		// Build the DFA from the terminal set of a grammar.
+	void Shutdown();
+
+	bool IsInitialized();							// True once a table has been built.
+	int Tokenize(const char* data,					// Append the tokens of the buffer to tokensOut. Returns the number added.
+		unsigned int size, vector<LexToken>& tokensOut,
+		int previousKind = LEX_NONE);				// The kind of the token before the buffer decides if '-' can start a number.
+	int FindKind(const string& text);				// Kind of a literal terminal or class name. LEX_UNKNOWN if not found.
+	const string& GetKindName(int kind);			// The terminal name of a kind.
+	int GetStateCount();							// Number of DFA states.
+	int GetClassCount();							// Number of byte equivalence classes.
+
+private:
+	int AddState(int acceptKind);					// Returns the new state index.
+	void AddLiteral(const string& text, int kind);	// Add a path for a literal terminal starting at the start state.
+	void BuildClasses();							// Compress the 256 wide rows into byte equivalence classes.
+	bool IsIDStart(unsigned char c);
+	bool IsIDChar(unsigned char c);
+
+private:
+	vector<unsigned short>	m_transitions;			// The table being built. One row of 256 per state.
+	vector<unsigned short>	m_table;				// The compressed table. One row of m_classCount per state.
+	vector<int>				m_accept;				// The kind accepted by each state.
+	vector<bool>			m_negativeContext;		// Per kind. True if a '-' following it may start a number.
+	vector<string>			m_kindNames;			// The terminal name of each kind.
+	map<string, int>		m_kinds;				// Terminal name to kind.
+	unsigned char			m_classes[256];			// The equivalence class of each byte.
+	int						m_classCount;			// Number of byte equivalence classes.
+	int						m_start;				// Start state.
+	int						m_startNegative;		// Start state where '-' followed by a digit is a number.
+};
+
+#endif
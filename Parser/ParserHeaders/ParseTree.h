@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: ParseTree.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _PARSE_TREE_H_
+#define _PARSE_TREE_H_
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define TREE_NODE_NONE		-1
+#define TREE_ROOT			0				// The first node added after Clear.
+#define TREE_CHILD_CAPACITY	4				// Children room given to a node when its first child is added.
+
+////////////////////////////////////////////////////////////////////////////////
+// A node of a ParseTree. Nothing is owned by the record, the value and the
+// children are ranges in the arrays of the tree.
+////////////////////////////////////////////////////////////////////////////////
+struct TreeNode
+{
+	int				type;							// The symbol this node represents.
+	int				lineNumber;						// The line number from the original code.
+	unsigned int	text;							// Offset of the value in the text of the tree.
+	unsigned int	textLength;						// Number of chars in the value.
+	unsigned int	children;						// Offset of the first child in the child list of the tree.
+	unsigned int	childCount;
+	unsigned int	childCapacity;					// Children which fit at children before the range has to move.
+	char			complete;						// NODE_* completion of the rule.
+	bool			closed;							// True when follow set matched.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ParseTree
+//
+// A parse tree stored as three arrays: the node records, the child lists, and
+// the text of the values. Adding a node to a parent stores its index, so a
+// subtree is never copied, and nodes are only released all at once by Clear.
+// Nodes built since Mark which did not end up in the tree are dropped by Compact.
+////////////////////////////////////////////////////////////////////////////////
+class ParseTree
+{
+public:
+	ParseTree();
+	~ParseTree();
+
+	void Clear();									// Release every node. The arrays keep their memory for the next tree.
+	int AddNode(int type, int lineNumber);			// Returns the index of the new node. References from Get are invalidated.
+	unsigned int AddText(const string& text);		// Returns the offset of the copy for SetText.
+	void SetText(int node, unsigned int text,
+		unsigned int length);
+	void AddChild(int parent, int child);			// Append a node to the children of parent.
+	void Mark();									// Remember the size of the tree for Compact.
+	void Compact(vector<int>& parents);				// Keep only the nodes added since Mark which are below one of parents.
+	bool IsAddedSinceMark(int node);				// True for the nodes Compact renumbers.
+	int GetCompactedIndex(int node);				// The index of a node after Compact. TREE_NODE_NONE if it was dropped.
+
+	TreeNode& Get(int node) {return m_nodes[node];}
+	int GetChild(int node, unsigned int index) {return m_children[m_nodes[node].children + index];}
+	unsigned int GetChildCount(int node) {return m_nodes[node].childCount;}
+	void GetText(int node, string& textOut);
+	int Find(int type, int node, int searchLevels);	// The first node of a type at most searchLevels deep. TREE_NODE_NONE if none.
+	int GetNodeCount();
+
+private:
+	vector<TreeNode>		m_nodes;
+	vector<int>				m_children;				// The child ranges of every node.
+	string					m_text;					// The values of every node.
+	int						m_nodeMark;				// The node count at Mark.
+	unsigned int			m_childMark;			// The child list size at Mark.
+	vector<int>				m_remap;				// The new index of each node added since Mark. Set by Compact.
+};
+
+#endif
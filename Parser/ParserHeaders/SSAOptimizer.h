@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: SSAOptimizer.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _SSA_OPTIMIZER_H_
+#define _SSA_OPTIMIZER_H_
+
+#include "compiler.h"
+#include "ControlFlow.h"
+
+struct Instruction;
+struct Slot;
+struct SlotType;
+
+// Passes
+#define SSA_PASS_GVN		1				// Read a value from where it is already held instead of reading or calculating it again.
+#define SSA_PASS_LICM		2				// Calculate a temporary which is the same each time around a loop in front of the loop.
+#define SSA_PASS_DSE		4				// Remove assignments whose value is never read.
+#define SSA_PASS_ALL		7
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: SSAOptimizer
+//
+// Rewrites the instructions ByteCode::Lower makes of each block of a
+// ControlFlow. The scalars of the frame, and every array as a whole, are put
+// in static single assignment form, with phis placed on the dominance
+// frontiers. Values are numbered down the dominator tree. Two values with
+// the same ident are the same Value, and two values with the same number
+// read as the same double, which is all an instruction of a typed opcode
+// reads of them.
+//
+// The instructions are lowered back without the phis, since no variable
+// gets a value another way than before. An operand is only pointed at
+// another scalar while that scalar still holds the value, a temporary is
+// only moved in front of a loop when it has one assignment in the loop and
+// none outside it which the loop may read, and an
+// assignment is only removed when nothing reads its value. The values of
+// variables other than temporaries are read when the program ends.
+// Programs with text or untyped assignments, or an index held in an array,
+// are left alone.
+////////////////////////////////////////////////////////////////////////////////
+class SSAOptimizer
+{
+public:
+	SSAOptimizer();
+	~SSAOptimizer();
+
+	bool Optimize(ControlFlow& controlFlow,			// Rewrite code, the instructions of each block by ID. A branch stays
+		vector<vector<Instruction> >& code,			// last. False, leaving code alone, when the program is not supported.
+		const vector<Slot>& slots,
+		const vector<SlotType>& types,
+		Variables* variables);
+	void Clear();
+
+	void SetPasses(int passes) {m_passes = passes;}	// SSA_PASS_* flags. 0 lowers the program as it is.
+	int GetPasses() {return m_passes;}
+	int GetValueCount() {return m_valueCount;}		// Values of the last Optimize, with the phis and the elements read.
+	int GetPhiCount() {return m_phiCount;}
+	int GetNumberedCount() {return m_numberedCount;}	// Operands and assignments given a value already held.
+	int GetHoistedCount() {return m_hoistedCount;}		// Instructions moved in front of loops.
+	int GetEliminatedCount() {return m_eliminatedCount;}// Instructions removed.
+
+private:
+	struct SSAValue
+	{
+		int				var;						// The variable holding it. -1 for an element read from an array.
+		int				block;						// The block assigning it. BLOCK_NONE for the value a variable starts with.
+		int				instruction;				// The instruction of block assigning it. -1 for a phi or a starting value.
+		int				kind;						// The VALUE_* it always has. -1 when it may have any, -2 until found.
+		int				ident;
+		int				number;
+		int				uses;
+		int				index;						// For an element, the value of its index or -1 for element 0.
+		int				memory;						// For an element, the version of the array it is read from.
+		int				defined;					// The order Define made it a leader in, or -1.
+		vector<int>		arguments;					// For a phi, the value from each predecessor.
+	};
+
+	struct LeaderList
+	{
+		LeaderList()
+		{
+			first	= -1;
+			last	= -1;
+		};
+
+		int				first;						// The first and last value * 2, + 1 in a list of numbers, or -1.
+		int				last;
+	};
+
+	struct Access
+	{
+		int				values[3];					// The value of the scalar assigned and the values read as op1 and op2, or -1.
+		int				index;						// For an element assigned, the value of its index or -1 for element 0.
+		int				memory;						// For an element assigned, the version of the array it replaces.
+		int				stored;						// For an element assigned, the version of the array after.
+		bool			removed;
+	};
+
+	bool Prepare(ControlFlow& controlFlow);			// Find the variables, and check every instruction is supported.
+	void FindDominators();
+	void PlacePhis();
+	void Rename();									// Give every read and assignment its value.
+	void FindKinds();
+	void NumberValues();
+	void HoistInvariants();
+	void EliminateDeadStores();
+	void CountUses();
+	void Use(int value, int count);					// Add count to the uses of value, or of the index and array version it reads.
+	void Lower();									// Write the instructions kept back into m_code.
+
+	int AddValue(int var, int block, int instruction);
+	int Read(int slot, int block);					// The value of a scalar, or a new value for an element.
+	int GetVar(int slot);
+	int GetKey(int a, int b, int c, int d);
+	void Substitute(Instruction& instruction,		// Point an operand of an instruction of block at a scalar holding a value
+		Access& access, int operand, int block);	// with the same class.
+	int FindLeader(int value, int cls, bool number,	// The first value still held in block with the ident or number cls, in a
+		int kind, int block);						// slot of the VALUE_* kind, unless value comes first. -1 for none.
+	long long GetLeaderKey(int cls, bool number,	// The list of the values held with a class in slots of a kind, for a
+		int kind, int block);						// block or BLOCK_ANY.
+	LeaderList& GetLeaders(int value, bool number);	// The list holding value by its ident or number.
+	void Link(int value, bool number);				// Put value back in the list it was unlinked from.
+	void Unlink(int value, bool number);
+	void Define(int value);							// Make value the held value of its variable, and a leader of its classes.
+	void Undefine(int value);
+
+	ControlFlow*					m_controlFlow;
+	vector<vector<Instruction> >*	m_code;
+	const vector<Slot>*				m_slots;
+	const vector<SlotType>*			m_types;
+	Variables*						m_variables;
+	vector<vector<Access> >			m_accesses;		// By block and instruction.
+	vector<SSAValue>				m_values;
+	vector<vector<int> >			m_stacks;		// The values each variable holds down the dominator tree.
+	vector<vector<int> >			m_phis;			// The phis of each block.
+	vector<vector<int> >			m_predecessors;
+	vector<vector<int> >			m_edges;		// The index in m_predecessors of each successor of a block.
+	vector<vector<int> >			m_children;		// The dominator tree.
+	vector<int>						m_dominators;	// The immediate dominator of each block.
+	vector<int>						m_order;		// The blocks in reverse post order.
+	vector<int>						m_walk;			// The dominator tree in pre order, with ~block where a block is left.
+	vector<int>						m_varSlots;		// The slot reading each scalar, or -1.
+	vector<bool>					m_temporaries;	// Scalars named by AddTempVariable.
+	vector<bool>					m_globals;		// Variables read in a block before it assigns them.
+	vector<int>						m_startKinds;	// The VALUE_* of each constant, otherwise -1.
+	vector<int>						m_exitValues;	// The values of the variables read when the program ends.
+	map<Variable*, int>				m_arrays;		// The variable of each array, after the scalars.
+	map<pair<pair<int, int>,
+		pair<int, int> >, int>		m_keys;			// The ident of each calculation.
+	unordered_map<long long,
+		LeaderList>					m_leaders;		// The values held with each ident and each number by GetLeaderKey, first assigned first.
+	vector<int>						m_nextLeaders;	// The links of each value * 2 in its list of idents, and + 1 of numbers.
+	vector<int>						m_previousLeaders;
+	int								m_definedCount;
+	int								m_scalarCount;
+	int								m_varCount;
+	int								m_identCount;
+	int								m_passes;
+	int								m_valueCount;
+	int								m_phiCount;
+	int								m_numberedCount;
+	int								m_hoistedCount;
+	int								m_eliminatedCount;
+};
+
+#endif
@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: Symbols.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _SYMBOLS_H_
+#define _SYMBOLS_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Variables.h"
+
+using namespace std;
+
+#define SYMBOL_NONE				-1
+
+// Symbol flags.
+#define SYMBOL_TERMINAL			1				// Declared in the terminal section of the grammar.
+#define SYMBOL_NONTERMINAL		2				// Declared in the non-terminal section of the grammar.
+
+// Symbols with fixed IDs. Every entry of TOKENS is interned first, so the symbol of
+// a reserved token is its index in TOKENS. The names the parser looks for follow.
+#define SYMBOL_EPSILON			TOKEN_HASH		// "#"
+#define SYMBOL_EOF				(RESERVED_COUNT + 0)
+#define SYMBOL_PROGRAM			(RESERVED_COUNT + 1)
+#define SYMBOL_BODY				(RESERVED_COUNT + 2)
+#define SYMBOL_TYPE_DECL_SECTION (RESERVED_COUNT + 3)
+#define SYMBOL_TYPE_DECL		(RESERVED_COUNT + 4)
+#define SYMBOL_VAR_DECL_SECTION	(RESERVED_COUNT + 5)
+#define SYMBOL_VAR_DECL			(RESERVED_COUNT + 6)
+#define SYMBOL_ASSIGN_STMT		(RESERVED_COUNT + 7)
+#define SYMBOL_WHILE_STMT		(RESERVED_COUNT + 8)
+#define SYMBOL_IF_STMT			(RESERVED_COUNT + 9)
+#define SYMBOL_ELSE_STMT		(RESERVED_COUNT + 10)
+#define SYMBOL_PRINT_STMT		(RESERVED_COUNT + 11)
+#define SYMBOL_REPEAT_STMT		(RESERVED_COUNT + 12)
+#define SYMBOL_FUNCTION_STMT	(RESERVED_COUNT + 13)
+#define SYMBOL_CONDITION		(RESERVED_COUNT + 14)
+#define SYMBOL_ARRAY			(RESERVED_COUNT + 15)
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: SymbolTable
+//
+// Interns every grammar symbol once to a dense integer. Rules, first and follow
+// sets, and parse tree nodes refer to symbols by ID so comparisons and lookups
+// do not touch strings.
+////////////////////////////////////////////////////////////////////////////////
+class SymbolTable
+{
+public:
+	SymbolTable();
+	~SymbolTable();
+
+	void Clear();									// Remove all symbols except the fixed ones.
+	int Intern(const string& name,					// Return the symbol of a name, adding it if needed.
+		int tokenID = ID);							// The token ID is only used for a new symbol.
+	int Find(const string& name);					// SYMBOL_NONE if the name was never interned.
+	const string& GetName(int symbol);				// The text of a symbol.
+	int GetCount();									// Number of symbols.
+
+	void AddFlags(int symbol, int flags);			// Add SYMBOL_* flags to a symbol.
+	int GetFlags(int symbol);						// The SYMBOL_* flags of a symbol.
+	bool IsTerminal(int symbol);
+	bool IsNonTerminal(int symbol);
+	int GetTokenID(int symbol);						// The token ID of the symbol's text. See CompleteParser::GetTokenID.
+	void GetNameRanks(vector<int>& ranksOut);		// The position of each symbol when all symbols are sorted by name.
+
+private:
+	unordered_map<string, int>	m_ids;				// Name to symbol.
+	vector<string>				m_names;			// Symbol to name.
+	vector<int>					m_flags;			// Symbol to SYMBOL_* flags.
+	vector<int>					m_tokenIDs;			// Symbol to token ID.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: SymbolSet
+//
+// A set of symbols stored as a bitset over symbol IDs, used for the first and
+// follow sets. Testing a symbol is constant time and merging two sets works a
+// word at a time. The members are also kept in insertion order for iteration.
+////////////////////////////////////////////////////////////////////////////////
+class SymbolSet
+{
+public:
+	SymbolSet();
+	~SymbolSet();
+
+	void Clear();
+	bool Add(int symbol);							// True if the symbol was not in the set.
+	bool Contains(int symbol) const;
+	bool Merge(const SymbolSet& other,				// Add every symbol of another set. True if the set grew.
+		int exclude = SYMBOL_NONE);					// A symbol which is never added, such as epsilon.
+	const vector<int>& GetSymbols() const;			// The members in the order they were added.
+	int GetSize() const;
+
+private:
+	vector<unsigned int>	m_bits;					// One bit per symbol ID. Grows with the largest member.
+	vector<int>				m_symbols;				// The members in insertion order.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Orders symbols by name. Used where output must be sorted alphabetically.
+////////////////////////////////////////////////////////////////////////////////
+class SymbolNameCompare
+{
+public:
+	SymbolNameCompare(SymbolTable* symbols) : symbols(symbols) {}
+	bool operator() (int a, int b) const {return symbols->GetName(a) < symbols->GetName(b);}
+private:
+	SymbolTable* symbols;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Orders symbols by the ranks of SymbolTable::GetNameRanks. The same order as
+// SymbolNameCompare without comparing any strings.
+////////////////////////////////////////////////////////////////////////////////
+class SymbolRankCompare
+{
+public:
+	SymbolRankCompare(const vector<int>& ranks) : ranks(ranks) {}
+	bool operator() (int a, int b) const {return ranks[a] < ranks[b];}
+private:
+	const vector<int>& ranks;
+};
+
+#endif
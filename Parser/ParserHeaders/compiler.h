@@ -19,6 +19,10 @@
 #define FUNCSTMT	105
 #define _CONSOLE 0			// Disable for GUI. Requires Windows and .NET 4.0.
 
+// What an index past the end of an array does. A negative index always stops the program.
+#define INDEX_GROW			0				// Elements are added up to it.
+#define INDEX_ERROR			1				// The program stops with an error.
+
 extern Variables* variablesPtr;
 
 //---------------------------------------------------------
@@ -36,6 +40,8 @@ struct assignmentStatement
 	struct varAccess * op2;
 	int op;		// PLUS, MINUS, MULT, DIV --> lhs = op1 op op2;
 				// 0                      --> lhs = op1;
+	int type;	// The VALUE_* stored in lhs, found by CompleteParser::ResolveTypes.
+				// TYPE_UNKNOWN --> the types are checked as the statement runs.
 };
 
 // Currently a place holder for a more advanced structure.
@@ -73,7 +79,7 @@ struct statementNode
 
 __declspec(dllexport) void print_debug(const char * format, ...);
 
-void execute_program(statementNode*);
+void execute_program(statementNode*, int indexPolicy = INDEX_GROW);
 
 struct statementNode * parse_program_and_generate_intermediate_representation();
 
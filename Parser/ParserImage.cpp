@@ -0,0 +1,406 @@
+#include "CompleteParser.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+/*
+	A grammar image is everything EndParsing produces for a grammar, written
+	out so the next load does not have to parse the text or compute any sets.
+	The file is a header followed by a flat array of ints. Strings are stored
+	as their length followed by their chars packed four to an int.
+
+	Symbols, terminals and non-terminals in input order, the rules, the rule
+	keys, the nullable flags, the first and follow sets, and the parse table
+	with its conflicts are stored in that order. The lexer is rebuilt from the
+	terminals since building it is cheap.
+
+	The image is written to a temporary file first and renamed over the old
+	one, so a reader never maps a half written image.
+*/
+
+struct GrammarImageHeader
+{
+	unsigned int		magic;						// GRAMMAR_IMAGE_MAGIC.
+	unsigned int		version;					// GRAMMAR_IMAGE_VERSION.
+	unsigned long long	grammarHash;				// HashGrammar of the text the image was made from.
+	unsigned long long	checksum;					// HashGrammar of the ints following the header.
+	unsigned int		size;						// Number of ints following the header.
+	unsigned int		reservedCount;				// RESERVED_COUNT. The symbols of the TOKENS entries depend on it.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: GrammarImageReader
+//
+// Reads the ints of a mapped image. Every read is bounds checked so a damaged
+// image fails to load instead of reading past the mapping.
+////////////////////////////////////////////////////////////////////////////////
+class GrammarImageReader
+{
+public:
+	GrammarImageReader(const int* data, unsigned int size) : m_data(data), m_size(size), m_index(0), m_good(true) {}
+
+	int Read()
+	{
+		if(m_index >= m_size)
+		{
+			m_good = false;
+			return 0;
+		}
+
+		return m_data[m_index++];
+	}
+
+	// A count which must fit in the rest of the image. Guards against huge allocations from a damaged image.
+	unsigned int ReadCount()
+	{
+		int count = Read();
+		if(count < 0 || (unsigned int)count > m_size - m_index)
+		{
+			m_good = false;
+			return 0;
+		}
+
+		return (unsigned int)count;
+	}
+
+	void ReadString(string& str)
+	{
+		// The length counts chars, so it is checked against the ints it packs into.
+		int length = Read();
+		unsigned int words = (length + sizeof(int) - 1) / sizeof(int);
+		if(!m_good || length < 0 || words > m_size - m_index)
+		{
+			m_good = false;
+			return;
+		}
+
+		str.assign((const char*)&m_data[m_index], length);
+		m_index += words;
+	}
+
+	bool IsGood()
+	{
+		return m_good;
+	}
+
+	bool IsEnd()
+	{
+		return m_index == m_size;
+	}
+
+private:
+	const int*		m_data;
+	unsigned int	m_size;
+	unsigned int	m_index;
+	bool			m_good;
+};
+
+static void WriteImageString(vector<int>& image, const string& str)
+{
+	image.push_back((int)str.length());
+
+	unsigned int start = image.size();
+	image.resize(start + (str.length() + sizeof(int) - 1) / sizeof(int), 0);
+	if(!str.empty())
+		memcpy(&image[start], str.data(), str.length());
+}
+
+static void WriteImageList(vector<int>& image, const list<int>& symbols)
+{
+	image.push_back((int)symbols.size());
+	image.insert(image.end(), symbols.begin(), symbols.end());
+}
+
+static void WriteImageVector(vector<int>& image, const vector<int>& symbols)
+{
+	image.push_back((int)symbols.size());
+	image.insert(image.end(), symbols.begin(), symbols.end());
+}
+
+unsigned long long CompleteParser::HashGrammar(const char* text, unsigned int size)
+{
+	// 64 bit FNV-1a.
+	unsigned long long hash = 14695981039346656037ULL;
+	for(unsigned int i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)text[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+// The temporary file is named after the process, so two processes saving the same image do not share it.
+static string GetTempImageName(const char* fileName)
+{
+	stringstream ss;
+#ifdef _WIN32
+	ss << fileName << "." << GetCurrentProcessId() << GRAMMAR_IMAGE_TEMP_EXTENSION;
+#else
+	ss << fileName << "." << getpid() << GRAMMAR_IMAGE_TEMP_EXTENSION;
+#endif
+	return ss.str();
+}
+
+// Move the source file over the target, which may exist already.
+static bool MoveImageFile(const char* source, const char* target)
+{
+#ifdef _WIN32
+	return MoveFileExA(source, target, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(source, target) == 0;
+#endif
+}
+
+__declspec(dllexport) bool CompleteParser::SaveGrammarImage(const char* fileName, unsigned long long grammarHash)
+{
+	// Only a grammar which finished without errors is worth keeping.
+	if(m_grammarStage < GRMR_FINISHED || m_errors.HasErrors() || m_ruleKeys.empty())
+		return false;
+
+	vector<int> image;
+
+	int symbolCount = m_symbols.GetCount();
+	image.push_back(symbolCount);
+	for(int i = 0; i < symbolCount; i++)
+	{
+		WriteImageString(image, m_symbols.GetName(i));
+		image.push_back(m_symbols.GetFlags(i));
+		image.push_back(m_symbols.GetTokenID(i));
+	}
+
+	WriteImageList(image, m_nonTerminals);
+	WriteImageList(image, m_terminals);
+
+	image.push_back((int)m_rules.size());
+	for(unsigned int key = 0; key < m_rules.size(); key++)
+	{
+		image.push_back((int)m_rules[key].size());
+		for(unsigned int i = 0; i < m_rules[key].size(); i++)
+			WriteImageVector(image, m_rules[key][i]);
+	}
+
+	WriteImageVector(image, m_ruleKeys);
+
+	image.push_back((int)m_nullable.size());
+	for(unsigned int i = 0; i < m_nullable.size(); i++)
+		image.push_back(m_nullable[i] ? 1 : 0);
+
+	image.push_back((int)m_firstSets.size());
+	for(unsigned int i = 0; i < m_firstSets.size(); i++)
+		WriteImageVector(image, m_firstSets[i].GetSymbols());
+
+	image.push_back((int)m_followSets.size());
+	for(unsigned int i = 0; i < m_followSets.size(); i++)
+		WriteImageVector(image, m_followSets[i].GetSymbols());
+
+	image.push_back(m_isLL1 ? 1 : 0);
+	image.push_back((int)m_parseTable.size());
+	for(unsigned int i = 0; i < m_parseTable.size(); i++)
+		WriteImageVector(image, m_parseTable[i]);
+
+	image.push_back((int)m_parseConflicts.size());
+	for(list<string>::iterator it = m_parseConflicts.begin(); it != m_parseConflicts.end(); it++)
+		WriteImageString(image, *it);
+
+	GrammarImageHeader header;
+	header.magic			= GRAMMAR_IMAGE_MAGIC;
+	header.version			= GRAMMAR_IMAGE_VERSION;
+	header.grammarHash		= grammarHash;
+	header.checksum			= image.empty() ? 0 : HashGrammar((const char*)&image[0], image.size() * sizeof(int));
+	header.size				= image.size();
+	header.reservedCount	= RESERVED_COUNT;
+
+	string tempName = GetTempImageName(fileName);
+	{
+		ofstream file(tempName.c_str(), ios::out | ios::binary | ios::trunc);
+		if(!file.good())
+			return false;
+
+		file.write((const char*)&header, sizeof(header));
+		if(!image.empty())
+			file.write((const char*)&image[0], image.size() * sizeof(int));
+
+		file.close();
+		if(file.fail())
+		{
+			remove(tempName.c_str());
+			return false;
+		}
+	}
+
+	if(!MoveImageFile(tempName.c_str(), fileName))
+	{
+		remove(tempName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+__declspec(dllexport) bool CompleteParser::LoadGrammarImage(const char* fileName, unsigned long long grammarHash)
+{
+	// A grammar can only be loaded once.
+	if(m_grammarStage != GRMR_NONTERMINALS || !m_ruleKeys.empty())
+		return false;
+
+	MappedFile mapping;
+	if(!mapping.Open(fileName) || mapping.GetSize() < sizeof(GrammarImageHeader))
+		return false;
+
+	GrammarImageHeader header;
+	memcpy(&header, mapping.GetData(), sizeof(header));
+	if(header.magic != GRAMMAR_IMAGE_MAGIC || header.version != GRAMMAR_IMAGE_VERSION ||
+		header.grammarHash != grammarHash || header.reservedCount != RESERVED_COUNT ||
+		mapping.GetSize() != sizeof(header) + header.size * sizeof(int))
+		return false;
+
+	const char* data = mapping.GetData() + sizeof(header);
+	if(HashGrammar(data, header.size * sizeof(int)) != header.checksum)
+		return false;
+
+	GrammarImageReader image((const int*)data, header.size);
+
+	// Interning the names again gives every symbol its old ID. The fixed symbols already in the table must agree.
+	m_symbols.Clear();
+	int fixedCount = m_symbols.GetCount();
+	unsigned int symbolCount = image.ReadCount();
+	for(unsigned int i = 0; i < symbolCount && image.IsGood(); i++)
+	{
+		string name;
+		image.ReadString(name);
+		int flags = image.Read();
+		int tokenID = image.Read();
+
+		if((int)i < fixedCount ? m_symbols.GetName(i) != name : m_symbols.Intern(name, tokenID) != (int)i)
+			break;
+		if(m_symbols.GetTokenID(i) != tokenID)
+			break;
+		m_symbols.AddFlags(i, flags);
+	}
+
+	bool loaded = image.IsGood() && m_symbols.GetCount() == (int)symbolCount;
+
+	unsigned int count = loaded ? image.ReadCount() : 0;
+	for(unsigned int i = 0; i < count; i++)
+		m_nonTerminals.push_back(image.Read());
+
+	count = image.ReadCount();
+	for(unsigned int i = 0; i < count; i++)
+		m_terminals.push_back(image.Read());
+
+	m_rules.resize(image.ReadCount());
+	for(unsigned int key = 0; key < m_rules.size() && image.IsGood(); key++)
+	{
+		m_rules[key].resize(image.ReadCount());
+		for(unsigned int i = 0; i < m_rules[key].size() && image.IsGood(); i++)
+		{
+			m_rules[key][i].resize(image.ReadCount());
+			for(unsigned int j = 0; j < m_rules[key][i].size(); j++)
+				m_rules[key][i][j] = image.Read();
+		}
+	}
+
+	m_ruleKeys.resize(image.ReadCount());
+	for(unsigned int i = 0; i < m_ruleKeys.size(); i++)
+		m_ruleKeys[i] = image.Read();
+
+	m_nullable.resize(image.ReadCount());
+	for(unsigned int i = 0; i < m_nullable.size(); i++)
+		m_nullable[i] = image.Read() != 0;
+
+	m_firstSets.resize(image.ReadCount());
+	for(unsigned int i = 0; i < m_firstSets.size() && image.IsGood(); i++)
+	{
+		count = image.ReadCount();
+		for(unsigned int j = 0; j < count; j++)
+			m_firstSets[i].Add(image.Read());
+	}
+
+	m_followSets.resize(image.ReadCount());
+	for(unsigned int i = 0; i < m_followSets.size() && image.IsGood(); i++)
+	{
+		count = image.ReadCount();
+		for(unsigned int j = 0; j < count; j++)
+			m_followSets[i].Add(image.Read());
+	}
+
+	m_isLL1 = image.Read() != 0;
+	m_parseTable.resize(image.ReadCount());
+	for(unsigned int i = 0; i < m_parseTable.size() && image.IsGood(); i++)
+	{
+		m_parseTable[i].resize(image.ReadCount());
+		for(unsigned int j = 0; j < m_parseTable[i].size(); j++)
+			m_parseTable[i][j] = image.Read();
+	}
+
+	count = image.ReadCount();
+	for(unsigned int i = 0; i < count && image.IsGood(); i++)
+	{
+		string conflict;
+		image.ReadString(conflict);
+		m_parseConflicts.push_back(conflict);
+	}
+
+	loaded = loaded && image.IsGood() && image.IsEnd() && !m_ruleKeys.empty() &&
+		m_rules.size() == symbolCount && m_firstSets.size() == symbolCount && m_followSets.size() == symbolCount;
+
+	// Every symbol in the image has to be one of its symbols, or a damaged image could index out of bounds.
+	for(list<int>::iterator it = m_nonTerminals.begin(); it != m_nonTerminals.end() && loaded; it++)
+		loaded = *it >= 0 && *it < (int)symbolCount;
+	for(list<int>::iterator it = m_terminals.begin(); it != m_terminals.end() && loaded; it++)
+		loaded = *it >= 0 && *it < (int)symbolCount;
+	for(vector<int>::iterator it = m_ruleKeys.begin(); it != m_ruleKeys.end() && loaded; it++)
+		loaded = *it >= 0 && *it < (int)symbolCount;
+	for(unsigned int key = 0; key < m_rules.size() && loaded; key++)
+	{
+		for(unsigned int i = 0; i < m_rules[key].size() && loaded; i++)
+		{
+			for(unsigned int j = 0; j < m_rules[key][i].size() && loaded; j++)
+				loaded = m_rules[key][i][j] >= 0 && m_rules[key][i][j] < (int)symbolCount;
+		}
+	}
+	for(unsigned int i = 0; i < m_parseTable.size() && loaded; i++)
+	{
+		loaded = i < symbolCount && m_parseTable[i].size() == PARSE_TABLE_EOF + 1;
+		for(unsigned int j = 0; j < m_parseTable[i].size() && loaded; j++)
+			loaded = m_parseTable[i][j] >= PARSE_TABLE_NONE && m_parseTable[i][j] < (int)m_rules[i].size();
+	}
+
+	if(!loaded)
+	{
+		// Leave the parser as it was so the grammar text can still be parsed.
+		m_symbols.Clear();
+		m_nonTerminals.clear();
+		m_terminals.clear();
+		m_rules.clear();
+		m_ruleKeys.clear();
+		m_nullable.clear();
+		m_firstSets.clear();
+		m_followSets.clear();
+		m_parseTable.clear();
+		m_parseConflicts.clear();
+		m_isLL1 = false;
+		return false;
+	}
+
+	m_grammarStage	= GRMR_FINISHED;
+	m_currentRule	= 0;
+
+	InitializeLexer();
+
+	// The same output as a grammar which was just parsed.
+	if(PRINT_RULES)
+		PrintRules();
+	if(PRINT_OUTPUT)
+	{
+		PrintFirstSets();
+		PrintFollowSets();
+	}
+
+	return true;
+}
@@ -0,0 +1,511 @@
+#include "CompleteParser.h"
+
+/*
+	The LALR(1) engine builds the LR(0) automaton of the rules, then finds
+	the lookaheads of its items by propagating them from state to state.
+	Tokens are shifted onto m_lalrStates and m_lalrNodes. A reduce replaces
+	the nodes of a production by one parent node, so the tree has the same
+	shape the other engines build. Left recursive rules reduce each element
+	of a list as it ends, which keeps both stacks short.
+*/
+
+// An LR(0) state while the table is built.
+struct LALRState
+{
+	vector<int> kernel;						// Item IDs, sorted.
+	vector<int> closure;					// The kernel followed by the items it adds.
+	vector<pair<int, int> > transitions;	// Symbol and the state it leads to, in the order found.
+};
+
+// The lookaheads of the kernel items and closure non-terminals of every state.
+class LALRLookaheads
+{
+public:
+	int GetSlot(int state, int item)
+	{
+		unsigned long long key = ((unsigned long long)state << 32) | (unsigned int)item;
+		unordered_map<unsigned long long, int>::iterator it = slots.find(key);
+		if(it != slots.end())
+			return it->second;
+
+		int slot = (int)states.size();
+		slots[key] = slot;
+		states.push_back(state);
+		items.push_back(item);
+		lookaheads.push_back(SymbolSet());
+		propagates.push_back(vector<int>());
+
+		return slot;
+	}
+
+	unordered_map<unsigned long long, int>	slots;		// State and item to slot.
+	vector<int>								states;		// Slot to state.
+	vector<int>								items;		// Slot to item, or the item count plus a non-terminal.
+	vector<SymbolSet>						lookaheads;	// Slot to lookahead columns.
+	vector<vector<int> >					propagates;	// Slot to the slots its lookaheads are passed on to.
+};
+
+__declspec(dllexport) string CompleteParser::GetLALRConflicts()
+{
+	string conflicts;
+	for(list<string>::iterator it = m_lalrConflicts.begin(); it != m_lalrConflicts.end(); it++)
+	{
+		conflicts.append(*it).append("\n");
+	}
+
+	return conflicts;
+}
+
+string CompleteParser::GetLALRActionText(int action)
+{
+	int value = action >> LALR_ACTION_BITS;
+
+	switch(action & LALR_ACTION_MASK)
+	{
+	case LALR_SHIFT:
+		return "shift " + m_symbols.GetName(m_lalrStateSymbols[value]);
+	case LALR_REDUCE:
+	{
+		LALRProduction& production = m_lalrProductions[value];
+		string text = "reduce " + m_symbols.GetName(production.key) + " ->";
+		for(vector<int>::iterator it = production.symbols.begin(); it != production.symbols.end(); it++)
+			text.append(" ").append(m_symbols.GetName(*it));
+		if(production.symbols.empty())
+			text.append(" ").append(m_symbols.GetName(SYMBOL_EPSILON));
+		return text;
+	}
+	case LALR_ACCEPT:
+		return "accept";
+	}
+
+	return "error";
+}
+
+void CompleteParser::AddLALRAction(int state, int column, int action)
+{
+	int& cell = m_lalrActions[state][column];
+
+	if(cell == LALR_ERROR || cell == action)
+	{
+		cell = action;
+		return;
+	}
+
+	// Like yacc, a shift wins over a reduce and the earlier production wins between reduces.
+	int kept = cell;
+	if((cell & LALR_ACTION_MASK) == LALR_REDUCE)
+	{
+		if((action & LALR_ACTION_MASK) != LALR_REDUCE || action < cell)
+			kept = action;
+	}
+
+	stringstream ss;
+	ss << "state " << state << ": " << GetLALRActionText(cell) << " and " << GetLALRActionText(action) << " on ";
+	if(column == PARSE_TABLE_EOF)
+		ss << m_symbols.GetName(SYMBOL_EOF);
+	else
+		ss << TOKENS[column];
+	ss << ", using " << GetLALRActionText(kept);
+	m_lalrConflicts.push_back(ss.str());
+
+	cell = kept;
+}
+
+void CompleteParser::BuildLALRTable()
+{
+	m_lalrBuilt = true;
+	m_lalrProductions.clear();
+	m_lalrActions.clear();
+	m_lalrGotos.clear();
+	m_lalrStateSymbols.clear();
+	m_lalrConflicts.clear();
+	m_lalrStates.clear();
+	m_lalrNodes.clear();
+
+	if(m_ruleKeys.empty())
+		return;
+
+	int symbolCount = m_symbols.GetCount();
+	int start = *m_nonTerminals.begin();
+
+	// The start production is first. Accepting it takes the place of shifting EOF, so EOF is left
+	// out of the rules. Productions are numbered in grammar order to resolve conflicts by it.
+	LALRProduction startProduction;
+	startProduction.key		= SYMBOL_NONE;
+	startProduction.ruleSet	= 0;
+	startProduction.symbols.push_back(start);
+	m_lalrProductions.push_back(startProduction);
+
+	vector<vector<int> > productionsOf(symbolCount);
+	for(list<int>::iterator key = m_nonTerminals.begin(); key != m_nonTerminals.end(); key++)
+	{
+		if(*key >= (int)m_rules.size())
+			continue;
+
+		for(unsigned int i = 0; i < m_rules[*key].size(); i++)
+		{
+			LALRProduction production;
+			production.key		= *key;
+			production.ruleSet	= i;
+			for(vector<int>::iterator rule = m_rules[*key][i].begin(); rule != m_rules[*key][i].end(); rule++)
+			{
+				if(*rule != SYMBOL_EPSILON && *rule != SYMBOL_EOF)
+					production.symbols.push_back(*rule);
+			}
+
+			productionsOf[*key].push_back(m_lalrProductions.size());
+			m_lalrProductions.push_back(production);
+		}
+	}
+
+	// An item is a production with a position in it. Item IDs of a production are consecutive.
+	vector<int> itemBase;
+	vector<int> itemProduction;
+	for(unsigned int p = 0; p < m_lalrProductions.size(); p++)
+	{
+		itemBase.push_back(itemProduction.size());
+		for(unsigned int dot = 0; dot <= m_lalrProductions[p].symbols.size(); dot++)
+			itemProduction.push_back(p);
+	}
+
+	// Terminals are matched by token ID, so the automaton shifts table columns. The symbol of a
+	// reserved token is its column. ReduceLALR gives the nodes their symbols back.
+	vector<bool> terminal(symbolCount, false);
+	for(int i = 0; i < symbolCount; i++)
+	{
+		if(IsTokenTerminal(i))
+		{
+			terminal[i] = true;
+			terminal[GetParseTableColumn(i)] = true;
+		}
+	}
+
+	// The symbol after the position of each item, and the first columns and nullability of the rest.
+	vector<int> itemSymbol(itemProduction.size(), SYMBOL_NONE);
+	vector<SymbolSet> firstAfter(itemProduction.size());
+	vector<bool> nullableAfter(itemProduction.size(), true);
+	for(unsigned int p = 0; p < m_lalrProductions.size(); p++)
+	{
+		vector<int>& symbols = m_lalrProductions[p].symbols;
+
+		SymbolSet first;
+		bool nullable = true;
+		for(int dot = (int)symbols.size() - 1; dot >= 0; dot--)
+		{
+			int item = itemBase[p] + dot;
+			itemSymbol[item]	= terminal[symbols[dot]] ? GetParseTableColumn(symbols[dot]) : symbols[dot];
+			firstAfter[item]	= first;
+			nullableAfter[item]	= nullable;
+
+			if(terminal[symbols[dot]])
+			{
+				first.Clear();
+				first.Add(GetParseTableColumn(symbols[dot]));
+				nullable = false;
+			}
+			else
+			{
+				bool symbolNullable = symbols[dot] < (int)m_nullable.size() && m_nullable[symbols[dot]];
+				if(!symbolNullable)
+					first.Clear();
+
+				if(symbols[dot] < (int)m_firstSets.size())
+				{
+					const vector<int>& firstSet = m_firstSets[symbols[dot]].GetSymbols();
+					for(vector<int>::const_iterator it = firstSet.begin(); it != firstSet.end(); it++)
+					{
+						if(*it != SYMBOL_EPSILON)
+							first.Add(GetParseTableColumn(*it));
+					}
+				}
+
+				nullable = nullable && symbolNullable;
+			}
+		}
+	}
+
+	// Build the LR(0) states. A state is known by its kernel.
+	vector<LALRState> states(1);
+	states[0].kernel.push_back(itemBase[0]);
+	map<vector<int>, int> stateIDs;
+	stateIDs[states[0].kernel] = 0;
+
+	vector<int> closedFor(symbolCount, -1);
+	for(unsigned int s = 0; s < states.size(); s++)
+	{
+		vector<int> closure(states[s].kernel);
+		for(unsigned int i = 0; i < closure.size(); i++)
+		{
+			int next = itemSymbol[closure[i]];
+			if(next == SYMBOL_NONE || terminal[next] || closedFor[next] == (int)s)
+				continue;
+
+			closedFor[next] = s;
+			for(vector<int>::iterator p = productionsOf[next].begin(); p != productionsOf[next].end(); p++)
+				closure.push_back(itemBase[*p]);
+		}
+
+		// The kernel reached through each symbol. The symbols are kept in the order they were found.
+		vector<int> order;
+		unordered_map<int, vector<int> > kernels;
+		for(vector<int>::iterator item = closure.begin(); item != closure.end(); item++)
+		{
+			int next = itemSymbol[*item];
+			if(next == SYMBOL_NONE)
+				continue;
+
+			vector<int>& kernel = kernels[next];
+			if(kernel.empty())
+				order.push_back(next);
+			kernel.push_back(*item + 1);
+		}
+
+		for(vector<int>::iterator symbol = order.begin(); symbol != order.end(); symbol++)
+		{
+			vector<int>& kernel = kernels[*symbol];
+			sort(kernel.begin(), kernel.end());
+
+			map<vector<int>, int>::iterator found = stateIDs.find(kernel);
+			int target;
+			if(found != stateIDs.end())
+				target = found->second;
+			else
+			{
+				target = states.size();
+				stateIDs[kernel] = target;
+				states.push_back(LALRState());
+				states.back().kernel = kernel;
+			}
+
+			states[s].transitions.push_back(make_pair(*symbol, target));
+			m_lalrGotos[((unsigned long long)s << 32) | (unsigned int)*symbol] = target;
+		}
+
+		states[s].closure.swap(closure);
+	}
+
+	// Lookaheads are kept for the kernel items of each state, and for each non-terminal its closure
+	// adds, which stands for every production of the non-terminal. An item passes its lookaheads on
+	// to the item after it in the next state, and to the non-terminal after it if the rest of its
+	// ruleset can be empty.
+	int itemCount = itemProduction.size();
+	LALRLookaheads lookaheads;
+	lookaheads.lookaheads[lookaheads.GetSlot(0, itemBase[0])].Add(PARSE_TABLE_EOF);
+
+	vector<pair<int, int> > reduces;
+	for(unsigned int s = 0; s < states.size(); s++)
+	{
+		vector<int>& closure = states[s].closure;
+		for(unsigned int i = 0; i < closure.size(); i++)
+		{
+			int item = closure[i];
+			int production = itemProduction[item];
+
+			int from;
+			if(i < states[s].kernel.size())
+				from = lookaheads.GetSlot(s, item);
+			else
+				from = lookaheads.GetSlot(s, itemCount + m_lalrProductions[production].key);
+
+			int next = itemSymbol[item];
+			if(next == SYMBOL_NONE)
+			{
+				if(production != 0)
+					reduces.push_back(make_pair(from, production));
+				continue;
+			}
+
+			int to = lookaheads.GetSlot(GetLALRGoto(s, next), item + 1);
+			lookaheads.propagates[from].push_back(to);
+
+			if(!terminal[next])
+			{
+				to = lookaheads.GetSlot(s, itemCount + next);
+				lookaheads.lookaheads[to].Merge(firstAfter[item]);
+				if(nullableAfter[item])
+					lookaheads.propagates[from].push_back(to);
+			}
+		}
+	}
+
+	// Pass the lookaheads on until nothing changes.
+	vector<int> work;
+	vector<bool> queued(lookaheads.states.size(), true);
+	for(int slot = (int)lookaheads.states.size() - 1; slot >= 0; slot--)
+		work.push_back(slot);
+
+	while(!work.empty())
+	{
+		int slot = work.back();
+		work.pop_back();
+		queued[slot] = false;
+
+		for(vector<int>::iterator to = lookaheads.propagates[slot].begin(); to != lookaheads.propagates[slot].end(); to++)
+		{
+			if(lookaheads.lookaheads[*to].Merge(lookaheads.lookaheads[slot]) && !queued[*to])
+			{
+				queued[*to] = true;
+				work.push_back(*to);
+			}
+		}
+	}
+
+	// Fill the table. Shifts and the accept go first so conflicts are reported against them.
+	m_lalrActions.assign(states.size(), vector<int>(PARSE_TABLE_EOF + 1, LALR_ERROR));
+	m_lalrStateSymbols.assign(states.size(), SYMBOL_NONE);
+	for(unsigned int s = 0; s < states.size(); s++)
+	{
+		for(vector<pair<int, int> >::iterator it = states[s].transitions.begin(); it != states[s].transitions.end(); it++)
+			m_lalrStateSymbols[it->second] = it->first;
+	}
+
+	for(unsigned int s = 0; s < states.size(); s++)
+	{
+		for(vector<pair<int, int> >::iterator it = states[s].transitions.begin(); it != states[s].transitions.end(); it++)
+		{
+			if(terminal[it->first])
+				AddLALRAction(s, it->first, (it->second << LALR_ACTION_BITS) | LALR_SHIFT);
+		}
+	}
+
+	AddLALRAction(GetLALRGoto(0, start), PARSE_TABLE_EOF, LALR_ACCEPT);
+
+	for(vector<pair<int, int> >::iterator it = reduces.begin(); it != reduces.end(); it++)
+	{
+		const vector<int>& columns = lookaheads.lookaheads[it->first].GetSymbols();
+		for(vector<int>::const_iterator column = columns.begin(); column != columns.end(); column++)
+			AddLALRAction(lookaheads.states[it->first], *column, (it->second << LALR_ACTION_BITS) | LALR_REDUCE);
+	}
+
+	if(PRINT_CONFLICTS && !m_lalrConflicts.empty())
+		printf("%s", GetLALRConflicts().c_str());
+}
+
+int CompleteParser::GetLALRGoto(int state, int symbol)
+{
+	unordered_map<unsigned long long, int>::iterator it = m_lalrGotos.find(((unsigned long long)state << 32) | (unsigned int)symbol);
+	if(it == m_lalrGotos.end())
+		return -1;
+
+	return it->second;
+}
+
+int CompleteParser::EvaluateLineLALR(list<LineToken>& line)
+{
+	// The whole program was already parsed.
+	if(!m_nodes.nodes.empty())
+		return TOKEN_ERR_SYNTAX;
+
+	if(m_lalrStates.empty())
+		m_lalrStates.push_back(0);
+
+	for(list<LineToken>::iterator token = line.begin(); token != line.end(); token++)
+	{
+		if(!ShiftLALR(token->tokenID, &*token))
+			return TOKEN_ERR_SYNTAX;
+	}
+
+	// Program input has no EOF token, so the program is accepted as soon as it can end.
+	if(CanAcceptLALR())
+		ShiftLALR(PARSE_TABLE_EOF, 0);
+
+	return TOKEN_ERR_NONE;
+}
+
+bool CompleteParser::ShiftLALR(int column, LineToken* token)
+{
+	if(column < 0 || column > PARSE_TABLE_EOF)
+		return false;
+
+	while(true)
+	{
+		int action = m_lalrActions[m_lalrStates.back()][column];
+
+		switch(action & LALR_ACTION_MASK)
+		{
+		case LALR_SHIFT:
+		{
+			int state = action >> LALR_ACTION_BITS;
+
+			m_lalrNodes.push_back(Node());
+			Node& newNodeT = m_lalrNodes.back();
+			newNodeT.type		= m_lalrStateSymbols[state];
+			newNodeT.closed		= true;
+			newNodeT.complete	= NODE_IS_COMPLETE;
+			newNodeT.value		= token->value;
+			newNodeT.lineNumber	= token->lineNumber;
+			m_lalrStates.push_back(state);
+
+			return true;
+		}
+		case LALR_REDUCE:
+			ReduceLALR(action >> LALR_ACTION_BITS);
+			break;
+		case LALR_ACCEPT:
+			m_nodes.nodes.push_back(Node());
+			MoveNode(m_lalrNodes.back(), m_nodes.nodes.back());
+			m_lalrNodes.clear();
+			m_lalrStates.clear();
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+void CompleteParser::ReduceLALR(int production)
+{
+	LALRProduction& rule = m_lalrProductions[production];
+	unsigned int count = rule.symbols.size();
+
+	Node newNode;
+	newNode.type		= rule.key;
+	newNode.closed		= true;
+	newNode.complete	= NODE_IS_COMPLETE;
+	newNode.nodes.resize(count);
+	for(unsigned int i = 0; i < count; i++)
+	{
+		// Terminals were shifted as the symbol of their column.
+		MoveNode(m_lalrNodes[m_lalrNodes.size() - count + i], newNode.nodes[i]);
+		newNode.nodes[i].type = rule.symbols[i];
+	}
+	newNode.lineNumber	= count ? newNode.nodes[0].lineNumber : GetCurrentLineNumber();
+
+	m_lalrNodes.resize(m_lalrNodes.size() - count);
+	m_lalrStates.resize(m_lalrStates.size() - count);
+
+	m_lalrNodes.push_back(Node());
+	MoveNode(newNode, m_lalrNodes.back());
+	m_lalrStates.push_back(GetLALRGoto(m_lalrStates.back(), rule.key));
+}
+
+bool CompleteParser::CanAcceptLALR()
+{
+	// Reduce on EOF using only the state numbers. States pushed by the reduces are kept apart
+	// so the stack is not copied.
+	unsigned int depth = m_lalrStates.size();
+	vector<int> pushed;
+
+	while(true)
+	{
+		int state = pushed.empty() ? m_lalrStates[depth - 1] : pushed.back();
+		int action = m_lalrActions[state][PARSE_TABLE_EOF];
+
+		if((action & LALR_ACTION_MASK) == LALR_ACCEPT)
+			return true;
+		if((action & LALR_ACTION_MASK) != LALR_REDUCE)
+			return false;
+
+		LALRProduction& rule = m_lalrProductions[action >> LALR_ACTION_BITS];
+		for(unsigned int i = 0; i < rule.symbols.size(); i++)
+		{
+			if(!pushed.empty())
+				pushed.pop_back();
+			else
+				depth--;
+		}
+
+		state = pushed.empty() ? m_lalrStates[depth - 1] : pushed.back();
+		pushed.push_back(GetLALRGoto(state, rule.key));
+	}
+}
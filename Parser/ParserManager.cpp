@@ -1,4 +1,6 @@
 #include "ParserManager.h"
+#include "GrammarFullParser.h"
+#include "CSource.h"
 #include <stdexcept>
 
 __declspec(dllexport) ParserManager* CreateParserManager()
@@ -16,6 +18,14 @@ __declspec(dllexport) void DeleteParserManager(ParserManager* manager)
 	}
 }
 
+__declspec(dllexport) void SetGrammarImagePath(ParserManager* manager, char* imagePath)
+{
+	if(manager != NULL)
+	{
+		manager->SetGrammarImagePath(imagePath);
+	}
+}
+
 __declspec(dllexport) bool InitializeParser(ParserManager* manager, char* filePath)
 {
 	if(manager != NULL)
@@ -30,11 +40,18 @@ __declspec(dllexport) void ParseSyntax(ParserManager* manager, char* syntax)
 {
 	if(manager != NULL)
 	{
-		manager->GetParser()->GetVariables()->Clear();
-		manager->GetParser()->ClearNodes();
-		manager->GetInput()->SetBuffer(string(syntax));
-		manager->GetParser()->Update();
+		manager->GetParser()->ParseProgram(string(syntax));
+	}
+}
+
+__declspec(dllexport) bool EditSyntax(ParserManager* manager, int start, int length, char* text)
+{
+	if(manager != NULL)
+	{
+		return manager->GetParser()->EditProgram(start, length, string(text));
 	}
+
+	return false;
 }
 
 __declspec(dllexport) void RunParser(ParserManager* manager)
@@ -53,7 +70,7 @@ __declspec(dllexport) bool CompileAndExecuteProgram(ParserManager* manager)
 		program = manager->GetParser()->Compile();
 		if(program != NULL)
 		{
-			execute_program(program);
+			manager->GetParser()->RunProgram(program);
 			return true;
 		}
 	}
@@ -61,6 +78,63 @@ __declspec(dllexport) bool CompileAndExecuteProgram(ParserManager* manager)
 	return false;
 }
 
+__declspec(dllexport) bool ExecuteProgram(ParserManager* manager)
+{
+	if(manager != NULL)
+	{
+		ByteCode* byteCode = manager->GetParser()->GetByteCode();
+		if(byteCode != NULL)
+		{
+			byteCode->Execute();
+			return true;
+		}
+
+		// A malformed program is reported by execute_program.
+		statementNode* program = manager->GetParser()->GetProgram();
+		if(program != NULL)
+		{
+			execute_program(program, manager->GetParser()->GetIndexPolicy());
+			return true;
+		}
+	}
+
+	return false;
+}
+
+__declspec(dllexport) void SetIndexPolicy(ParserManager* manager, int policy)
+{
+	if(manager != NULL)
+	{
+		manager->GetParser()->SetIndexPolicy(policy);
+	}
+}
+
+__declspec(dllexport) int GetIndexPolicy(ParserManager* manager)
+{
+	if(manager != NULL)
+	{
+		return manager->GetParser()->GetIndexPolicy();
+	}
+
+	return INDEX_GROW;
+}
+
+__declspec(dllexport) bool TranslateProgram(ParserManager* manager, char* filePath)
+{
+	if(manager != NULL)
+	{
+		statementNode* program = manager->GetParser()->GetProgram();
+		if(program != NULL)
+		{
+			CSource source;
+			return (source.Translate(program, manager->GetParser()->GetVariables(), manager->GetParser()->GetIndexPolicy()) &&
+				source.Write(filePath));
+		}
+	}
+
+	return false;
+}
+
 __declspec(dllexport) Variables* GetVariables(ParserManager* manager)
 {
 	if(manager != NULL)
@@ -96,6 +170,14 @@ __declspec(dllexport) ParserManager::ParserManager()
 {
 	m_input		= 0;
 	m_parser	= 0;
+	m_generatedParser = 0;
+	m_defaultImagePath = true;
+}
+
+__declspec(dllexport) void ParserManager::SetGrammarImagePath(const char* imagePath)
+{
+	m_defaultImagePath = (imagePath == 0);
+	m_imagePath = imagePath ? imagePath : "";
 }
 
 __declspec(dllexport) ParserManager::~ParserManager()
@@ -121,20 +203,51 @@ __declspec(dllexport) bool ParserManager::Initialize(char* filePath)
 		return false;
 	}
 
-	// Load grammar from file.
-	if(!m_input->OpenFile(filePath))
+	// Load grammar from file. Map it when possible so it is read without copying.
+	bool mapped = m_input->MapFile(filePath);
+	if(!mapped && !m_input->OpenFile(filePath))
 		printf("Failed to open file %s.", filePath);
 
-	// --------------Load Grammar--------------
-	while(true)
+	// A mapped grammar is read as a single line, so its whole text can be hashed before parsing.
+	// An image made from the same text replaces parsing it.
+	string imagePath = m_defaultImagePath ? string(filePath) + GRAMMAR_IMAGE_EXTENSION : m_imagePath;
+	unsigned long long grammarHash = 0;
+	bool useImage = USE_GRAMMAR_IMAGE && mapped && !imagePath.empty();
+	bool lineRead = false;
+	if(useImage)
 	{
 		m_input->ReadLine();
-		if(!m_parser->Update())
-			break;
+		lineRead = true;
+		grammarHash = CompleteParser::HashGrammar(m_input->GetBuffer(), m_input->GetBufferSize());
+	}
+
+	// --------------Load Grammar--------------
+	if(!useImage || !m_parser->LoadGrammarImage(imagePath.c_str(), grammarHash))
+	{
+		while(true)
+		{
+			if(!lineRead)
+				m_input->ReadLine();
+			lineRead = false;
+			if(!m_parser->Update())
+				break;
+		}
+
+		if(useImage)
+			m_parser->SaveGrammarImage(imagePath.c_str(), grammarHash);
 	}
 
 	m_input->CloseFile();
 
+	// The parser generated from grammarFull.txt is compiled in. It is used once selected with
+	// SetParseEngine(PARSE_ENGINE_GENERATED), and only for the grammar it was generated from.
+	m_generatedParser = new GrammarFullParser;
+	if(!m_parser->SetGeneratedParser(m_generatedParser))
+	{
+		delete m_generatedParser;
+		m_generatedParser = 0;
+	}
+
 	m_parser->SetGrammarStage(PROGRAM_INPUT);
 
 	return true;
@@ -149,6 +262,12 @@ __declspec(dllexport) void ParserManager::Shutdown()
 		m_parser = 0;
 	}
 
+	if(m_generatedParser)
+	{
+		delete m_generatedParser;
+		m_generatedParser = 0;
+	}
+
 	if(m_input)
 	{
 		m_input->Shutdown();
@@ -157,6 +276,21 @@ __declspec(dllexport) void ParserManager::Shutdown()
 	}
 }
 
+__declspec(dllexport) bool ParserManager::LoadProgram(char* filePath)
+{
+	if(!m_input)
+		return false;
+
+	// The program is consumed by Run() as a single view of the mapped file.
+	if(!m_input->MapFile(filePath) && !m_input->OpenFile(filePath))
+	{
+		printf("Failed to open file %s.", filePath);
+		return false;
+	}
+
+	return true;
+}
+
 __declspec(dllexport) void ParserManager::Run()
 {
 	// --------------Accept Program Input--------------
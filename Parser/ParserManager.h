@@ -24,8 +24,12 @@ extern "C"
 		__declspec(dllexport) ParserManager();
 		__declspec(dllexport) ~ParserManager();
 
+		__declspec(dllexport) void SetGrammarImagePath(const char* imagePath);	// Before Initialize. 0 keeps the image next to the grammar, "" turns it off.
+
 		__declspec(dllexport) bool Initialize(char* filePath);
 
+		__declspec(dllexport) bool LoadProgram(char* filePath);
+
 		__declspec(dllexport) void Run();
 
 		__declspec(dllexport) void Shutdown();
@@ -36,15 +40,24 @@ extern "C"
 	private:
 		Input*	m_input;
 		CompleteParser* m_parser;
+		GeneratedParser* m_generatedParser;
+		string	m_imagePath;
+		bool	m_defaultImagePath;
 	};
 
 	// Wrapper point for C# or other languages.
 __declspec(dllexport) ParserManager* CreateParserManager();
 __declspec(dllexport) void DeleteParserManager(ParserManager* manager);
+__declspec(dllexport) void SetGrammarImagePath(ParserManager* manager, char* imagePath);
 __declspec(dllexport) bool InitializeParser(ParserManager* manager, char* filePath);
 __declspec(dllexport) void ParseSyntax(ParserManager* manager, char* syntax);
+__declspec(dllexport) bool EditSyntax(ParserManager* manager, int start, int length, char* text);	// False if the whole program was parsed again.
 __declspec(dllexport) void RunParser(ParserManager* manager);
 __declspec(dllexport) bool CompileAndExecuteProgram(ParserManager* manager);
+__declspec(dllexport) bool ExecuteProgram(ParserManager* manager);				// Run the program kept up to date by EditSyntax.
+__declspec(dllexport) bool TranslateProgram(ParserManager* manager, char* filePath);	// Write that program as C. False if it can not be translated.
+__declspec(dllexport) void SetIndexPolicy(ParserManager* manager, int policy);	// INDEX_*, for every way the program is run.
+__declspec(dllexport) int GetIndexPolicy(ParserManager* manager);
 __declspec(dllexport) Variables* GetVariables(ParserManager* manager);
 __declspec(dllexport) VarAccessOut* GetOrCreateVarAccess(ParserManager* manager, char* varName);
 }
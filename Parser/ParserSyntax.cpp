@@ -26,23 +26,29 @@ int CompleteParser::HandleTokenIDSyntax(string& token)
 	{
 	case PROGRAM_INPUT:
 		{
-			m_currentLine.push_back(token);
-
 			// Determine the id of the token.
-			int tokenID = GetTokenID(token);
+			LineToken lineToken;
+			lineToken.value			= token;
+			lineToken.tokenID		= GetTokenID(token);
+			lineToken.lineNumber	= GetCurrentLineNumber();
+			m_currentLine.push_back(lineToken);
+
+			int tokenID = lineToken.tokenID;
 
 			// Unknown, check against constant types.
 			switch(tokenID)
 			{
 			case SEMICOLON:
 				{
-					returnCode = EvaluateLine(m_currentLine);
+					AddProgramLine();
+					returnCode = ParseLine(m_currentLine);
 					m_currentLine.clear();
 					break;
 				}
 			case RBRACE:
 				{
-					returnCode = EvaluateLine(m_currentLine);
+					AddProgramLine();
+					returnCode = ParseLine(m_currentLine);
 					m_currentLine.clear();
 					break;
 				}
@@ -58,11 +64,11 @@ int CompleteParser::HandleTokenIDSyntax(string& token)
 // Currently only checks for open brackets.
 void CompleteParser::VerifyNodes(Node& node)
 {
-	if(node.type == TOKENS[LBRAC])
+	if(node.type == LBRAC)
 	{
 		m_openBrackets++;
 	}
-	else if(node.type == TOKENS[RBRAC])
+	else if(node.type == RBRAC)
 	{
 		m_openBrackets--;
 	}
@@ -73,42 +79,61 @@ void CompleteParser::VerifyNodes(Node& node)
 	}
 }
 
-int CompleteParser::EvaluateLine(list<string>& line)
+void CompleteParser::BeginMatchLine(list<LineToken>& line)
 {
+	// Results are only valid for the tokens of this line.
+	m_matchMemo.clear();
+
+	// The text of every token is added to the tree once. Like the memo, it is found by the line size left.
+	m_matchText.resize(line.size() + 1);
+	unsigned int position = line.size();
+	for(list<LineToken>::iterator it = line.begin(); it != line.end(); it++)
+		m_matchText[position--] = m_tree.AddText(it->value);
+}
+
+int CompleteParser::EvaluateLine(list<LineToken>& line)
+{
+	BeginMatchLine(line);
+
+	m_treeChanged = true;
+
+	// Nodes of rulesets which were not taken are dropped once the line is done. Only the base nodes of the
+	// line lead to the nodes which were kept.
+	m_tree.Mark();
+	vector<int> parents;
+
 find_open_node:
 	bool found = false;
 
 	// The possible rules the first token of this line may match.
-	list<string> possibleRules;
-	int tokenID = GetTokenID(*line.begin());
+	list<int> possibleRules;
+	int tokenID = line.begin()->tokenID;
 
-	// Find the deepest node that has not been closed and has not been completed.
-	Node* openNode = GetFarthestOpenNode(m_nodes);
-	// Find the deepest node within the farthest open node which is unknown if it has been completed.
-	Node* expandableNode = 0;
-	if(openNode) expandableNode = GetFarthestExpandableNode(*openNode);
-	if(expandableNode) openNode = expandableNode;
+	// Find the deepest node that has not been closed and has not been completed. Every node below it comes
+	// after it, so none of them are open, and it is also the farthest node which is unknown if it has been completed.
+	int openNode = GetFarthestOpenNode();
 
-	Node &baseNode = openNode ? *openNode : m_nodes;
+	int baseNode = (openNode != TREE_NODE_NONE) ? openNode : TREE_ROOT;
 
 	// If we are adding to an existing node this is the start index of the list in the specific ruleset.
 	int sIndex = 0;
 
 	// When working with an unknown rule, find the possible start sets which create the rule.
-	if(baseNode.type == BASE_NODE_TYPE)
+	if(m_tree.Get(baseNode).type == BASE_NODE_TYPE)
 	{
 		found = true;
 	}
 
-	possibleRules.push_back(baseNode.type);
-	sIndex = baseNode.nodes.size();
+	possibleRules.push_back(m_tree.Get(baseNode).type);
+	sIndex = m_tree.GetChildCount(baseNode);
+	parents.push_back(baseNode);
 
-	list<string> lineCpy = list<string>(line);
-	for(list<string>::iterator it = possibleRules.begin(); it != possibleRules.end(); it++)
+	list<LineToken> lineCpy = list<LineToken>(line);
+	for(list<int>::iterator it = possibleRules.begin(); it != possibleRules.end(); it++)
 	{
 		if(MatchLineToRule(line, lineCpy, *it, baseNode, sIndex))
 		{
-			CloseNodeChildren(m_nodes);
+			AddMatchedNodes(baseNode, sIndex);
 
 			// A match may have been found but the line could still have more to process.
 			if(line.empty())
@@ -119,6 +144,10 @@ find_open_node:
 		{
 			// Reset the line for the next possible rule.
 			line = lineCpy;
+
+			// Terminals may have been added to the base node. They are checked with the next match.
+			m_closeNodes.push_back(baseNode);
+			m_closeFirst.push_back(sIndex);
 		}
 	}
 
@@ -126,20 +155,28 @@ find_open_node:
 	// and re-check all nodes.
 	if(!found)
 	{
-		baseNode.complete = NODE_IS_COMPLETE;
+		m_tree.Get(baseNode).complete = NODE_IS_COMPLETE;
 		goto find_open_node;
 	}
 
+	m_tree.Compact(parents);
+
+	// The nodes added by this line are all at the top of m_openNodes.
+	for(vector<int>::reverse_iterator it = m_openNodes.rbegin(); it != m_openNodes.rend() && m_tree.IsAddedSinceMark(*it); it++)
+		*it = m_tree.GetCompactedIndex(*it);
+	for(unsigned int i = 0; i < m_closeNodes.size(); i++)
+		m_closeNodes[i] = m_tree.GetCompactedIndex(m_closeNodes[i]);
+
 	return TOKEN_ERR_NONE;
 }
 
-bool CompleteParser::MatchLineToRule(list<string>& line, list<string> lineCpy, string& nonToken, Node& node, int sIndex)
+bool CompleteParser::MatchLineToRule(list<LineToken>& line, list<LineToken> lineCpy, int nonToken, int node, int sIndex)
 {
 	if(line.empty() || !IsTokenNonTerminal(nonToken))
 		return false;
 	// The best node to use out of all rulesets for this non-token.
-	Node bestNode;
-	list<string> bestLine = list<string>(line);
+	int bestNode = TREE_NODE_NONE;
+	list<LineToken> bestLine = list<LineToken>(line);
 	// Will be set to false on first non-match through a ruleset iteration.
 	bool match = true;
 	int highestMatch = 0;
@@ -153,42 +190,40 @@ bool CompleteParser::MatchLineToRule(list<string>& line, list<string> lineCpy, s
 		match = false;
 		int currentMatch = 0;
 		float matchPercent = 0.0f;
-		// The node for this token. It may be disregarded.
-		Node newNode;
-		newNode.type = nonToken;
 
 		// Reset the line to be executed.
-		line = list<string>(lineCpy);
+		line = list<LineToken>(lineCpy);
 
 		// For each token in the ruleset.
-		list<string>::iterator tokenIt = m_rules[nonToken][i].begin();
+		vector<int>::iterator tokenIt = m_rules[nonToken][i].begin();
 		// If epsilon is valid then this rule should be marked as complete.
 		//match = (*tokenIt == TOKEN_EPSILON);
 
 		if(sIndex >= m_rules[nonToken][i].size())
 			continue;
 		advance(tokenIt, sIndex);
+
+		// The node for this token. It may be disregarded.
+		int newNode = m_tree.AddNode(nonToken, 0);
 		while(tokenIt != m_rules[nonToken][i].end())
 		{
-			int tokenID = GetTokenID(*line.begin());
+			int tokenID = line.begin()->tokenID;
 
 			// Compare to terminal requirement.
 			if(IsTokenTerminal(*tokenIt))
 			{
 				// A match to a terminal was found.
-				if(GetTokenID(*tokenIt) == tokenID)
+				if(m_symbols.GetTokenID(*tokenIt) == tokenID)
 				{
 					// Automatically add the terminal node to the new node of this token.
-					Node newNodeT;
-					newNodeT.type = *tokenIt;
-					newNodeT.closed = true;
-					newNodeT.complete = NODE_IS_COMPLETE;
-					newNodeT.value = *line.begin();
-					newNodeT.lineNumber = m_inputBuffer->GetLineNumber();
+					int newNodeT = m_tree.AddNode(*tokenIt, GetCurrentLineNumber());
+					m_tree.Get(newNodeT).closed = true;
+					m_tree.Get(newNodeT).complete = NODE_IS_COMPLETE;
+					m_tree.SetText(newNodeT, m_matchText[line.size()], line.begin()->value.size());
 					if(sIndex)
-						node.nodes.push_back(newNodeT);
+						m_tree.AddChild(node, newNodeT);
 					else
-						newNode.nodes.push_back(newNodeT);
+						m_tree.AddChild(newNode, newNodeT);
 
 					// Move the line forward.
 					line.pop_front();
@@ -210,7 +245,7 @@ bool CompleteParser::MatchLineToRule(list<string>& line, list<string> lineCpy, s
 			// A non-terminal requires a complete re-evaluation.
 			else
 			{
-				match = MatchLineToRule(line, list<string>(line), *tokenIt, newNode);
+				match = MatchNonTerminal(line, *tokenIt, newNode);
 				if(!match)
 					break;
 			}
@@ -226,7 +261,7 @@ bool CompleteParser::MatchLineToRule(list<string>& line, list<string> lineCpy, s
 			}
 			else // .. The rule has been completed. Update the parent node.
 			{
-				node.complete = NODE_IS_COMPLETE;
+				m_tree.Get(node).complete = NODE_IS_COMPLETE;
 			}
 		}
 
@@ -255,8 +290,8 @@ bool CompleteParser::MatchLineToRule(list<string>& line, list<string> lineCpy, s
 
 			highestMatch = currentMatch;
 			bestNode = newNode;
-			bestNode.lineNumber = m_inputBuffer->GetLineNumber();
-			bestLine = list<string>(line);
+			m_tree.Get(bestNode).lineNumber = GetCurrentLineNumber();
+			bestLine = list<LineToken>(line);
 		}
 	}
 
@@ -265,23 +300,27 @@ bool CompleteParser::MatchLineToRule(list<string>& line, list<string> lineCpy, s
 	{
 		line = bestLine;
 
+		// No ruleset matched a token of an empty line, so there is nothing to add.
+		if(bestNode == TREE_NODE_NONE)
+			return true;
+
 		// Some rules may appear complete but can be added to later.
-		bestNode.complete = (bestPerMatch == 1.0f ? NODE_IS_COMPLETE : highestPerMatch == 1.0f ? NODE_MAYBE_COMPLETE : NODE_NOT_COMPLETE);
+		m_tree.Get(bestNode).complete = (bestPerMatch == 1.0f ? NODE_IS_COMPLETE : highestPerMatch == 1.0f ? NODE_MAYBE_COMPLETE : NODE_NOT_COMPLETE);
 
 		// This makes sure garbage entries aren't added if an expandable node was being checked but no suitable rule was found.
 		if(sIndex)
 		{
 			// Prevent duplicate entries. This node is being expanded upon and the grandchildren should become the children.
-			for(unsigned int i = 0; i < bestNode.nodes.size(); i++)
+			for(unsigned int i = 0; i < m_tree.GetChildCount(bestNode); i++)
 			{
-				node.nodes.push_back(bestNode.nodes[i]);
+				m_tree.AddChild(node, m_tree.GetChild(bestNode, i));
 			}
 		}
 		else
 		{
 			// Prevent garbage entries.
-			if(IsTokenTerminal(bestNode.type) || bestNode.nodes.size() > 0)
-				node.nodes.push_back(bestNode);
+			if(IsTokenTerminal(m_tree.Get(bestNode).type) || m_tree.GetChildCount(bestNode) > 0)
+				m_tree.AddChild(node, bestNode);
 		}
 
 		return true;
@@ -290,18 +329,63 @@ bool CompleteParser::MatchLineToRule(list<string>& line, list<string> lineCpy, s
 	return match;
 }
 
-bool CompleteParser::FindFirstSets(list<string>& possibleRules, int tokenID)
+bool CompleteParser::MatchNonTerminal(list<LineToken>& line, int nonToken, int node)
 {
-	// For each first set.
-	for(map<string, list<string> >::iterator it = m_firstSets.begin(); it != m_firstSets.end(); it++)
+	if(!m_matchMemoEnabled)
+		return MatchLineToRule(line, list<LineToken>(line), nonToken, node);
+
+	// The line only ever loses tokens from the front, so its size tells where in the line this is.
+	m_matchMemoLookups++;
+	unsigned long long key = ((unsigned long long)line.size() << 32) | (unsigned int)nonToken;
+	unordered_map<unsigned long long, MatchMemoEntry>::iterator it = m_matchMemo.find(key);
+	if(it != m_matchMemo.end())
+	{
+		m_matchMemoHits++;
+
+		MatchMemoEntry& memo = it->second;
+		while(line.size() > memo.remaining)
+			line.pop_front();
+		if(memo.completed)
+			m_tree.Get(node).complete = NODE_IS_COMPLETE;
+		if(memo.added)
+			m_tree.AddChild(node, memo.node);
+
+		return memo.matched;
+	}
+
+	// MatchLineToRule can only mark the parent complete, so the mark is seen by clearing it first.
+	int complete = m_tree.Get(node).complete;
+	unsigned int children = m_tree.GetChildCount(node);
+	m_tree.Get(node).complete = NODE_NOT_COMPLETE;
+
+	MatchMemoEntry memo;
+	memo.matched	= MatchLineToRule(line, list<LineToken>(line), nonToken, node);
+	memo.completed	= (m_tree.Get(node).complete == NODE_IS_COMPLETE);
+	memo.added		= (m_tree.GetChildCount(node) > children);
+	memo.remaining	= line.size();
+	memo.node		= memo.added ? m_tree.GetChild(node, children) : TREE_NODE_NONE;
+
+	if(!memo.completed)
+		m_tree.Get(node).complete = complete;
+
+	m_matchMemo[key] = memo;
+
+	return memo.matched;
+}
+
+bool CompleteParser::FindFirstSets(list<int>& possibleRules, int tokenID)
+{
+	// For each first set in name order.
+	for(vector<int>::iterator it = m_ruleKeys.begin(); it != m_ruleKeys.end(); it++)
 	{
 		// For each token starting the first set.
-		for(list<string>::iterator tokenIt = it->second.begin(); tokenIt != it->second.end(); tokenIt++)
+		const vector<int>& firstSet = m_firstSets[*it].GetSymbols();
+		for(vector<int>::const_iterator tokenIt = firstSet.begin(); tokenIt != firstSet.end(); tokenIt++)
 		{
 			// The token is a match
-			if(GetTokenID(*tokenIt) == tokenID)
+			if(m_symbols.GetTokenID(*tokenIt) == tokenID)
 			{
-				possibleRules.push_back(it->first);
+				possibleRules.push_back(*it);
 				// Break out of second loop but continue first finding all possibilities.
 				break;
 			}
@@ -311,32 +395,50 @@ bool CompleteParser::FindFirstSets(list<string>& possibleRules, int tokenID)
 	return true;
 }
 
-Node* CompleteParser::GetFarthestOpenNode(Node& node)
+int CompleteParser::GetFarthestOpenNode()
 {
-	Node* returnNode = (node.complete != NODE_IS_COMPLETE && !node.closed) ? &node : 0;
-
-	for(unsigned int i = 0; i < node.nodes.size(); i++)
+	// Nodes never open again once completed or closed, so they are dropped as they reach the top.
+	while(!m_openNodes.empty())
 	{
-		// Only accept a child node if it is not closed.
-		Node* childNode = GetFarthestOpenNode(node.nodes[i]);
-		if(childNode) returnNode = childNode;
+		TreeNode& node = m_tree.Get(m_openNodes.back());
+		if(node.complete != NODE_IS_COMPLETE && !node.closed)
+			return m_openNodes.back();
+
+		m_openNodes.pop_back();
 	}
 
-	return returnNode;
+	return TREE_NODE_NONE;
 }
 
-Node* CompleteParser::GetFarthestExpandableNode(Node& node)
+void CompleteParser::AddMatchedNodes(int node, unsigned int first)
 {
-	Node* returnNode = (!node.closed && node.complete == NODE_MAYBE_COMPLETE) ? &node : 0;
+	for(unsigned int i = 0; i < m_closeNodes.size(); i++)
+	{
+		CloseNodeChildren(m_closeNodes[i], m_closeFirst[i]);
+	}
+	m_closeNodes.clear();
+	m_closeFirst.clear();
 
-	for(unsigned int i = 0; i < node.nodes.size(); i++)
+	CloseNodeChildren(node, first);
+
+	// The new children come after every open node, so they go on top of m_openNodes in tree order.
+	for(unsigned int i = first; i < m_tree.GetChildCount(node); i++)
 	{
-		// Only accept a child node if it is not closed.
-		Node* childNode = GetFarthestExpandableNode(node.nodes[i]);
-		if(childNode) returnNode = childNode;
+		AddNewNode(m_tree.GetChild(node, i));
 	}
+}
+
+void CompleteParser::AddNewNode(int node)
+{
+	if(m_tree.Get(node).complete != NODE_IS_COMPLETE && !m_tree.Get(node).closed)
+		m_openNodes.push_back(node);
+
+	CloseNodeChildren(node, 0);
 
-	return returnNode;
+	for(unsigned int i = 0; i < m_tree.GetChildCount(node); i++)
+	{
+		AddNewNode(m_tree.GetChild(node, i));
+	}
 }
 
 Node* CompleteParser::GetLowestRightNode(Node& node)
@@ -347,47 +449,46 @@ Node* CompleteParser::GetLowestRightNode(Node& node)
 	return GetLowestRightNode(node.nodes.back());
 }
 
-bool CompleteParser::CloseNodeChildren(Node& node)
+bool CompleteParser::CloseNodeChildren(int node, unsigned int first)
 {
 	bool close = false;
 
-	for(unsigned int i = 0; i < node.nodes.size(); i++)
+	// A child is closed by the type of the child after it, so only children next to the new ones are checked.
+	for(unsigned int i = first ? first - 1 : 0; i < m_tree.GetChildCount(node); i++)
 	{
-		// Terminals are already closed.
-		if(!IsTokenNonTerminal(node.nodes[i].type))
+		int child = m_tree.GetChild(node, i);
+
+		// Terminals and closed nodes are already closed.
+		if(!IsTokenNonTerminal(m_tree.Get(child).type) || m_tree.Get(child).closed)
 			continue;
 
-		list<string> followTypes;
+		list<int> followTypes;
 		// If the token is a non-terminal, find the first set since it would be in the follow set.
-		if(i + 1 < node.nodes.size())
+		if(i + 1 < m_tree.GetChildCount(node))
 		{
-			if(IsTokenNonTerminal(node.nodes[i+1].type))
+			int nextType = m_tree.Get(m_tree.GetChild(node, i + 1)).type;
+			if(IsTokenNonTerminal(nextType))
 			{
-				for(list<string>::iterator it = m_firstSets[node.nodes[i+1].type].begin();
-					it != m_firstSets[node.nodes[i+1].type].end(); it++)
-				{
-					followTypes.push_back(*it);
-				}
+				const vector<int>& firstSet = m_firstSets[nextType].GetSymbols();
+				followTypes.insert(followTypes.end(), firstSet.begin(), firstSet.end());
 				//CloseNodeIfChildTerminal(node.nodes[i]);
 			}
 			else
 			{
-				followTypes.push_back(node.nodes[i+1].type);
+				followTypes.push_back(nextType);
 			}
-			for(list<string>::iterator it = followTypes.begin();
+			for(list<int>::iterator it = followTypes.begin();
 							it != followTypes.end(); it++)
 			{
-				if(IsTokenFollow(node.nodes[i].type, *it))
+				if(IsTokenFollow(m_tree.Get(child).type, *it))
 				{
 					// Close the node and all child nodes.
-					ForceCloseNode(node.nodes[i]);
+					ForceCloseNode(child);
 					close = true;
 					break;
 				}
 			}
 		}
-		// Check children to see if they should close.
-		CloseNodeChildren(node.nodes[i]);
 	}
 
 	return close;
@@ -395,7 +496,9 @@ bool CompleteParser::CloseNodeChildren(Node& node)
 
 bool CompleteParser::CloseNodeIfChildTerminal(Node& node)
 {
-	if(!(m_variables->IsTokenInternalType(node.type) && node.nodes.size() <= 1))
+	// Reserved tokens have the same symbol as their TOKENS index.
+	bool reserved = node.type >= 0 && node.type < RESERVED_COUNT;
+	if(!(reserved && node.nodes.size() <= 1))
 		return false;
 
 	for(unsigned int i = 0; i < node.nodes.size(); i++)
@@ -409,27 +512,19 @@ bool CompleteParser::CloseNodeIfChildTerminal(Node& node)
 	return true;
 }
 
-void CompleteParser::ForceCloseNode(Node& node)
+void CompleteParser::ForceCloseNode(int node)
 {
-	node.closed = true;
-	for(unsigned int i = 0; i < node.nodes.size(); i++)
+	m_tree.Get(node).closed = true;
+	for(unsigned int i = 0; i < m_tree.GetChildCount(node); i++)
 	{
-		ForceCloseNode(node.nodes[i]);
+		ForceCloseNode(m_tree.GetChild(node, i));
 	}
 }
 
-bool CompleteParser::IsTokenFollow(string& nonTerminal, string& token)
+bool CompleteParser::IsTokenFollow(int nonTerminal, int token)
 {
 	if(!IsTokenNonTerminal(nonTerminal))
 		return false;
 
-	for(list<string>::iterator tokenIt = m_followSets[nonTerminal].begin(); tokenIt != m_followSets[nonTerminal].end(); tokenIt++)
-	{
-		if(*tokenIt == token)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return m_followSets[nonTerminal].Contains(token);
 }
\ No newline at end of file
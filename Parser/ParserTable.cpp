@@ -0,0 +1,256 @@
+#include "CompleteParser.h"
+
+/*
+	The predictive engine keeps the symbols still expected by the parse on
+	m_parseStack. Each token either matches the terminal on top, or selects
+	the ruleset of the non-terminal on top through m_parseTable. A token is
+	never looked at twice, so a line is parsed in time linear to its length.
+	Nodes are only added once their symbol is reached, which keeps pointers to
+	the nodes on the stack valid while the tree grows.
+*/
+
+void CompleteParser::SetParseEngine(int engine)
+{
+	m_parseEngine = engine;
+}
+
+int CompleteParser::GetParseEngine()
+{
+	if(m_parseEngine == PARSE_ENGINE_GENERATED && m_generatedParser)
+		return PARSE_ENGINE_GENERATED;
+
+	if(m_parseEngine == PARSE_ENGINE_LALR)
+	{
+		// The table is only built for grammars which use it.
+		if(!m_lalrBuilt && m_lexer.IsInitialized())
+			BuildLALRTable();
+		if(!m_lalrActions.empty())
+			return PARSE_ENGINE_LALR;
+	}
+
+	return (m_parseEngine != PARSE_ENGINE_MATCH && m_isLL1) ? PARSE_ENGINE_LL1 : PARSE_ENGINE_MATCH;
+}
+
+__declspec(dllexport) string CompleteParser::GetParseConflicts()
+{
+	string conflicts;
+	for(list<string>::iterator it = m_parseConflicts.begin(); it != m_parseConflicts.end(); it++)
+	{
+		conflicts.append(*it).append("\n");
+	}
+
+	return conflicts;
+}
+
+int CompleteParser::GetParseTableColumn(int symbol)
+{
+	// The EOF symbol is not a token and has a column of its own.
+	if(symbol == SYMBOL_EOF)
+		return PARSE_TABLE_EOF;
+
+	return m_symbols.GetTokenID(symbol);
+}
+
+void CompleteParser::AddParseTableEntry(int nonTerminal, int column, int ruleSet)
+{
+	int& cell = m_parseTable[nonTerminal][column];
+
+	if(cell == PARSE_TABLE_NONE || cell == ruleSet)
+	{
+		cell = ruleSet;
+		return;
+	}
+
+	stringstream ss;
+	ss << m_symbols.GetName(nonTerminal) << ": rulesets " << cell << " and " << ruleSet << " both start with ";
+	if(column == PARSE_TABLE_EOF)
+		ss << m_symbols.GetName(SYMBOL_EOF);
+	else
+		ss << TOKENS[column];
+	m_parseConflicts.push_back(ss.str());
+
+	m_isLL1 = false;
+}
+
+void CompleteParser::GetRuleSetColumns(int key, int ruleSet, SymbolSet& columns)
+{
+	// Add the first set of the ruleset. Nullable symbols let the next symbol start it too.
+	bool allNullable = true;
+	for(vector<int>::iterator rule = m_rules[key][ruleSet].begin(); rule != m_rules[key][ruleSet].end() && allNullable; rule++)
+	{
+		if(IsTokenNonTerminal(*rule))
+		{
+			const vector<int>& firstSet = m_firstSets[*rule].GetSymbols();
+			for(vector<int>::const_iterator first = firstSet.begin(); first != firstSet.end(); first++)
+			{
+				if(*first != SYMBOL_EPSILON)
+					columns.Add(GetParseTableColumn(*first));
+			}
+		}
+		else if(*rule != SYMBOL_EPSILON)
+		{
+			columns.Add(GetParseTableColumn(*rule));
+		}
+
+		allNullable = m_nullable[*rule];
+	}
+
+	// A ruleset which can derive nothing is chosen by whatever follows the key.
+	if(allNullable)
+	{
+		const vector<int>& followSet = m_followSets[key].GetSymbols();
+		for(vector<int>::const_iterator follow = followSet.begin(); follow != followSet.end(); follow++)
+		{
+			columns.Add(GetParseTableColumn(*follow));
+		}
+	}
+}
+
+void CompleteParser::BuildParseTable()
+{
+	m_parseTable.clear();
+	m_parseConflicts.clear();
+	m_parseStack.clear();
+	m_isLL1 = false;
+
+	if(m_ruleKeys.empty())
+		return;
+
+	int symbolCount = m_symbols.GetCount();
+
+	m_isLL1 = true;
+	m_parseTable.resize(symbolCount, vector<int>(PARSE_TABLE_EOF + 1, PARSE_TABLE_NONE));
+
+	for(vector<int>::iterator key = m_ruleKeys.begin(); key != m_ruleKeys.end(); key++)
+	{
+		for(unsigned int i = 0; i < m_rules[*key].size(); i++)
+		{
+			// Collect the columns first. Terminals sharing a token ID would otherwise set the same cell twice.
+			SymbolSet columns;
+			GetRuleSetColumns(*key, i, columns);
+
+			for(vector<int>::const_iterator column = columns.GetSymbols().begin(); column != columns.GetSymbols().end(); column++)
+			{
+				AddParseTableEntry(*key, *column, i);
+			}
+		}
+	}
+
+	if(PRINT_CONFLICTS && !m_isLL1)
+		printf("%s", GetParseConflicts().c_str());
+}
+
+int CompleteParser::ParseLine(list<LineToken>& line)
+{
+	switch(GetParseEngine())
+	{
+	case PARSE_ENGINE_GENERATED:
+		return EvaluateLineGenerated(line);
+	case PARSE_ENGINE_LL1:
+		return EvaluateLinePredictive(line);
+	case PARSE_ENGINE_LALR:
+		return EvaluateLineLALR(line);
+	}
+
+	return EvaluateLine(line);
+}
+
+void CompleteParser::EndCompletedNodes()
+{
+	while(!m_parseStack.empty())
+	{
+		ParseStackEntry& top = m_parseStack.back();
+
+		if(top.symbol == SYMBOL_NONE)
+		{
+			top.node->complete = NODE_IS_COMPLETE;
+			top.node->closed = true;
+		}
+		// The EOF of the start rule is never a token. Once it is on top the program is complete, and the empty
+		// stack rejects any token after it.
+		else if(top.symbol != SYMBOL_EPSILON && top.symbol != SYMBOL_EOF)
+			break;
+
+		m_parseStack.pop_back();
+	}
+}
+
+int CompleteParser::EvaluateLinePredictive(list<LineToken>& line)
+{
+	// Start a new parse tree below the base node.
+	if(m_parseStack.empty() && m_nodes.nodes.empty())
+	{
+		ParseStackEntry start;
+		start.symbol	= *m_nonTerminals.begin();
+		start.node		= &m_nodes;
+		m_parseStack.push_back(start);
+	}
+
+	for(list<LineToken>::iterator token = line.begin(); token != line.end(); token++)
+	{
+		bool matched = false;
+
+		while(!matched)
+		{
+			EndCompletedNodes();
+
+			// Nothing more is expected, the whole program was already parsed.
+			if(m_parseStack.empty())
+				return TOKEN_ERR_SYNTAX;
+
+			ParseStackEntry top = m_parseStack.back();
+			m_parseStack.pop_back();
+
+			if(IsTokenTerminal(top.symbol))
+			{
+				if(m_symbols.GetTokenID(top.symbol) != token->tokenID)
+					return TOKEN_ERR_SYNTAX;
+
+				// Add the terminal node to its parent.
+				Node newNodeT;
+				newNodeT.type		= top.symbol;
+				newNodeT.closed		= true;
+				newNodeT.complete	= NODE_IS_COMPLETE;
+				newNodeT.value		= token->value;
+				newNodeT.lineNumber	= GetCurrentLineNumber();
+				top.node->nodes.push_back(newNodeT);
+
+				matched = true;
+			}
+			else
+			{
+				int ruleSet = PARSE_TABLE_NONE;
+				if(top.symbol < (int)m_parseTable.size())
+					ruleSet = m_parseTable[top.symbol][token->tokenID];
+				if(ruleSet == PARSE_TABLE_NONE)
+					return TOKEN_ERR_SYNTAX;
+
+				Node newNode;
+				newNode.type		= top.symbol;
+				newNode.lineNumber	= GetCurrentLineNumber();
+				top.node->nodes.push_back(newNode);
+				Node* node = &top.node->nodes.back();
+
+				// The end marker is below the rule so the node completes once its symbols are matched.
+				ParseStackEntry end;
+				end.symbol	= SYMBOL_NONE;
+				end.node	= node;
+				m_parseStack.push_back(end);
+
+				vector<int>& rule = m_rules[top.symbol][ruleSet];
+				for(vector<int>::reverse_iterator it = rule.rbegin(); it != rule.rend(); it++)
+				{
+					ParseStackEntry entry;
+					entry.symbol	= *it;
+					entry.node		= node;
+					m_parseStack.push_back(entry);
+				}
+			}
+		}
+	}
+
+	// Close out anything the last token finished, such as the body of the program.
+	EndCompletedNodes();
+
+	return TOKEN_ERR_NONE;
+}
@@ -0,0 +1,1205 @@
+#include "SSAOptimizer.h"
+#include "ByteCode.h"
+
+// The first of the four parts of a key. Opcodes and relops are not negative.
+#define KEY_ELEMENT			-1				// An element of a version of an array, and the ident of its index.
+#define KEY_CONSTANT		-2				// The kind and the bits of a constant.
+#define KEY_CONSTANT_NUMBER	-3				// The bits of a constant read as a double.
+#define KEY_NUMBER			-4				// An operation calculated in doubles, whether the result is PRIM_REAL or not.
+
+#define KIND_ANY			-1				// A value which may have any VALUE_* kind.
+#define KIND_UNKNOWN		-2				// A phi whose kind is not found yet.
+
+#define BLOCK_ANY			-2				// Where the leaders of a variable read across blocks may be read.
+
+static bool IsTyped(int opcode)
+{
+	return (opcode == BYTECODE_INT || opcode == BYTECODE_TRUNCATE || opcode == BYTECODE_REAL || opcode == BYTECODE_NUMBER);
+}
+
+// The kind AssignTyped stores for the opcode.
+static int GetResultKind(int opcode)
+{
+	switch(opcode)
+	{
+	case BYTECODE_INT:
+	case BYTECODE_TRUNCATE:	return VALUE_INT;
+	case BYTECODE_REAL:		return VALUE_REAL;
+	default:				return VALUE_NUMBER;
+	}
+}
+
+// Opcodes which read their operands as doubles. The others may read the kind and the integer.
+static bool ReadsNumbers(int opcode)
+{
+	return (opcode == BYTECODE_TRUNCATE || opcode == BYTECODE_REAL || opcode == BYTECODE_NUMBER);
+}
+
+static bool IsTemporary(Variable* var)
+{
+	// AddTempVariable names them with a '#', which a program can not use.
+	return (var->name.compare(0, 5, "temp#") == 0);
+}
+
+SSAOptimizer::SSAOptimizer()
+{
+	m_controlFlow		= 0;
+	m_code				= 0;
+	m_slots				= 0;
+	m_types				= 0;
+	m_variables			= 0;
+	m_scalarCount		= 0;
+	m_varCount			= 0;
+	m_identCount		= 0;
+	m_passes			= SSA_PASS_ALL;
+	m_valueCount		= 0;
+	m_phiCount			= 0;
+	m_numberedCount		= 0;
+	m_hoistedCount		= 0;
+	m_eliminatedCount	= 0;
+}
+
+SSAOptimizer::~SSAOptimizer()
+{
+}
+
+void SSAOptimizer::Clear()
+{
+	m_accesses.clear();
+	m_values.clear();
+	m_stacks.clear();
+	m_phis.clear();
+	m_predecessors.clear();
+	m_edges.clear();
+	m_children.clear();
+	m_dominators.clear();
+	m_order.clear();
+	m_walk.clear();
+	m_varSlots.clear();
+	m_temporaries.clear();
+	m_globals.clear();
+	m_startKinds.clear();
+	m_exitValues.clear();
+	m_arrays.clear();
+	m_keys.clear();
+	m_leaders.clear();
+	m_nextLeaders.clear();
+	m_previousLeaders.clear();
+
+	m_controlFlow	= 0;
+	m_code			= 0;
+	m_slots			= 0;
+	m_types			= 0;
+	m_variables		= 0;
+}
+
+bool SSAOptimizer::Optimize(ControlFlow& controlFlow, vector<vector<Instruction> >& code, const vector<Slot>& slots, const vector<SlotType>& types,
+	Variables* variables)
+{
+	Clear();
+	m_valueCount		= 0;
+	m_phiCount			= 0;
+	m_numberedCount		= 0;
+	m_hoistedCount		= 0;
+	m_eliminatedCount	= 0;
+
+	if(m_passes == 0)
+		return false;
+
+	m_controlFlow	= &controlFlow;
+	m_code			= &code;
+	m_slots			= &slots;
+	m_types			= &types;
+	m_variables		= variables;
+
+	if(!Prepare(controlFlow))
+	{
+		Clear();
+		return false;
+	}
+
+	FindDominators();
+	PlacePhis();
+	Rename();
+	FindKinds();
+	NumberValues();
+	if(m_passes & SSA_PASS_LICM)
+		HoistInvariants();
+	if(m_passes & SSA_PASS_DSE)
+		EliminateDeadStores();
+	Lower();
+
+	m_valueCount = m_values.size();
+	Clear();
+
+	return true;
+}
+
+bool SSAOptimizer::Prepare(ControlFlow& controlFlow)
+{
+	const vector<Slot>& slots = *m_slots;
+	vector<vector<Instruction> >& code = *m_code;
+	int blockCount = controlFlow.GetBlockCount();
+	if(blockCount == 0 || (int)code.size() != blockCount)
+		return false;
+
+	// Every instruction is typed, so no value is read as text.
+	vector<bool> assigned(slots.size(), false);
+	for(int block = 0; block < blockCount; block++)
+	{
+		for(vector<Instruction>::iterator it = code[block].begin(); it != code[block].end(); it++)
+		{
+			if(!IsTyped(it->opcode) && it->opcode != BYTECODE_PRINT && it->opcode != BYTECODE_BRANCH)
+				return false;
+			if(IsTyped(it->opcode))
+				assigned[it->target] = true;
+		}
+	}
+
+	// The scalars are numbered by frame element and the arrays after them.
+	m_scalarCount = 0;
+	for(vector<Slot>::const_iterator it = slots.begin(); it != slots.end(); it++)
+	{
+		if(it->index)
+			return false;
+		m_scalarCount = max(m_scalarCount, max(it->frame, it->indexFrame) + 1);
+	}
+
+	m_varSlots.assign(m_scalarCount, -1);
+	m_temporaries.assign(m_scalarCount, false);
+	m_startKinds.assign(m_scalarCount, KIND_ANY);
+	m_varCount = m_scalarCount;
+	for(int slot = 0; slot < (int)slots.size(); slot++)
+	{
+		Variable* var = slots[slot].var;
+		if(slots[slot].frame == FRAME_NONE)
+		{
+			if(!m_arrays.count(var))
+				m_arrays[var] = m_varCount++;
+			continue;
+		}
+
+		int frame = slots[slot].frame;
+		m_varSlots[frame]		= slot;
+		m_temporaries[frame]	= IsTemporary(var);
+
+		// GetOrCreateVarAccess gives every constant a variable of its own, outside of Variables.
+		if(!assigned[slot] && var->name.compare(0, 9, "CONSTANT_") == 0 && var->value[0].kind != VALUE_STRING &&
+			m_variables->GetVariable(var->name) != var)
+			m_startKinds[frame] = var->value[0].kind;
+	}
+
+	m_predecessors.assign(blockCount, vector<int>());
+	m_edges.assign(blockCount, vector<int>(2, -1));
+	for(int block = 0; block < blockCount; block++)
+	{
+		const BasicBlock& basicBlock = controlFlow.GetBlock(block);
+		for(int i = 0; i < 2; i++)
+		{
+			int successor = basicBlock.successors[i];
+			if(successor < 0)
+				continue;
+
+			m_edges[block][i] = m_predecessors[successor].size();
+			m_predecessors[successor].push_back(block);
+		}
+	}
+
+	return true;
+}
+
+void SSAOptimizer::FindDominators()
+{
+	int blockCount = m_predecessors.size();
+
+	// Reverse post order from the block the program starts at.
+	vector<int> post;
+	vector<bool> visited(blockCount, false);
+	vector<pair<int, int> > stack;
+	stack.push_back(make_pair(0, 0));
+	visited[0] = true;
+	while(!stack.empty())
+	{
+		int block = stack.back().first;
+		int i = stack.back().second++;
+		if(i == 2)
+		{
+			post.push_back(block);
+			stack.pop_back();
+			continue;
+		}
+
+		int successor = m_controlFlow->GetBlock(block).successors[i];
+		if(successor >= 0 && !visited[successor])
+		{
+			visited[successor] = true;
+			stack.push_back(make_pair(successor, 0));
+		}
+	}
+	m_order.assign(post.rbegin(), post.rend());
+
+	vector<int> positions(blockCount, blockCount);
+	for(int i = 0; i < (int)m_order.size(); i++)
+		positions[m_order[i]] = i;
+
+	// Cooper, Harvey and Kennedy. Each dominator is found from those of the predecessors until none changes.
+	m_dominators.assign(blockCount, BLOCK_NONE);
+	m_dominators[0] = 0;
+	bool changed = true;
+	while(changed)
+	{
+		changed = false;
+		for(vector<int>::iterator it = m_order.begin() + 1; it != m_order.end(); it++)
+		{
+			int dominator = BLOCK_NONE;
+			for(vector<int>::iterator predecessor = m_predecessors[*it].begin(); predecessor != m_predecessors[*it].end(); predecessor++)
+			{
+				if(m_dominators[*predecessor] == BLOCK_NONE)
+					continue;
+				if(dominator == BLOCK_NONE)
+				{
+					dominator = *predecessor;
+					continue;
+				}
+
+				int other = *predecessor;
+				while(other != dominator)
+				{
+					while(positions[other] > positions[dominator])
+						other = m_dominators[other];
+					while(positions[dominator] > positions[other])
+						dominator = m_dominators[dominator];
+				}
+			}
+
+			if(m_dominators[*it] != dominator)
+			{
+				m_dominators[*it] = dominator;
+				changed = true;
+			}
+		}
+	}
+
+	m_children.assign(blockCount, vector<int>());
+	for(vector<int>::iterator it = m_order.begin() + 1; it != m_order.end(); it++)
+		m_children[m_dominators[*it]].push_back(*it);
+
+	// The walks keep their stacks here rather than recursing, as the tree is as deep as a program is long.
+	vector<int> pending(1, 0);
+	while(!pending.empty())
+	{
+		int block = pending.back();
+		pending.pop_back();
+		m_walk.push_back(block);
+		if(block < 0)
+			continue;
+
+		pending.push_back(~block);
+		pending.insert(pending.end(), m_children[block].rbegin(), m_children[block].rend());
+	}
+}
+
+void SSAOptimizer::PlacePhis()
+{
+	const vector<Slot>& slots = *m_slots;
+	vector<vector<Instruction> >& code = *m_code;
+	int blockCount = m_predecessors.size();
+
+	vector<vector<int> > frontiers(blockCount);
+	for(int block = 0; block < blockCount; block++)
+	{
+		if(m_predecessors[block].size() < 2 || m_dominators[block] == BLOCK_NONE)
+			continue;
+
+		for(vector<int>::iterator it = m_predecessors[block].begin(); it != m_predecessors[block].end(); it++)
+		{
+			for(int runner = *it; runner != m_dominators[block]; runner = m_dominators[runner])
+			{
+				if(frontiers[runner].empty() || frontiers[runner].back() != block)
+					frontiers[runner].push_back(block);
+			}
+		}
+	}
+
+	// Only variables read in a block before it assigns them need phis.
+	vector<vector<int> > definitions(m_varCount);
+	m_globals.assign(m_varCount, false);
+	vector<int> assigned(m_varCount, BLOCK_NONE);
+	for(int block = 0; block < blockCount; block++)
+	{
+		for(vector<Instruction>::iterator it = code[block].begin(); it != code[block].end(); it++)
+		{
+			int reads[2] = {it->op1, it->op2};
+			for(int i = 0; i < 2; i++)
+			{
+				if(reads[i] == SLOT_NONE)
+					continue;
+
+				const Slot& slot = slots[reads[i]];
+				int var = GetVar(reads[i]);
+				if(assigned[var] != block)
+					m_globals[var] = true;
+				if(slot.indexFrame != FRAME_NONE && assigned[slot.indexFrame] != block)
+					m_globals[slot.indexFrame] = true;
+			}
+
+			if(!IsTyped(it->opcode))
+				continue;
+
+			// An element assigned keeps the others of the version before.
+			const Slot& target = slots[it->target];
+			int var = GetVar(it->target);
+			if(target.frame == FRAME_NONE && assigned[var] != block)
+				m_globals[var] = true;
+			if(target.indexFrame != FRAME_NONE && assigned[target.indexFrame] != block)
+				m_globals[target.indexFrame] = true;
+
+			if(assigned[var] != block)
+				definitions[var].push_back(block);
+			assigned[var] = block;
+		}
+
+		// The variables are read when the program ends.
+		if(m_controlFlow->GetBlock(block).successors[0] == BLOCK_END)
+		{
+			for(int var = 0; var < m_scalarCount; var++)
+			{
+				if(!m_temporaries[var] && assigned[var] != block)
+					m_globals[var] = true;
+			}
+		}
+	}
+
+	m_phis.assign(blockCount, vector<int>());
+	vector<int> placed(blockCount, -1);
+	vector<int> queued(blockCount, -1);
+	for(int var = 0; var < m_varCount; var++)
+	{
+		if(!m_globals[var])
+			continue;
+
+		vector<int> work(definitions[var]);
+		for(vector<int>::iterator it = work.begin(); it != work.end(); it++)
+			queued[*it] = var;
+
+		while(!work.empty())
+		{
+			int block = work.back();
+			work.pop_back();
+			for(vector<int>::iterator it = frontiers[block].begin(); it != frontiers[block].end(); it++)
+			{
+				if(placed[*it] == var)
+					continue;
+
+				placed[*it] = var;
+				int phi = AddValue(var, *it, -1);
+				m_values[phi].arguments.assign(m_predecessors[*it].size(), -1);
+				m_phis[*it].push_back(phi);
+				m_phiCount++;
+
+				if(queued[*it] != var)
+				{
+					queued[*it] = var;
+					work.push_back(*it);
+				}
+			}
+		}
+	}
+}
+
+void SSAOptimizer::Rename()
+{
+	const vector<Slot>& slots = *m_slots;
+	vector<vector<Instruction> >& code = *m_code;
+	int blockCount = m_predecessors.size();
+
+	// The phis come first, so the starting value of each variable is the value with its number.
+	vector<SSAValue> phis;
+	phis.swap(m_values);
+	for(int var = 0; var < m_varCount; var++)
+		AddValue(var, BLOCK_NONE, -1);
+	for(int block = 0; block < blockCount; block++)
+	{
+		for(vector<int>::iterator it = m_phis[block].begin(); it != m_phis[block].end(); it++)
+		{
+			m_values.push_back(phis[*it]);
+			*it = m_values.size() - 1;
+		}
+	}
+
+	m_stacks.assign(m_varCount, vector<int>());
+	for(int var = 0; var < m_varCount; var++)
+		m_stacks[var].push_back(var);
+
+	m_accesses.assign(blockCount, vector<Access>());
+	vector<vector<int> > assigned(blockCount);	// The variables given a value in each block, to take back when it is left.
+	for(vector<int>::iterator walk = m_walk.begin(); walk != m_walk.end(); walk++)
+	{
+		if(*walk < 0)
+		{
+			vector<int>& vars = assigned[~*walk];
+			for(vector<int>::reverse_iterator it = vars.rbegin(); it != vars.rend(); it++)
+				m_stacks[*it].pop_back();
+			continue;
+		}
+
+		int block = *walk;
+		for(vector<int>::iterator it = m_phis[block].begin(); it != m_phis[block].end(); it++)
+		{
+			m_stacks[m_values[*it].var].push_back(*it);
+			assigned[block].push_back(m_values[*it].var);
+		}
+
+		m_accesses[block].resize(code[block].size());
+		for(int i = 0; i < (int)code[block].size(); i++)
+		{
+			Instruction& instruction = code[block][i];
+			Access& access = m_accesses[block][i];
+			access.values[0]	= -1;
+			access.values[1]	= (instruction.op1 != SLOT_NONE) ? Read(instruction.op1, block) : -1;
+			access.values[2]	= (instruction.op2 != SLOT_NONE) ? Read(instruction.op2, block) : -1;
+			access.index		= -1;
+			access.memory		= -1;
+			access.stored		= -1;
+			access.removed		= false;
+
+			if(!IsTyped(instruction.opcode))
+				continue;
+
+			const Slot& target = slots[instruction.target];
+			int var = GetVar(instruction.target);
+			int value = AddValue(var, block, i);
+			if(target.frame != FRAME_NONE)
+			{
+				access.values[0] = value;
+			}
+			else
+			{
+				if(target.indexFrame != FRAME_NONE)
+					access.index = m_stacks[target.indexFrame].back();
+				access.memory = m_stacks[var].back();
+				access.stored = value;
+			}
+			m_stacks[var].push_back(value);
+			assigned[block].push_back(var);
+		}
+
+		const BasicBlock& basicBlock = m_controlFlow->GetBlock(block);
+		if(basicBlock.successors[0] == BLOCK_END)
+		{
+			for(int var = 0; var < m_scalarCount; var++)
+			{
+				if(!m_temporaries[var])
+					m_exitValues.push_back(m_stacks[var].back());
+			}
+		}
+
+		for(int i = 0; i < 2; i++)
+		{
+			int successor = basicBlock.successors[i];
+			if(successor < 0)
+				continue;
+
+			for(vector<int>::iterator it = m_phis[successor].begin(); it != m_phis[successor].end(); it++)
+				m_values[*it].arguments[m_edges[block][i]] = m_stacks[m_values[*it].var].back();
+		}
+	}
+}
+
+void SSAOptimizer::FindKinds()
+{
+	vector<vector<Instruction> >& code = *m_code;
+
+	for(vector<SSAValue>::iterator it = m_values.begin(); it != m_values.end(); it++)
+	{
+		if(it->var < 0 || it->var >= m_scalarCount)
+			it->kind = KIND_ANY;
+		else if(it->block == BLOCK_NONE)
+			it->kind = m_startKinds[it->var];
+		else if(it->instruction < 0)
+			it->kind = KIND_UNKNOWN;
+		else
+			it->kind = GetResultKind(code[it->block][it->instruction].opcode);
+	}
+
+	// A phi has the kind of all its arguments. The kinds only go from unknown to known to any, so this ends.
+	bool changed = true;
+	while(changed)
+	{
+		changed = false;
+		for(vector<vector<int> >::iterator block = m_phis.begin(); block != m_phis.end(); block++)
+		{
+			for(vector<int>::iterator it = block->begin(); it != block->end(); it++)
+			{
+				SSAValue& phi = m_values[*it];
+				int kind = KIND_UNKNOWN;
+				for(vector<int>::iterator argument = phi.arguments.begin(); argument != phi.arguments.end(); argument++)
+				{
+					int other = (*argument >= 0) ? m_values[*argument].kind : KIND_ANY;
+					if(other == KIND_UNKNOWN)
+						continue;
+					kind = (kind == KIND_UNKNOWN || kind == other) ? other : KIND_ANY;
+				}
+
+				if(phi.kind != kind)
+				{
+					phi.kind = kind;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	for(vector<SSAValue>::iterator it = m_values.begin(); it != m_values.end(); it++)
+	{
+		if(it->kind == KIND_UNKNOWN)
+			it->kind = KIND_ANY;
+	}
+}
+
+void SSAOptimizer::NumberValues()
+{
+	const vector<Slot>& slots = *m_slots;
+	const vector<SlotType>& types = *m_types;
+	vector<vector<Instruction> >& code = *m_code;
+	bool substitute = (m_passes & SSA_PASS_GVN) != 0;
+
+	m_stacks.assign(m_varCount, vector<int>());
+	m_nextLeaders.assign(m_values.size() * 2, -1);
+	m_previousLeaders.assign(m_values.size() * 2, -1);
+	m_definedCount = 0;
+	for(int var = 0; var < m_varCount; var++)
+	{
+		SSAValue& value = m_values[var];
+		if(var < m_scalarCount && m_startKinds[var] != KIND_ANY)
+		{
+			Value& constant = slots[m_varSlots[var]].var->value[0];
+			long long bits = constant.integer;
+			double number = constant.ToNumber();
+			long long numberBits;
+			memcpy(&numberBits, &number, sizeof(numberBits));
+			value.ident		= GetKey(KEY_CONSTANT, constant.kind, (int)(bits >> 32), (int)bits);
+			value.number	= GetKey(KEY_CONSTANT_NUMBER, (int)(numberBits >> 32), (int)numberBits, 0);
+		}
+		else
+		{
+			value.ident		= m_identCount++;
+			value.number	= value.ident;
+		}
+		Define(var);
+	}
+
+	for(vector<int>::iterator walk = m_walk.begin(); walk != m_walk.end(); walk++)
+	{
+		if(*walk < 0)
+		{
+			int block = ~*walk;
+			for(vector<Access>::reverse_iterator it = m_accesses[block].rbegin(); it != m_accesses[block].rend(); it++)
+			{
+				if(it->values[0] >= 0)
+					Undefine(it->values[0]);
+			}
+			for(vector<int>::reverse_iterator it = m_phis[block].rbegin(); it != m_phis[block].rend(); it++)
+				Undefine(*it);
+			continue;
+		}
+
+		int block = *walk;
+		for(vector<int>::iterator it = m_phis[block].begin(); it != m_phis[block].end(); it++)
+		{
+			m_values[*it].ident		= m_identCount++;
+			m_values[*it].number	= m_values[*it].ident;
+			Define(*it);
+		}
+
+		for(int i = 0; i < (int)code[block].size(); i++)
+		{
+			Instruction& instruction = code[block][i];
+			Access& access = m_accesses[block][i];
+
+			for(int operand = 1; operand <= 2; operand++)
+			{
+				int read = access.values[operand];
+				if(read < 0)
+					continue;
+
+				// Elements are the same when the version of the array and the index are.
+				SSAValue& element = m_values[read];
+				if(element.var < 0)
+				{
+					element.ident	= GetKey(KEY_ELEMENT, element.memory, (element.index >= 0) ? m_values[element.index].ident : -1, 0);
+					element.number	= element.ident;
+				}
+
+				if(substitute)
+					Substitute(instruction, access, operand, block);
+			}
+
+			if(!IsTyped(instruction.opcode))
+				continue;
+
+			// The ident and number of the result.
+			int opcode = instruction.opcode;
+			int kind = GetResultKind(opcode);
+			bool numbers = ReadsNumbers(opcode);
+			SSAValue& op1 = m_values[access.values[1]];
+			int class1 = numbers ? op1.number : op1.ident;
+			int ident, number;
+			if(instruction.op == 0)
+			{
+				// A copy of a value which already has the kind stored is the same value.
+				bool same = (op1.kind == kind && opcode != BYTECODE_TRUNCATE);
+				ident	= same ? op1.ident : GetKey(opcode, 0, class1, -1);
+				number	= (same || opcode == BYTECODE_REAL || opcode == BYTECODE_NUMBER) ? op1.number : ident;
+			}
+			else
+			{
+				SSAValue& op2 = m_values[access.values[2]];
+				int class2 = numbers ? op2.number : op2.ident;
+				if((instruction.op == PLUS || instruction.op == MULT) && class1 > class2)
+					swap(class1, class2);
+
+				ident	= GetKey(opcode, instruction.op, class1, class2);
+				number	= (opcode == BYTECODE_REAL || opcode == BYTECODE_NUMBER) ? GetKey(KEY_NUMBER, instruction.op, class1, class2) : ident;
+			}
+
+			// A variable or an element given a value already held is copied from where it is held.
+			const Slot& target = slots[instruction.target];
+			bool calculated = (instruction.op != 0 || op1.var < 0);
+			if(substitute && calculated && (target.frame == FRAME_NONE || !m_temporaries[target.frame]))
+			{
+				int leader = FindLeader(-1, ident, false, types[target.type].kind, block);
+				if(leader >= 0)
+				{
+					instruction.op		= 0;
+					instruction.op1		= m_varSlots[m_values[leader].var];
+					instruction.op2		= SLOT_NONE;
+					access.values[1]	= leader;
+					access.values[2]	= -1;
+					m_numberedCount++;
+				}
+			}
+
+			if(access.values[0] < 0)
+				continue;
+
+			m_values[access.values[0]].ident	= ident;
+			m_values[access.values[0]].number	= number;
+			Define(access.values[0]);
+		}
+	}
+
+	m_stacks.clear();
+	m_leaders.clear();
+	m_nextLeaders.clear();
+	m_previousLeaders.clear();
+}
+
+void SSAOptimizer::HoistInvariants()
+{
+	vector<vector<Instruction> >& code = *m_code;
+	int blockCount = m_predecessors.size();
+
+	// Where each value is read. -1 stands for a phi or the end of the program, which are never inside a loop.
+	vector<vector<int> > uses(m_values.size());
+	vector<int> definitions(m_scalarCount, 0);
+	for(int block = 0; block < blockCount; block++)
+	{
+		for(int i = 0; i < (int)code[block].size(); i++)
+		{
+			Access& access = m_accesses[block][i];
+			for(int operand = 1; operand <= 2; operand++)
+			{
+				int read = access.values[operand];
+				if(read >= 0 && m_values[read].var < 0 && m_values[read].index >= 0)
+					uses[m_values[read].index].push_back(block);
+				else if(read >= 0)
+					uses[read].push_back(block);
+			}
+			if(access.index >= 0)
+				uses[access.index].push_back(block);
+			if(access.values[0] >= 0)
+				definitions[m_values[access.values[0]].var]++;
+		}
+
+		for(vector<int>::iterator phi = m_phis[block].begin(); phi != m_phis[block].end(); phi++)
+		{
+			for(vector<int>::iterator it = m_values[*phi].arguments.begin(); it != m_values[*phi].arguments.end(); it++)
+			{
+				if(*it >= 0)
+					uses[*it].push_back(-1);
+			}
+		}
+	}
+	for(vector<int>::iterator it = m_exitValues.begin(); it != m_exitValues.end(); it++)
+		uses[*it].push_back(-1);
+
+	// A block dominates the blocks entered after it and left before it on the walk.
+	vector<int> entered(blockCount, 0);
+	vector<int> left(blockCount, 0);
+	vector<int> positions(blockCount, 0);
+	for(int i = 0; i < (int)m_walk.size(); i++)
+	{
+		if(m_walk[i] >= 0)
+			entered[m_walk[i]] = i;
+		else
+			left[~m_walk[i]] = i;
+	}
+	for(int i = 0; i < (int)m_order.size(); i++)
+		positions[m_order[i]] = i;
+
+	// A block going back to a block dominating it closes a loop. Loops with the same header are one loop.
+	map<int, vector<int> > latches;
+	for(int block = 0; block < blockCount; block++)
+	{
+		for(int i = 0; i < 2; i++)
+		{
+			int header = m_controlFlow->GetBlock(block).successors[i];
+			if(header >= 0 && entered[header] <= entered[block] && left[block] <= left[header])
+				latches[header].push_back(block);
+		}
+	}
+
+	// The blocks of each loop, header first. Inner loops are done first, so an instruction moved out of one may be moved out of the loop around it.
+	vector<vector<int> > loops;
+	vector<pair<int, int> > sizes;
+	vector<int> loopDefinitions(m_scalarCount, 0);	// The assignments of each scalar kept inside the loop being done.
+	vector<int> inside(blockCount, -1);				// The last loop found holding each block.
+	for(map<int, vector<int> >::iterator it = latches.begin(); it != latches.end(); it++)
+	{
+		int loop = loops.size();
+		loops.push_back(vector<int>(1, it->first));
+		inside[it->first] = loop;
+		vector<int> work(it->second);
+		while(!work.empty())
+		{
+			int block = work.back();
+			work.pop_back();
+			if(inside[block] == loop)
+				continue;
+
+			inside[block] = loop;
+			loops[loop].push_back(block);
+			work.insert(work.end(), m_predecessors[block].begin(), m_predecessors[block].end());
+		}
+		sizes.push_back(make_pair(loops[loop].size(), loop));
+	}
+	sort(sizes.begin(), sizes.end());
+
+	for(vector<pair<int, int> >::iterator size = sizes.begin(); size != sizes.end(); size++)
+	{
+		int loop = size->second;
+		vector<int>& blocks = loops[loop];
+		int header = blocks[0];
+		for(vector<int>::iterator it = blocks.begin(); it != blocks.end(); it++)
+			inside[*it] = loop;
+
+		// The instructions go at the end of the only block entering the loop, which must go nowhere else.
+		int preheader = BLOCK_NONE;
+		for(vector<int>::iterator it = m_predecessors[header].begin(); it != m_predecessors[header].end(); it++)
+		{
+			if(inside[*it] == loop || *it == preheader)
+				continue;
+			if(preheader != BLOCK_NONE)
+			{
+				preheader = BLOCK_NONE;
+				break;
+			}
+			preheader = *it;
+		}
+		if(preheader == BLOCK_NONE || m_controlFlow->GetBlock(preheader).successors[1] != BLOCK_NONE)
+			continue;
+
+		// In reverse post order, so a temporary is moved before the instructions reading it.
+		vector<pair<int, int> > ordered;
+		for(vector<int>::iterator it = blocks.begin(); it != blocks.end(); it++)
+			ordered.push_back(make_pair(positions[*it], *it));
+		sort(ordered.begin(), ordered.end());
+
+		vector<int> assigned;
+		for(vector<int>::iterator it = blocks.begin(); it != blocks.end(); it++)
+		{
+			for(vector<Access>::iterator access = m_accesses[*it].begin(); access != m_accesses[*it].end(); access++)
+			{
+				if(access->removed || access->values[0] < 0)
+					continue;
+
+				int var = m_values[access->values[0]].var;
+				if(!loopDefinitions[var]++)
+					assigned.push_back(var);
+			}
+		}
+
+		for(vector<pair<int, int> >::iterator it = ordered.begin(); it != ordered.end(); it++)
+		{
+			int block = it->second;
+			for(int i = 0; i < (int)code[block].size(); i++)
+			{
+				Instruction instruction = code[block][i];
+				Access access = m_accesses[block][i];
+				if(access.removed || access.values[0] < 0)
+					continue;
+
+				// A temporary assigned once inside the loop, from scalars given their values before the loop, and only
+				// read inside it. A temporary only read in the blocks assigning it may be assigned outside the loop too.
+				int var = m_values[access.values[0]].var;
+				if(!m_temporaries[var] || loopDefinitions[var] != 1 || (definitions[var] != 1 && m_globals[var]))
+					continue;
+
+				bool invariant = true;
+				for(int operand = 1; operand <= 2 && invariant; operand++)
+				{
+					int read = access.values[operand];
+					if(read < 0)
+						continue;
+
+					int defined = m_values[read].block;
+					invariant = (m_values[read].var >= 0 && (defined == BLOCK_NONE || inside[defined] != loop));
+				}
+
+				vector<int>& reads = uses[access.values[0]];
+				for(vector<int>::iterator use = reads.begin(); use != reads.end() && invariant; use++)
+					invariant = (*use >= 0 && inside[*use] == loop);
+				if(!invariant)
+					continue;
+
+				m_accesses[block][i].removed = true;
+				code[preheader].push_back(instruction);
+				m_accesses[preheader].push_back(access);
+				m_values[access.values[0]].block		= preheader;
+				m_values[access.values[0]].instruction	= code[preheader].size() - 1;
+				for(int operand = 1; operand <= 2; operand++)
+				{
+					// Only a temporary may be moved after it.
+					int read = access.values[operand];
+					if(read < 0 || !m_temporaries[m_values[read].var])
+						continue;
+
+					vector<int>::iterator use = find(uses[read].begin(), uses[read].end(), block);
+					if(use != uses[read].end())
+						*use = preheader;
+				}
+				m_hoistedCount++;
+			}
+		}
+
+		for(vector<int>::iterator it = assigned.begin(); it != assigned.end(); it++)
+			loopDefinitions[*it] = 0;
+	}
+}
+
+void SSAOptimizer::EliminateDeadStores()
+{
+	vector<vector<Instruction> >& code = *m_code;
+	int blockCount = m_predecessors.size();
+
+	CountUses();
+
+	// An element assigned again in the same block, with nothing reading the array between. The block is walked
+	// backwards, keeping the elements of each array assigned further on since the array was last read.
+	for(int block = 0; block < blockCount; block++)
+	{
+		map<int, set<pair<int, int> > > assigned;
+		for(int i = (int)code[block].size() - 1; i >= 0; i--)
+		{
+			Access& access = m_accesses[block][i];
+			Instruction& instruction = code[block][i];
+			if(access.removed)
+				continue;
+
+			if(access.stored >= 0)
+			{
+				set<pair<int, int> >& elements = assigned[GetVar(instruction.target)];
+				pair<int, int> element(instruction.target, access.index);
+				bool readsElement = (access.values[1] >= 0 && m_values[access.values[1]].var < 0) ||
+					(access.values[2] >= 0 && m_values[access.values[2]].var < 0);
+				if(!readsElement && elements.count(element))
+				{
+					access.removed = true;
+					Use(access.values[1], -1);
+					Use(access.values[2], -1);
+					Use(access.index, -1);
+					m_eliminatedCount++;
+				}
+				elements.insert(element);
+			}
+
+			// The assignments before this one are read by it, even when it is removed.
+			if(instruction.op1 != SLOT_NONE)
+				assigned.erase(GetVar(instruction.op1));
+			if(instruction.op2 != SLOT_NONE)
+				assigned.erase(GetVar(instruction.op2));
+		}
+	}
+
+	// A scalar nothing reads. Reading an element beyond the end of an array adds it, so those reads stay.
+	vector<pair<int, int> > work;
+	for(int block = 0; block < blockCount; block++)
+	{
+		for(int i = 0; i < (int)code[block].size(); i++)
+			work.push_back(make_pair(block, i));
+	}
+
+	while(!work.empty())
+	{
+		Access& access = m_accesses[work.back().first][work.back().second];
+		work.pop_back();
+		if(access.removed || access.values[0] < 0 || m_values[access.values[0]].uses != 0)
+			continue;
+		if((access.values[1] >= 0 && m_values[access.values[1]].var < 0) || (access.values[2] >= 0 && m_values[access.values[2]].var < 0))
+			continue;
+
+		access.removed = true;
+		m_eliminatedCount++;
+		for(int operand = 1; operand <= 2; operand++)
+		{
+			int read = access.values[operand];
+			if(read < 0)
+				continue;
+
+			Use(read, -1);
+			SSAValue& value = m_values[read];
+			if(value.uses == 0 && value.block >= 0 && value.instruction >= 0)
+				work.push_back(make_pair(value.block, value.instruction));
+		}
+	}
+
+}
+
+void SSAOptimizer::CountUses()
+{
+	vector<vector<Instruction> >& code = *m_code;
+
+	for(vector<SSAValue>::iterator it = m_values.begin(); it != m_values.end(); it++)
+		it->uses = 0;
+
+	for(int block = 0; block < (int)code.size(); block++)
+	{
+		for(vector<Access>::iterator it = m_accesses[block].begin(); it != m_accesses[block].end(); it++)
+		{
+			if(it->removed)
+				continue;
+
+			Use(it->values[1], 1);
+			Use(it->values[2], 1);
+			Use(it->index, 1);
+			Use(it->memory, 1);
+		}
+
+		for(vector<int>::iterator phi = m_phis[block].begin(); phi != m_phis[block].end(); phi++)
+		{
+			for(vector<int>::iterator it = m_values[*phi].arguments.begin(); it != m_values[*phi].arguments.end(); it++)
+				Use(*it, 1);
+		}
+	}
+
+	for(vector<int>::iterator it = m_exitValues.begin(); it != m_exitValues.end(); it++)
+		Use(*it, 1);
+}
+
+void SSAOptimizer::Use(int value, int count)
+{
+	if(value < 0)
+		return;
+
+	SSAValue& used = m_values[value];
+	if(used.var >= 0)
+	{
+		used.uses += count;
+		return;
+	}
+
+	if(used.index >= 0)
+		m_values[used.index].uses += count;
+	m_values[used.memory].uses += count;
+}
+
+void SSAOptimizer::Lower()
+{
+	vector<vector<Instruction> >& code = *m_code;
+
+	for(int block = 0; block < (int)code.size(); block++)
+	{
+		vector<Instruction> kept;
+		for(int i = 0; i < (int)code[block].size(); i++)
+		{
+			if(!m_accesses[block][i].removed)
+				kept.push_back(code[block][i]);
+		}
+		code[block].swap(kept);
+	}
+}
+
+int SSAOptimizer::AddValue(int var, int block, int instruction)
+{
+	SSAValue value;
+	value.var			= var;
+	value.block			= block;
+	value.instruction	= instruction;
+	value.kind			= KIND_ANY;
+	value.ident			= -1;
+	value.number		= -1;
+	value.uses			= 0;
+	value.index			= -1;
+	value.memory		= -1;
+	value.defined		= -1;
+	m_values.push_back(value);
+
+	return m_values.size() - 1;
+}
+
+int SSAOptimizer::Read(int slot, int block)
+{
+	const Slot& read = (*m_slots)[slot];
+	if(read.frame != FRAME_NONE)
+		return m_stacks[read.frame].back();
+
+	int element = AddValue(-1, block, -1);
+	if(read.indexFrame != FRAME_NONE)
+		m_values[element].index = m_stacks[read.indexFrame].back();
+	m_values[element].memory = m_stacks[GetVar(slot)].back();
+
+	return element;
+}
+
+int SSAOptimizer::GetVar(int slot)
+{
+	const Slot& read = (*m_slots)[slot];
+	if(read.frame != FRAME_NONE)
+		return read.frame;
+
+	return m_arrays[read.var];
+}
+
+int SSAOptimizer::GetKey(int a, int b, int c, int d)
+{
+	pair<pair<int, int>, pair<int, int> > key(make_pair(a, b), make_pair(c, d));
+	map<pair<pair<int, int>, pair<int, int> >, int>::iterator it = m_keys.find(key);
+	if(it != m_keys.end())
+		return it->second;
+
+	m_keys[key] = m_identCount;
+	return m_identCount++;
+}
+
+void SSAOptimizer::Substitute(Instruction& instruction, Access& access, int operand, int block)
+{
+	int& slot = (operand == 1) ? instruction.op1 : instruction.op2;
+	int read = access.values[operand];
+	if(read < m_scalarCount && m_startKinds[read] != KIND_ANY)
+		return;
+
+	// Operations in doubles only read the number. Integer operations, branches and prints read the value itself.
+	bool number = ReadsNumbers(instruction.opcode);
+	int cls = number ? m_values[read].number : m_values[read].ident;
+	int leader = FindLeader(read, cls, number, (*m_types)[(*m_slots)[slot].type].kind, block);
+	if(leader < 0)
+		return;
+
+	slot					= m_varSlots[m_values[leader].var];
+	access.values[operand]	= leader;
+	m_numberedCount++;
+}
+
+int SSAOptimizer::FindLeader(int value, int cls, bool number, int kind, int block)
+{
+	// Only the values still held are listed, so the first of a list is the leader. A variable only read where it is
+	// assigned may be given other values on the way to another block, so its values are listed by their block.
+	int leader = -1;
+	for(int local = 0; local < 2; local++)
+	{
+		unordered_map<long long, LeaderList>::iterator leaders = m_leaders.find(GetLeaderKey(cls, number, kind, local ? block : BLOCK_ANY));
+		if(leaders == m_leaders.end() || leaders->second.first < 0)
+			continue;
+
+		int first = leaders->second.first / 2;
+		if(leader < 0 || m_values[first].defined < m_values[leader].defined)
+			leader = first;
+	}
+
+	if(leader < 0 || (value >= 0 && m_values[value].defined >= 0 && m_values[value].defined <= m_values[leader].defined))
+		return -1;
+
+	return leader;
+}
+
+long long SSAOptimizer::GetLeaderKey(int cls, bool number, int kind, int block)
+{
+	return ((long long)(cls * 2 + (number ? 1 : 0)) << 32) | ((long long)(kind & 0xFF) << 24) | ((block - BLOCK_ANY) & 0xFFFFFF);
+}
+
+SSAOptimizer::LeaderList& SSAOptimizer::GetLeaders(int value, bool number)
+{
+	SSAValue& defined = m_values[value];
+	int var = defined.var;
+	int kind = (*m_types)[(*m_slots)[m_varSlots[var]].type].kind;
+
+	return m_leaders[GetLeaderKey(number ? defined.number : defined.ident, number, kind, m_globals[var] ? BLOCK_ANY : defined.block)];
+}
+
+void SSAOptimizer::Link(int value, bool number)
+{
+	// Between the values it was taken from, which are next to each other again.
+	LeaderList& leaders = GetLeaders(value, number);
+	int node = value * 2 + (number ? 1 : 0);
+	int previous = m_previousLeaders[node];
+	int next = m_nextLeaders[node];
+
+	((previous >= 0) ? m_nextLeaders[previous] : leaders.first) = node;
+	((next >= 0) ? m_previousLeaders[next] : leaders.last) = node;
+}
+
+void SSAOptimizer::Unlink(int value, bool number)
+{
+	// The value keeps its neighbours, for Link.
+	LeaderList& leaders = GetLeaders(value, number);
+	int node = value * 2 + (number ? 1 : 0);
+	int previous = m_previousLeaders[node];
+	int next = m_nextLeaders[node];
+
+	((previous >= 0) ? m_nextLeaders[previous] : leaders.first) = next;
+	((next >= 0) ? m_previousLeaders[next] : leaders.last) = previous;
+}
+
+void SSAOptimizer::Define(int value)
+{
+	SSAValue& defined = m_values[value];
+	int var = defined.var;
+	int replaced = m_stacks[var].empty() ? -1 : m_stacks[var].back();
+	m_stacks[var].push_back(value);
+	if(var >= m_scalarCount || m_varSlots[var] < 0)
+		return;
+
+	// The value replaced is not held again until value is undefined.
+	if(replaced >= 0)
+	{
+		Unlink(replaced, false);
+		Unlink(replaced, true);
+	}
+
+	defined.defined = m_definedCount++;
+	for(int number = 0; number < 2; number++)
+	{
+		int node = value * 2 + number;
+		m_previousLeaders[node]	= GetLeaders(value, number != 0).last;
+		m_nextLeaders[node]		= -1;
+		Link(value, number != 0);
+	}
+}
+
+void SSAOptimizer::Undefine(int value)
+{
+	int var = m_values[value].var;
+	m_stacks[var].pop_back();
+	if(var >= m_scalarCount || m_varSlots[var] < 0)
+		return;
+
+	// In the reverse order of Define, which leaves each list as it was before.
+	Unlink(value, true);
+	Unlink(value, false);
+	if(!m_stacks[var].empty())
+	{
+		Link(m_stacks[var].back(), true);
+		Link(m_stacks[var].back(), false);
+	}
+}
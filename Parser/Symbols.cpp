@@ -0,0 +1,226 @@
+#include "Symbols.h"
+
+// Names of the fixed symbols following TOKENS. Must match the SYMBOL_* order.
+static const char *FIXED_SYMBOLS[] =
+{
+	"$",
+	"program",
+	"body",
+	"type_decl_section",
+	"type_decl",
+	"var_decl_section",
+	"var_decl",
+	"assign_stmt",
+	"while_stmt",
+	"if_stmt",
+	"else_stmt",
+	"print_stmt",
+	"repeat_stmt",
+	"function_stmt",
+	"condition",
+	"array"
+};
+
+const int FIXED_SYMBOL_COUNT = sizeof(FIXED_SYMBOLS)/sizeof(FIXED_SYMBOLS[0]);
+
+SymbolTable::SymbolTable()
+{
+	Clear();
+}
+
+SymbolTable::~SymbolTable()
+{
+}
+
+void SymbolTable::Clear()
+{
+	m_ids.clear();
+	m_names.clear();
+	m_flags.clear();
+	m_tokenIDs.clear();
+
+	// A name listed twice in TOKENS keeps its first index, the same as a search through TOKENS.
+	for(int i = 0; i < RESERVED_COUNT; i++)
+	{
+		string name(TOKENS[i]);
+		unordered_map<string, int>::iterator it = m_ids.find(name);
+		int tokenID = (it == m_ids.end()) ? i : it->second;
+		if(it == m_ids.end())
+			m_ids[name] = i;
+
+		m_names.push_back(name);
+		m_flags.push_back(0);
+		m_tokenIDs.push_back(tokenID);
+	}
+
+	for(int i = 0; i < FIXED_SYMBOL_COUNT; i++)
+		Intern(FIXED_SYMBOLS[i]);
+}
+
+int SymbolTable::Intern(const string& name, int tokenID)
+{
+	unordered_map<string, int>::iterator it = m_ids.find(name);
+	if(it != m_ids.end())
+		return it->second;
+
+	int symbol = (int)m_names.size();
+	m_ids[name] = symbol;
+	m_names.push_back(name);
+	m_flags.push_back(0);
+	m_tokenIDs.push_back(tokenID);
+
+	return symbol;
+}
+
+int SymbolTable::Find(const string& name)
+{
+	unordered_map<string, int>::iterator it = m_ids.find(name);
+	if(it == m_ids.end())
+		return SYMBOL_NONE;
+
+	return it->second;
+}
+
+void SymbolTable::GetNameRanks(vector<int>& ranksOut)
+{
+	vector<int> sorted(m_names.size());
+	for(unsigned int i = 0; i < sorted.size(); i++)
+		sorted[i] = i;
+	stable_sort(sorted.begin(), sorted.end(), SymbolNameCompare(this));
+
+	ranksOut.resize(sorted.size());
+	for(unsigned int i = 0; i < sorted.size(); i++)
+		ranksOut[sorted[i]] = i;
+}
+
+const string& SymbolTable::GetName(int symbol)
+{
+	static const string noName;
+
+	if(symbol < 0 || symbol >= (int)m_names.size())
+		return noName;
+
+	return m_names[symbol];
+}
+
+int SymbolTable::GetCount()
+{
+	return (int)m_names.size();
+}
+
+void SymbolTable::AddFlags(int symbol, int flags)
+{
+	if(symbol >= 0 && symbol < (int)m_flags.size())
+		m_flags[symbol] |= flags;
+}
+
+int SymbolTable::GetFlags(int symbol)
+{
+	if(symbol < 0 || symbol >= (int)m_flags.size())
+		return 0;
+
+	return m_flags[symbol];
+}
+
+bool SymbolTable::IsTerminal(int symbol)
+{
+	return symbol >= 0 && symbol < (int)m_flags.size() && (m_flags[symbol] & SYMBOL_TERMINAL);
+}
+
+bool SymbolTable::IsNonTerminal(int symbol)
+{
+	return symbol >= 0 && symbol < (int)m_flags.size() && (m_flags[symbol] & SYMBOL_NONTERMINAL);
+}
+
+int SymbolTable::GetTokenID(int symbol)
+{
+	if(symbol < 0 || symbol >= (int)m_tokenIDs.size())
+		return ID;
+
+	return m_tokenIDs[symbol];
+}
+
+#define SYMBOL_SET_BITS		32
+
+SymbolSet::SymbolSet()
+{
+}
+
+SymbolSet::~SymbolSet()
+{
+}
+
+void SymbolSet::Clear()
+{
+	m_bits.clear();
+	m_symbols.clear();
+}
+
+bool SymbolSet::Add(int symbol)
+{
+	if(symbol < 0)
+		return false;
+
+	unsigned int word = symbol / SYMBOL_SET_BITS;
+	unsigned int bit = 1u << (symbol % SYMBOL_SET_BITS);
+
+	if(word >= m_bits.size())
+		m_bits.resize(word + 1, 0);
+	else if(m_bits[word] & bit)
+		return false;
+
+	m_bits[word] |= bit;
+	m_symbols.push_back(symbol);
+
+	return true;
+}
+
+bool SymbolSet::Contains(int symbol) const
+{
+	if(symbol < 0)
+		return false;
+
+	unsigned int word = symbol / SYMBOL_SET_BITS;
+	if(word >= m_bits.size())
+		return false;
+
+	return (m_bits[word] & (1u << (symbol % SYMBOL_SET_BITS))) != 0;
+}
+
+bool SymbolSet::Merge(const SymbolSet& other, int exclude)
+{
+	if(other.m_bits.size() > m_bits.size())
+		m_bits.resize(other.m_bits.size(), 0);
+
+	int added = 0;
+	for(unsigned int word = 0; word < other.m_bits.size(); word++)
+	{
+		unsigned int bits = other.m_bits[word] & ~m_bits[word];
+		if(exclude >= 0 && (unsigned int)exclude / SYMBOL_SET_BITS == word)
+			bits &= ~(1u << (exclude % SYMBOL_SET_BITS));
+		if(!bits)
+			continue;
+
+		m_bits[word] |= bits;
+		for(int bit = 0; bit < SYMBOL_SET_BITS; bit++)
+		{
+			if(bits & (1u << bit))
+			{
+				m_symbols.push_back(word * SYMBOL_SET_BITS + bit);
+				added++;
+			}
+		}
+	}
+
+	return added > 0;
+}
+
+const vector<int>& SymbolSet::GetSymbols() const
+{
+	return m_symbols;
+}
+
+int SymbolSet::GetSize() const
+{
+	return (int)m_symbols.size();
+}
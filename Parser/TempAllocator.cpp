@@ -0,0 +1,409 @@
+#include "TempAllocator.h"
+#include <deque>
+
+TempAllocator::TempAllocator()
+{
+	m_variables			= 0;
+	m_program			= 0;
+	m_block				= BLOCK_NONE;
+	m_loop				= -1;
+	m_enabled			= true;
+	m_temporaryCount	= 0;
+	m_slotCount			= 0;
+	m_releasedCount		= 0;
+}
+
+TempAllocator::~TempAllocator()
+{
+}
+
+void TempAllocator::Start()
+{
+	if(!m_variables)
+		return;
+
+	unordered_set<Variable*> temps;
+	m_variables->TakeNewTempVariables(temps);
+}
+
+bool TempAllocator::Allocate(statementNode* program, ControlFlow& controlFlow)
+{
+	m_temporaryCount	= 0;
+	m_slotCount			= 0;
+	m_releasedCount		= 0;
+
+	if(!m_enabled || !m_variables)
+		return false;
+
+	// An edit may have dropped the statements reading some of the temporaries of the program, and the
+	// optimizer those reading others.
+	unordered_set<Variable*> temps;
+	if(program == m_program)
+		temps.swap(m_owned);
+	m_variables->TakeNewTempVariables(temps);
+
+	m_reserved.clear();
+	FindValues(controlFlow, 0, controlFlow.GetLayout().size());
+	m_temporaryCount = m_temps.size();
+	bool added = AssignSlots();
+	Rename();
+	m_variables->TakeNewTempVariables(temps);
+
+	m_program = program;
+	m_owned.clear();
+	FindTemporaries(program, m_owned);
+	ReleaseUnused(temps, m_owned);
+	ClearValues();
+
+	return added;
+}
+
+bool TempAllocator::Allocate(statementNode* first, statementNode* last, ControlFlow& controlFlow, int block)
+{
+	m_temporaryCount	= 0;
+	m_slotCount			= 0;
+	m_releasedCount		= 0;
+
+	if(!m_enabled || !m_variables)
+		return false;
+
+	// A loop is laid out in one piece, which is allocated whole.
+	const vector<int>& layout = controlFlow.GetLayout();
+	if(controlFlow.GetBlock(block).loopDepth)
+	{
+		int start = find(layout.begin(), layout.end(), block) - layout.begin();
+		int end = start + 1;
+		while(start > 0 && controlFlow.GetBlock(layout[start - 1]).loopDepth)
+			start--;
+		while(end < (int)layout.size() && controlFlow.GetBlock(layout[end]).loopDepth)
+			end++;
+		FindValues(controlFlow, start, end);
+	}
+	else
+	{
+		m_block	= block;
+		m_loop	= -1;
+		int position = 0;
+		for(statementNode* node = first; node; node = (node == last) ? 0 : node->next)
+			AddStatement(node, position++);
+	}
+
+	m_temporaryCount = m_temps.size();
+	bool added = AssignSlots();
+	Rename();
+
+	// Only the temporaries made for the line may be left without a statement.
+	unordered_set<Variable*> temps;
+	unordered_set<Variable*> owned;
+	m_variables->TakeNewTempVariables(temps);
+	FindTemporaries(first, owned, last);
+	m_owned.insert(owned.begin(), owned.end());
+	ReleaseUnused(temps, owned);
+	ClearValues();
+
+	return added;
+}
+
+bool TempAllocator::HasOnlySlots(statementNode* first, statementNode* last)
+{
+	if(!m_enabled || !m_variables)
+		return true;
+
+	unordered_set<Variable*> temps;
+	FindTemporaries(first, temps, last);
+	for(unordered_set<Variable*>::iterator it = temps.begin(); it != temps.end(); it++)
+	{
+		bool slot = false;
+		for(int i = 0; i < m_variables->GetTempSlotCount() && !slot; i++)
+			slot = (m_variables->GetTempSlot(i) == *it);
+		if(!slot)
+			return false;
+	}
+
+	return true;
+}
+
+void TempAllocator::Release(statementNode* program)
+{
+	if(!program || program != m_program || !m_variables)
+		return;
+
+	m_variables->ReleaseTempVariables(m_owned);
+	m_owned.clear();
+	m_program = 0;
+}
+
+void TempAllocator::FindValues(ControlFlow& controlFlow, int first, int end)
+{
+	// A loop is laid out in one piece, with the loops inside it.
+	const vector<int>& layout = controlFlow.GetLayout();
+	int loops = 0;
+	m_loop = -1;
+	for(int block = first; block < end; block++)
+	{
+		m_block = layout[block];
+		if(!controlFlow.GetBlock(m_block).loopDepth)
+			m_loop = -1;
+		else if(m_loop < 0)
+			m_loop = loops++;
+
+		const vector<statementNode*>& statements = controlFlow.GetBlock(m_block).statements;
+		for(int i = 0; i < (int)statements.size(); i++)
+			AddStatement(statements[i], i);
+	}
+}
+
+void TempAllocator::AddStatement(statementNode* node, int position)
+{
+	// A statement reads its operands before it assigns its target.
+	switch(node->stmt_type)
+	{
+	case ASSIGNSTMT:
+		if(node->assign_stmt)
+		{
+			Read(&node->assign_stmt->op1, 2 * position);
+			Read(&node->assign_stmt->op2, 2 * position);
+			Add(&node->assign_stmt->lhs, true, 2 * position, false, false);
+			Add(&node->assign_stmt->lhs, false, 2 * position + 1, true, node->assign_stmt->type != VALUE_NUMBER);
+		}
+		break;
+	case PRINTSTMT:
+		if(node->print_stmt)
+			Read(&node->print_stmt->id, 2 * position);
+		break;
+	case IFSTMT:
+		if(node->if_stmt)
+		{
+			Read(&node->if_stmt->op1, 2 * position);
+			Read(&node->if_stmt->op2, 2 * position);
+		}
+		break;
+	case FUNCSTMT:
+		if(node->func_stmt)
+			Read(&node->func_stmt->argument, 2 * position);
+		break;
+	}
+}
+
+void TempAllocator::Read(varAccess** access, int position)
+{
+	Add(access, false, position, false, false);
+	Add(access, true, position, false, false);
+}
+
+void TempAllocator::Add(varAccess** access, bool index, int position, bool assign, bool text)
+{
+	if(!*access)
+		return;
+
+	Variable* var = index ? (*access)->index : (*access)->var;
+	if(!var || !m_variables->IsTempVariable(var))
+		return;
+
+	pair<unordered_map<Variable*, int>::iterator, bool> found = m_tempIDs.insert(make_pair(var, (int)m_temps.size()));
+	int temp = found.first->second;
+	if(found.second)
+	{
+		m_temps.push_back(var);
+		m_kept.push_back(false);
+		m_text.push_back(false);
+		m_current.push_back(-1);
+	}
+
+	// A temporary with elements stays where it is.
+	if(var->value.size() != 1 || (!index && (*access)->index))
+		m_kept[temp] = true;
+
+	int value = m_current[temp];
+	if(assign)
+	{
+		TempValue assigned;
+		assigned.temp	= temp;
+		assigned.block	= m_block;
+		assigned.loop	= m_loop;
+		assigned.first	= position;
+		assigned.last	= position;
+		assigned.slot	= 0;
+		value = m_values.size();
+		m_values.push_back(assigned);
+		m_current[temp] = value;
+		if(text)
+			m_text[temp] = true;
+	}
+	else if(value < 0 || m_values[value].block != m_block)
+	{
+		m_kept[temp] = true;
+		value = -1;
+	}
+	else
+		m_values[value].last = position;
+
+	Reference reference;
+	reference.access	= access;
+	reference.index		= index;
+	reference.value		= value;
+	m_references.push_back(reference);
+}
+
+bool TempAllocator::AssignSlots()
+{
+	int tempCount = m_temps.size();
+	vector<int> counts(tempCount, 0);
+	for(vector<TempValue>::iterator it = m_values.begin(); it != m_values.end(); it++)
+		counts[it->temp]++;
+
+	unordered_map<Variable*, int> slots;
+	for(int slot = 0; slot < m_variables->GetTempSlotCount(); slot++)
+		slots[m_variables->GetTempSlot(slot)] = slot;
+
+	// A slot which keeps its values is not given any others, here or in another block.
+	vector<bool> renamed(tempCount, false);
+	vector<bool>& reserved = m_reserved;
+	reserved.resize(slots.size(), false);
+	for(int temp = 0; temp < tempCount; temp++)
+	{
+		unordered_map<Variable*, int>::iterator slot = slots.find(m_temps[temp]);
+		if(m_kept[temp] && slot != slots.end())
+			reserved[slot->second] = true;
+		else if(!m_kept[temp] && m_text[temp] && (counts[temp] > 1 || slot != slots.end()))
+			renamed[temp] = true;
+		else if(m_text[temp])
+			m_kept[temp] = true;
+	}
+
+	bool added = false;
+	deque<int> free;
+	vector<pair<int, int> > live;					// The values holding slots, with their slots.
+	int next = 0;
+	for(vector<TempValue>::iterator value = m_values.begin(); value != m_values.end(); value++)
+	{
+		if(m_kept[value->temp])
+			continue;
+		if(renamed[value->temp])
+		{
+			value->slot = m_variables->AddTempVariable();
+			added = true;
+			continue;
+		}
+
+		// A slot is free once its value has been read for the last time, and the loop holding it has ended.
+		for(vector<pair<int, int> >::iterator it = live.begin(); it != live.end(); )
+		{
+			const TempValue& held = m_values[it->first];
+			if((held.block == value->block && held.last >= value->first) || (held.loop >= 0 && held.loop == value->loop))
+			{
+				it++;
+				continue;
+			}
+
+			free.push_back(it->second);
+			it = live.erase(it);
+		}
+
+		int slot;
+		if(!free.empty())
+		{
+			slot = free.front();
+			free.pop_front();
+		}
+		else
+		{
+			while(next < (int)reserved.size() && reserved[next])
+				next++;
+			slot = next++;
+			m_slotCount++;
+		}
+
+		value->slot = m_variables->GetTempSlot(slot);
+		live.push_back(make_pair((int)(value - m_values.begin()), slot));
+	}
+
+	return added;
+}
+
+void TempAllocator::Rename()
+{
+	// An access held by two statements is copied when they are given different variables.
+	unordered_map<varAccess*, Variable*> given;
+	for(vector<Reference>::iterator it = m_references.begin(); it != m_references.end(); it++)
+	{
+		if(it->value < 0 || !m_values[it->value].slot)
+			continue;
+
+		Variable* slot = m_values[it->value].slot;
+		varAccess* access = *it->access;
+		pair<unordered_map<varAccess*, Variable*>::iterator, bool> found = given.insert(make_pair(access, slot));
+		if(!found.second && found.first->second != slot)
+		{
+			access = new varAccess(*access);
+			*it->access = access;
+		}
+
+		if(it->index)
+			access->index = slot;
+		else
+			access->var = slot;
+	}
+}
+
+void TempAllocator::FindTemporaries(statementNode* program, unordered_set<Variable*>& temps, statementNode* last)
+{
+	for(statementNode* node = program; node; node = (node == last) ? 0 : node->next)
+	{
+		varAccess* accesses[3] = {0, 0, 0};
+		switch(node->stmt_type)
+		{
+		case ASSIGNSTMT:
+			if(node->assign_stmt)
+			{
+				accesses[0] = node->assign_stmt->lhs;
+				accesses[1] = node->assign_stmt->op1;
+				accesses[2] = node->assign_stmt->op2;
+			}
+			break;
+		case PRINTSTMT:
+			if(node->print_stmt)
+				accesses[0] = node->print_stmt->id;
+			break;
+		case IFSTMT:
+			if(node->if_stmt)
+			{
+				accesses[0] = node->if_stmt->op1;
+				accesses[1] = node->if_stmt->op2;
+			}
+			break;
+		case FUNCSTMT:
+			if(node->func_stmt)
+				accesses[0] = node->func_stmt->argument;
+			break;
+		}
+
+		for(int i = 0; i < 3; i++)
+		{
+			if(!accesses[i])
+				continue;
+			if(m_variables->IsTempVariable(accesses[i]->var))
+				temps.insert(accesses[i]->var);
+			if(accesses[i]->index && m_variables->IsTempVariable(accesses[i]->index))
+				temps.insert(accesses[i]->index);
+		}
+	}
+}
+
+void TempAllocator::ReleaseUnused(unordered_set<Variable*>& temps, const unordered_set<Variable*>& owned)
+{
+	for(unordered_set<Variable*>::const_iterator it = owned.begin(); it != owned.end(); it++)
+		temps.erase(*it);
+	m_releasedCount = m_variables->ReleaseTempVariables(temps);
+}
+
+void TempAllocator::ClearValues()
+{
+	m_temps.clear();
+	m_tempIDs.clear();
+	m_kept.clear();
+	m_text.clear();
+	m_current.clear();
+	m_values.clear();
+	m_references.clear();
+}
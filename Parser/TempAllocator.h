@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: TempAllocator.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _TEMP_ALLOCATOR_H_
+#define _TEMP_ALLOCATOR_H_
+
+#include "compiler.h"
+#include "ControlFlow.h"
+#include <unordered_set>
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: TempAllocator
+//
+// Gives the temporaries of a compiled program a few slots which are reused,
+// so the variables kept for it stop growing with the number of expressions.
+// Each assignment to a temporary starts a value, which lives until the last
+// statement of its block reading it. The values of a block are given the
+// slots of Variables::GetTempSlot free when they are assigned, the one
+// freed first first, and every slot is free again when the block ends.
+// Inside a loop a slot is only given one value until the blocks of the loop
+// end, so SSAOptimizer may still move the value in front of the loop.
+//
+// A temporary read by a block before the block assigns it keeps its
+// variable, as the value comes from another block. So does one which may
+// be given text, as its type becomes PRIM_STRING for good. When that
+// variable is a slot, or holds more than one value, each value is given a
+// new temporary instead, and the types of the program have to be found
+// again. Temporaries made for the program which it no longer reads or
+// assigns are freed.
+//
+// The temporaries of a line are assigned and read by that line alone, so a
+// line compiled again is allocated by itself, from the first slot, with the
+// slots kept by the program left out. Inside a loop the other values of the
+// loop still hold their slots while the line runs, so the blocks of the
+// loop are allocated again with it.
+////////////////////////////////////////////////////////////////////////////////
+class TempAllocator
+{
+public:
+	TempAllocator();
+	~TempAllocator();
+
+	void Start();									// Forget the temporaries made so far. Those made from now on which
+													// the program allocated next does not use are freed.
+	bool Allocate(statementNode* program,			// program split into blocks by controlFlow. True when temporaries were
+		ControlFlow& controlFlow);					// added, which CompleteParser::ResolveTypes has to type.
+	bool Allocate(statementNode* first,				// Allocate the statements from first to last, a line compiled again in
+		statementNode* last,						// block of the program last allocated, which controlFlow holds. True
+		ControlFlow& controlFlow, int block);		// when temporaries were added.
+	bool HasOnlySlots(statementNode* first,			// The statements from first to last only hold temporaries which are
+		statementNode* last);						// slots, so nothing is left to free once the line is replaced.
+	void Release(statementNode* program);			// Free the temporaries of program, which is being shut down, if it was
+													// the program last allocated.
+
+	void SetEnabled(bool enable) {m_enabled = enable;}
+	void SetVariables(Variables* variables) {m_variables = variables;}	// The table the temporaries are kept in. Nothing is allocated without it.
+	bool IsEnabled() {return m_enabled;}
+	int GetTemporaryCount() {return m_temporaryCount;}	// Temporaries the blocks read or assigned before the last Allocate.
+	int GetSlotCount() {return m_slotCount;}			// Slots it gave their values.
+	int GetReleasedCount() {return m_releasedCount;}	// Temporaries it freed.
+
+private:
+	struct Reference
+	{
+		varAccess**		access;						// Where the statement holds the access.
+		bool			index;						// The temporary is the index of the access rather than its variable.
+		int				value;						// The value read or assigned. -1 when it comes from another block.
+	};
+
+	struct TempValue
+	{
+		int				temp;						// By ID.
+		int				block;
+		int				loop;						// The blocks laid out inside loops holding it, by the order they come in. -1 for none.
+		int				first;						// Where it is assigned and last read. Reads of statement i of the
+		int				last;						// block are at 2 * i, and its assignment at 2 * i + 1.
+		Variable*		slot;						// The variable given to it. 0 when it keeps its temporary.
+	};
+
+	void FindValues(ControlFlow& controlFlow,		// The values of the blocks laid out from first, up to end.
+		int first, int end);
+	void AddStatement(statementNode* node,			// The values read and assigned by the statement at position of its block.
+		int position);
+	void Read(varAccess** access, int position);
+	void Add(varAccess** access, bool index,		// Record a temporary read or assigned by the access.
+		int position, bool assign, bool text);
+	bool AssignSlots();								// True when a value was given a new temporary.
+	void Rename();
+	void FindTemporaries(statementNode* program,	// Every temporary the statements read or assign, up to last when given.
+		unordered_set<Variable*>& temps,
+		statementNode* last = 0);
+	void ReleaseUnused(unordered_set<Variable*>& temps,	// Free temps other than those owned.
+		const unordered_set<Variable*>& owned);
+	void ClearValues();
+
+	Variables*							m_variables;
+	vector<Variable*>					m_temps;	// By ID.
+	unordered_map<Variable*, int>		m_tempIDs;
+	vector<bool>						m_kept;		// Temporaries read before they are assigned, by ID.
+	vector<bool>						m_text;		// Temporaries which may be given text.
+	vector<int>							m_current;	// The last value of each temporary, or -1.
+	vector<TempValue>					m_values;	// In the order of the blocks and of their statements.
+	vector<Reference>					m_references;
+	vector<bool>						m_reserved;	// The slots kept by a block of the program last allocated, by slot.
+	statementNode*						m_program;	// The program last allocated.
+	unordered_set<Variable*>			m_owned;	// The temporaries it read or assigned.
+	int									m_block;	// The block FindValues is in.
+	int									m_loop;		// The loop it is in, or -1.
+	bool								m_enabled;
+	int									m_temporaryCount;
+	int									m_slotCount;
+	int									m_releasedCount;
+};
+
+#endif
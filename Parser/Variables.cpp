@@ -6,11 +6,19 @@ Variables::Variables()
 	m_internalVariable	= 0;
 	m_tempVariableCount	= 0;
 	m_constantCount		= 0;
+	m_intType			= TYPE_UNKNOWN;
+	m_realType			= TYPE_UNKNOWN;
+	m_lookupCount		= 0;
+
+	// A name listed twice in TOKENS keeps its first index.
+	for(int i = RESERVED_COUNT - 1; i >= 0; i--)
+		m_reservedTokens[TOKENS[i]] = i;
 }
 
 Variables::~Variables()
 {
-
+	for(unordered_set<Variable*>::iterator it = m_temporaries.begin(); it != m_temporaries.end(); it++)
+		delete *it;
 }
 
 __declspec(dllexport) void Variables::Clear()
@@ -19,9 +27,19 @@ __declspec(dllexport) void Variables::Clear()
 	m_types.clear();
 	m_typeDefs.clear();
 	m_variables.clear();
+	m_variableIDs.clear();
+	for(unordered_set<Variable*>::iterator it = m_temporaries.begin(); it != m_temporaries.end(); it++)
+		delete *it;
+	m_temporaries.clear();
+	m_tempSlots.clear();
+	m_newTemporaries.clear();
 	m_tempVariableCount = 0;
 	m_internalType = m_primitives.size();
 	m_types = m_primitives;
+
+	m_typeIDs.clear();
+	for(map<int, string>::iterator it = m_primitives.begin(); it != m_primitives.end(); it++)
+		m_typeIDs.insert(make_pair(it->second, it->first));
 	m_internalVariable = 0;
 	m_constantCount = 0;
 }
@@ -33,10 +51,16 @@ bool Variables::AddPrimitive(string& type)
 	if(TypeIsPrimitive(existingID))
 		return false;
 
-	m_primitives[m_internalType] = type;
+	int typeID = m_internalType;
+	m_primitives[typeID] = type;
 
 	AddType(type);
 
+	if(type == "PRIM_INT")
+		m_intType = typeID;
+	else if(type == "PRIM_REAL")
+		m_realType = typeID;
+
 	return true;
 }
 
@@ -70,14 +94,67 @@ void Variables::VerifyDataTypes()
 	}
 }
 
+int Variables::GetValueKind(int typeID)
+{
+	int lowestID = GetLowestType(typeID);
+
+	if(lowestID == TYPE_UNKNOWN)
+		return VALUE_NUMBER;
+	if(lowestID == m_intType)
+		return VALUE_INT;
+	if(lowestID == m_realType)
+		return VALUE_REAL;
+
+	return VALUE_NUMBER;
+}
+
+bool Variables::ConvertValue(Value& value, int typeID)
+{
+	if(value.kind == VALUE_STRING)
+		return ConvertValue(value.text, typeID);
+
+	// Other types keep what they are given.
+	switch(GetValueKind(typeID))
+	{
+	case VALUE_INT:
+		if(value.kind != VALUE_INT)
+		{
+			value.integer	= TruncateNumber(value.real);
+			value.kind		= VALUE_INT;
+			return true;
+		}
+		break;
+	case VALUE_REAL:
+		if(value.kind != VALUE_REAL)
+		{
+			value.real	= value.ToNumber();
+			value.kind	= VALUE_REAL;
+			return true;
+		}
+		break;
+	}
+
+	return false;
+}
+
 bool Variables::ConvertValue(string& value, int typeID)
 {
 	if(!TypeIsDeclared(typeID))
 		return false;
 
 	string& type = m_types[typeID];
-	std::size_t index = value.find('.');
 	if(type == "PRIM_INT")
+		return ConvertText(value, VALUE_INT);
+	else if(type == "PRIM_REAL")
+		return ConvertText(value, VALUE_REAL);
+
+	return false;
+}
+
+bool Variables::ConvertText(string& value, int kind)
+{
+	std::size_t index = value.find('.');
+	if(kind == VALUE_INT)
 	{
 		if(index != std::string::npos)
 		{
@@ -85,7 +162,7 @@ bool Variables::ConvertValue(string& value, int typeID)
 			return true;
 		}
 	}
-	else if(type == "PRIM_REAL")
+	else if(kind == VALUE_REAL)
 	{
 		if(index == std::string::npos)
 		{
@@ -110,31 +187,42 @@ __declspec(dllexport) bool Variables::SetVar(string& varName, string& value, int
 	// The ID of the existing or new variable.
 	int varID = GetVarIDNumber(varName);
 
+	// Text is kept as it is given. The caller sees it converted.
+	Value text;
+	text.SetText(value);
+	bool set = SetValue(m_variables[varID], text, typeID, index);
+	value = text.text;
+
+	return set;
+}
+
+bool Variables::SetValue(Variable& var, Value& value, int typeID, int index)
+{
 	// TODO: Type checking is disabled... but PRIM_INT/PRIM_REAL will be converted.
-	//if(CheckTypes(m_variables[varID].typeID, typeID))
+	//if(CheckTypes(var.typeID, typeID))
 
-	int lowestID1 = GetLowestType(m_variables[varID].typeID);
-	int lowestID2 = GetLowestType(typeID);
-	// The type was previously unknown. Set it to the known value.
-	if(!TypeIsPrimitive(lowestID1) && lowestID1 != lowestID2 && !TypeIsTypeDef(lowestID1))
-	{
-		m_typeDefs[lowestID1] = lowestID2;
-	}
+	BindType(GetLowestType(var.typeID), GetLowestType(typeID));
 
 	// Cast most compatible types.
-	ConvertValue(value, GetLowestType(m_variables[varID].typeID));
+	ConvertValue(value, GetLowestType(var.typeID));
 
-	if(GetTypeIDNumber(value) == TYPE_UNKNOWN)
-	{
-		// Resize the array if necessary.
-		while(m_variables[varID].value.size() <= index)
-			m_variables[varID].value.push_back("0");
+	// Text naming a type is not stored.
+	if(value.kind == VALUE_STRING && GetTypeIDNumber(value.text) != TYPE_UNKNOWN)
+		return false;
 
-		m_variables[varID].value[index] = value;
-		return true;
-	}
+	// Resize the array if necessary.
+	var.Set(value, index);
+	return true;
+}
 
-	return false;
+bool Variables::BindType(int typeID, int lowestID)
+{
+	// The type was previously unknown. Set it to the known value.
+	if(TypeIsPrimitive(typeID) || typeID == lowestID || TypeIsTypeDef(typeID))
+		return false;
+
+	m_typeDefs[typeID] = lowestID;
+	return true;
 }
 
 Variable* Variables::GetVariable(string& varName)
@@ -182,11 +270,15 @@ __declspec(dllexport) varAccess* Variables::GetOrCreateVarAccess(string& token)
 			break;
 		}
 		var->typeID = GetTypeIDNumber(type);
-		var->value.push_back(token);
+		var->value.push_back(Value());
 		if(type == "PRIM_STRING")
 		{
-			var->value.back().pop_back();
-			var->value.back().erase(var->value.back().begin());
+			var->value.back().SetText(token.substr(1, token.size() - 2));
+		}
+		else
+		{
+			var->value.back().SetNumber(atof(token.c_str()));
+			ConvertValue(var->value.back(), var->typeID);
 		}
 	}
 
@@ -200,13 +292,11 @@ __declspec(dllexport) varAccess* Variables::GetOrCreateVarAccess(string& token)
 
 int Variables::IsTokenInternalType(string& token)
 {
-	for(int i = 0; i < RESERVED_COUNT; i++)
-	{
-		if(strcmp(token.c_str(), TOKENS[i]) == 0)
-			return i;
-	}
+	unordered_map<string, int>::iterator it = m_reservedTokens.find(token);
+	if(it == m_reservedTokens.end())
+		return -1;
 
-	return -1;
+	return it->second;
 }
 
 int Variables::IsDigit(string& token)
@@ -242,27 +332,18 @@ map<int, Variable>* Variables::GetVariables()
 	return &m_variables;
 }
 
-void Variables::InitializeVariable(Variable& variable)
+map<int, string>* Variables::GetTypes()
 {
-	int lowestID = GetLowestType(variable.typeID);
+	return &m_types;
+}
 
-	// Universal option.
+void Variables::InitializeVariable(Variable& variable)
+{
+	// Numbers get initialized to 0 of the kind of the type.
 	for(int i = 0; i < variable.value.size(); i++)
-		variable.value[i] = "0";
-
-	if(TypeIsPrimitive(lowestID))
 	{
-		// Numbers get initialized to 0.
-		if(m_types[lowestID] == "PRIM_INT")
-		{
-			for(int i = 0; i < variable.value.size(); i++)
-				variable.value[i] = "0";
-		}
-		else if(m_types[lowestID] == "PRIM_REAL")
-		{
-			for(int i = 0; i < variable.value.size(); i++)
-				variable.value[i] = "0.0";
-		}
+		variable.value[i] = Value();
+		ConvertValue(variable.value[i], variable.typeID);
 	}
 }
 
@@ -279,13 +360,30 @@ void Variables::RemoveScope()
 		// Remove variables declared in this scope.
 		for(list<int>::iterator it = m_scopes.back().variables.begin(); it != m_scopes.back().variables.end(); it++)
 		{
-			m_variables.erase(*it);
+			map<int, Variable>::iterator var = m_variables.find(*it);
+			if(var == m_variables.end())
+				continue;
+
+			unordered_map<string, int>::iterator name = m_variableIDs.find(var->second.name);
+			if(name != m_variableIDs.end() && name->second == *it)
+				m_variableIDs.erase(name);
+
+			m_variables.erase(var);
 		}
 
 		// Remove types declared in this scope.
 		for(list<int>::iterator it = m_scopes.back().types.begin(); it != m_scopes.back().types.end(); it++)
 		{
-			m_types.erase(*it);
+			// Primitives are still found by name once they leave m_types.
+			map<int, string>::iterator type = m_types.find(*it);
+			if(type != m_types.end())
+			{
+				unordered_map<string, int>::iterator name = m_typeIDs.find(type->second);
+				if(name != m_typeIDs.end() && name->second == *it && !TypeIsPrimitive(*it))
+					m_typeIDs.erase(name);
+
+				m_types.erase(type);
+			}
 
 			// Remove typedefs that map to a type declared in this scope.
 			for(map<int, int>::iterator tDefs = m_typeDefs.begin(); tDefs != m_typeDefs.end(); tDefs++)
@@ -346,11 +444,12 @@ __declspec(dllexport) bool Variables::AddVariable(string& varName, int typeID, i
 	variable.name	= varName;
 	variable.typeID = typeIDCpy;
 	while(variable.value.size() < size)
-		variable.value.push_back("0");
+		variable.value.push_back(Value());
 	InitializeVariable(variable);
 
 	AddVariableToScope(m_internalVariable);
 
+	m_variableIDs[varName] = m_internalVariable;
 	m_variables[m_internalVariable++] = variable;
 
 	return true;
@@ -392,11 +491,12 @@ __declspec(dllexport) bool Variables::AddVariable(string& varName, string& type,
 	variable.name	= varName;
 	variable.typeID = typeID;
 	while(variable.value.size() < index)
-		variable.value.push_back("0");
+		variable.value.push_back(Value());
 	InitializeVariable(variable);
 
 	AddVariableToScope(m_internalVariable);
 
+	m_variableIDs[varName] = m_internalVariable;
 	m_variables[m_internalVariable++] = variable;
 
 	return true;
@@ -406,25 +506,88 @@ __declspec(dllexport) struct varAccess* Variables::GetVarAccess(string& name)
 {
 	Variable* node = GetVariable(GetVarIDNumber(name));
 	if(node)
-	{
-		varAccess* access = new varAccess;
-		access->index = 0;
-		access->var = node;
-		return access;
-	}
+		return GetVarAccess(node);
 
 	return 0;
 }
 
+struct varAccess* Variables::GetVarAccess(Variable* var)
+{
+	varAccess* access = new varAccess;
+	access->index = 0;
+	access->var = var;
+	return access;
+}
+
 struct Variable* Variables::AddTempVariable()
 {
 	// Use '#' to prevent user from adding variable name.
 	string tempName("temp#");
 	stringstream ss;
 	ss << tempName << m_tempVariableCount++;
-	string finalStr = ss.str();
-	AddVariable(finalStr, TYPE_UNKNOWN);
-	return GetVariable(GetVarIDNumber(finalStr));
+
+	// The type becomes PRIM_STRING if text is assigned to it, so it is not shared.
+	string typeStr = "";
+	if(!AddType(typeStr, true))
+		return 0;
+
+	Variable* variable = new Variable;
+	variable->name		= ss.str();
+	variable->typeID	= m_internalType - 1;
+	variable->value.push_back(Value());
+	InitializeVariable(*variable);
+	m_temporaries.insert(variable);
+	m_newTemporaries.insert(variable);
+
+	return variable;
+}
+
+struct Variable* Variables::GetTempSlot(int slot)
+{
+	while((int)m_tempSlots.size() <= slot)
+		m_tempSlots.push_back(AddTempVariable());
+
+	return m_tempSlots[slot];
+}
+
+void Variables::TakeNewTempVariables(unordered_set<Variable*>& temps)
+{
+	temps.insert(m_newTemporaries.begin(), m_newTemporaries.end());
+	m_newTemporaries.clear();
+}
+
+bool Variables::IsTempVariable(Variable* var)
+{
+	return (m_temporaries.find(var) != m_temporaries.end());
+}
+
+int Variables::ReleaseTempVariables(const unordered_set<Variable*>& temps)
+{
+	unordered_set<Variable*> slots(m_tempSlots.begin(), m_tempSlots.end());
+	int released = 0;
+	for(unordered_set<Variable*>::const_iterator it = temps.begin(); it != temps.end(); it++)
+	{
+		Variable* var = *it;
+		if(slots.count(var) || !m_temporaries.erase(var))
+			continue;
+		m_newTemporaries.erase(var);
+
+		// Nothing else is given the internal type of a temporary.
+		map<int, string>::iterator type = m_types.find(var->typeID);
+		if(type != m_types.end())
+		{
+			unordered_map<string, int>::iterator name = m_typeIDs.find(type->second);
+			if(name != m_typeIDs.end() && name->second == var->typeID)
+				m_typeIDs.erase(name);
+			m_types.erase(type);
+		}
+		m_typeDefs.erase(var->typeID);
+
+		delete var;
+		released++;
+	}
+
+	return released;
 }
 
 bool Variables::AddType(string& typeDef, string& type)
@@ -471,59 +634,40 @@ bool Variables::AddType(string& type, bool internalOnly)
 		return false;
 
 	// A variable is being declared with an unknown type.
+	string name = type;
 	if(internalOnly)
 	{
 		stringstream ss;
 		ss << "INTERNAL_" << m_internalType;
-		m_types[m_internalType++] = ss.str();
-	}
-	else
-	{
-		m_types[m_internalType++] = type;
+		name = ss.str();
 	}
 
+	// A name given to two types is found as the first.
+	m_typeIDs.insert(make_pair(name, m_internalType));
+	m_types[m_internalType++] = name;
+
 	return true;
 }
 
 int Variables::GetVarIDNumber(string& token)
 {
-	// Search all types.
-	map<int, Variable>::iterator it = m_variables.begin();
+	m_lookupCount++;
+	unordered_map<string, int>::iterator it = m_variableIDs.find(token);
+	if(it == m_variableIDs.end())
+		return TYPE_UNKNOWN;
 
-	while(it != m_variables.end())
-	{
-		if(it->second.name.compare(token) == 0)
-			return it->first;
-		it++;
-	}
-
-	return TYPE_UNKNOWN;
+	return it->second;
 }
 
 __declspec(dllexport) int Variables::GetTypeIDNumber(string& token)
 {
-	// Search all types.
-	map<int, string>::iterator it = m_types.begin();
-
-	while(it != m_types.end())
-	{
-		if(it->second.compare(token) == 0)
-			return it->first;
-		it++;
-	}
-
-	// Search primitives.
-	it = m_primitives.begin();
-
-	while(it != m_primitives.end())
-	{
-		if(it->second.compare(token) == 0)
-			return it->first;
-
-		it++;
-	}
+	// Primitives are kept in the index along with every type.
+	m_lookupCount++;
+	unordered_map<string, int>::iterator it = m_typeIDs.find(token);
+	if(it == m_typeIDs.end())
+		return TYPE_UNKNOWN;
 
-	return TYPE_UNKNOWN;
+	return it->second;
 }
 
 __declspec(dllexport) string Variables::GetTypeString(int typeID)
@@ -544,21 +688,25 @@ __declspec(dllexport) int Variables::GetLowestType(int typeID)
 
 bool Variables::TypeIsTypeDef(int typeID)
 {
+	m_lookupCount++;
 	return (m_typeDefs.find(typeID) != m_typeDefs.end());
 }
 
 bool Variables::VarIsDeclared(int varID)
 {
+	m_lookupCount++;
 	return (m_variables.find(varID) != m_variables.end());
 }
 
 bool Variables::TypeIsDeclared(int typeID)
 {
+	m_lookupCount++;
 	return (m_types.find(typeID) != m_types.end());
 }
 
 bool Variables::TypeIsPrimitive(int typeID)
 {
+	m_lookupCount++;
 	return (m_primitives.find(typeID) != m_primitives.end());
 }
 
@@ -569,7 +717,7 @@ void Variables::PrintVariables()
 	cout << "VARIABLES\n";
 	while(it != m_variables.end())
 	{
-		cout << "ID: " << it->first << " VAR: " << it->second.name.c_str() << " Value: " << it->second.value[0].c_str() << " TYPE: " << it->second.typeID << "\n";
+		cout << "ID: " << it->first << " VAR: " << it->second.name.c_str() << " Value: " << it->second.value[0].ToString() << " TYPE: " << it->second.typeID << "\n";
 		it++;
 	}
 }
@@ -5,12 +5,15 @@
 #define _VARIABLES_H_
 
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <list>
 #include <vector>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string.h>
+#include <stdlib.h>
 
 using namespace std;
 
@@ -109,22 +112,124 @@ static const char *TOKENS[] =
 
 const int RESERVED_COUNT = sizeof(TOKENS)/sizeof(TOKENS[0]);
 
+// Value kinds
+#define VALUE_NUMBER		0				// A number held by a variable which is not PRIM_INT or PRIM_REAL.
+#define VALUE_INT			1
+#define VALUE_REAL			2
+#define VALUE_STRING		3				// Text, including numbers set as text by SetVar.
+
+// A number as a PRIM_INT holds it, cut toward zero. NaN is 0 and a number past the range of a long long,
+// such as the infinity of a division by 0, is the nearest limit. A cast alone would be undefined for them.
+inline long long TruncateNumber(double number)
+{
+	if(number != number)
+		return 0;
+	if(number >= 9223372036854775808.0)
+		return 9223372036854775807LL;
+	if(number < -9223372036854775808.0)
+		return -9223372036854775807LL - 1;
+
+	return (long long)number;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// One element of a variable. Numbers are kept as numbers and only formatted
+// by ToString, which gives the text the value used to be stored as. A number
+// becomes a VALUE_INT through TruncateNumber on every path which stores one.
+////////////////////////////////////////////////////////////////////////////////
+struct Value
+{
+	Value()
+	{
+		kind = VALUE_NUMBER;
+		real = 0.0;
+	};
+	void SetNumber(double number)
+	{
+		kind = VALUE_NUMBER;
+		real = number;
+	};
+	void SetInteger(long long number)
+	{
+		kind = VALUE_INT;
+		integer = number;
+	};
+	void SetReal(double number)
+	{
+		kind = VALUE_REAL;
+		real = number;
+	};
+	void SetText(const string& str)
+	{
+		kind = VALUE_STRING;
+		text = str;
+	};
+	double ToNumber()								// The value read like atof reads its text.
+	{
+		switch(kind)
+		{
+		case VALUE_INT:		return (double)integer;
+		case VALUE_STRING:	return atof(text.c_str());
+		default:			return real;
+		}
+	};
+	long long ToInteger()							// The value read like atoi reads its text.
+	{
+		switch(kind)
+		{
+		case VALUE_INT:		return integer;
+		case VALUE_STRING:	return atoi(text.c_str());
+		default:			return TruncateNumber(real);
+		}
+	};
+	string ToString()
+	{
+		if(kind == VALUE_STRING)
+			return text;
+
+		stringstream ss;
+		if(kind == VALUE_INT)
+			ss << integer;
+		else
+			ss << real;
+
+		// A real always shows its decimal point.
+		string str = ss.str();
+		if(kind == VALUE_REAL && str.find('.') == string::npos)
+			str.append(".0");
+
+		return str;
+	};
+
+	int kind;										// VALUE_*
+	union
+	{
+		long long	integer;
+		double		real;
+	};
+	string text;
+};
+
 struct Variable
 {
-	void Set(string val, int index)
+	void Set(const Value& val, int index)
 	{
 		while(index >= value.size())
-			value.push_back("0");
+			value.push_back(Value());
 		value[index] = val;
 	};
-	string Get(int index)
+	Value& GetValue(int index)						// Adds elements up to index like Get.
 	{
-		if(index >= value.size())
-			Set("0", index);
+		while(index >= value.size())
+			value.push_back(Value());
 
 		return value[index];
 	};
-	vector<string> value;
+	string Get(int index)
+	{
+		return GetValue(index).ToString();
+	};
+	vector<Value> value;
 	string name;
 	int typeID;
 };
@@ -175,13 +280,27 @@ public:
 
 	__declspec(dllexport) varAccess* GetOrCreateVarAccess(string& name);
 	__declspec(dllexport) struct varAccess* GetVarAccess(string& name);
+	struct varAccess* GetVarAccess(Variable* var);
 	//struct varNode* GetVarNode(string& name);
 
-	struct Variable* AddTempVariable();
+	struct Variable* AddTempVariable();				// A variable for an expression, with an internal type of its own. It is not
+													// in the table of variables, so it is never looked up or listed.
+	struct Variable* GetTempSlot(int slot);			// A temporary kept for TempAllocator to reuse. Added when it is missing.
+	bool IsTempVariable(Variable* var);
+	int ReleaseTempVariables(						// Free the temporaries of temps other than the slots, with their types.
+		const unordered_set<Variable*>& temps);		// Returns the number freed.
+	void TakeNewTempVariables(						// Add the temporaries made since the last call to temps.
+		unordered_set<Variable*>& temps);
+	int GetTempVariableCount() {return m_temporaries.size();}
+	int GetTempSlotCount() {return m_tempSlots.size();}
 
 	__declspec(dllexport) bool SetVar(string& varName, string& value,		// Set a variable to a value. Will create the variable if required.
 		int type, int index = 0);	
 
+	bool SetValue(Variable& var, Value& value,		// SetVar for a variable which is already declared.
+		int type, int index = 0);
+	bool BindType(int typeID, int lowestID);		// Give a type which is not yet known the lowest type of a value set to it.
+
 	int IsDigit(string& str);						// Determines if the string is PRIM_INT, PRIM_REAL, or neither.
 
 	int IsTokenInternalType(string& tokenStr);		// Match against TOKENS.
@@ -201,11 +320,16 @@ public:
 	__declspec(dllexport) int GetLowestType(int typeID);	// Return the lowest type ID for a given type.
 
 	bool ConvertValue(string& value, int typeID);
+	bool ConvertText(string& value, int kind);		// ConvertValue for text stored with a VALUE_* kind.
+	bool ConvertValue(Value& value, int typeID);	// Numbers become the kind of the type. Text is converted like a string.
+	int GetValueKind(int typeID);					// VALUE_INT or VALUE_REAL for those primitives, otherwise VALUE_NUMBER.
 	__declspec(dllexport) string GetTypeString(int typeID);	// Return the friendly name of the type ID.
 
 	Variable* GetVariable(string& var);
 	Variable* GetVariable(int varID);				// Return pointer to variable by ID.
 	map<int, Variable>* GetVariables();				// Returns the current map of variables.
+	map<int, string>* GetTypes();					// Returns the current map of types.
+	unsigned long long GetLookupCount() {return m_lookupCount;}	// Lookups of variables and types made so far.
 
 	void PrintVariables();
 	void PrintTypes(stringstream&);
@@ -215,13 +339,27 @@ private:
 	map<int, string>		m_primitives;			// The primitive types.
 	map<int, int>			m_typeDefs;				// The ID of one type referencing another type.
 	map<int, Variable>		m_variables;			// The loaded variables.
+	unordered_map<string,
+		int>				m_variableIDs;			// The name of every variable in m_variables to its ID.
+	unordered_map<string,
+		int>				m_typeIDs;				// The name of every type in m_types and m_primitives to its ID.
+	unordered_map<string,
+		int>				m_reservedTokens;		// TOKENS text to index.
 	//map<int, 
 	//	varNodeCPP>			m_varNodes;				// For compiling purposes.
+	unordered_set<
+		Variable*>			m_temporaries;			// Made by AddTempVariable. Owned here.
+	vector<Variable*>		m_tempSlots;			// The temporaries GetTempSlot keeps, by slot.
+	unordered_set<
+		Variable*>			m_newTemporaries;		// Made since TakeNewTempVariables.
 	list<Scope>				m_scopes;				// Variables loaded for each scope.
 	int						m_internalType;			// The current internal id being assigned to types.
 	int						m_internalVariable;		// The current internal id being assigned to variables.
 	int						m_tempVariableCount;	// The system assigns temporary variables for expressions.
 	int						m_constantCount;		// Number of constants declared.
+	int						m_intType;				// The type IDs of PRIM_INT and PRIM_REAL. TYPE_UNKNOWN until added.
+	int						m_realType;
+	unsigned long long		m_lookupCount;			// Searches of the maps above, counted for profiling.
 };
 
 #endif
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <ctype.h>
 #include <string.h>
 #include "compiler.h"
+#include "ByteCode.h"
 
 Variables* variablesPtr;
 
@@ -51,12 +52,23 @@ char *reserved[] =
 		"P_ERROR"
 	 };
 
+// The index of an array access. A negative one, or one past the end with INDEX_ERROR, is reported and stops the program.
+static bool GetIndex(struct varAccess* access, int& index, int indexPolicy)
+{
+	index = access->index ? (int)access->index->GetValue(0).ToInteger() : 0;
+	if(index >= 0 && (indexPolicy == INDEX_GROW || index < (int)access->var->value.size()))
+		return true;
+
+	ByteCode::ReportIndex(access->var, index);
+	return false;
+}
+
 //---------------------------------------------------------
 // Execute
-void execute_program(struct statementNode* program)
+void execute_program(struct statementNode* program, int indexPolicy)
 {
 	struct statementNode * pc = program;
-	float op1, op2, result;
+	double op1, op2;
 	int index, index1, index2;
 
 	while (pc != NULL)
@@ -79,8 +91,9 @@ void execute_program(struct statementNode* program)
 					exit(1);
 				}
 				// Get the index of the array.
-				index = pc->print_stmt->id->index ? atoi(pc->print_stmt->id->index->Get(0).c_str()) : 0;
-				cout << pc->print_stmt->id->var->Get(index) << "\n";
+				if(!GetIndex(pc->print_stmt->id, index, indexPolicy))
+					return;
+				cout << pc->print_stmt->id->var->GetValue(index).ToString() << "\n";
 				pc = pc->next;
 				break;
 
@@ -111,70 +124,73 @@ void execute_program(struct statementNode* program)
 						exit(1);
 					}
 					// Get the index of the array.
-					index1 = pc->assign_stmt->op1->index ? atoi(pc->assign_stmt->op1->index->Get(0).c_str()) : 0;
-
-					op1 = atof(pc->assign_stmt->op1->var->Get(index1).c_str());
+					if(!GetIndex(pc->assign_stmt->op1, index1, indexPolicy))
+						return;
 
-					int id	= variablesPtr->GetLowestType(pc->assign_stmt->lhs->var->typeID);
-					int id1 = variablesPtr->GetLowestType(pc->assign_stmt->op1->var->typeID);
-					int id2 = 0;
+					op1 = pc->assign_stmt->op1->var->GetValue(index1).ToNumber();
 
-					int typeToUse = id;
+					int typeToUse = pc->assign_stmt->lhs->var->typeID;
 
 					if(pc->assign_stmt->op2 != 0)
 					{
-						index2 = pc->assign_stmt->op2->index ? atoi(pc->assign_stmt->op2->index->Get(0).c_str()) : 0;
-						op2 = atof(pc->assign_stmt->op2->var->Get(index2).c_str());
-						id2 = variablesPtr->GetLowestType(pc->assign_stmt->op2->var->typeID);
+						if(!GetIndex(pc->assign_stmt->op2, index2, indexPolicy))
+							return;
+						op2 = pc->assign_stmt->op2->var->GetValue(index2).ToNumber();
 					}
 
-					int idType = id;
+					// The types are only checked when the compiler could not tell if a string is assigned.
+					bool text = (pc->assign_stmt->type == VALUE_STRING);
+					if(pc->assign_stmt->type == TYPE_UNKNOWN)
+					{
+						int id	= variablesPtr->GetLowestType(pc->assign_stmt->lhs->var->typeID);
+						int id1 = variablesPtr->GetLowestType(pc->assign_stmt->op1->var->typeID);
+						int id2 = pc->assign_stmt->op2 ? variablesPtr->GetLowestType(pc->assign_stmt->op2->var->typeID) : 0;
+
+						text = (variablesPtr->GetTypeString(id) == string(TOKENS[PRIM_STRING]) || 
+							variablesPtr->GetTypeString(id1) == string(TOKENS[PRIM_STRING]) || variablesPtr->GetTypeString(id2) == string(TOKENS[PRIM_STRING]));
+					}
 
-					stringstream ss;
-					if(variablesPtr->GetTypeString(id) == string(TOKENS[PRIM_STRING]) || 
-						variablesPtr->GetTypeString(id1) == string(TOKENS[PRIM_STRING]) || variablesPtr->GetTypeString(id2) == string(TOKENS[PRIM_STRING]))
+					Value result;
+					if(text)
 					{
-						string resultStr;
-						resultStr = pc->assign_stmt->op1->var->Get(index1);
+						result.SetText(pc->assign_stmt->op1->var->GetValue(index1).ToString());
 						switch (pc->assign_stmt->op)
 						{
 						case PLUS:
-							resultStr.append(pc->assign_stmt->op2->var->Get(index2));
+							result.text.append(pc->assign_stmt->op2->var->GetValue(index2).ToString());
 							break;
 						}
 
 						typeToUse = variablesPtr->GetTypeIDNumber(string(TOKENS[PRIM_STRING]));
-
-						ss << resultStr;
 					}
 					else
 					{
 						switch (pc->assign_stmt->op)
 						{
 							case PLUS:
-								result = op1 + op2;
+								result.SetNumber(op1 + op2);
 								break;
 							case MINUS:
-								result = op1 - op2;
+								result.SetNumber(op1 - op2);
 								break;
 							case MULT:
-								result = op1 * op2;
+								result.SetNumber(op1 * op2);
 								break;
 							case DIV:
-								result = op1 / op2;
+								result.SetNumber(op1 / op2);
 								break;
 							case 0:
-								result = op1;
+								result.SetNumber(op1);
 								break;
 							default:
 								print_debug("Error: invalid value for assign_stmt->op (%d).\n", pc->assign_stmt->op);
 								exit(1);
 								break;
 						}
-						ss << result;
 					}
-					index = pc->assign_stmt->lhs->index ? atoi(pc->assign_stmt->lhs->index->Get(0).c_str()) : 0;
-					variablesPtr->SetVar(pc->assign_stmt->lhs->var->name, ss.str(), typeToUse, index);
+					if(!GetIndex(pc->assign_stmt->lhs, index, indexPolicy))
+						return;
+					variablesPtr->SetValue(*pc->assign_stmt->lhs->var, result, typeToUse, index);
 					//pc->assign_stmt->lhs->var->Set(ss.str(), index);
 					pc = pc->next;
 					break;
@@ -206,11 +222,13 @@ void execute_program(struct statementNode* program)
 					exit(1);
 				}
 				// Get the index of the array.
-				index1 = pc->if_stmt->op1->index ? atoi(pc->if_stmt->op1->index->Get(0).c_str()) : 0;
-				index2 = pc->if_stmt->op2->index ? atoi(pc->if_stmt->op2->index->Get(0).c_str()) : 0;
-				op1 = atoi(pc->if_stmt->op1->var->Get(index1).c_str());
+				if(!GetIndex(pc->if_stmt->op1, index1, indexPolicy))
+					return;
+				if(!GetIndex(pc->if_stmt->op2, index2, indexPolicy))
+					return;
+				op1 = (double)pc->if_stmt->op1->var->GetValue(index1).ToInteger();
 				if(pc->if_stmt->op2 != 0)
-					op2 = atoi(pc->if_stmt->op2->var->Get(index2).c_str());
+					op2 = (double)pc->if_stmt->op2->var->GetValue(index2).ToInteger();
 				switch (pc->if_stmt->relop)
 				{
 					case GREATER:
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: EditTests.cpp
+//
+// Regression tests for EditSyntax, ExecuteProgram and SetIndexPolicy. Each
+// edit is made to a program parsed with ParseSyntax, the program is run with
+// ExecuteProgram, and the values of its variables are checked. The tree kept
+// up to date by EditSyntax must be the tree a new parse of the edited text
+// gives.
+//
+//	EditTests <tests/grammar.txt>
+//
+// Prints a line for every check that fails and returns the number of them.
+////////////////////////////////////////////////////////////////////////////////
+#include "../ParserManager.h"
+#include <cstdio>
+#include <sstream>
+
+static const char* PROGRAM =
+	"VAR\n"
+	" a, b;\n"
+	" x : ARRAY[4];\n"
+	"{\n"
+	" a = 2;\n"
+	" b = a * 3;\n"
+	" x[1] = b + 1;\n"
+	" WHILE a < 5 {\n"
+	"  a = a + 1;\n"
+	" }\n"
+	" print b;\n"
+	"}\n";
+
+static int s_failures = 0;
+
+static void Check(bool passed, const char* test, const char* what)
+{
+	if(!passed)
+	{
+		printf("FAIL %s: %s\n", test, what);
+		s_failures++;
+	}
+}
+
+// Element 0 of a scalar, or the element of an array, as print shows it.
+static string GetValue(ParserManager* manager, const char* name, int index)
+{
+	string varName(name);
+	Variable* var = GetVariables(manager)->GetVariable(varName);
+
+	return var ? var->Get(index) : string("-");
+}
+
+static int GetSize(ParserManager* manager, const char* name)
+{
+	string varName(name);
+	Variable* var = GetVariables(manager)->GetVariable(varName);
+
+	return var ? (int)var->value.size() : -1;
+}
+
+static void DumpTree(Node& node, int depth, stringstream& out)
+{
+	out << depth << " " << node.type << " '" << node.value << "' " << node.complete << node.closed << "\n";
+	for(unsigned int i = 0; i < node.nodes.size(); i++)
+		DumpTree(node.nodes[i], depth + 1, out);
+}
+
+// Replace the first find in text and in the program of manager. Returns what EditSyntax returned.
+static bool Edit(ParserManager* manager, string& text, const string& find, const string& replace)
+{
+	size_t offset = text.find(find);
+	text.replace(offset, find.size(), replace);
+
+	return EditSyntax(manager, (int)offset, (int)find.size(), const_cast<char*>(replace.c_str()));
+}
+
+// The tree of manager must be the tree a new parse of text gives.
+static void CheckTree(ParserManager* manager, char* grammar, const string& text, const char* test)
+{
+	ParserManager* fresh = CreateParserManager();
+	InitializeParser(fresh, grammar);
+	ParseSyntax(fresh, const_cast<char*>(text.c_str()));
+
+	stringstream edited;
+	stringstream parsed;
+	DumpTree(*manager->GetParser()->GetNodes(), 0, edited);
+	DumpTree(*fresh->GetParser()->GetNodes(), 0, parsed);
+	Check(edited.str() == parsed.str(), test, "the tree differs from a new parse");
+
+	DeleteParserManager(fresh);
+
+	// execute_program reads the variables of the last parser set up.
+	variablesPtr = GetVariables(manager);
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: EditTests <tests/grammar.txt>\n");
+		return 1;
+	}
+
+	ParserManager* manager = CreateParserManager();
+	if(!InitializeParser(manager, argv[1]))
+		return 1;
+	variablesPtr = GetVariables(manager);
+
+	string text(PROGRAM);
+	ParseSyntax(manager, const_cast<char*>(text.c_str()));
+	Check(ExecuteProgram(manager), "parse", "ExecuteProgram failed");
+	Check(GetValue(manager, "a", 0) == "5", "parse", "a is not 5");
+	Check(GetValue(manager, "b", 0) == "6", "parse", "b is not 6");
+	Check(GetValue(manager, "x", 1) == "7", "parse", "x[1] is not 7");
+
+	// A constant changed inside a statement is parsed as that statement alone.
+	Check(Edit(manager, text, "a * 3", "a * 4"), "constant", "the edit was not incremental");
+	Check(ExecuteProgram(manager), "constant", "ExecuteProgram failed");
+	Check(GetValue(manager, "b", 0) == "8", "constant", "b is not 8");
+	Check(GetValue(manager, "x", 1) == "9", "constant", "x[1] is not 9");
+	CheckTree(manager, argv[1], text, "constant");
+
+	// The statement inside the loop. Whether it is parsed alone or with the whole program, the
+	// result must be the same.
+	Edit(manager, text, "a + 1;", "a + 2;");
+	Check(ExecuteProgram(manager), "loop body", "ExecuteProgram failed");
+	Check(GetValue(manager, "a", 0) == "6", "loop body", "a is not 6");
+	CheckTree(manager, argv[1], text, "loop body");
+
+	// A new statement changes the lines, so the whole program is parsed again.
+	Check(!Edit(manager, text, " print b;", " b = b - x[1];\n print b;"), "new statement", "the edit was incremental");
+	Check(ExecuteProgram(manager), "new statement", "ExecuteProgram failed");
+	Check(GetValue(manager, "b", 0) == "-1", "new statement", "b is not -1");
+	CheckTree(manager, argv[1], text, "new statement");
+
+	// A program ending inside a statement is not run until the statement is finished.
+	Edit(manager, text, " print b;\n}\n", " print b");
+	Check(!ExecuteProgram(manager), "open statement", "a program ending inside a statement was run");
+	Edit(manager, text, " print b", " print b;\n}\n");
+	Check(ExecuteProgram(manager), "open statement", "ExecuteProgram failed once the statement was finished");
+	Check(GetValue(manager, "x", 1) == "9", "open statement", "x[1] is not 9");
+	CheckTree(manager, argv[1], text, "open statement");
+
+	// An index past the end stops the program with INDEX_ERROR, and grows the array with INDEX_GROW.
+	SetIndexPolicy(manager, INDEX_ERROR);
+	Edit(manager, text, "x[1] = b + 1;", "x[5] = b + 1;");
+	Check(ExecuteProgram(manager), "index policy", "ExecuteProgram failed");
+	Check(GetSize(manager, "x") == 4, "index policy", "x grew with INDEX_ERROR");
+	SetIndexPolicy(manager, INDEX_GROW);
+	Check(ExecuteProgram(manager), "index policy", "ExecuteProgram failed");
+	Check(GetSize(manager, "x") == 6, "index policy", "x did not grow with INDEX_GROW");
+	CheckTree(manager, argv[1], text, "index policy");
+
+	DeleteParserManager(manager);
+
+	if(!s_failures)
+		printf("All edit tests passed.\n");
+
+	return s_failures;
+}
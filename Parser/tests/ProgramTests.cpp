@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: ProgramTests.cpp
+//
+// Regression tests for the parse engines. Each program is parsed from its file
+// with the grammar and the PARSE_ENGINE_* given, compiled and run, and what it
+// prints must be the text of the file with .expected added to its name. Blank
+// lines are left out of both.
+//
+//	ProgramTests <grammar> <engine> <program>...
+//
+// The programs of grammar_ll1.txt are run with PARSE_ENGINE_LL1, and those of
+// the left recursive grammar_left.txt with PARSE_ENGINE_LALR:
+//
+//	ProgramTests tests/grammar_ll1.txt 1 tests/ll1_test01.txt tests/ll1_test02.txt tests/ll1_test03.txt
+//	ProgramTests tests/grammar_left.txt 3 tests/left_test01.txt tests/left_test02.txt
+//
+// Prints a line for every program that fails and returns the number of them.
+////////////////////////////////////////////////////////////////////////////////
+#include "../ParserManager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// The lines of text which are not blank.
+static string TrimBlankLines(const string& text)
+{
+	stringstream in(text);
+	string trimmed;
+	string line;
+	while(getline(in, line))
+	{
+		if(line.find_first_not_of(" \t\r") != string::npos)
+			trimmed.append(line).append("\n");
+	}
+
+	return trimmed;
+}
+
+static bool RunTest(char* grammar, int engine, char* program)
+{
+	ifstream file((string(program) + ".expected").c_str());
+	if(!file)
+	{
+		printf("FAIL %s: no .expected file\n", program);
+		return false;
+	}
+	stringstream expected;
+	expected << file.rdbuf();
+
+	ParserManager* manager = CreateParserManager();
+	SetGrammarImagePath(manager, const_cast<char*>(""));
+	if(!InitializeParser(manager, grammar) || !manager->LoadProgram(program))
+	{
+		printf("FAIL %s: the grammar or the program could not be loaded\n", program);
+		DeleteParserManager(manager);
+		return false;
+	}
+
+	CompleteParser* parser = manager->GetParser();
+	parser->SetParseEngine(engine);
+	variablesPtr = parser->GetVariables();
+
+	// A grammar the engine does not accept would be parsed by matching instead.
+	bool passed = (parser->GetParseEngine() == engine);
+	if(!passed)
+		printf("FAIL %s: the grammar is not accepted by engine %d\n", program, engine);
+
+	stringstream output;
+	if(passed)
+	{
+		streambuf* console = cout.rdbuf(output.rdbuf());
+		manager->Run();
+		statementNode* compiled = parser->Compile();
+		if(compiled)
+		{
+			parser->RunProgram(compiled);
+			parser->ShutdownProgram(compiled);
+		}
+		cout.rdbuf(console);
+
+		passed = (compiled != 0);
+		if(!passed)
+			printf("FAIL %s: the program was not compiled\n", program);
+	}
+
+	if(passed && TrimBlankLines(output.str()) != TrimBlankLines(expected.str()))
+	{
+		printf("FAIL %s: the output differs\n%s", program, output.str().c_str());
+		passed = false;
+	}
+
+	DeleteParserManager(manager);
+
+	return passed;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 4)
+	{
+		printf("usage: ProgramTests <grammar> <engine> <program>...\n");
+		return 1;
+	}
+
+	int engine = atoi(argv[2]);
+	int failures = 0;
+	for(int i = 3; i < argc; i++)
+	{
+		if(!RunTest(argv[1], engine, argv[i]))
+			failures++;
+	}
+
+	if(!failures)
+		printf("All %d programs passed.\n", argc - 3);
+
+	return failures;
+}
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: EditReparse.cpp
+//
+// Changes a constant in the middle of a program and runs it again, once with
+// EditSyntax and once by parsing the whole edited text with ParseSyntax, and
+// prints the time of each.
+//
+//	EditReparse <tests/grammar.txt> [statements] [edits]
+//
+// The program has 2000 statements by default and is edited 200 times. Each
+// time includes ExecuteProgram. The program has no loops, so only the edited
+// line is lowered again, but the whole program still runs.
+////////////////////////////////////////////////////////////////////////////////
+#include "../../ParserManager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+// Assignments and array stores, with the edited statement in the middle.
+static string MakeProgram(int statements, size_t& editOffset)
+{
+	static const char* STATEMENTS[] =
+	{
+		" a = 3;\n",
+		" b = a + 2 * c;\n",
+		" x[3] = b - a;\n"
+	};
+
+	string text("VAR\n a, b, c;\n x : ARRAY[4];\n{\n");
+	for(int i = 0; i < statements; i++)
+	{
+		if(i == statements / 2)
+		{
+			text.append(" c = b + 1;\n");
+			editOffset = text.size() - 4;
+		}
+		text.append(STATEMENTS[i % 3]);
+	}
+	text.append(" print b;\n}\n");
+
+	return text;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: EditReparse <tests/grammar.txt> [statements] [edits]\n");
+		return 1;
+	}
+
+	int statements = (argc > 2) ? atoi(argv[2]) : 2000;
+	int edits = (argc > 3) ? atoi(argv[3]) : 200;
+
+	ParserManager* manager = CreateParserManager();
+	if(!InitializeParser(manager, argv[1]))
+		return 1;
+
+	// execute_program reads the variables of the last parser set up.
+	variablesPtr = GetVariables(manager);
+
+	size_t editOffset = 0;
+	string text = MakeProgram(statements, editOffset);
+	const char* digits[] = { "2", "1" };
+
+	// Each edit swaps the constant of "c = b + 1;" and runs the program.
+	ParseSyntax(manager, const_cast<char*>(text.c_str()));
+	int incremental = 0;
+	clock_t start = clock();
+	for(int i = 0; i < edits; i++)
+	{
+		if(EditSyntax(manager, (int)editOffset, 1, const_cast<char*>(digits[i % 2])))
+			incremental++;
+		ExecuteProgram(manager);
+	}
+	double editMs = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+	start = clock();
+	for(int i = 0; i < edits; i++)
+	{
+		text.replace(editOffset, 1, digits[i % 2]);
+		ParseSyntax(manager, const_cast<char*>(text.c_str()));
+		ExecuteProgram(manager);
+	}
+	double parseMs = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+	DeleteParserManager(manager);
+
+	printf("%d statements, %d edits (%d incremental)\n", statements + 2, edits, incremental);
+	printf("EditSyntax  %10.3f ms per edit\n", editMs / edits);
+	printf("ParseSyntax %10.3f ms per edit\n", parseMs / edits);
+	printf("speedup     %10.1fx\n", parseMs / (editMs ? editMs : 1.0));
+
+	return 0;
+}
@@ -0,0 +1,153 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: Interpreters.cpp
+//
+// Runs loops of growing length with execute_program, with the byte code and
+// with native code, and prints the time of each.
+//
+//	Interpreters <tests/grammar.txt> [iterations] [runs]
+//
+// Every loop is run 10 to iterations times, 1,000,000 by default, and the best
+// of 3 runs is printed. The program is parsed again before each run, so every
+// run starts from new variables. Only the run is timed, lowering is not.
+////////////////////////////////////////////////////////////////////////////////
+#include "../../ParserManager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#define ENGINE_TREE		0
+#define ENGINE_BYTECODE	1
+#define ENGINE_NATIVE	2
+
+struct Loop
+{
+	const char* name;
+	const char* declarations;
+	const char* body;
+};
+
+// Each body runs while i < n and prints s once the loop is done.
+static const Loop LOOPS[] =
+{
+	{ "integer", " i, n, s : PRIM_INT;\n", "  s = s + i * 3 - s / 7;\n" },
+	{ "real", " i, n : PRIM_INT;\n s : PRIM_REAL;\n", "  s = s * 0.5 + i;\n" },
+	{ "array", " i, n, s : PRIM_INT;\n a : ARRAY[64];\n", "  a[i - i / 64 * 64] = i;\n  s = s + a[i / 2 - i / 128 * 64];\n" }
+};
+
+static string MakeProgram(const Loop& loop, int iterations)
+{
+	char count[32];
+	sprintf(count, "%d", iterations);
+
+	string text("VAR\n");
+	text.append(loop.declarations);
+	text.append("{\n i = 0;\n s = 0;\n n = ");
+	text.append(count);
+	text.append(";\n WHILE i < n {\n");
+	text.append(loop.body);
+	text.append("  i = i + 1;\n }\n print s;\n}\n");
+
+	return text;
+}
+
+// The time of one run of text with engine, or a negative time if it can not run with it.
+static double Run(ParserManager* manager, const string& text, int engine)
+{
+	ParseSyntax(manager, const_cast<char*>(text.c_str()));
+	statementNode* program = manager->GetParser()->GetProgram();
+	if(program == NULL)
+		return -1.0;
+
+	ByteCode byteCode(GetVariables(manager));
+	if(engine != ENGINE_TREE)
+	{
+		byteCode.SetNativeCode(engine == ENGINE_NATIVE);
+		if(!byteCode.Lower(program) || byteCode.IsNative() != (engine == ENGINE_NATIVE))
+			return -1.0;
+	}
+
+	clock_t start = clock();
+	if(engine == ENGINE_TREE)
+		execute_program(program);
+	else
+		byteCode.Execute();
+
+	return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: Interpreters <tests/grammar.txt> [iterations] [runs]\n");
+		return 1;
+	}
+
+	int iterations = (argc > 2) ? atoi(argv[2]) : 1000000;
+	int runs = (argc > 3) ? atoi(argv[3]) : 3;
+
+	ParserManager* manager = CreateParserManager();
+	if(!InitializeParser(manager, argv[1]))
+		return 1;
+
+	// execute_program reads the variables of the last parser set up.
+	variablesPtr = GetVariables(manager);
+
+	const char* names[] = { "tree", "byte code", "native" };
+	double results[3][16][3];
+	int sizes = 0;
+
+	for(int size = 10; size <= iterations && sizes < 16; size *= 10, sizes++)
+	{
+		for(int l = 0; l < 3; l++)
+		{
+			string text = MakeProgram(LOOPS[l], size);
+			for(int e = 0; e < 3; e++)
+			{
+				double best = -1.0;
+				for(int run = 0; run < runs; run++)
+				{
+					double ms = Run(manager, text, e);
+					if(ms >= 0.0 && (best < 0.0 || ms < best))
+						best = ms;
+				}
+				results[l][sizes][e] = best;
+			}
+		}
+	}
+
+	DeleteParserManager(manager);
+
+	// The results are printed after the programs, which print s.
+	printf("\n%-8s %10s", "loop", "iterations");
+	for(int e = 0; e < 3; e++)
+		printf(" %12s", names[e]);
+	printf(" %10s %10s\n", "tree/byte", "tree/nat");
+
+	for(int l = 0; l < 3; l++)
+	{
+		int size = 10;
+		for(int s = 0; s < sizes; s++, size *= 10)
+		{
+			printf("%-8s %10d", LOOPS[l].name, size);
+			for(int e = 0; e < 3; e++)
+			{
+				if(results[l][s][e] < 0.0)
+					printf(" %12s", "-");
+				else
+					printf(" %9.3f ms", results[l][s][e]);
+			}
+
+			for(int e = 1; e < 3; e++)
+			{
+				if(results[l][s][e] > 0.0 && results[l][s][0] >= 0.0)
+					printf(" %9.1fx", results[l][s][0] / results[l][s][e]);
+				else
+					printf(" %10s", "-");
+			}
+			printf("\n");
+		}
+	}
+
+	return 0;
+}
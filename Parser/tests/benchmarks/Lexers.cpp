@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: Lexers.cpp
+//
+// Tokenizes one program with the DFA of Lexer alone, then parses it with
+// LEXER_DFA and with LEXER_LEGACY, and prints the time of each. The legacy
+// lexer hands each token to the parser as it finds it, so it is only timed
+// with the parse. Both parses use the same engine, so the difference between
+// them is the difference between the lexers.
+//
+//	Lexers <tests/grammar.txt> [statements] [runs] [engine]
+//
+// The program has 20,000 statements by default, and the best of 5 runs is
+// printed for each. engine is one of the PARSE_ENGINE_* values,
+// PARSE_ENGINE_LALR by default, as it spends the least time on each token.
+////////////////////////////////////////////////////////////////////////////////
+#include "../../ParserManager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+
+// Assignments, array stores, conditions and prints, with names and numbers of several lengths.
+static string MakeProgram(int statements)
+{
+	static const char* STATEMENTS[] =
+	{
+		" alpha = 314;\n",
+		" beta = alpha + 2 * counter - 17;\n",
+		" values[3] = beta - alpha / 4;\n",
+		" IF beta > 1000 { counter = counter - 1; }\n",
+		" print beta;\n"
+	};
+
+	string text("VAR\n alpha, beta, counter;\n values : ARRAY[10];\n{\n");
+	for(int i = 0; i < statements; i++)
+		text.append(STATEMENTS[i % 5]);
+	text.append("}\n");
+
+	return text;
+}
+
+// The terminals of a grammar file are its second section, which ends with a '#'.
+static bool ReadTerminals(const char* filePath, list<string>& terminals)
+{
+	ifstream file(filePath);
+	string word;
+	int section = 0;
+	while(section < 2 && file >> word)
+	{
+		if(word == "#")
+			section++;
+		else if(section == 1)
+			terminals.push_back(word);
+	}
+
+	return !terminals.empty();
+}
+
+// The best time of runs parses of text, in ms.
+static double TimeParse(CompleteParser* parser, const string& text, int lexer, int runs)
+{
+	parser->SetLexer(lexer);
+
+	double best = 0;
+	for(int run = 0; run < runs; run++)
+	{
+		clock_t start = clock();
+		parser->ParseProgram(text);
+		double ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+		if(parser->GetNodes()->nodes.empty())
+			return -1;
+		if(!run || ms < best)
+			best = ms;
+	}
+
+	return best;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: Lexers <tests/grammar.txt> [statements] [runs] [engine]\n");
+		return 1;
+	}
+
+	int statements = (argc > 2) ? atoi(argv[2]) : 20000;
+	int runs = (argc > 3) ? atoi(argv[3]) : 5;
+	string text = MakeProgram(statements);
+
+	list<string> terminals;
+	Lexer lexer;
+	if(!ReadTerminals(argv[1], terminals) || !lexer.Initialize(terminals))
+		return 1;
+
+	double tokenizeMs = 0;
+	vector<LexToken> tokens;
+	for(int run = 0; run < runs; run++)
+	{
+		tokens.clear();
+		clock_t start = clock();
+		lexer.Tokenize(text.c_str(), text.size(), tokens);
+		double ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+		if(!run || ms < tokenizeMs)
+			tokenizeMs = ms;
+	}
+
+	ParserManager manager;
+	if(!manager.Initialize(argv[1]))
+		return 1;
+
+	CompleteParser* parser = manager.GetParser();
+	parser->SetParseEngine((argc > 4) ? atoi(argv[4]) : PARSE_ENGINE_LALR);
+
+	double dfaMs = TimeParse(parser, text, LEXER_DFA, runs);
+	double legacyMs = TimeParse(parser, text, LEXER_LEGACY, runs);
+	if(dfaMs < 0 || legacyMs < 0)
+	{
+		printf("the program did not parse\n");
+		return 1;
+	}
+
+	double megabytes = text.size() / (1024.0 * 1024.0);
+	printf("%d statements, %d bytes, %d tokens\n", statements, (int)text.size(), (int)tokens.size());
+	printf("%-22s %10.2f ms %10.1f MB/s\n", "Lexer::Tokenize", tokenizeMs, tokenizeMs > 0 ? megabytes * 1000.0 / tokenizeMs : 0.0);
+	printf("%-22s %10.2f ms\n", "parse, LEXER_DFA", dfaMs);
+	printf("%-22s %10.2f ms\n", "parse, LEXER_LEGACY", legacyMs);
+	printf("%-22s %10.2f ms\n", "lexer difference", legacyMs - dfaMs);
+
+	manager.Shutdown();
+
+	return 0;
+}
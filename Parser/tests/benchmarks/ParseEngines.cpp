@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: ParseEngines.cpp
+//
+// Parses one program with every engine which accepts grammarFull.txt and
+// compares the time and the tree of each with the compiled in GrammarFullParser.
+//
+//	ParseEngines <grammarFull.txt> [blocks] [runs]
+//
+// The program repeats a block of seven statements, 200 times by default. The
+// best of 3 runs is printed for each engine. The matcher gives terminals sharing
+// a token the first symbol of that token and leaves the program node open, so
+// its tree is expected to differ.
+////////////////////////////////////////////////////////////////////////////////
+#include "../../ParserManager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+
+static const char* BLOCK =
+	" a = b + c * ( a - r ) / b;\n"
+	" WHILE a > b { a = a - c; print a; }\n"
+	" IF a <> c { print a, b; } ELSE IF a < c { print c; } ELSE { print debug; }\n"
+	" IF r { print r; }\n";
+
+static string MakeProgram(int blocks)
+{
+	string text("VAR\n a, b, c : INT;\n r : REAL;\n{\n");
+	for(int i = 0; i < blocks; i++)
+		text.append(BLOCK);
+	text.append("}\n");
+
+	return text;
+}
+
+// Symbols, values and flags of every node, in order.
+static void DumpTree(Node& node, int depth, stringstream& out)
+{
+	out << depth << " " << node.type << " '" << node.value << "' " << node.complete << node.closed << "\n";
+	for(unsigned int i = 0; i < node.nodes.size(); i++)
+		DumpTree(node.nodes[i], depth + 1, out);
+}
+
+static int CountNodes(Node& node)
+{
+	int count = 1;
+	for(unsigned int i = 0; i < node.nodes.size(); i++)
+		count += CountNodes(node.nodes[i]);
+
+	return count;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: ParseEngines <grammarFull.txt> [blocks] [runs]\n");
+		return 1;
+	}
+
+	int blocks = (argc > 2) ? atoi(argv[2]) : 200;
+	int runs = (argc > 3) ? atoi(argv[3]) : 3;
+
+	ParserManager manager;
+	if(!manager.Initialize(argv[1]))
+		return 1;
+
+	CompleteParser* parser = manager.GetParser();
+	string text = MakeProgram(blocks);
+
+	const int engines[] = { PARSE_ENGINE_GENERATED, PARSE_ENGINE_LALR, PARSE_ENGINE_MATCH };
+	const char* names[] = { "generated", "lalr", "match" };
+	string expected;
+
+	printf("%d statements\n", blocks * 7);
+	for(int e = 0; e < 3; e++)
+	{
+		parser->SetParseEngine(engines[e]);
+		if(parser->GetParseEngine() != engines[e])
+		{
+			printf("%-10s not available for this grammar\n", names[e]);
+			continue;
+		}
+
+		double best = 0.0;
+		for(int run = 0; run < runs; run++)
+		{
+			clock_t start = clock();
+			parser->ParseProgram(text);
+			double ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+			if(run == 0 || ms < best)
+				best = ms;
+		}
+
+		stringstream tree;
+		DumpTree(*parser->GetNodes(), 0, tree);
+		if(e == 0)
+			expected = tree.str();
+
+		printf("%-10s %10.2f ms %8d nodes  %s\n", names[e], best, CountNodes(*parser->GetNodes()),
+			(tree.str() == expected) ? "same tree" : "different tree");
+	}
+
+	manager.Shutdown();
+
+	return 0;
+}
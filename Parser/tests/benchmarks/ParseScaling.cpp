@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: ParseScaling.cpp
+//
+// Parses programs of 100 to 100,000 statements and prints the time per
+// statement, which stays flat while parsing is linear in program length.
+//
+//	ParseScaling <tests/grammar.txt> [statements] [engine]
+//
+// statements is the largest program, 100,000 by default. engine is one of the
+// PARSE_ENGINE_* values, the rule matcher by default. Every statement nests
+// another stmt_list node and the tree is walked recursively, so 100,000
+// statements need about 12 MB of stack. ParserTests.vcxproj reserves 16 MB.
+////////////////////////////////////////////////////////////////////////////////
+#include "../../ParserManager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+// Assignments, array stores and prints, in turn.
+static string MakeProgram(int statements)
+{
+	static const char* STATEMENTS[] =
+	{
+		" a = 3;\n",
+		" b = a + 2 * c;\n",
+		" x[3] = b - a;\n",
+		" print b;\n"
+	};
+
+	string text("VAR\n a, b, c;\n x : ARRAY[10];\n{\n");
+	for(int i = 0; i < statements; i++)
+		text.append(STATEMENTS[i % 4]);
+	text.append("}\n");
+
+	return text;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: ParseScaling <tests/grammar.txt> [statements] [engine]\n");
+		return 1;
+	}
+
+	int largest = (argc > 2) ? atoi(argv[2]) : 100000;
+
+	ParserManager manager;
+	if(!manager.Initialize(argv[1]))
+		return 1;
+
+	CompleteParser* parser = manager.GetParser();
+	parser->SetParseEngine((argc > 3) ? atoi(argv[3]) : PARSE_ENGINE_MATCH);
+
+	printf("%10s %12s %14s\n", "statements", "ms", "us/statement");
+	for(int statements = 100; statements <= largest; statements *= 10)
+	{
+		string text = MakeProgram(statements);
+
+		clock_t start = clock();
+		parser->ParseProgram(text);
+		double ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+		if(parser->GetNodes()->nodes.empty())
+		{
+			printf("%10d did not parse\n", statements);
+			return 1;
+		}
+
+		printf("%10d %12.1f %14.2f\n", statements, ms, ms * 1000.0 / statements);
+	}
+
+	manager.Shutdown();
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: VariableLookup.cpp
+//
+// Declares 1,000 to 100,000 variables in the Variables of a parser and looks
+// every one up by name, and prints the time of each declaration and lookup.
+//
+//	VariableLookup <tests/grammar.txt> [variables] [runs]
+//
+// variables is the largest table, 100,000 by default. The names are looked up
+// in the order they were added and then in a scattered order, and the best of
+// 3 runs is printed, with the searches of Variables made by each lookup. Their
+// number stays the same however large the table is. What grows in the scattered
+// order is the cost of cache misses once the table no longer fits in the cache.
+////////////////////////////////////////////////////////////////////////////////
+#include "../../ParserManager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+static string MakeName(int index)
+{
+	char name[32];
+	sprintf(name, "var%d", index);
+
+	return string(name);
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: VariableLookup <tests/grammar.txt> [variables] [runs]\n");
+		return 1;
+	}
+
+	int largest = (argc > 2) ? atoi(argv[2]) : 100000;
+	int runs = (argc > 3) ? atoi(argv[3]) : 3;
+
+	ParserManager* manager = CreateParserManager();
+	if(!InitializeParser(manager, argv[1]))
+		return 1;
+
+	Variables* variables = GetVariables(manager);
+	string type("PRIM_INT");
+
+	printf("%10s %10s %14s %14s %10s\n", "variables", "add (us)", "in order (us)", "scattered (us)", "searches");
+	for(int count = 1000; count <= largest; count *= 10)
+	{
+		vector<string> names;
+		for(int i = 0; i < count; i++)
+			names.push_back(MakeName(i));
+
+		double bestAdd = 0.0;
+		double bestOrdered = 0.0;
+		double bestLookup = 0.0;
+		double searches = 0.0;
+		int found = 0;
+		for(int run = 0; run < runs; run++)
+		{
+			variables->Clear();
+
+			clock_t start = clock();
+			for(int i = 0; i < count; i++)
+				variables->AddVariable(names[i], type);
+			double add = (double)(clock() - start) * 1000000.0 / CLOCKS_PER_SEC / count;
+
+			start = clock();
+			for(int i = 0; i < count; i++)
+				variables->GetVariable(names[i]);
+			double ordered = (double)(clock() - start) * 1000000.0 / CLOCKS_PER_SEC / count;
+
+			// A stride prime to count visits every name once, out of the order they were added.
+			found = 0;
+			unsigned long long lookups = variables->GetLookupCount();
+			start = clock();
+			for(int i = 0; i < count; i++)
+			{
+				if(variables->GetVariable(names[(int)(((long long)i * 7919) % count)]) != NULL)
+					found++;
+			}
+			double lookup = (double)(clock() - start) * 1000000.0 / CLOCKS_PER_SEC / count;
+			searches = (double)(variables->GetLookupCount() - lookups) / count;
+
+			if(run == 0 || add < bestAdd)
+				bestAdd = add;
+			if(run == 0 || ordered < bestOrdered)
+				bestOrdered = ordered;
+			if(run == 0 || lookup < bestLookup)
+				bestLookup = lookup;
+		}
+
+		printf("%10d %10.3f %14.3f %14.3f %10.2f%s\n", count, bestAdd, bestOrdered, bestLookup, searches, (found == count) ? "" : "  (not all found)");
+	}
+
+	DeleteParserManager(manager);
+
+	return 0;
+}